@@ -19,6 +19,14 @@ void tb_flush(CPUState *cpu)
 {
 }
 
+void tb_jmp_cache_init(CPUState *cpu)
+{
+}
+
+void tb_jmp_cache_destroy(CPUState *cpu)
+{
+}
+
 void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
 {
 }
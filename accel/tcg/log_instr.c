@@ -35,6 +35,8 @@
 #include "qemu/osdep.h"
 #include "qemu/range.h"
 #include "qemu/log.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
 #include "qapi/error.h"
 #include "cpu-param.h"
 #include "cpu.h"
@@ -43,6 +45,7 @@
 #include "exec/helper-proto.h"
 #include "exec/log_instr.h"
 #include "exec/log_instr_internal.h"
+#include "exec/log_instr_fast.h"
 #include "exec/memop.h"
 #include "disas/disas.h"
 #include "exec/translator.h"
@@ -104,10 +107,14 @@ static void emit_nop_entry(CPUArchState *env, cpu_log_entry_t *entry);
  * Existing format callbacks list, indexed by qemu_log_instr_backend_t.
  */
 static trace_backend_hooks_t trace_backends[] = {
-    { .init = NULL, .sync = NULL, .emit_instr = emit_text_instr },
+    { .init = init_text_backend,
+      .sync = sync_text_backend,
+      .emit_instr = emit_text_instr,
+      .after_fork = reopen_text_backend },
     { .init = emit_cvtrace_header,
       .sync = NULL,
-      .emit_instr = emit_cvtrace_entry },
+      .emit_instr = emit_cvtrace_entry,
+      .after_fork = reopen_cvtrace_backend },
     { .init = NULL, .sync = NULL, .emit_instr = emit_nop_entry },
 #ifdef CONFIG_TRACE_PERFETTO
     { .init = init_perfetto_backend,
@@ -120,14 +127,16 @@ static trace_backend_hooks_t trace_backends[] = {
 #ifdef CONFIG_TRACE_PROTOBUF
     { .init = init_protobuf_backend,
       .sync = sync_protobuf_backend,
-      .emit_instr = emit_protobuf_entry },
+      .emit_instr = emit_protobuf_entry,
+      .after_fork = reopen_protobuf_backend },
 #else
     {0},
 #endif
 #ifdef CONFIG_TRACE_JSON
     { .init = init_json_backend,
       .sync = sync_json_backend,
-      .emit_instr = emit_json_entry },
+      .emit_instr = emit_json_entry,
+      .after_fork = reopen_json_backend },
 #else
     {0},
 #endif
@@ -135,10 +144,15 @@ static trace_backend_hooks_t trace_backends[] = {
     { .init = init_drcachesim_backend,
       .sync = NULL,
       .emit_debug = NULL,
-      .emit_instr = emit_drcachesim_entry },
+      .emit_instr = emit_drcachesim_entry,
+      .after_fork = reopen_drcachesim_backend },
 #else
     {0},
 #endif
+    { .init = init_cvtrace2_backend,
+      .sync = sync_cvtrace2_backend,
+      .emit_instr = emit_cvtrace2_entry,
+      .after_fork = reopen_cvtrace2_backend },
 };
 
 /* Existing trace filters list, indexed by cpu_log_instr_filter_t */
@@ -154,6 +168,13 @@ static unsigned long reset_entry_buffer_size = MIN_ENTRY_BUFFER_SIZE;
 
 static bool trace_debug;
 
+/* Capture register values on commit, see qemu_log_instr_lazy_regs() */
+static bool lazy_regs;
+
+/* Guest context allow-lists for LOG_INSTR_FILTER_CONTEXT, arrays of uint64_t */
+static GArray *ctx_filter_pid;
+static GArray *ctx_filter_cid;
+
 static void emit_nop_entry(CPUArchState *env, cpu_log_entry_t *entry)
 {
     return;
@@ -175,6 +196,9 @@ static void dump_debug_stats(CPUState *cpu)
     if (stats->trace_start != stats->trace_stop) {
         fprintf(stderr, "Unbalanced trace stop: %lu\n", stats->trace_stop);
     }
+    if (stats->fast_dropped) {
+        fprintf(stderr, "fast records dropped: %lu\n", stats->fast_dropped);
+    }
 }
 
 void qemu_log_instr_enable_trace_debug()
@@ -182,6 +206,16 @@ void qemu_log_instr_enable_trace_debug()
     trace_debug = true;
 }
 
+void qemu_log_instr_enable_lazy_regs(void)
+{
+    lazy_regs = true;
+}
+
+bool qemu_log_instr_lazy_regs_enabled(void)
+{
+    return lazy_regs;
+}
+
 static void emit_regdump_event(CPUArchState *env, cpu_log_entry_t *entry)
 {
     log_event_t event;
@@ -264,6 +298,27 @@ static void reset_log_buffer(cpu_log_instr_state_t *cpulog,
     cpulog->starting = false;
 }
 
+/*
+ * Track the guest context from context switch events, so that filters and
+ * backends can attribute each entry to a process and compartment.
+ */
+static void update_entry_context(cpu_log_instr_state_t *cpulog,
+                                 cpu_log_entry_t *entry)
+{
+    log_event_t *evt;
+    int i;
+
+    for (i = 0; i < entry->events->len; i++) {
+        evt = &g_array_index(entry->events, log_event_t, i);
+        if (evt->id == LOG_EVENT_CTX_UPDATE) {
+            cpulog->ctx_pid = evt->ctx_update.pid;
+            cpulog->ctx_cid = evt->ctx_update.cid;
+        }
+    }
+    entry->ctx_pid = cpulog->ctx_pid;
+    entry->ctx_cid = cpulog->ctx_cid;
+}
+
 /* Common instruction commit implementation */
 
 static void do_instr_commit(CPUArchState *env)
@@ -279,6 +334,8 @@ static void do_instr_commit(CPUArchState *env)
     if (cpulog->force_drop)
         return;
 
+    update_entry_context(cpulog, entry);
+
     for (i = 0; i < cpulog->filters->len; i++) {
         filter = g_array_index(cpulog->filters, cpu_log_instr_filter_fn_t, i);
         if (!filter(entry)) {
@@ -312,7 +369,7 @@ static void do_cpu_loglevel_switch(CPUState *cpu, run_on_cpu_data data)
 {
     CPUArchState *env = cpu->env_ptr;
     cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
     qemu_log_instr_loglevel_t prev_level = cpulog->loglevel;
     bool prev_level_active = cpulog->loglevel_active;
     qemu_log_next_level_arg_t *arg = data.host_ptr;
@@ -321,6 +378,10 @@ static void do_cpu_loglevel_switch(CPUState *cpu, run_on_cpu_data data)
 
     log_assert(qemu_loglevel_mask(CPU_LOG_INSTR));
 
+    /* The pending fast logging records belong to the previous level */
+    qemu_log_instr_fast_rewind(env);
+    entry = get_cpu_log_entry(env);
+
     /* Decide whether we have to pause/resume logging */
     switch (arg->next_level) {
     case QEMU_LOG_INSTR_LOGLEVEL_NONE:
@@ -499,6 +560,41 @@ static void qemu_log_entry_destroy(gpointer data)
     g_array_free(entry->events, true);
 }
 
+/* Backends that can use the instruction dictionary */
+static bool insn_dict_backend_supported(void)
+{
+    switch (qemu_log_instr_backend) {
+#ifdef CONFIG_TRACE_PROTOBUF
+    case QEMU_LOG_INSTR_BACKEND_PROTOBUF:
+#endif
+#ifdef CONFIG_TRACE_JSON
+    case QEMU_LOG_INSTR_BACKEND_JSON:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Fast logging is limited to the backends with fixed-size records, which
+ * do not use the extra text that it does not record.
+ */
+static bool fast_backend_supported(void)
+{
+    switch (qemu_log_instr_backend) {
+    case QEMU_LOG_INSTR_BACKEND_CVTRACE:
+    case QEMU_LOG_INSTR_BACKEND_CVTRACE2:
+    case QEMU_LOG_INSTR_BACKEND_NOP:
+#ifdef CONFIG_TRACE_DRCACHESIM
+    case QEMU_LOG_INSTR_BACKEND_DRCACHESIM:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
 /*
  * This must be called upon cpu creation.
  * Initializes the per-CPU logging state and data structures.
@@ -530,11 +626,66 @@ void qemu_log_instr_init(CPUState *cpu)
     cpulog->instr_info = entry_ring;
     cpulog->ring_head = 0;
     cpulog->ring_tail = 0;
+    cpulog->lazy_regs = 0;
     reset_log_buffer(cpulog, entry);
+    qemu_log_instr_fast_init(cpu);
 
     /* Make sure we are using the correct trace format. */
     if (trace_backend == NULL) {
         trace_backend = &trace_backends[qemu_log_instr_backend];
+        if (qemu_log_instr_split_enabled() &&
+            qemu_log_instr_backend != QEMU_LOG_INSTR_BACKEND_CVTRACE) {
+            error_report("Per-context trace output is only supported by "
+                         "the cvtrace backend");
+            exit(1);
+        }
+        if (qemu_log_instr_text_per_cpu_enabled() &&
+            qemu_log_instr_backend != QEMU_LOG_INSTR_BACKEND_TEXT) {
+            error_report("Per-CPU text trace files are only supported by "
+                         "the text backend");
+            exit(1);
+        }
+        if (qemu_log_instr_chunked_enabled() &&
+            (qemu_log_instr_split_enabled() ||
+             (qemu_log_instr_backend != QEMU_LOG_INSTR_BACKEND_CVTRACE &&
+              qemu_log_instr_backend != QEMU_LOG_INSTR_BACKEND_PROTOBUF &&
+              qemu_log_instr_backend != QEMU_LOG_INSTR_BACKEND_DRCACHESIM))) {
+            error_report("Chunked trace output is only supported by the "
+                         "cvtrace, protobuf and drcachesim backends, "
+                         "without per-context output");
+            exit(1);
+        }
+        if (qemu_log_instr_fast_enabled()) {
+#ifndef TARGET_LOG_INSTR_FAST
+            error_report("Fast instruction logging is not supported by this "
+                         "target");
+            exit(1);
+#endif
+            if (!fast_backend_supported()) {
+                error_report("Fast instruction logging is only supported by "
+                             "the cvtrace, cvtrace2, drcachesim and nop "
+                             "backends");
+                exit(1);
+            }
+        }
+        if (qemu_log_instr_lazy_regs_enabled()) {
+#ifndef TARGET_LOG_INSTR_LAZY_REGS
+            error_report("Lazy register logging is not supported by this "
+                         "target");
+            exit(1);
+#endif
+            if (qemu_log_instr_fast_enabled()) {
+                error_report("Lazy register logging can not be combined with "
+                             "fast instruction logging");
+                exit(1);
+            }
+        }
+        if (qemu_log_instr_insn_dict_enabled() &&
+            !insn_dict_backend_supported()) {
+            error_report("The instruction dictionary is only supported by "
+                         "the json and protobuf backends");
+            exit(1);
+        }
     }
     /* Initialize backend state on this CPU */
     if (trace_backend->init) {
@@ -567,9 +718,11 @@ void qemu_log_instr_init(CPUState *cpu)
 
 static void do_log_backend_sync(CPUState *cpu, run_on_cpu_data _unused)
 {
+    qemu_log_instr_fast_rewind(cpu->env_ptr);
     if (trace_backend->sync != NULL) {
         trace_backend->sync(cpu->env_ptr);
     }
+    qemu_log_instr_chunk_sync(cpu->env_ptr);
     dump_debug_stats(cpu);
 }
 
@@ -585,6 +738,34 @@ void qemu_log_instr_sync_buffers()
     {
         run_on_cpu(cpu, do_log_backend_sync, RUN_ON_CPU_NULL);
     }
+    qemu_log_instr_sync_streams();
+}
+
+char *qemu_log_instr_fork_path(const char *path)
+{
+    return g_strdup_printf("%s.%d", path, (int)getpid());
+}
+
+void qemu_log_instr_check_fork(Error **errp)
+{
+    trace_backend_hooks_t *backend = &trace_backends[qemu_log_instr_backend];
+
+    if (backend->init && backend->after_fork == NULL) {
+        error_setg(errp, "The selected trace backend does not support "
+                   "forked sessions");
+    }
+}
+
+void qemu_log_instr_after_fork(void)
+{
+    if (trace_backend == NULL) {
+        return;
+    }
+    if (trace_backend->after_fork) {
+        trace_backend->after_fork();
+    }
+    qemu_log_instr_chunk_after_fork();
+    qemu_log_instr_split_after_fork();
 }
 
 static void do_log_buffer_resize(CPUState *cpu, run_on_cpu_data data)
@@ -650,7 +831,10 @@ void qemu_log_instr_mode_switch(CPUArchState *env,
                                 qemu_log_instr_cpu_mode_t mode, target_ulong pc)
 {
     cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
     log_assert(cpulog != NULL && "Invalid log state");
     log_assert(entry != NULL && "Invalid log info");
@@ -670,35 +854,62 @@ void qemu_log_instr_mode_switch(CPUArchState *env,
     }
 }
 
+void qemu_log_instr_asid_change(CPUArchState *env)
+{
+    qemu_log_instr_fast_sync(env);
+}
+
 void qemu_log_instr_drop(CPUArchState *env)
 {
     cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
 
     log_assert(cpulog != NULL && "Invalid log state");
 
+    qemu_log_instr_fast_sync(env);
     cpulog->force_drop = true;
+    cpulog->lazy_regs = 0;
 }
 
 void qemu_log_instr_commit(CPUArchState *env)
 {
     cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
     log_assert(cpulog != NULL && "Invalid log state");
     log_assert(entry != NULL && "Invalid log info");
 
+#ifdef TARGET_LOG_INSTR_LAZY_REGS
+    if (cpulog->lazy_regs) {
+        cpu_log_instr_lazy_regs(env, cpulog->lazy_regs);
+        cpulog->lazy_regs = 0;
+    }
+#endif
     do_instr_commit(env);
     /* commit may have advanced to the next entry buffer slot */
     entry = get_cpu_log_entry(env);
     reset_log_buffer(cpulog, entry);
 }
 
+void qemu_log_instr_lazy_regs(CPUArchState *env, uint64_t regs)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+
+    cpulog->lazy_regs = regs;
+}
+
 void qemu_log_instr_reg(CPUArchState *env, const char *reg_name,
                         target_ulong value)
 {
     cpu_log_entry_t *entry = get_cpu_log_entry(env);
     log_reginfo_t r;
 
+    if (qemu_log_instr_fast_append(env, LIF_REG, (uintptr_t)reg_name, value,
+                                   0, NULL, 0)) {
+        return;
+    }
     r.flags = 0;
     r.name = reg_name;
     r.gpr = value;
@@ -719,6 +930,10 @@ void qemu_log_instr_cap(CPUArchState *env, const char *reg_name,
     cpu_log_entry_t *entry = get_cpu_log_entry(env);
     log_reginfo_t r;
 
+    if (qemu_log_instr_fast_append(env, LIF_CAP, (uintptr_t)reg_name, 0, 0,
+                                   cr, sizeof(*cr))) {
+        return;
+    }
     r.flags = LRI_CAP_REG | LRI_HOLDS_CAP;
     r.name = reg_name;
     r.cap = *cr;
@@ -738,6 +953,10 @@ void qemu_log_instr_cap_int(CPUArchState *env, const char *reg_name,
     cpu_log_entry_t *entry = get_cpu_log_entry(env);
     log_reginfo_t r;
 
+    if (qemu_log_instr_fast_append(env, LIF_CAP_INT, (uintptr_t)reg_name,
+                                   value, 0, NULL, 0)) {
+        return;
+    }
     r.flags = LRI_CAP_REG;
     r.name = reg_name;
     r.gpr = value;
@@ -752,6 +971,10 @@ static inline void qemu_log_instr_mem_int(CPUArchState *env, target_ulong addr,
     cpu_log_entry_t *entry = get_cpu_log_entry(env);
     log_meminfo_t m;
 
+    if (qemu_log_instr_fast_append(env, (flags & LMI_ST) ? LIF_STORE : LIF_LOAD,
+                                   addr, value, oi, NULL, 0)) {
+        return;
+    }
     m.flags = flags;
     m.op = get_memop(oi);
     m.addr = addr;
@@ -786,6 +1009,11 @@ static inline void qemu_log_instr_mem_cap(CPUArchState *env, target_ulong addr,
     cpu_log_entry_t *entry = get_cpu_log_entry(env);
     log_meminfo_t m;
 
+    if (qemu_log_instr_fast_append(
+            env, (flags & LMI_ST) ? LIF_STORE_CAP : LIF_LOAD_CAP, addr, 0, 0,
+            value, sizeof(*value))) {
+        return;
+    }
     m.flags = flags;
     m.op = 0;
     m.addr = addr;
@@ -806,30 +1034,60 @@ void qemu_log_instr_st_cap(CPUArchState *env, target_ulong addr,
 }
 #endif
 
-void qemu_log_instr(CPUArchState *env, target_ulong pc, const char *insn,
-                    uint32_t size)
+void qemu_log_instr_paddr(CPUArchState *env, target_ulong pc, hwaddr paddr,
+                          const char *insn, uint32_t size)
 {
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
     entry->pc = pc;
-    entry->paddr = get_paddr(env, pc);
+    entry->paddr = paddr;
     entry->insn_size = size;
     entry->flags |= LI_FLAG_HAS_INSTR_DATA;
     memcpy(entry->insn_bytes, insn, size);
 }
 
+void qemu_log_instr(CPUArchState *env, target_ulong pc, const char *insn,
+                    uint32_t size)
+{
+    qemu_log_instr_paddr(env, pc, get_paddr(env, pc), insn, size);
+}
+
 void qemu_log_instr_asid(CPUArchState *env, uint16_t asid)
 {
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
     entry->asid = asid;
 }
 
 void qemu_log_instr_exception(CPUArchState *env, uint32_t code,
-                              target_ulong vector, target_ulong faultaddr)
+                              target_ulong vector, target_ulong faultaddr,
+                              target_ulong epc)
 {
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
+#ifdef TARGET_LOG_INSTR_LAZY_REGS
+    /*
+     * If the trap belongs to the instruction that set the lazy registers,
+     * it did not complete and the registers still hold their old values.
+     * Otherwise the trap was raised before the next instruction was logged
+     * (e.g. an instruction fetch fault), the instruction in the entry did
+     * complete and its results must be captured before they are lost.
+     */
+    if (cpulog->lazy_regs && epc != entry->pc) {
+        cpu_log_instr_lazy_regs(env, cpulog->lazy_regs);
+    }
+#endif
+    cpulog->lazy_regs = 0;
     entry->flags |= LI_FLAG_INTR_TRAP;
     entry->intr_code = code;
     entry->intr_vector = vector;
@@ -839,7 +1097,10 @@ void qemu_log_instr_exception(CPUArchState *env, uint32_t code,
 void qemu_log_instr_interrupt(CPUArchState *env, uint32_t code,
                               target_ulong vector)
 {
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
     entry->flags |= LI_FLAG_INTR_ASYNC;
     entry->intr_code = code;
@@ -848,7 +1109,10 @@ void qemu_log_instr_interrupt(CPUArchState *env, uint32_t code,
 
 void qemu_log_instr_event(CPUArchState *env, log_event_t *evt)
 {
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    cpu_log_entry_t *entry;
+
+    qemu_log_instr_fast_sync(env);
+    entry = get_cpu_log_entry(env);
 
     /* Note: transfer ownership of dynamically allocated data in evt */
     g_array_append_val(entry->events, *evt);
@@ -904,6 +1168,10 @@ void qemu_log_instr_extra(CPUArchState *env, const char *msg, ...)
     cpu_log_entry_t *entry = get_cpu_log_entry(env);
     va_list va;
 
+    /* The fast logging buffer does not record text */
+    if (qemu_log_instr_fast_enabled()) {
+        return;
+    }
     va_start(va, msg);
     g_string_append_vprintf(entry->txt_buffer, msg, va);
     va_end(va);
@@ -1045,7 +1313,7 @@ void qemu_log_gen_printf(DisasContextBase *base, const char *qemu_format,
                          const char *fmt, ...)
 {
 
-    if (!qemu_base_logging_enabled(base)) {
+    if (!qemu_base_logging_enabled(base) || qemu_log_instr_fast_enabled()) {
         return;
     }
 
@@ -1276,10 +1544,14 @@ void qemu_log_gen_printf_flush(DisasContextBase *base, bool flush_early,
 void qemu_log_instr_flush(CPUArchState *env)
 {
     cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
-    size_t curr = cpulog->ring_tail;
-    cpu_log_entry_t *entry = get_cpu_log_entry(env);
+    size_t curr;
+    cpu_log_entry_t *entry;
     log_event_t event;
 
+    qemu_log_instr_fast_sync(env);
+    curr = cpulog->ring_tail;
+    entry = get_cpu_log_entry(env);
+
     /* Emit FLUSH event so that it can be picked up by backends */
     event.id = LOG_EVENT_STATE;
     event.state.next_state = LOG_EVENT_STATE_FLUSH;
@@ -1571,6 +1843,44 @@ void qemu_log_instr_set_cli_filters(const char *filter_spec, Error **errp)
     }
 }
 
+static void ctx_filter_append(GArray **list, const char *value, Error **errp)
+{
+    uint64_t id;
+
+    if (qemu_strtou64(value, NULL, 0, &id) < 0) {
+        error_setg(errp, "Invalid trace context id '%s'", value);
+        return;
+    }
+    if (*list == NULL) {
+        *list = g_array_new(false, false, sizeof(uint64_t));
+    }
+    g_array_append_val(*list, id);
+}
+
+void qemu_log_instr_set_ctx_filter(const char *spec, Error **errp)
+{
+    gchar **items = g_strsplit(spec, ",", 0);
+    Error *err = NULL;
+    int i;
+
+    for (i = 0; items[i] && err == NULL; i++) {
+        if (g_str_has_prefix(items[i], "pid=")) {
+            ctx_filter_append(&ctx_filter_pid, items[i] + strlen("pid="), &err);
+        } else if (g_str_has_prefix(items[i], "cid=")) {
+            ctx_filter_append(&ctx_filter_cid, items[i] + strlen("cid="), &err);
+        } else {
+            error_setg(&err, "Invalid trace context filter '%s'", items[i]);
+        }
+    }
+    g_strfreev(items);
+
+    if (err) {
+        error_propagate(errp, err);
+        return;
+    }
+    qemu_log_instr_add_startup_filter(LOG_INSTR_FILTER_CONTEXT);
+}
+
 /*
  * Log entry filter reusing the qemu -dfilter infrastructure to
  * filter instructions that run from or access given address ranges.
@@ -1614,6 +1924,35 @@ static bool entry_event_filter(cpu_log_entry_t *entry)
     return false;
 }
 
+static bool ctx_filter_match(GArray *list, uint64_t id)
+{
+    int i;
+
+    if (list == NULL) {
+        return true;
+    }
+    for (i = 0; i < list->len; i++) {
+        if (g_array_index(list, uint64_t, i) == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Log entry filter to retain only entries from the selected guest contexts.
+ * Entries with events are always kept, so that the trace still records
+ * context switches and start/stop markers.
+ */
+static bool entry_context_filter(cpu_log_entry_t *entry)
+{
+    if (entry->events->len > 0) {
+        return true;
+    }
+    return ctx_filter_match(ctx_filter_pid, entry->ctx_pid) &&
+        ctx_filter_match(ctx_filter_cid, entry->ctx_cid);
+}
+
 /*
  * Trace filters mapping. Note that indices must match the
  * cpu_log_instr_filter_t enum values.
@@ -1621,5 +1960,6 @@ static bool entry_event_filter(cpu_log_entry_t *entry)
 static cpu_log_instr_filter_fn_t trace_filters[] = {
     entry_mem_regions_filter,
     entry_event_filter,
+    entry_context_filter,
 };
 #endif /* CONFIG_TCG_LOG_INSTR */
@@ -0,0 +1,280 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Chunked trace container writer.
+ *
+ * Backends that produce a binary record stream can route it through this
+ * layer instead of writing it to their output file directly. Each vCPU
+ * accumulates the records of up to chunk_entries trace entries, compresses
+ * them on its own thread and appends the chunk to the shared container.
+ * See exec/log_instr_chunked.h for the on-disk layout.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/bswap.h"
+#include "qemu/cutils.h"
+#include "qemu/thread.h"
+#include "qemu/units.h"
+#include "qemu/error-report.h"
+#include "qapi/error.h"
+#include "cpu.h"
+#include "exec/log_instr.h"
+#include "exec/log_instr_internal.h"
+#include "exec/log_instr_chunked.h"
+#include <zlib.h>
+
+#ifdef CONFIG_TCG_LOG_INSTR
+
+#define DEFAULT_CHUNK_ENTRIES (1 << 16)
+/* Keep the raw chunk size well within the 32-bit header fields */
+#define MAX_CHUNK_RAW_SIZE (64 * MiB)
+
+struct qemu_log_instr_chunk {
+    /* Header of the chunk being filled, in host byte order */
+    lic_chunk_header_t hdr;
+    GByteArray *raw;
+    /* Sequence number of the next entry on this CPU */
+    uint64_t icount;
+};
+
+static FILE *chunk_file;
+static char *chunk_path;
+static uint32_t chunk_entries = DEFAULT_CHUNK_ENTRIES;
+/* Protects the container file, the index and data_end */
+static QemuMutex chunk_lock;
+/* Array of lic_index_entry_t, already in little-endian byte order */
+static GArray *chunk_index;
+/*
+ * End of the file, new chunks and indexes are appended here. The footer of
+ * the last sync is never overwritten, so it stays valid until the next one
+ * is complete.
+ */
+static uint64_t data_end;
+/* Number of index entries written by the last sync */
+static guint chunks_synced;
+
+bool qemu_log_instr_chunked_enabled(void)
+{
+    return chunk_file != NULL;
+}
+
+static void chunk_header_to_le(lic_chunk_header_t *hdr)
+{
+    cpu_to_le32s(&hdr->magic);
+    cpu_to_le32s(&hdr->cpu);
+    cpu_to_le64s(&hdr->ctx_pid);
+    cpu_to_le64s(&hdr->ctx_cid);
+    cpu_to_le64s(&hdr->icount_first);
+    cpu_to_le64s(&hdr->icount_last);
+    cpu_to_le64s(&hdr->pc_min);
+    cpu_to_le64s(&hdr->pc_max);
+    cpu_to_le32s(&hdr->nentries);
+    cpu_to_le32s(&hdr->raw_size);
+    cpu_to_le32s(&hdr->compressed_size);
+}
+
+static void chunk_fwrite(const void *data, size_t len)
+{
+    if (len && fwrite(data, len, 1, chunk_file) != 1) {
+        error_report("Failed to write chunked trace: %s", strerror(errno));
+        exit(1);
+    }
+}
+
+static struct qemu_log_instr_chunk *get_chunk(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+
+    if (unlikely(cpulog->chunk == NULL)) {
+        cpulog->chunk = g_new0(struct qemu_log_instr_chunk, 1);
+        cpulog->chunk->raw = g_byte_array_sized_new(MiB);
+    }
+    return cpulog->chunk;
+}
+
+/* Compress the current chunk and append it to the container */
+static void chunk_flush(CPUArchState *env, struct qemu_log_instr_chunk *chunk)
+{
+    lic_index_entry_t ientry;
+    uLongf clen;
+    uint8_t *cbuf;
+
+    if (chunk->hdr.nentries == 0) {
+        return;
+    }
+    clen = compressBound(chunk->raw->len);
+    cbuf = g_malloc(clen);
+    if (compress2(cbuf, &clen, chunk->raw->data, chunk->raw->len,
+                  Z_BEST_SPEED) != Z_OK) {
+        error_report("Failed to compress trace chunk");
+        exit(1);
+    }
+    chunk->hdr.magic = LIC_CHUNK_MAGIC;
+    chunk->hdr.cpu = env_cpu(env)->cpu_index;
+    chunk->hdr.raw_size = chunk->raw->len;
+    chunk->hdr.compressed_size = clen;
+    ientry.header = chunk->hdr;
+    chunk_header_to_le(&ientry.header);
+
+    qemu_mutex_lock(&chunk_lock);
+    if (data_end == 0) {
+        lic_file_header_t fhdr = {
+            .version = cpu_to_le32(LIC_VERSION),
+            .backend = cpu_to_le32(qemu_log_instr_backend),
+            .chunk_entries = cpu_to_le32(chunk_entries),
+        };
+        memcpy(fhdr.magic, LIC_FILE_MAGIC, sizeof(fhdr.magic));
+        fseeko(chunk_file, 0, SEEK_SET);
+        chunk_fwrite(&fhdr, sizeof(fhdr));
+        data_end = sizeof(fhdr);
+    }
+    fseeko(chunk_file, data_end, SEEK_SET);
+    ientry.offset = cpu_to_le64(data_end);
+    chunk_fwrite(&ientry.header, sizeof(ientry.header));
+    chunk_fwrite(cbuf, clen);
+    data_end += sizeof(ientry.header) + clen;
+    g_array_append_val(chunk_index, ientry);
+    qemu_mutex_unlock(&chunk_lock);
+
+    g_free(cbuf);
+    g_byte_array_set_size(chunk->raw, 0);
+    memset(&chunk->hdr, 0, sizeof(chunk->hdr));
+}
+
+void qemu_log_instr_chunk_begin(CPUArchState *env, cpu_log_entry_t *entry)
+{
+    struct qemu_log_instr_chunk *chunk = get_chunk(env);
+    lic_chunk_header_t *hdr = &chunk->hdr;
+
+    if (hdr->nentries > 0 &&
+        (hdr->nentries >= chunk_entries ||
+         chunk->raw->len >= MAX_CHUNK_RAW_SIZE ||
+         hdr->ctx_pid != entry->ctx_pid || hdr->ctx_cid != entry->ctx_cid)) {
+        chunk_flush(env, chunk);
+    }
+    if (hdr->nentries == 0) {
+        hdr->ctx_pid = entry->ctx_pid;
+        hdr->ctx_cid = entry->ctx_cid;
+        hdr->icount_first = chunk->icount;
+        hdr->pc_min = UINT64_MAX;
+        hdr->pc_max = 0;
+    }
+    hdr->icount_last = chunk->icount++;
+    /* Events without instruction data do not carry a meaningful pc */
+    if (entry->flags & LI_FLAG_HAS_INSTR_DATA) {
+        hdr->pc_min = MIN(hdr->pc_min, (uint64_t)entry->pc);
+        hdr->pc_max = MAX(hdr->pc_max, (uint64_t)entry->pc);
+    }
+    hdr->nentries++;
+}
+
+void qemu_log_instr_chunk_append(CPUArchState *env, const void *data,
+                                 size_t len)
+{
+    g_byte_array_append(get_chunk(env)->raw, data, len);
+}
+
+void qemu_log_instr_chunk_sync(CPUArchState *env)
+{
+    lic_footer_t footer;
+
+    if (chunk_file == NULL) {
+        return;
+    }
+    chunk_flush(env, get_chunk(env));
+
+    qemu_mutex_lock(&chunk_lock);
+    if (data_end != 0 && chunk_index->len != chunks_synced) {
+        fseeko(chunk_file, data_end, SEEK_SET);
+        chunk_fwrite(chunk_index->data,
+                     chunk_index->len * sizeof(lic_index_entry_t));
+        footer.index_offset = cpu_to_le64(data_end);
+        footer.nchunks = cpu_to_le32(chunk_index->len);
+        footer.magic = cpu_to_le32(LIC_FOOTER_MAGIC);
+        chunk_fwrite(&footer, sizeof(footer));
+        fflush(chunk_file);
+        data_end += chunk_index->len * sizeof(lic_index_entry_t) +
+            sizeof(footer);
+        chunks_synced = chunk_index->len;
+    }
+    qemu_mutex_unlock(&chunk_lock);
+}
+
+void qemu_log_instr_chunk_after_fork(void)
+{
+    g_autofree char *path = NULL;
+
+    if (chunk_file == NULL) {
+        return;
+    }
+    path = qemu_log_instr_fork_path(chunk_path);
+    fclose(chunk_file);
+    chunk_file = fopen(path, "w+b");
+    if (chunk_file == NULL) {
+        error_report("Could not open %s: %s", path, strerror(errno));
+        exit(1);
+    }
+    g_array_set_size(chunk_index, 0);
+    data_end = 0;
+    chunks_synced = 0;
+}
+
+void qemu_log_instr_set_chunked_output(const char *spec, Error **errp)
+{
+    gchar **opts = g_strsplit(spec, ",", 0);
+    const char *path = NULL;
+    uint64_t value;
+    int i;
+
+    for (i = 0; opts[i]; i++) {
+        if (g_str_has_prefix(opts[i], "file=")) {
+            path = opts[i] + strlen("file=");
+        } else if (g_str_has_prefix(opts[i], "entries=") &&
+                   qemu_strtou64(opts[i] + strlen("entries="), NULL, 0,
+                                 &value) == 0 &&
+                   value > 0 && value <= UINT32_MAX) {
+            chunk_entries = value;
+        } else {
+            error_setg(errp, "Invalid chunked trace option '%s'", opts[i]);
+            g_strfreev(opts);
+            return;
+        }
+    }
+
+    if (path == NULL) {
+        error_setg(errp, "Chunked trace output requires file=path");
+    } else if ((chunk_file = fopen(path, "w+b")) == NULL) {
+        error_setg_errno(errp, errno, "Could not open %s", path);
+    } else {
+        chunk_path = g_strdup(path);
+        qemu_mutex_init(&chunk_lock);
+        chunk_index = g_array_new(false, false, sizeof(lic_index_entry_t));
+    }
+    g_strfreev(opts);
+}
+
+#endif /* CONFIG_TCG_LOG_INSTR */
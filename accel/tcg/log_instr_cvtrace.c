@@ -36,96 +36,88 @@
 
 #include "qemu/osdep.h"
 #include "qemu/log.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
 #include "cpu.h"
 #include "exec/log_instr.h"
 #include "exec/log_instr_internal.h"
+#include "exec/log_instr_cvtrace.h"
 #include "exec/memop.h"
 #include "disas/disas.h"
+#include <zlib.h>
 
-/*
- * CHERI binary trace format, originally used for MIPS only.
- * The format is limited to one entry per instruction, each
- * entry can hold at most one register modification and one
- * memory address.
- * Note that the CHERI format is the legacy MIPS format and
- * assumes big-endian byte order.
- */
-typedef struct {
-    uint8_t entry_type;
-#define CTE_NO_REG 0   /* No register is changed. */
-#define CTE_GPR    1   /* GPR change (val2) */
-#define CTE_LD_GPR 2   /* Load into GPR (val2) from address (val1) */
-#define CTE_ST_GPR 3   /* Store from GPR (val2) to address (val1) */
-#define CTE_CAP    11  /* Cap change (val2,val3,val4,val5) */
-#define CTE_LD_CAP 12  /* Load Cap (val2,val3,val4,val5) from addr (val1) */
-#define CTE_ST_CAP 13  /* Store Cap (val2,val3,val4,val5) to addr (val1) */
-    uint8_t exception; /* 0=none, 1=TLB Mod, 2=TLB Load, 3=TLB Store, etc. */
-#define CTE_EXCEPTION_NONE 31
-    uint16_t cycles; /* Currently not used. */
-    uint32_t inst;   /* Encoded instruction. */
-    uint64_t pc;     /* PC value of instruction. */
-    uint64_t val1;   /* val1 is used for memory address. */
-    uint64_t val2;   /* val2, val3, val4, val5 are used for reg content. */
-    uint64_t val3;
-    uint64_t val4;
-    uint64_t val5;
-    uint8_t thread; /* Hardware thread/CPU (i.e. cpu->cpu_index ) */
-    uint8_t asid;   /* Address Space ID */
-} __attribute__((packed)) cheri_trace_entry_t;
-
-/* Version 3 Cheri Stream Trace header info */
-#define CTE_QEMU_VERSION (0x80U + 3)
-#define CTE_QEMU_MAGIC   "CheriTraceV03"
+static void fill_cvtrace_header(char *buffer, size_t size)
+{
+    memset(buffer, 0, size);
+    buffer[0] = CTE_QEMU_VERSION;
+    g_strlcpy(buffer + 1, CTE_QEMU_MAGIC, size - 2);
+}
+
+/* Each per-context output file is a complete trace with its own header */
+static void emit_cvtrace_stream_header(qemu_log_instr_stream_t *stream)
+{
+    char buffer[sizeof(cheri_trace_entry_t)];
+
+    fill_cvtrace_header(buffer, sizeof(buffer));
+    qemu_log_instr_stream_write(stream, buffer, sizeof(buffer));
+}
 
 /*
  * Emit cvtrace trace trace header. This is a magic byte + string
  */
+static bool cvtrace_header_done;
+
 void emit_cvtrace_header(CPUArchState *env)
 {
-    static bool initialized;
     FILE *logfile;
     char buffer[sizeof(cheri_trace_entry_t)];
 
-    if (initialized) {
+    /* Split and chunked output identify the format on their own */
+    if (cvtrace_header_done || qemu_log_instr_split_enabled() ||
+        qemu_log_instr_chunked_enabled()) {
         return;
     }
-    initialized = true;
+    cvtrace_header_done = true;
     logfile = qemu_log_lock();
-    buffer[0] = CTE_QEMU_VERSION;
-    g_strlcpy(buffer + 1, CTE_QEMU_MAGIC, sizeof(buffer) - 2);
+    fill_cvtrace_header(buffer, sizeof(buffer));
     fwrite(buffer, sizeof(buffer), 1, logfile);
     qemu_log_unlock(logfile);
 }
 
+void reopen_cvtrace_backend(void)
+{
+    /* The header was written to the log file of the parent */
+    cvtrace_header_done = false;
+    emit_cvtrace_header(first_cpu->env_ptr);
+}
+
 /*
- * Emit cvtrace trace entry.
+ * Fill a cvtrace entry in host byte order, unused fields are zero.
  * Note: this format is very MIPS-specific.
  */
-void emit_cvtrace_entry(CPUArchState *env, cpu_log_entry_t *entry)
+static void fill_cvtrace_entry(CPUArchState *env, cpu_log_entry_t *entry,
+                               cheri_trace_entry_t *ct_entry, uint16_t cycles)
 {
-    FILE *logfile;
-    cheri_trace_entry_t ct_entry;
-    /* TODO(am2419): this should be a per-cpu counter. */
-    static uint16_t cycles;
     uint32_t *insn = (uint32_t *)&entry->insn_bytes[0];
 
-    ct_entry.entry_type = CTE_NO_REG;
-    ct_entry.thread = (uint8_t)env_cpu(env)->cpu_index;
-    ct_entry.asid = (uint8_t)entry->asid;
-    ct_entry.pc = cpu_to_be64(entry->pc);
-    ct_entry.cycles = cpu_to_be16(cycles++);
+    memset(ct_entry, 0, sizeof(*ct_entry));
+    ct_entry->entry_type = CTE_NO_REG;
+    ct_entry->thread = (uint8_t)env_cpu(env)->cpu_index;
+    ct_entry->asid = (uint8_t)entry->asid;
+    ct_entry->pc = entry->pc;
+    ct_entry->cycles = cycles;
     /*
      * TODO(am2419): The instruction bytes are alread in target byte-order,
      * however cheritrace does not currently expect this.
      */
-    ct_entry.inst = cpu_to_be32(*insn);
+    ct_entry->inst = *insn;
     switch (entry->flags & LI_FLAG_INTR_MASK) {
     case LI_FLAG_INTR_TRAP:
-        ct_entry.exception = (uint8_t)(entry->intr_code & 0xff);
+        ct_entry->exception = (uint8_t)(entry->intr_code & 0xff);
     case LI_FLAG_INTR_ASYNC:
-        ct_entry.exception = 0;
+        ct_entry->exception = 0;
     default:
-        ct_entry.exception = CTE_EXCEPTION_NONE;
+        ct_entry->exception = CTE_EXCEPTION_NONE;
     }
 
     if (entry->regs->len) {
@@ -147,16 +139,16 @@ void emit_cvtrace_entry(CPUArchState *env, cpu_log_entry_t *entry)
                                  ((uint64_t)COMBINED_PERMS_VALUE(cr) << 1) |
                                  (uint64_t)(cap_is_unsealed(cr) ? 0 : 1));
 
-            ct_entry.entry_type = CTE_CAP;
-            ct_entry.val2 = cpu_to_be64(metadata);
-            ct_entry.val3 = cpu_to_be64(cap_get_cursor(cr));
-            ct_entry.val4 = cpu_to_be64(cap_get_base(cr));
-            ct_entry.val5 = cpu_to_be64(cap_get_length_sat(cr));
+            ct_entry->entry_type = CTE_CAP;
+            ct_entry->val2 = metadata;
+            ct_entry->val3 = cap_get_cursor(cr);
+            ct_entry->val4 = cap_get_base(cr);
+            ct_entry->val5 = cap_get_length_sat(cr);
         } else
 #endif
         {
-            ct_entry.entry_type = CTE_GPR;
-            ct_entry.val2 = cpu_to_be64(rinfo->gpr);
+            ct_entry->entry_type = CTE_GPR;
+            ct_entry->val2 = rinfo->gpr;
         }
     }
 
@@ -166,16 +158,324 @@ void emit_cvtrace_entry(CPUArchState *env, cpu_log_entry_t *entry)
         log_assert((minfo->flags & LMI_CAP) == 0 && "Capability memory access "
                                                     "without CHERI support");
 #endif
-        ct_entry.val1 = cpu_to_be64(minfo->addr);
+        ct_entry->val1 = minfo->addr;
         /* Hack to avoid checking for GPR or CAP */
         if (minfo->flags & LMI_LD) {
-            ct_entry.entry_type += 1;
+            ct_entry->entry_type += 1;
         } else if (minfo->flags & LMI_ST) {
-            ct_entry.entry_type += 2;
+            ct_entry->entry_type += 2;
         }
     }
+}
+
+/*
+ * Emit cvtrace trace entry.
+ */
+void emit_cvtrace_entry(CPUArchState *env, cpu_log_entry_t *entry)
+{
+    qemu_log_instr_stream_t *stream;
+    FILE *logfile;
+    cheri_trace_entry_t ct_entry;
+    /* TODO(am2419): this should be a per-cpu counter. */
+    static uint16_t cycles;
+
+    fill_cvtrace_entry(env, entry, &ct_entry, cycles++);
+    ct_entry.pc = cpu_to_be64(ct_entry.pc);
+    ct_entry.cycles = cpu_to_be16(ct_entry.cycles);
+    ct_entry.inst = cpu_to_be32(ct_entry.inst);
+    ct_entry.val1 = cpu_to_be64(ct_entry.val1);
+    ct_entry.val2 = cpu_to_be64(ct_entry.val2);
+    ct_entry.val3 = cpu_to_be64(ct_entry.val3);
+    ct_entry.val4 = cpu_to_be64(ct_entry.val4);
+    ct_entry.val5 = cpu_to_be64(ct_entry.val5);
 
+    if (qemu_log_instr_chunked_enabled()) {
+        qemu_log_instr_chunk_begin(env, entry);
+        qemu_log_instr_chunk_append(env, &ct_entry, sizeof(ct_entry));
+        return;
+    }
+    stream = qemu_log_instr_get_stream(env, entry, "cvtrace",
+                                       emit_cvtrace_stream_header);
+    if (stream) {
+        qemu_log_instr_stream_write(stream, &ct_entry, sizeof(ct_entry));
+        return;
+    }
     logfile = qemu_log_lock();
     fwrite(&ct_entry, sizeof(ct_entry), 1, logfile);
     qemu_log_unlock(logfile);
 }
+
+/*
+ * Compressed cvtrace backend, see exec/log_instr_cvtrace.h for the format.
+ *
+ * Each CPU encodes its records into a private batch. Full batches are fed
+ * to a single deflate stream that writes a gzip file to the qemu log, so
+ * records from different CPUs are interleaved at batch granularity.
+ */
+
+/* Encoded records are passed to the compressor in batches of this size */
+#define CVT2_BATCH_SIZE (64 * 1024)
+#define CVT2_OUT_SIZE (16 * 1024)
+
+typedef struct {
+    uint64_t pc;
+    uint32_t insn;
+    bool valid;
+} cvt2_insn_cache_t;
+
+typedef struct {
+    /* Delta state, see the format description */
+    uint64_t pc;
+    uint64_t val[5];
+    uint16_t cycles;
+    uint8_t asid;
+    /* The next record starts a batch and must carry CVT2_F_CTX */
+    bool batch_start;
+    cvt2_insn_cache_t insn_cache[CVT2_INSN_CACHE_SIZE];
+    size_t batch_len;
+    uint8_t batch[CVT2_BATCH_SIZE + CVT2_MAX_RECORD_SIZE];
+} cvt2_cpu_state_t;
+
+/* Shared compressor, protected by the qemu log lock */
+static z_stream cvt2_zs;
+static bool cvt2_initialized;
+/* Data was compressed since the last gzip member was finished */
+static bool cvt2_member_open;
+
+static inline uint8_t *cvt2_put_varint(uint8_t *p, uint64_t value)
+{
+    while (value >= 0x80) {
+        *p++ = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    *p++ = value;
+    return p;
+}
+
+/* Value relative to @prev, see the format description */
+static inline uint8_t *cvt2_put_value(uint8_t *p, uint64_t value,
+                                      uint64_t *prev)
+{
+    uint64_t zz;
+
+    if (value == 0) {
+        *p++ = 0;
+        return p;
+    }
+    zz = cvt2_zigzag(value - *prev);
+    *prev = value;
+    if (zz == UINT64_MAX) {
+        /* zz + 1 is 2^64 */
+        memset(p, 0x80, 9);
+        p[9] = 0x02;
+        return p + 10;
+    }
+    return cvt2_put_varint(p, zz + 1);
+}
+
+/*
+ * Compress the given data with @flush and write the output, called with
+ * the log lock held.
+ */
+static void cvt2_deflate(FILE *logfile, const void *data, size_t len,
+                         int flush)
+{
+    uint8_t out[CVT2_OUT_SIZE];
+
+    cvt2_zs.next_in = (Bytef *)data;
+    cvt2_zs.avail_in = len;
+    do {
+        cvt2_zs.next_out = out;
+        cvt2_zs.avail_out = sizeof(out);
+        if (deflate(&cvt2_zs, flush) == Z_STREAM_ERROR) {
+            error_report("Failed to compress cvtrace2 trace");
+            exit(1);
+        }
+        fwrite(out, sizeof(out) - cvt2_zs.avail_out, 1, logfile);
+    } while (cvt2_zs.avail_out == 0);
+    cvt2_member_open = (flush != Z_FINISH);
+}
+
+static void cvt2_flush_batch(cvt2_cpu_state_t *cs, bool finish)
+{
+    FILE *logfile;
+
+    if (cs->batch_len == 0 && !finish) {
+        return;
+    }
+    logfile = qemu_log_lock();
+    if (logfile) {
+        cvt2_deflate(logfile, cs->batch, cs->batch_len, Z_NO_FLUSH);
+        if (finish) {
+            /*
+             * End the gzip member so that the file can be decoded up to
+             * here, the next batch starts a new member.
+             */
+            cvt2_deflate(logfile, NULL, 0, Z_FINISH);
+            deflateReset(&cvt2_zs);
+            fflush(logfile);
+        }
+    }
+    qemu_log_unlock(logfile);
+    cs->batch_len = 0;
+    cs->batch_start = true;
+}
+
+/* Start the stream with the file header, called with the log lock held */
+static void cvt2_write_header(FILE *logfile)
+{
+    cvt2_file_header_t hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CVT2_MAGIC, sizeof(hdr.magic));
+    hdr.version = cpu_to_le32(CVT2_VERSION);
+    if (logfile) {
+        cvt2_deflate(logfile, &hdr, sizeof(hdr), Z_NO_FLUSH);
+    }
+}
+
+/*
+ * Flush the batch of every CPU and finish the gzip member on exit, so that
+ * the trace stays decodable however QEMU terminates (shutdown on a signal,
+ * a guest test device calling exit(), etc.).
+ * The vCPUs may still be running, the final records of a CPU that is in the
+ * middle of emitting an entry can be lost.
+ */
+static void cleanup_cvtrace2_backend(void)
+{
+    cpu_log_instr_state_t *cpulog;
+    cvt2_cpu_state_t *cs;
+    CPUState *cpu;
+    FILE *logfile;
+
+    logfile = qemu_log_lock();
+    if (logfile) {
+        CPU_FOREACH(cpu) {
+            cpulog = get_cpu_log_state(cpu->env_ptr);
+            cs = cpulog ? cpulog->backend_data : NULL;
+            if (cs && cs->batch_len) {
+                cvt2_deflate(logfile, cs->batch, cs->batch_len, Z_NO_FLUSH);
+                cs->batch_len = 0;
+            }
+        }
+        if (cvt2_member_open) {
+            cvt2_deflate(logfile, NULL, 0, Z_FINISH);
+        }
+        fflush(logfile);
+    }
+    qemu_log_unlock(logfile);
+}
+
+void init_cvtrace2_backend(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    cvt2_cpu_state_t *cs = g_new0(cvt2_cpu_state_t, 1);
+    FILE *logfile;
+
+    cs->cycles = 0xffff;
+    cs->batch_start = true;
+    cpulog->backend_data = cs;
+
+    logfile = qemu_log_lock();
+    if (!cvt2_initialized) {
+        cvt2_initialized = true;
+        if (deflateInit2(&cvt2_zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            error_report("Failed to initialize cvtrace2 compressor");
+            exit(1);
+        }
+        cvt2_write_header(logfile);
+        atexit(cleanup_cvtrace2_backend);
+    }
+    qemu_log_unlock(logfile);
+}
+
+void reopen_cvtrace2_backend(void)
+{
+    FILE *logfile;
+
+    if (!cvt2_initialized) {
+        return;
+    }
+    /* Part of the stream may have been written to the parent's log file */
+    logfile = qemu_log_lock();
+    deflateReset(&cvt2_zs);
+    cvt2_write_header(logfile);
+    qemu_log_unlock(logfile);
+}
+
+void sync_cvtrace2_backend(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+
+    cvt2_flush_batch(cpulog->backend_data, true);
+}
+
+void emit_cvtrace2_entry(CPUArchState *env, cpu_log_entry_t *entry)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    cvt2_cpu_state_t *cs = cpulog->backend_data;
+    cheri_trace_entry_t ct;
+    cvt2_insn_cache_t *ic;
+    uint8_t *flags, *p;
+    uint64_t vals[5];
+    int code, i;
+
+    fill_cvtrace_entry(env, entry, &ct, cs->cycles + 1);
+    vals[0] = ct.val1;
+    vals[1] = ct.val2;
+    vals[2] = ct.val3;
+    vals[3] = ct.val4;
+    vals[4] = ct.val5;
+    code = cvt2_type_code(ct.entry_type);
+    for (i = 0; i < 5 && code != CVT2_TYPE_RAW; i++) {
+        if (vals[i] != 0 && !cvt2_type_has_val(code, i + 1)) {
+            code = CVT2_TYPE_RAW;
+        }
+    }
+
+    p = &cs->batch[cs->batch_len];
+    flags = p++;
+    *flags = code;
+    if (cs->batch_start || ct.asid != cs->asid) {
+        *flags |= CVT2_F_CTX;
+        *p++ = ct.thread;
+        *p++ = ct.asid;
+        cs->asid = ct.asid;
+        cs->batch_start = false;
+    }
+    if (ct.pc != cs->pc + 4) {
+        *flags |= CVT2_F_PC;
+        p = cvt2_put_varint(p, cvt2_zigzag(ct.pc - (cs->pc + 4)));
+    }
+    cs->pc = ct.pc;
+    ic = &cs->insn_cache[(ct.pc >> 1) & (CVT2_INSN_CACHE_SIZE - 1)];
+    if (!ic->valid || ic->pc != ct.pc || ic->insn != ct.inst) {
+        *flags |= CVT2_F_INSN;
+        stl_le_p(p, ct.inst);
+        p += 4;
+        ic->pc = ct.pc;
+        ic->insn = ct.inst;
+        ic->valid = true;
+    }
+    if (ct.exception != CTE_EXCEPTION_NONE) {
+        *flags |= CVT2_F_EXC;
+        *p++ = ct.exception;
+    }
+    cs->cycles++;
+    if (code == CVT2_TYPE_RAW) {
+        *p++ = ct.entry_type;
+    }
+
+    for (i = 0; i < 5; i++) {
+        if (!cvt2_type_has_val(code, i + 1)) {
+            continue;
+        }
+        p = cvt2_put_value(p, vals[i], &cs->val[i]);
+    }
+
+    cs->batch_len = p - cs->batch;
+    if (cs->batch_len >= CVT2_BATCH_SIZE) {
+        cvt2_flush_batch(cs, false);
+    }
+}
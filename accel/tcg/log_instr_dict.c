@@ -0,0 +1,189 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Per-CPU instruction dictionary.
+ *
+ * Backends that would otherwise store the opcode bytes and disassembly
+ * with every entry write a definition record the first time an
+ * instruction is seen and reference it by id afterwards. Instructions are
+ * keyed by physical address, virtual address and opcode bytes: code
+ * modified in place gets a new definition because its bytes differ, and
+ * the virtual address keeps the disassembly of pc-relative operands
+ * correct for code mapped at several addresses.
+ *
+ * A direct-mapped cache catches repeated instructions without hashing the
+ * full key, and a bloom filter lets new instructions skip the hash table
+ * lookup.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitmap.h"
+#include "qemu/xxhash.h"
+#include "cpu.h"
+#include "exec/log_instr.h"
+#include "exec/log_instr_internal.h"
+#include "disas/disas.h"
+
+#define DICT_CACHE_BITS 12
+#define DICT_CACHE_SIZE (1 << DICT_CACHE_BITS)
+/*
+ * Entries are never invalidated, once the dictionary grows this large it is
+ * emptied. Ids are not reused so references to old definitions stay valid.
+ */
+#define DICT_MAX_ENTRIES_BITS 20
+#define DICT_MAX_ENTRIES (1 << DICT_MAX_ENTRIES_BITS)
+/*
+ * 16 bits per entry with 2 hash functions keep the false positive rate of
+ * a full dictionary around 1.4%, at the cost of 2 MiB per CPU.
+ */
+#define DICT_BLOOM_BITS (DICT_MAX_ENTRIES_BITS + 4)
+#define DICT_BLOOM_SIZE (1 << DICT_BLOOM_BITS)
+
+QEMU_BUILD_BUG_ON(TARGET_MAX_INSN_SIZE > 16);
+
+struct log_instr_dict {
+    /* Set of log_instr_dict_entry_t, owns the entries */
+    GHashTable *table;
+    log_instr_dict_entry_t *cache[DICT_CACHE_SIZE];
+    unsigned long bloom[BITS_TO_LONGS(DICT_BLOOM_SIZE)];
+    uint32_t next_id;
+};
+
+static bool insn_dict;
+
+void qemu_log_instr_enable_insn_dict(void)
+{
+    insn_dict = true;
+}
+
+bool qemu_log_instr_insn_dict_enabled(void)
+{
+    return insn_dict;
+}
+
+static uint32_t dict_hash(const log_instr_dict_entry_t *e)
+{
+    uint64_t lo = 0, hi = 0;
+
+    memcpy(&lo, e->insn_bytes, MIN(e->insn_size, 8));
+    if (e->insn_size > 8) {
+        memcpy(&hi, e->insn_bytes + 8, e->insn_size - 8);
+    }
+    return qemu_xxhash7(e->paddr, e->pc, lo, (lo >> 32) ^ hi ^ (hi >> 32),
+                        e->insn_size);
+}
+
+static guint dict_entry_hash(gconstpointer key)
+{
+    return ((const log_instr_dict_entry_t *)key)->hash;
+}
+
+static gboolean dict_entry_equal(gconstpointer a, gconstpointer b)
+{
+    const log_instr_dict_entry_t *ea = a;
+    const log_instr_dict_entry_t *eb = b;
+
+    return ea->paddr == eb->paddr && ea->pc == eb->pc &&
+           ea->insn_size == eb->insn_size &&
+           memcmp(ea->insn_bytes, eb->insn_bytes, ea->insn_size) == 0;
+}
+
+static void dict_entry_free(gpointer data)
+{
+    log_instr_dict_entry_t *e = data;
+
+    g_free(e->disas);
+    g_free(e);
+}
+
+static struct log_instr_dict *get_dict(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+
+    if (unlikely(cpulog->insn_dict == NULL)) {
+        cpulog->insn_dict = g_new0(struct log_instr_dict, 1);
+        cpulog->insn_dict->table = g_hash_table_new_full(
+            dict_entry_hash, dict_entry_equal, dict_entry_free, NULL);
+        cpulog->insn_dict->next_id = 1;
+    }
+    return cpulog->insn_dict;
+}
+
+static void dict_reset(struct log_instr_dict *dict)
+{
+    g_hash_table_remove_all(dict->table);
+    memset(dict->cache, 0, sizeof(dict->cache));
+    bitmap_zero(dict->bloom, DICT_BLOOM_SIZE);
+}
+
+log_instr_dict_entry_t *qemu_log_instr_dict_lookup(CPUArchState *env,
+                                                   cpu_log_entry_t *entry,
+                                                   bool *is_new)
+{
+    struct log_instr_dict *dict = get_dict(env);
+    log_instr_dict_entry_t key, *e, **slot;
+    unsigned int b0, b1;
+
+    key.paddr = entry->paddr;
+    key.pc = entry->pc;
+    key.insn_size = MIN(entry->insn_size, TARGET_MAX_INSN_SIZE);
+    memset(key.insn_bytes, 0, sizeof(key.insn_bytes));
+    memcpy(key.insn_bytes, entry->insn_bytes, key.insn_size);
+    key.hash = dict_hash(&key);
+
+    *is_new = false;
+    slot = &dict->cache[key.hash & (DICT_CACHE_SIZE - 1)];
+    if (likely(*slot && (*slot)->hash == key.hash &&
+               dict_entry_equal(*slot, &key))) {
+        return *slot;
+    }
+
+    /* The bit ranges overlap, remix the hash for the second index */
+    b0 = key.hash & (DICT_BLOOM_SIZE - 1);
+    b1 = (key.hash * 0x9e3779b1U) >> (32 - DICT_BLOOM_BITS);
+    if (test_bit(b0, dict->bloom) && test_bit(b1, dict->bloom)) {
+        e = g_hash_table_lookup(dict->table, &key);
+        if (e) {
+            *slot = e;
+            return e;
+        }
+    }
+
+    if (g_hash_table_size(dict->table) >= DICT_MAX_ENTRIES) {
+        dict_reset(dict);
+    }
+    e = g_new(log_instr_dict_entry_t, 1);
+    *e = key;
+    e->id = dict->next_id++;
+    e->disas = disas_one_strbuf(env_cpu(env), entry->insn_bytes,
+                                sizeof(entry->insn_bytes), entry->pc);
+    g_hash_table_add(dict->table, e);
+    set_bit(b0, dict->bloom);
+    set_bit(b1, dict->bloom);
+    *slot = e;
+    *is_new = true;
+    return e;
+}
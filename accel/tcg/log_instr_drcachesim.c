@@ -23,6 +23,8 @@
 
 static FILE * output_trace_file;
 static FILE * output_dbg_file;
+static char * output_trace_name;
+static char * output_dbg_name;
 
 
 typedef struct stats_t stats_t;
@@ -128,11 +130,12 @@ static void cleanup_drcachesim_backend(void)
 
 void qemu_log_instr_drcachesim_conf_tracefile(const char * name)
 {
-    output_trace_file = fopen(name, "wb");
+    output_trace_name = g_strdup(name);
 }
 
 void qemu_log_instr_drcachesim_conf_dbgfile(const char * name)
 {
+    output_dbg_name = g_strdup(name);
     output_dbg_file = fopen(name, "w");
 }
 
@@ -140,14 +143,36 @@ void init_drcachesim_backend(CPUArchState * env)
 {
     assert(env_cpu(env)->nr_cores == 1 && env_cpu(env)->nr_threads == 1);
 
-    if (output_trace_file == NULL)
-        output_trace_file = fopen("output_trace.gz", "wb");
+    // The chunk writer owns the trace output in chunked mode
+    if (output_trace_file == NULL && !qemu_log_instr_chunked_enabled())
+        output_trace_file = fopen(output_trace_name ? output_trace_name : "output_trace.gz", "wb");
     if (output_dbg_file == NULL)
         output_dbg_file = fopen("output_dbg.txt", "w");
 
     atexit(cleanup_drcachesim_backend);
 }
 
+void reopen_drcachesim_backend(void)
+{
+    g_autofree char *trace_path = NULL;
+    g_autofree char *dbg_path = NULL;
+
+    if (output_trace_file) {
+        trace_path = qemu_log_instr_fork_path(output_trace_name ?
+                                              output_trace_name :
+                                              "output_trace.gz");
+        fclose(output_trace_file);
+        output_trace_file = fopen(trace_path, "wb");
+    }
+    if (output_dbg_file) {
+        dbg_path = qemu_log_instr_fork_path(output_dbg_name ?
+                                            output_dbg_name :
+                                            "output_dbg.txt");
+        fclose(output_dbg_file);
+        output_dbg_file = fopen(dbg_path, "w");
+    }
+}
+
 
 // NOTE can get this information by running dmesg within QEMU
 #define MEMORY_SIZE (2 * 1024LL*1024*1024)
@@ -158,7 +183,7 @@ static bool check_paddr_valid(uint64_t paddr)
     return paddr >= BASE_PADDR && paddr < BASE_PADDR + MEMORY_SIZE;
 }
 
-static void emit_trace_entry(uint8_t type, uint16_t size, uint64_t vaddr, uint64_t paddr, uint8_t tag)
+static void emit_trace_entry(CPUArchState * env, uint8_t type, uint16_t size, uint64_t vaddr, uint64_t paddr, uint8_t tag)
 {
     dbg_stats.num_entries_total++;
 
@@ -169,6 +194,12 @@ static void emit_trace_entry(uint8_t type, uint16_t size, uint64_t vaddr, uint64
     trace_entry.vaddr = vaddr;
     trace_entry.paddr = paddr;
 
+    if (qemu_log_instr_chunked_enabled())
+    {
+        qemu_log_instr_chunk_append(env, &trace_entry, sizeof(trace_entry));
+        return;
+    }
+
     size_t bytes_written = fwrite(&trace_entry, 1, sizeof(trace_entry), output_trace_file);
     if (bytes_written != sizeof(trace_entry)) dbg_stats.num_write_failures++;
 }
@@ -197,9 +228,12 @@ static bool is_paddr_mmio(CPUArchState * env, hwaddr paddr, hwaddr size, bool is
 
 void emit_drcachesim_entry(CPUArchState * env, cpu_log_entry_t * entry)
 {
-    assert(output_trace_file);
+    assert(output_trace_file || qemu_log_instr_chunked_enabled());
     assert(output_dbg_file);
 
+    if (qemu_log_instr_chunked_enabled())
+        qemu_log_instr_chunk_begin(env, entry);
+
     if (entry->flags & LI_FLAG_HAS_INSTR_DATA)
     {
         target_ulong pc = entry->pc;
@@ -242,7 +276,7 @@ void emit_drcachesim_entry(CPUArchState * env, cpu_log_entry_t * entry)
         }
         else
         {
-            emit_trace_entry(CUSTOM_TRACE_TYPE_INSTR, entry->insn_size, pc, instr_paddr, 0);
+            emit_trace_entry(env, CUSTOM_TRACE_TYPE_INSTR, entry->insn_size, pc, instr_paddr, 0);
         }
 
         if (entry->mem->len == 2) dbg_stats.num_atomic_ops++;
@@ -315,7 +349,7 @@ void emit_drcachesim_entry(CPUArchState * env, cpu_log_entry_t * entry)
             }
             else
             {
-                emit_trace_entry(op_type, size, vaddr, paddr, tag);
+                emit_trace_entry(env, op_type, size, vaddr, paddr, tag);
             }
         }
     }
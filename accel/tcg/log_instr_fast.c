@@ -0,0 +1,432 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Fast instruction logging.
+ *
+ * Translated code fills a per-CPU buffer of log_instr_fast_rec_t with inline
+ * stores, the records are replayed through the qemu_log_instr_* interface
+ * to build the trace entries for the backend. See exec/log_instr_fast.h.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/log_instr.h"
+#include "exec/log_instr_internal.h"
+#include "exec/log_instr_fast.h"
+#include "tcg/tcg-op.h"
+
+#ifdef CONFIG_TCG_LOG_INSTR
+
+/* Per-CPU record buffer size */
+#define FAST_BUFFER_SIZE (4 * MiB)
+/*
+ * Space left past fast_limit for records appended by helpers, the TB start
+ * check only accounts for the records reserved by translated code.
+ */
+#define FAST_BUFFER_SLACK (64 * KiB)
+
+#define FAST_REC_SIZE sizeof(log_instr_fast_rec_t)
+
+/* Offset of a cpu_log_instr_state_t field from cpu_env */
+#define LOG_STATE_OFFSET(field)                                                \
+    ((offsetof(ArchCPU, parent_obj) - offsetof(ArchCPU, env)) +                \
+     offsetof(struct CPUState, log_state.field))
+
+/* Offset of a field of the n-th record of the current instruction */
+#define REC_OFFSET(n, field)                                                   \
+    ((n) * FAST_REC_SIZE + offsetof(log_instr_fast_rec_t, field))
+
+static bool log_fast;
+
+bool qemu_log_instr_fast_enabled(void)
+{
+    return log_fast;
+}
+
+void qemu_log_instr_enable_fast(void)
+{
+    log_fast = true;
+}
+
+void qemu_log_instr_fast_init(CPUState *cpu)
+{
+    cpu_log_instr_state_t *cpulog = &cpu->log_state;
+    size_t nrecs = FAST_BUFFER_SIZE / FAST_REC_SIZE;
+
+    if (!log_fast) {
+        return;
+    }
+    cpulog->fast_buf = g_new0(log_instr_fast_rec_t, nrecs);
+    cpulog->fast_ptr = cpulog->fast_buf;
+    cpulog->fast_drained = cpulog->fast_buf;
+    cpulog->fast_end = cpulog->fast_buf + nrecs;
+    cpulog->fast_limit = cpulog->fast_end - FAST_BUFFER_SLACK / FAST_REC_SIZE;
+}
+
+/*
+ * Decode a single record, returns the last record it uses.
+ * An instruction header commits the previous entry, so the last instruction
+ * is left open in the current entry, as it would be after its logging
+ * helpers ran.
+ */
+static log_instr_fast_rec_t *fast_decode(CPUArchState *env,
+                                         log_instr_fast_rec_t *rec)
+{
+    const char *name = (const char *)(uintptr_t)rec->addr;
+    uint32_t opcode;
+#ifdef TARGET_CHERI
+    cap_register_t cap;
+#endif
+
+    switch (rec->type) {
+    case LIF_EMPTY:
+        break;
+    case LIF_INSN:
+        qemu_log_instr_commit(env);
+        opcode = rec->info;
+        qemu_log_instr_asid(env, cpu_get_asid(env, rec->addr));
+        qemu_log_instr_paddr(env, rec->addr, rec->value, (char *)&opcode,
+                             LIF_INSN_BYTES(rec->size));
+        break;
+    case LIF_REG:
+        qemu_log_instr_reg(env, name, rec->value);
+        break;
+    case LIF_LOAD:
+        qemu_log_instr_ld_int(env, rec->addr, rec->info, rec->value);
+        break;
+    case LIF_STORE:
+        qemu_log_instr_st_int(env, rec->addr, rec->info, rec->value);
+        break;
+#ifdef TARGET_CHERI
+    case LIF_CAP_INT:
+        qemu_log_instr_cap_int(env, name, rec->value);
+        break;
+    case LIF_CAP:
+        memcpy(&cap, rec + 1, sizeof(cap));
+        qemu_log_instr_cap(env, name, &cap);
+        rec += rec->size;
+        break;
+    case LIF_LOAD_CAP:
+        memcpy(&cap, rec + 1, sizeof(cap));
+        qemu_log_instr_ld_cap(env, rec->addr, &cap);
+        rec += rec->size;
+        break;
+    case LIF_STORE_CAP:
+        memcpy(&cap, rec + 1, sizeof(cap));
+        qemu_log_instr_st_cap(env, rec->addr, &cap);
+        rec += rec->size;
+        break;
+#endif
+    default:
+        g_assert_not_reached();
+    }
+    return rec;
+}
+
+/*
+ * Decode the records written since the last sync.
+ * The reserved records of the last instruction that are still empty may be
+ * written after this returns, if we are called from a helper of that
+ * instruction. They are remembered in fast_pending and decoded by the next
+ * sync, until the header of another instruction is decoded. Records in the
+ * pending range are cleared once decoded, so that they are not seen twice.
+ */
+void qemu_log_instr_fast_sync(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    log_instr_fast_rec_t *insn_end = NULL;
+    log_instr_fast_rec_t *rec;
+
+    if (cpulog->fast_buf == NULL || cpulog->fast_draining) {
+        return;
+    }
+
+    cpulog->fast_draining = true;
+    for (rec = cpulog->fast_pending; rec < cpulog->fast_pending_end; rec++) {
+        if (rec->type != LIF_EMPTY) {
+            fast_decode(env, rec);
+            rec->type = LIF_EMPTY;
+        }
+    }
+    for (rec = cpulog->fast_drained; rec < cpulog->fast_ptr; rec++) {
+        if (rec->type == LIF_INSN) {
+            insn_end = rec + LIF_INSN_RECS(rec->size);
+            cpulog->fast_pending = NULL;
+            cpulog->fast_pending_end = NULL;
+        } else if (rec < insn_end && rec->type == LIF_EMPTY &&
+                   cpulog->fast_pending == NULL) {
+            cpulog->fast_pending = rec;
+            cpulog->fast_pending_end = insn_end;
+        } else if (rec < cpulog->fast_pending_end) {
+            fast_decode(env, rec);
+            rec->type = LIF_EMPTY;
+            continue;
+        }
+        rec = fast_decode(env, rec);
+    }
+    cpulog->fast_drained = cpulog->fast_ptr;
+    cpulog->fast_draining = false;
+}
+
+/*
+ * Decode the buffer and reuse it from the start.
+ * This must only be called between TBs, when no instruction has records
+ * reserved in the buffer.
+ */
+void qemu_log_instr_fast_rewind(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+
+    if (cpulog->fast_buf == NULL) {
+        return;
+    }
+    qemu_log_instr_fast_sync(env);
+    memset(cpulog->fast_buf, 0,
+           (char *)cpulog->fast_ptr - (char *)cpulog->fast_buf);
+    cpulog->fast_ptr = cpulog->fast_buf;
+    cpulog->fast_drained = cpulog->fast_buf;
+    cpulog->fast_pending = NULL;
+    cpulog->fast_pending_end = NULL;
+}
+
+bool qemu_log_instr_fast_append(CPUArchState *env, int type,
+                                uint64_t addr, uint64_t value, uint32_t info,
+                                const void *payload, size_t len)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    size_t npayload = DIV_ROUND_UP(len, FAST_REC_SIZE);
+    log_instr_fast_rec_t *rec = cpulog->fast_ptr;
+
+    if (cpulog->fast_buf == NULL || cpulog->fast_draining) {
+        return false;
+    }
+    if (rec + 1 + npayload > cpulog->fast_end) {
+        QEMU_LOG_INSTR_INC_STAT(cpulog, fast_dropped);
+        return true;
+    }
+    rec->addr = addr;
+    rec->value = value;
+    rec->info = info;
+    rec->type = type;
+    rec->size = npayload;
+    if (len) {
+        memcpy(rec + 1, payload, len);
+    }
+    cpulog->fast_ptr = rec + 1 + npayload;
+    return true;
+}
+
+void helper_qemu_log_instr_fast_flush(CPUArchState *env)
+{
+    qemu_log_instr_fast_rewind(env);
+}
+
+/* Code generation */
+
+static void gen_fast_close_insn(TCGContext *s)
+{
+    if (s->log_fast_insn_slots) {
+        g_assert(s->log_fast_insn_slots <= LIF_INSN_MAX_RECS);
+        tcg_set_insn_param(s->log_fast_insn_op, 1,
+                           s->log_fast_insn_slots * FAST_REC_SIZE);
+        tcg_set_insn_param(s->log_fast_hdr_op, 1,
+                           LIF_HEADER(LIF_INSN,
+                                      LIF_INSN_SIZE(s->log_fast_insn_bytes,
+                                                    s->log_fast_insn_slots)));
+        s->log_fast_tb_slots += s->log_fast_insn_slots;
+        s->log_fast_insn_slots = 0;
+    }
+}
+
+/*
+ * Store the type and size of the n-th record, this marks it valid.
+ * Returns the op that loads the header constant.
+ */
+static TCGOp *gen_fast_header(TCGContext *s, int n,
+                              log_instr_fast_type_t type, int size)
+{
+    TCGv_i32 hdr = tcg_const_i32(LIF_HEADER(type, size));
+    TCGOp *op = tcg_last_op();
+
+    tcg_gen_st_i32(hdr, s->log_fast_cur, REC_OFFSET(n, type));
+    tcg_temp_free_i32(hdr);
+    return op;
+}
+
+void gen_log_instr_fast_tb_start(CPUState *cpu)
+{
+    TCGContext *s = tcg_ctx;
+    TCGv_ptr end = tcg_temp_new_ptr();
+    TCGv_ptr limit = tcg_temp_new_ptr();
+    TCGLabel *fits = gen_new_label();
+
+    s->log_fast_cur = tcg_temp_local_new_ptr();
+    s->log_fast_tb_slots = 0;
+    s->log_fast_insn_slots = 0;
+    s->log_fast_cpu = cpu;
+    s->log_fast_vpage = -1;
+
+    /* Patched in gen_log_instr_fast_tb_end() */
+    tcg_gen_movi_ptr(end, 0xdeadbeef);
+    s->log_fast_tb_op = tcg_last_op();
+    tcg_gen_ld_ptr(limit, cpu_env, LOG_STATE_OFFSET(fast_ptr));
+    tcg_gen_add_ptr(end, end, limit);
+    tcg_gen_ld_ptr(limit, cpu_env, LOG_STATE_OFFSET(fast_limit));
+    tcg_gen_brcond_ptr(TCG_COND_LEU, end, limit, fits);
+    gen_helper_qemu_log_instr_fast_flush(cpu_env);
+    gen_set_label(fits);
+
+    tcg_temp_free_ptr(end);
+    tcg_temp_free_ptr(limit);
+}
+
+void gen_log_instr_fast_tb_end(void)
+{
+    TCGContext *s = tcg_ctx;
+
+    gen_fast_close_insn(s);
+    tcg_set_insn_param(s->log_fast_tb_op, 1,
+                       s->log_fast_tb_slots * FAST_REC_SIZE);
+    tcg_temp_free_ptr(s->log_fast_cur);
+    s->log_fast_cur = NULL;
+}
+
+void gen_log_instr_fast_insn(target_ulong pc, uint32_t opcode, int size)
+{
+    TCGContext *s = tcg_ctx;
+    TCGv_ptr next = tcg_temp_new_ptr();
+    TCGv_i64 t64 = tcg_temp_new_i64();
+    TCGv_i32 t32;
+    uint64_t paddr = -1;
+
+    gen_fast_close_insn(s);
+
+    /*
+     * Reserve the records of this instruction up front, so that they are
+     * not reused if it raises an exception halfway through.
+     */
+    tcg_gen_ld_ptr(s->log_fast_cur, cpu_env, LOG_STATE_OFFSET(fast_ptr));
+    tcg_gen_movi_ptr(next, 0xdeadbeef);
+    s->log_fast_insn_op = tcg_last_op();
+    tcg_gen_add_ptr(next, next, s->log_fast_cur);
+    tcg_gen_st_ptr(next, cpu_env, LOG_STATE_OFFSET(fast_ptr));
+
+#ifndef CONFIG_USER_ONLY
+    /*
+     * TBs are looked up by physical address, so the mapping seen now holds
+     * whenever this TB runs.
+     */
+    if ((pc & TARGET_PAGE_MASK) != s->log_fast_vpage) {
+        s->log_fast_vpage = pc & TARGET_PAGE_MASK;
+        s->log_fast_ppage = cpu_get_phys_page_debug(s->log_fast_cpu,
+                                                    s->log_fast_vpage);
+    }
+    if (s->log_fast_ppage != -1) {
+        paddr = s->log_fast_ppage + (pc & ~TARGET_PAGE_MASK);
+    }
+#endif
+
+    tcg_gen_movi_i64(t64, pc);
+    tcg_gen_st_i64(t64, s->log_fast_cur, REC_OFFSET(0, addr));
+    tcg_gen_movi_i64(t64, paddr);
+    tcg_gen_st_i64(t64, s->log_fast_cur, REC_OFFSET(0, value));
+    t32 = tcg_const_i32(opcode);
+    tcg_gen_st_i32(t32, s->log_fast_cur, REC_OFFSET(0, info));
+    /* Patched with the reserved records in gen_fast_close_insn() */
+    s->log_fast_hdr_op = gen_fast_header(s, 0, LIF_INSN, 0);
+    s->log_fast_insn_bytes = size;
+    s->log_fast_insn_slots = 1;
+
+    tcg_temp_free_ptr(next);
+    tcg_temp_free_i64(t64);
+    tcg_temp_free_i32(t32);
+}
+
+bool gen_log_instr_fast_reg(const char *reg_name, TCGv value)
+{
+    TCGContext *s = tcg_ctx;
+    int n = s->log_fast_insn_slots;
+    TCGv_i64 t64;
+
+    if (n == 0) {
+        return false;
+    }
+
+    t64 = tcg_const_i64((uintptr_t)reg_name);
+    tcg_gen_st_i64(t64, s->log_fast_cur, REC_OFFSET(n, addr));
+    tcg_gen_extu_tl_i64(t64, value);
+    tcg_gen_st_i64(t64, s->log_fast_cur, REC_OFFSET(n, value));
+    gen_fast_header(s, n, LIF_REG, 0);
+    tcg_temp_free_i64(t64);
+    s->log_fast_insn_slots++;
+    return true;
+}
+
+bool gen_log_instr_fast_mem(TCGv_cap_checked_ptr addr, TCGv_i64 value,
+                            TCGMemOpIdx oi, bool store)
+{
+    TCGContext *s = tcg_ctx;
+    int n = s->log_fast_insn_slots;
+    TCGv_i64 t64;
+    TCGv_i32 t32;
+
+    if (n == 0) {
+        return false;
+    }
+
+    t64 = tcg_temp_new_i64();
+    tcg_gen_extu_tl_i64(t64, (TCGv)addr);
+    tcg_gen_st_i64(t64, s->log_fast_cur, REC_OFFSET(n, addr));
+    tcg_gen_st_i64(value, s->log_fast_cur, REC_OFFSET(n, value));
+    t32 = tcg_const_i32(oi);
+    tcg_gen_st_i32(t32, s->log_fast_cur, REC_OFFSET(n, info));
+    gen_fast_header(s, n, store ? LIF_STORE : LIF_LOAD, 0);
+    tcg_temp_free_i64(t64);
+    tcg_temp_free_i32(t32);
+    s->log_fast_insn_slots++;
+    return true;
+}
+
+bool gen_log_instr_fast_mem_i32(TCGv_cap_checked_ptr addr, TCGv_i32 value,
+                                TCGMemOpIdx oi, bool store)
+{
+    TCGv_i64 t64;
+    bool handled;
+
+    if (tcg_ctx->log_fast_insn_slots == 0) {
+        return false;
+    }
+
+    t64 = tcg_temp_new_i64();
+    tcg_gen_extu_i32_i64(t64, value);
+    handled = gen_log_instr_fast_mem(addr, t64, oi, store);
+    tcg_temp_free_i64(t64);
+    return handled;
+}
+
+#endif /* CONFIG_TCG_LOG_INSTR */
@@ -163,6 +163,35 @@ static void emit_json_evt_regdump(const log_event_regdump_t *evt, cJSON *list)
     cJSON_AddItemToObject(list, "rdump", regdump);
 }
 
+/*
+ * Instruction dictionary definition, emitted as a separate list element
+ * before the first entry that refers to it with "insn_id".
+ */
+static void emit_json_insn_def(CPUArchState *env, log_instr_dict_entry_t *def)
+{
+    cJSON *js_def = cJSON_CreateObject();
+    char bytes[sizeof(def->insn_bytes) * 2 + 1];
+    char *str;
+    int i;
+
+    for (i = 0; i < def->insn_size; i++) {
+        snprintf(&bytes[i * 2], 3, "%02x", (uint8_t)def->insn_bytes[i]);
+    }
+    bytes[def->insn_size * 2] = '\0';
+
+    cJSON_AddItemToObject(js_def, "def", cJSON_CreateNumber(def->id));
+    cJSON_AddItemToObject(js_def, "cpu",
+                          cJSON_CreateNumber(env_cpu(env)->cpu_index));
+    cJSON_AddItemToObject(js_def, "paddr", emit_json_hex(def->paddr));
+    cJSON_AddItemToObject(js_def, "pc", emit_json_hex(def->pc));
+    cJSON_AddItemToObject(js_def, "bytes", cJSON_CreateString(bytes));
+    cJSON_AddItemToObject(js_def, "insn", cJSON_CreateString(def->disas));
+    str = cJSON_PrintUnformatted(js_def);
+    qemu_log("%s,", str);
+    cJSON_free(str);
+    cJSON_Delete(js_def);
+}
+
 void sync_json_backend(CPUArchState *env)
 {
     /*
@@ -173,13 +202,20 @@ void sync_json_backend(CPUArchState *env)
     qemu_log("{}]");
 }
 
+static bool json_initialized;
+
 void init_json_backend(CPUArchState *env)
 {
     /* Initialize the json logfile */
-    static bool initialized;
+    if (!json_initialized) {
+        json_initialized = true;
+        qemu_log("[");
+    }
+}
 
-    if (!initialized) {
-        initialized = true;
+void reopen_json_backend(void)
+{
+    if (json_initialized) {
         qemu_log("[");
     }
 }
@@ -187,6 +223,7 @@ void init_json_backend(CPUArchState *env)
 void emit_json_entry(CPUArchState *env, cpu_log_entry_t *entry)
 {
     const log_event_t *event;
+    char *str;
     int i;
 
     /*
@@ -199,13 +236,25 @@ void emit_json_entry(CPUArchState *env, cpu_log_entry_t *entry)
         cJSON *pc = emit_json_hex(entry->pc);
         cJSON *cpu = cJSON_CreateNumber(env_cpu(env)->cpu_index);
         cJSON *asid = cJSON_CreateNumber(entry->asid);
-        cJSON *insn = cJSON_CreateString(
-            disas_one_strbuf(env_cpu(env), entry->insn_bytes,
-                             sizeof(entry->insn_bytes), entry->pc));
         cJSON_AddItemToObject(js_entry, "pc", pc);
         cJSON_AddItemToObject(js_entry, "cpu", cpu);
         cJSON_AddItemToObject(js_entry, "asid", asid);
-        cJSON_AddItemToObject(js_entry, "insn", insn);
+        if (qemu_log_instr_insn_dict_enabled()) {
+            bool is_new;
+            log_instr_dict_entry_t *def =
+                qemu_log_instr_dict_lookup(env, entry, &is_new);
+
+            if (is_new) {
+                emit_json_insn_def(env, def);
+            }
+            cJSON_AddItemToObject(js_entry, "insn_id",
+                                  cJSON_CreateNumber(def->id));
+        } else {
+            cJSON *insn = cJSON_CreateString(
+                disas_one_strbuf(env_cpu(env), entry->insn_bytes,
+                                 sizeof(entry->insn_bytes), entry->pc));
+            cJSON_AddItemToObject(js_entry, "insn", insn);
+        }
 
         if (entry->flags & LI_FLAG_MODE_SWITCH) {
             cJSON *mode =
@@ -284,6 +333,8 @@ void emit_json_entry(CPUArchState *env, cpu_log_entry_t *entry)
         }
         cJSON_AddItemToObject(js_entry, "evt", js_evt);
     }
-    qemu_log("%s,", cJSON_PrintUnformatted(js_entry));
+    str = cJSON_PrintUnformatted(js_entry);
+    qemu_log("%s,", str);
+    cJSON_free(str);
     cJSON_Delete(js_entry);
 }
@@ -47,6 +47,7 @@
 #include "qemu_log_entry.pb-c.h"
 
 static FILE *protobuf_logfile;
+static char *protobuf_logfile_name;
 
 /*
  * Helpers to simplify access to namespaced protobuf values
@@ -265,11 +266,24 @@ void init_protobuf_backend(CPUArchState *env)
      * data so that we avoid all the g_malloc() and g_free().
      */
 
-    if (protobuf_logfile == NULL) {
+    if (protobuf_logfile == NULL && !qemu_log_instr_chunked_enabled()) {
         protobuf_logfile = fopen("qemu-trace.pb", "w+b");
     }
 }
 
+void reopen_protobuf_backend(void)
+{
+    g_autofree char *path = NULL;
+
+    if (protobuf_logfile == NULL) {
+        return;
+    }
+    path = qemu_log_instr_fork_path(protobuf_logfile_name ?
+                                    protobuf_logfile_name : "qemu-trace.pb");
+    fclose(protobuf_logfile);
+    protobuf_logfile = fopen(path, "w+b");
+}
+
 void sync_protobuf_backend(CPUArchState *env)
 {
     if (protobuf_logfile != NULL) {
@@ -293,8 +307,20 @@ void emit_protobuf_entry(CPUArchState *env, cpu_log_entry_t *entry)
 
     if (entry->flags & LI_FLAG_HAS_INSTR_DATA) {
         pb_entry.insn_case = ENUM_ENTRY_INSN_CASE(DISAS);
-        pb_entry.disas = disas_one_strbuf(env_cpu(env), entry->insn_bytes,
-                                          sizeof(entry->insn_bytes), entry->pc);
+        if (qemu_log_instr_insn_dict_enabled()) {
+            /*
+             * The message has no field for a dictionary id, only reuse the
+             * disassembly. This is owned by the dictionary.
+             */
+            bool is_new;
+
+            pb_entry.disas =
+                qemu_log_instr_dict_lookup(env, entry, &is_new)->disas;
+        } else {
+            pb_entry.disas = disas_one_strbuf(env_cpu(env), entry->insn_bytes,
+                                              sizeof(entry->insn_bytes),
+                                              entry->pc);
+        }
         pb_entry.cpu = env_cpu(env)->cpu_index;
         pb_entry.asid = entry->asid;
         if (entry->flags & LI_FLAG_MODE_SWITCH) {
@@ -363,12 +389,19 @@ void emit_protobuf_entry(CPUArchState *env, cpu_log_entry_t *entry)
      * Technically we should not use the qemu logfile as it is not open in
      * binary mode
      */
-    qemu_flockfile(protobuf_logfile);
-    fwrite(buf, len + sizeof(preamble), 1, protobuf_logfile);
-    qemu_funlockfile(protobuf_logfile);
+    if (qemu_log_instr_chunked_enabled()) {
+        qemu_log_instr_chunk_begin(env, entry);
+        qemu_log_instr_chunk_append(env, buf, len + sizeof(preamble));
+    } else {
+        qemu_flockfile(protobuf_logfile);
+        fwrite(buf, len + sizeof(preamble), 1, protobuf_logfile);
+        qemu_funlockfile(protobuf_logfile);
+    }
 
     if (entry->flags & LI_FLAG_HAS_INSTR_DATA) {
-        g_free(pb_entry.disas);
+        if (!qemu_log_instr_insn_dict_enabled()) {
+            g_free(pb_entry.disas);
+        }
 
         if (entry->mem->len > 0) {
             for (i = 0; i < entry->mem->len; i++) {
@@ -394,5 +427,7 @@ void emit_protobuf_entry(CPUArchState *env, cpu_log_entry_t *entry)
 
 void qemu_log_instr_protobuf_conf_logfile(const char *name)
 {
+    g_free(protobuf_logfile_name);
+    protobuf_logfile_name = g_strdup(name);
     protobuf_logfile = fopen(name, "w+b");
 }
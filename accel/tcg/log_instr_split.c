@@ -0,0 +1,306 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Per guest context trace output.
+ *
+ * When enabled, trace entries are routed to a separate output file for each
+ * guest process or compartment, based on the context tracked from
+ * LOG_EVENT_CTX_UPDATE events. Each stream owns a writer thread so that
+ * vCPUs only append to an in-memory buffer and never block on file I/O
+ * unless the writer falls too far behind.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/thread.h"
+#include "qemu/units.h"
+#include "qemu/error-report.h"
+#include "qapi/error.h"
+#include "cpu.h"
+#include "exec/log_instr.h"
+#include "exec/log_instr_internal.h"
+
+#ifdef CONFIG_TCG_LOG_INSTR
+
+/* Wake up the writer when this much data is pending */
+#define STREAM_WRITE_THRESHOLD (1 * MiB)
+/* Stall the producer when the writer is this far behind */
+#define STREAM_HIGH_WATERMARK (64 * MiB)
+
+typedef enum {
+    SPLIT_NONE,
+    SPLIT_BY_PID,
+    SPLIT_BY_CID,
+} split_key_t;
+
+struct qemu_log_instr_stream {
+    uint64_t key;
+    FILE *fp;
+    QemuThread thread;
+    QemuMutex lock;
+    /* Signalled when data is pending or the writer must exit */
+    QemuCond data_cond;
+    /* Signalled when the writer has drained a buffer */
+    QemuCond done_cond;
+    /* Buffer filled by the vCPUs, protected by lock */
+    GByteArray *pending;
+    /* Buffer owned by the writer thread */
+    GByteArray *spare;
+    bool busy;
+    bool flush;
+    /* Set on exit, the writer drains the pending data and stops */
+    bool exit;
+};
+
+static split_key_t split_key = SPLIT_NONE;
+static char *split_dir;
+/* Set in forked children, whose streams must not clash with each other */
+static int split_pid;
+static const char *split_key_name[] = { "", "pid", "cid" };
+
+/* Map key -> qemu_log_instr_stream_t, protected by streams_lock */
+static GHashTable *streams;
+static QemuMutex streams_lock;
+
+static void *stream_writer_thread(void *opaque)
+{
+    qemu_log_instr_stream_t *stream = opaque;
+    GByteArray *tmp;
+
+    qemu_mutex_lock(&stream->lock);
+    while (true) {
+        while (!stream->flush && !stream->exit &&
+               stream->pending->len < STREAM_WRITE_THRESHOLD) {
+            qemu_cond_wait(&stream->data_cond, &stream->lock);
+        }
+        if (stream->exit && stream->pending->len == 0) {
+            break;
+        }
+        stream->flush = false;
+        tmp = stream->pending;
+        stream->pending = stream->spare;
+        stream->spare = tmp;
+        stream->busy = true;
+        qemu_mutex_unlock(&stream->lock);
+
+        if (tmp->len > 0) {
+            fwrite(tmp->data, tmp->len, 1, stream->fp);
+            g_byte_array_set_size(tmp, 0);
+        }
+        fflush(stream->fp);
+
+        qemu_mutex_lock(&stream->lock);
+        stream->busy = false;
+        qemu_cond_broadcast(&stream->done_cond);
+    }
+    qemu_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+static qemu_log_instr_stream_t *stream_new(uint64_t key, const char *suffix)
+{
+    qemu_log_instr_stream_t *stream = g_new0(qemu_log_instr_stream_t, 1);
+    g_autofree char *name = NULL;
+    g_autofree char *path = NULL;
+
+    if (split_pid) {
+        name = g_strdup_printf("trace-%s%" PRIu64 ".%d.%s",
+                               split_key_name[split_key], key, split_pid,
+                               suffix);
+    } else {
+        name = g_strdup_printf("trace-%s%" PRIu64 ".%s",
+                               split_key_name[split_key], key, suffix);
+    }
+    path = g_build_filename(split_dir ? split_dir : ".", name, NULL);
+    stream->fp = fopen(path, "wb");
+    if (stream->fp == NULL) {
+        error_report("Could not open trace output %s: %s", path,
+                     strerror(errno));
+        exit(1);
+    }
+    stream->key = key;
+    stream->pending = g_byte_array_sized_new(STREAM_WRITE_THRESHOLD);
+    stream->spare = g_byte_array_sized_new(STREAM_WRITE_THRESHOLD);
+    qemu_mutex_init(&stream->lock);
+    qemu_cond_init(&stream->data_cond);
+    qemu_cond_init(&stream->done_cond);
+    qemu_thread_create(&stream->thread, "trace-writer", stream_writer_thread,
+                       stream, QEMU_THREAD_JOINABLE);
+    return stream;
+}
+
+void qemu_log_instr_split_after_fork(void)
+{
+    /* Streams are only created once the vCPUs run, none is open yet */
+    split_pid = getpid();
+}
+
+bool qemu_log_instr_split_enabled(void)
+{
+    return split_key != SPLIT_NONE;
+}
+
+qemu_log_instr_stream_t *
+qemu_log_instr_get_stream(CPUArchState *env, cpu_log_entry_t *entry,
+                          const char *suffix,
+                          qemu_log_instr_stream_init_fn_t init)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    qemu_log_instr_stream_t *stream = cpulog->split_stream;
+    uint64_t key;
+
+    if (split_key == SPLIT_NONE) {
+        return NULL;
+    }
+    key = (split_key == SPLIT_BY_PID) ? entry->ctx_pid : entry->ctx_cid;
+    /* Fast path, the context did not change since the last entry */
+    if (likely(stream != NULL && stream->key == key)) {
+        return stream;
+    }
+
+    qemu_mutex_lock(&streams_lock);
+    stream = g_hash_table_lookup(streams, &key);
+    if (stream == NULL) {
+        stream = stream_new(key, suffix);
+        g_hash_table_insert(streams, &stream->key, stream);
+        if (init) {
+            init(stream);
+        }
+    }
+    qemu_mutex_unlock(&streams_lock);
+    cpulog->split_stream = stream;
+    return stream;
+}
+
+void qemu_log_instr_stream_write(qemu_log_instr_stream_t *stream,
+                                 const void *data, size_t len)
+{
+    qemu_mutex_lock(&stream->lock);
+    if (unlikely(stream->exit)) {
+        /* Entries committed by vCPUs still running at exit are dropped */
+        qemu_mutex_unlock(&stream->lock);
+        return;
+    }
+    while (stream->pending->len >= STREAM_HIGH_WATERMARK) {
+        stream->flush = true;
+        qemu_cond_signal(&stream->data_cond);
+        qemu_cond_wait(&stream->done_cond, &stream->lock);
+    }
+    g_byte_array_append(stream->pending, data, len);
+    if (stream->pending->len >= STREAM_WRITE_THRESHOLD) {
+        qemu_cond_signal(&stream->data_cond);
+    }
+    qemu_mutex_unlock(&stream->lock);
+}
+
+static void stream_sync(gpointer key, gpointer value, gpointer opaque)
+{
+    qemu_log_instr_stream_t *stream = value;
+
+    qemu_mutex_lock(&stream->lock);
+    if (stream->exit) {
+        qemu_mutex_unlock(&stream->lock);
+        return;
+    }
+    stream->flush = true;
+    qemu_cond_signal(&stream->data_cond);
+    while (stream->flush || stream->busy) {
+        qemu_cond_wait(&stream->done_cond, &stream->lock);
+    }
+    qemu_mutex_unlock(&stream->lock);
+}
+
+void qemu_log_instr_sync_streams(void)
+{
+    if (split_key == SPLIT_NONE) {
+        return;
+    }
+    qemu_mutex_lock(&streams_lock);
+    g_hash_table_foreach(streams, stream_sync, NULL);
+    qemu_mutex_unlock(&streams_lock);
+}
+
+static void stream_close(gpointer key, gpointer value, gpointer opaque)
+{
+    qemu_log_instr_stream_t *stream = value;
+
+    qemu_mutex_lock(&stream->lock);
+    stream->exit = true;
+    qemu_cond_signal(&stream->data_cond);
+    qemu_mutex_unlock(&stream->lock);
+    qemu_thread_join(&stream->thread);
+    /* Release producers that were waiting for the writer */
+    qemu_cond_broadcast(&stream->done_cond);
+    if (fclose(stream->fp) != 0) {
+        error_report("Failed to close trace output: %s", strerror(errno));
+    }
+    stream->fp = NULL;
+}
+
+/*
+ * Stop the writer threads and close the files. The streams are not freed
+ * since vCPUs may still hold a reference in their split_stream.
+ */
+static void close_streams(void)
+{
+    qemu_mutex_lock(&streams_lock);
+    g_hash_table_foreach(streams, stream_close, NULL);
+    qemu_mutex_unlock(&streams_lock);
+}
+
+void qemu_log_instr_set_split_output(const char *spec, Error **errp)
+{
+    gchar **opts = g_strsplit(spec, ",", 0);
+    int i;
+
+    for (i = 0; opts[i]; i++) {
+        if (strcmp(opts[i], "by=pid") == 0) {
+            split_key = SPLIT_BY_PID;
+        } else if (strcmp(opts[i], "by=cid") == 0) {
+            split_key = SPLIT_BY_CID;
+        } else if (g_str_has_prefix(opts[i], "dir=")) {
+            g_free(split_dir);
+            split_dir = g_strdup(opts[i] + strlen("dir="));
+        } else {
+            error_setg(errp, "Invalid trace split option '%s'", opts[i]);
+            g_strfreev(opts);
+            return;
+        }
+    }
+    g_strfreev(opts);
+
+    if (split_key == SPLIT_NONE) {
+        error_setg(errp, "Trace split requires by=pid or by=cid");
+        return;
+    }
+    if (streams == NULL) {
+        streams = g_hash_table_new(g_int64_hash, g_int64_equal);
+        qemu_mutex_init(&streams_lock);
+        atexit(close_streams);
+    }
+}
+
+#endif /* CONFIG_TCG_LOG_INSTR */
@@ -32,20 +32,119 @@
 
 /*
  * Text instruction logging backend
+ *
+ * Each CPU formats its entries into a private buffer, without holding the
+ * log lock. In the default mode the buffer is written to the qemu log once
+ * per entry, so that entries from different CPUs are not interleaved.
+ * With -cheri-trace-text-per-cpu, each CPU writes to its own file and the
+ * buffer is only flushed when it grows past TEXT_FLUSH_SIZE.
  */
 
 #include "qemu/osdep.h"
 #include "qemu/log.h"
+#include "qemu/timer.h"
+#include "qemu/error-report.h"
+#include "qemu-common.h"
+#include "qapi/error.h"
 #include "cpu.h"
 #include "exec/log_instr.h"
 #include "exec/log_instr_internal.h"
 #include "exec/memop.h"
 #include "disas/disas.h"
 
+/* Per-CPU log files are written in chunks of at least this size */
+#define TEXT_FLUSH_SIZE (1 << 20)
+/* Room for the disassembly of a single instruction */
+#define TEXT_DISAS_SIZE 512
+
+/* Number of hex digits printed by TARGET_FMT_lx */
+#define TEXT_TL_DIGITS (TARGET_LONG_BITS / 4)
+
+typedef struct {
+    /* Per-CPU log file descriptor, -1 when writing to the qemu log */
+    int fd;
+    /* Formatted text not yet written out */
+    GString *buf;
+    /* Memory stream the disassembler prints to */
+    FILE *disas_stream;
+    char disas_buf[TEXT_DISAS_SIZE];
+} text_backend_state_t;
+
+/* Per-CPU file name pattern, split around the %d for the CPU index */
+static char *per_cpu_prefix;
+static char *per_cpu_suffix;
+/* Prefix each entry with a host timestamp line, for merging per-CPU files */
+static bool per_cpu_timestamps;
+
+static const char text_hex_digits[] = "0123456789abcdef";
+
+static inline text_backend_state_t *get_text_state(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    return (text_backend_state_t *)cpulog->backend_data;
+}
+
+/*
+ * Append @value in hex, zero-padded to @width digits.
+ */
+static inline void text_hex(GString *buf, uint64_t value, int width)
+{
+    char tmp[16];
+    int n = 0;
+
+    do {
+        tmp[15 - n++] = text_hex_digits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    while (n < width) {
+        tmp[15 - n++] = '0';
+    }
+    g_string_append_len(buf, tmp + 16 - n, n);
+}
+
+/*
+ * Append @value in decimal.
+ */
+static inline void text_dec(GString *buf, uint64_t value)
+{
+    char tmp[20];
+    int n = 0;
+
+    do {
+        tmp[19 - n++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    g_string_append_len(buf, tmp + 20 - n, n);
+}
+
+static void text_write_out(text_backend_state_t *ts)
+{
+    FILE *logfile;
+
+    if (ts->buf->len == 0) {
+        return;
+    }
+    if (ts->fd >= 0) {
+        if (qemu_write_full(ts->fd, ts->buf->str, ts->buf->len) !=
+            ts->buf->len) {
+            warn_report_once("Failed to write per-CPU instruction log: %s",
+                             strerror(errno));
+        }
+    } else {
+        logfile = qemu_log_lock();
+        if (logfile) {
+            fwrite(ts->buf->str, ts->buf->len, 1, logfile);
+        }
+        qemu_log_unlock(logfile);
+    }
+    g_string_truncate(ts->buf, 0);
+}
+
 /*
  * Emit textual trace representation of memory access
  */
-static inline void emit_text_ldst(log_meminfo_t *minfo, const char *direction)
+static inline void emit_text_ldst(GString *buf, log_meminfo_t *minfo,
+                                  const char *direction)
 {
 
 #ifndef TARGET_CHERI
@@ -53,42 +152,39 @@ static inline void emit_text_ldst(log_meminfo_t *minfo, const char *direction)
                "Capability memory access without CHERI support");
 #else
     if (minfo->flags & LMI_CAP) {
-        qemu_log("    Cap Memory %s [" TARGET_FMT_lx
-                 "] = v:%d PESBT:" TARGET_FMT_lx " Cursor:" TARGET_FMT_lx "\n",
-                 direction, minfo->addr, minfo->cap.cr_tag,
-                 CAP_cc(compress_mem)(&minfo->cap),
-                 cap_get_cursor(&minfo->cap));
+        g_string_append_printf(
+            buf, "    Cap Memory %s [" TARGET_FMT_lx
+            "] = v:%d PESBT:" TARGET_FMT_lx " Cursor:" TARGET_FMT_lx "\n",
+            direction, minfo->addr, minfo->cap.cr_tag,
+            CAP_cc(compress_mem)(&minfo->cap), cap_get_cursor(&minfo->cap));
     } else
 #endif
     {
-        switch (memop_size(minfo->op)) {
-        default:
-            qemu_log("    Unknown memory access width\n");
-            /* fallthrough */
-        case 8:
-            qemu_log("    Memory %s [" TARGET_FMT_lx "] = " TARGET_FMT_plx "\n",
-                     direction, minfo->addr, minfo->value);
-            break;
-        case 4:
-            qemu_log("    Memory %s [" TARGET_FMT_lx "] = %08x\n", direction,
-                     minfo->addr, (uint32_t)minfo->value);
-            break;
-        case 2:
-            qemu_log("    Memory %s [" TARGET_FMT_lx "] = %04x\n", direction,
-                     minfo->addr, (uint16_t)minfo->value);
-            break;
-        case 1:
-            qemu_log("    Memory %s [" TARGET_FMT_lx "] = %02x\n", direction,
-                     minfo->addr, (uint8_t)minfo->value);
-            break;
+        int size = memop_size(minfo->op);
+
+        if (size != 1 && size != 2 && size != 4 && size != 8) {
+            g_string_append(buf, "    Unknown memory access width\n");
+            size = 8;
         }
+        g_string_append(buf, "    Memory ");
+        g_string_append(buf, direction);
+        g_string_append(buf, " [");
+        text_hex(buf, minfo->addr, TEXT_TL_DIGITS);
+        g_string_append(buf, "] = ");
+        if (size < 8) {
+            text_hex(buf, minfo->value & MAKE_64BIT_MASK(0, size * 8),
+                     size * 2);
+        } else {
+            text_hex(buf, minfo->value, 16);
+        }
+        g_string_append_c(buf, '\n');
     }
 }
 
 /*
  * Emit textual trace representation of register modification
  */
-static inline void emit_text_reg(log_reginfo_t *rinfo)
+static inline void emit_text_reg(GString *buf, log_reginfo_t *rinfo)
 {
 #ifndef TARGET_CHERI
     log_assert(!reginfo_is_cap(rinfo) && "Register marked as capability "
@@ -96,20 +192,108 @@ static inline void emit_text_reg(log_reginfo_t *rinfo)
 #else
     if (reginfo_is_cap(rinfo)) {
         if (reginfo_has_cap(rinfo))
-            qemu_log("    Write %s|" PRINT_CAP_FMTSTR_L1 "\n"
-                     "             |" PRINT_CAP_FMTSTR_L2 "\n",
-                     rinfo->name, PRINT_CAP_ARGS_L1(&rinfo->cap),
-                     PRINT_CAP_ARGS_L2(&rinfo->cap));
+            g_string_append_printf(buf, "    Write %s|" PRINT_CAP_FMTSTR_L1 "\n"
+                                   "             |" PRINT_CAP_FMTSTR_L2 "\n",
+                                   rinfo->name, PRINT_CAP_ARGS_L1(&rinfo->cap),
+                                   PRINT_CAP_ARGS_L2(&rinfo->cap));
         else
-            qemu_log("  %s <- " TARGET_FMT_lx " (setting integer value)\n",
-                     rinfo->name, rinfo->gpr);
+            g_string_append_printf(buf, "  %s <- " TARGET_FMT_lx
+                                   " (setting integer value)\n",
+                                   rinfo->name, rinfo->gpr);
     } else
 #endif
     {
-        qemu_log("    Write %s = " TARGET_FMT_lx "\n", rinfo->name, rinfo->gpr);
+        g_string_append(buf, "    Write ");
+        g_string_append(buf, rinfo->name);
+        g_string_append(buf, " = ");
+        text_hex(buf, rinfo->gpr, TEXT_TL_DIGITS);
+        g_string_append_c(buf, '\n');
     }
 }
 
+/*
+ * Disassemble the instruction bytes of the entry into the output buffer.
+ * Note that we use the instruction info opcode bytes, without accessing
+ * target memory here.
+ */
+static void emit_text_disas(CPUArchState *env, text_backend_state_t *ts,
+                            cpu_log_entry_t *entry)
+{
+    long len;
+
+    rewind(ts->disas_stream);
+    target_disas_buf(ts->disas_stream, env_cpu(env), entry->insn_bytes,
+                     sizeof(entry->insn_bytes), entry->pc, 1);
+    fflush(ts->disas_stream);
+    len = ftell(ts->disas_stream);
+    if (len > 0) {
+        g_string_append_len(ts->buf, ts->disas_buf,
+                            MIN(len, sizeof(ts->disas_buf)));
+    }
+}
+
+static void text_open_per_cpu(text_backend_state_t *ts, const char *path)
+{
+    ts->fd = qemu_open_old(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (ts->fd < 0) {
+        error_report("Failed to open per-CPU instruction log %s: %s",
+                     path, strerror(errno));
+        exit(1);
+    }
+}
+
+void init_text_backend(CPUArchState *env)
+{
+    cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
+    text_backend_state_t *ts = g_new0(text_backend_state_t, 1);
+    g_autofree char *path = NULL;
+
+    ts->fd = -1;
+    ts->buf = g_string_sized_new(per_cpu_prefix ? TEXT_FLUSH_SIZE * 2 : 1024);
+    ts->disas_stream = fmemopen(ts->disas_buf, sizeof(ts->disas_buf), "w");
+    if (ts->disas_stream == NULL) {
+        error_report("Failed to create instruction log disassembly buffer: %s",
+                     strerror(errno));
+        exit(1);
+    }
+    if (per_cpu_prefix) {
+        path = g_strdup_printf("%s%d%s", per_cpu_prefix,
+                               env_cpu(env)->cpu_index, per_cpu_suffix);
+        text_open_per_cpu(ts, path);
+    }
+    cpulog->backend_data = ts;
+}
+
+void reopen_text_backend(void)
+{
+    CPUState *cpu;
+
+    if (per_cpu_prefix == NULL) {
+        return;
+    }
+    CPU_FOREACH(cpu) {
+        text_backend_state_t *ts = get_text_state(cpu->env_ptr);
+        g_autofree char *name = NULL;
+        g_autofree char *path = NULL;
+
+        if (ts == NULL || ts->fd < 0) {
+            continue;
+        }
+        name = g_strdup_printf("%s%d%s", per_cpu_prefix, cpu->cpu_index,
+                               per_cpu_suffix);
+        path = qemu_log_instr_fork_path(name);
+        close(ts->fd);
+        text_open_per_cpu(ts, path);
+    }
+}
+
+void sync_text_backend(CPUArchState *env)
+{
+    text_backend_state_t *ts = get_text_state(env);
+
+    text_write_out(ts);
+}
+
 /*
  * Emit textual representation of the instruction in the given
  * trace entry to the log.
@@ -117,27 +301,32 @@ static inline void emit_text_reg(log_reginfo_t *rinfo)
 void emit_text_instr(CPUArchState *env, cpu_log_entry_t *entry)
 {
     cpu_log_instr_state_t *cpulog = get_cpu_log_state(env);
-    QemuLogFile *logfile;
+    text_backend_state_t *ts = get_text_state(env);
+    GString *buf = ts->buf;
     const log_event_t *event;
     const char *log_state_op;
+    size_t entry_start = buf->len;
+    size_t ts_end;
     int i, j;
     bool incremental;
+    bool flush = false;
+
+    if (per_cpu_timestamps) {
+        g_string_append_c(buf, '@');
+        text_dec(buf, get_clock());
+        g_string_append_c(buf, '\n');
+    }
+    ts_end = buf->len;
 
     if (entry->flags & LI_FLAG_HAS_INSTR_DATA) {
         /* Dump CPU-ID:ASID + address */
-        qemu_log("[%d:%d] ", env_cpu(env)->cpu_index, entry->asid);
+        g_string_append_c(buf, '[');
+        text_dec(buf, env_cpu(env)->cpu_index);
+        g_string_append_c(buf, ':');
+        text_dec(buf, entry->asid);
+        g_string_append(buf, "] ");
 
-        /*
-         * Instruction disassembly, note that we use the instruction info
-         * opcode bytes, without accessing target memory here.
-         */
-        rcu_read_lock();
-        logfile = qatomic_rcu_read(&qemu_logfile);
-        if (logfile) {
-            target_disas_buf(logfile->fd, env_cpu(env), entry->insn_bytes,
-                             sizeof(entry->insn_bytes), entry->pc, 1);
-        }
-        rcu_read_unlock();
+        emit_text_disas(env, ts, entry);
 
         /*
          * TODO(am2419): what to do with injected instructions?
@@ -146,19 +335,21 @@ void emit_text_instr(CPUArchState *env, cpu_log_entry_t *entry)
 
         /* Dump mode switching info */
         if (entry->flags & LI_FLAG_MODE_SWITCH)
-            qemu_log("-> Switch to %s mode\n",
-                     cpu_get_mode_name(entry->next_cpu_mode));
+            g_string_append_printf(buf, "-> Switch to %s mode\n",
+                                   cpu_get_mode_name(entry->next_cpu_mode));
         /* Dump interrupt/exception info */
         switch (entry->flags & LI_FLAG_INTR_MASK) {
         case LI_FLAG_INTR_TRAP:
-            qemu_log("-> Exception #%u vector 0x" TARGET_FMT_lx
-                     " fault-addr 0x" TARGET_FMT_lx "\n",
-                     entry->intr_code, entry->intr_vector,
-                     entry->intr_faultaddr);
+            g_string_append_printf(buf, "-> Exception #%u vector 0x"
+                                   TARGET_FMT_lx " fault-addr 0x"
+                                   TARGET_FMT_lx "\n",
+                                   entry->intr_code, entry->intr_vector,
+                                   entry->intr_faultaddr);
             break;
         case LI_FLAG_INTR_ASYNC:
-            qemu_log("-> Interrupt #%04x vector 0x" TARGET_FMT_lx "\n",
-                     entry->intr_code, entry->intr_vector);
+            g_string_append_printf(buf, "-> Interrupt #%04x vector 0x"
+                                   TARGET_FMT_lx "\n",
+                                   entry->intr_code, entry->intr_vector);
             break;
         default:
             /* No interrupt */
@@ -169,9 +360,9 @@ void emit_text_instr(CPUArchState *env, cpu_log_entry_t *entry)
         for (i = 0; i < entry->mem->len; i++) {
             log_meminfo_t *minfo = &g_array_index(entry->mem, log_meminfo_t, i);
             if (minfo->flags & LMI_LD) {
-                emit_text_ldst(minfo, "Read");
+                emit_text_ldst(buf, minfo, "Read");
             } else if (minfo->flags & LMI_ST) {
-                emit_text_ldst(minfo, "Write");
+                emit_text_ldst(buf, minfo, "Write");
             }
         }
 
@@ -179,13 +370,14 @@ void emit_text_instr(CPUArchState *env, cpu_log_entry_t *entry)
         for (i = 0; i < entry->regs->len; i++) {
             log_reginfo_t *rinfo =
                 &g_array_index(entry->regs, log_reginfo_t, i);
-            emit_text_reg(rinfo);
+            emit_text_reg(buf, rinfo);
         }
     }
 
     /* Dump extra logged messages, if any */
     if (entry->txt_buffer->len > 0) {
-        qemu_log("%s", entry->txt_buffer->str);
+        g_string_append_len(buf, entry->txt_buffer->str,
+                            entry->txt_buffer->len);
     }
 
     /* Emit events recorded by the given trace entry */
@@ -198,46 +390,99 @@ void emit_text_instr(CPUArchState *env, cpu_log_entry_t *entry)
             } else if (event->state.next_state == LOG_EVENT_STATE_STOP) {
                 log_state_op = "Disabled";
             } else {
+                flush |= event->state.next_state == LOG_EVENT_STATE_FLUSH;
                 continue;
             }
 
             if (cpulog->loglevel == QEMU_LOG_INSTR_LOGLEVEL_USER) {
-                qemu_log(
-                    "[%u:%u] %s user-mode only instruction logging @ %lx\n",
+                g_string_append_printf(
+                    buf, "[%u:%u] %s user-mode only instruction logging @ %lx\n",
                     env_cpu(env)->cpu_index, cpu_get_asid(env, event->state.pc),
                     log_state_op, event->state.pc);
             } else {
-                qemu_log("[%u:%u] %s instruction logging @ %lx\n",
-                         env_cpu(env)->cpu_index,
-                         cpu_get_asid(env, event->state.pc), log_state_op,
-                         event->state.pc);
+                g_string_append_printf(
+                    buf, "[%u:%u] %s instruction logging @ %lx\n",
+                    env_cpu(env)->cpu_index, cpu_get_asid(env, event->state.pc),
+                    log_state_op, event->state.pc);
             }
             break;
         case LOG_EVENT_CTX_UPDATE:
-            qemu_log("Context switch pid=0x%lx tid=0x%lx cid=0x%lx\n",
-                     event->ctx_update.pid, event->ctx_update.tid,
-                     event->ctx_update.cid);
+            g_string_append_printf(
+                buf, "Context switch pid=0x%lx tid=0x%lx cid=0x%lx\n",
+                event->ctx_update.pid, event->ctx_update.tid,
+                event->ctx_update.cid);
             break;
         case LOG_EVENT_MARKER:
-            qemu_log("Guest trace marker %lx\n", event->marker);
+            g_string_append_printf(buf, "Guest trace marker %lx\n",
+                                   event->marker);
             break;
         case LOG_EVENT_REGDUMP:
-            qemu_log("Register dump\n");
+            g_string_append(buf, "Register dump\n");
             for (j = 0; j < event->reg_dump.gpr->len; j++) {
                 log_reginfo_t *r =
                     &g_array_index(event->reg_dump.gpr, log_reginfo_t, j);
-                emit_text_reg(r);
+                emit_text_reg(buf, r);
             }
             break;
         case LOG_EVENT_COUNTER:
             incremental = log_event_counter_incremental(event->counter.flags);
-            qemu_log("Counter %s %s[%d]: %lx\n", (incremental) ? "INC" : "ABS",
-                     event->counter.name,
-                     log_event_counter_slot(event->counter.flags),
-                     event->counter.value);
+            g_string_append_printf(buf, "Counter %s %s[%d]: %lx\n",
+                                   (incremental) ? "INC" : "ABS",
+                                   event->counter.name,
+                                   log_event_counter_slot(event->counter.flags),
+                                   event->counter.value);
             break;
         default:
             assert(0 && "unknown event ID");
         }
     }
+
+    if (buf->len == ts_end) {
+        /* Nothing to print, drop the timestamp */
+        g_string_truncate(buf, entry_start);
+    }
+    if (ts->fd < 0 || flush || buf->len >= TEXT_FLUSH_SIZE) {
+        text_write_out(ts);
+    }
+}
+
+bool qemu_log_instr_text_per_cpu_enabled(void)
+{
+    return per_cpu_prefix != NULL;
+}
+
+void qemu_log_instr_set_text_per_cpu(const char *spec, Error **errp)
+{
+    gchar **opts = g_strsplit(spec, ",", 0);
+    const char *pattern = NULL;
+    const char *pos;
+    int i;
+
+    for (i = 0; opts[i]; i++) {
+        if (g_str_has_prefix(opts[i], "file=")) {
+            pattern = opts[i] + strlen("file=");
+        } else if (strcmp(opts[i], "timestamps=on") == 0) {
+            per_cpu_timestamps = true;
+        } else if (strcmp(opts[i], "timestamps=off") == 0) {
+            per_cpu_timestamps = false;
+        } else {
+            error_setg(errp, "Invalid per-CPU text trace option '%s'",
+                       opts[i]);
+            goto out;
+        }
+    }
+
+    pos = pattern ? strstr(pattern, "%d") : NULL;
+    if (pos == NULL || strchr(pos + 2, '%') != NULL ||
+        memchr(pattern, '%', pos - pattern) != NULL) {
+        error_setg(errp, "Per-CPU text trace requires file=path with a "
+                   "single %%d for the CPU index");
+        goto out;
+    }
+    g_free(per_cpu_prefix);
+    g_free(per_cpu_suffix);
+    per_cpu_prefix = g_strndup(pattern, pos - pattern);
+    per_cpu_suffix = g_strdup(pos + 2);
+out:
+    g_strfreev(opts);
 }
@@ -31,6 +31,7 @@
 #include "qapi/error.h"
 #include "qemu/error-report.h"
 #include "hw/boards.h"
+#include "hw/core/cpu.h"
 #include "qapi/qapi-builtin-visit.h"
 #include "tcg-cpus.h"
 
@@ -40,6 +41,9 @@ struct TCGState {
     bool mttcg_enabled;
     int splitwx_enabled;
     unsigned long tb_size;
+    uint32_t jmp_cache_bits;
+    uint32_t jmp_cache_ways;
+    bool idle_warp;
 };
 typedef struct TCGState TCGState;
 
@@ -95,6 +99,8 @@ static void tcg_accel_instance_init(Object *obj)
     TCGState *s = TCG_STATE(obj);
 
     s->mttcg_enabled = default_mttcg_enabled();
+    s->jmp_cache_bits = TB_JMP_CACHE_BITS;
+    s->jmp_cache_ways = 1;
 
     /* If debugging enabled, default "auto on", otherwise off. */
 #ifdef CONFIG_DEBUG_TCG
@@ -111,7 +117,11 @@ static int tcg_init(MachineState *ms)
     TCGState *s = TCG_STATE(current_accel());
 
     tcg_exec_init(s->tb_size * 1024 * 1024, s->splitwx_enabled);
+    tcg_jmp_cache_configure(s->jmp_cache_bits, s->jmp_cache_ways);
     mttcg_enabled = s->mttcg_enabled;
+    if (s->idle_warp) {
+        cpu_idle_warp_enable();
+    }
     cpus_register_accel(&tcg_cpus);
 
     return 0;
@@ -176,6 +186,80 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_jmp_cache_bits(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->jmp_cache_bits;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_bits(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value < TB_JMP_CACHE_BITS_MIN || value > TB_JMP_CACHE_BITS_MAX) {
+        error_setg(errp, "Invalid 'tb-jmp-cache-bits' %u (must be %d..%d)",
+                   value, TB_JMP_CACHE_BITS_MIN, TB_JMP_CACHE_BITS_MAX);
+        return;
+    }
+    s->jmp_cache_bits = value;
+}
+
+static void tcg_get_jmp_cache_ways(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->jmp_cache_ways;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_ways(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value != 1 && value != 2) {
+        error_setg(errp, "Invalid 'tb-jmp-cache-ways' %u (must be 1 or 2)",
+                   value);
+        return;
+    }
+    s->jmp_cache_ways = value;
+}
+
+static bool tcg_get_idle_warp(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->idle_warp;
+}
+
+static void tcg_set_idle_warp(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    if (value && icount_enabled()) {
+        error_setg(errp, "No idle-warp when icount is enabled, "
+                   "use -icount sleep=off instead");
+        return;
+    }
+    s->idle_warp = value;
+}
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -205,10 +289,27 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add(oc, "tb-jmp-cache-bits", "int",
+        tcg_get_jmp_cache_bits, tcg_set_jmp_cache_bits,
+        NULL, NULL);
+    object_class_property_set_description(oc, "tb-jmp-cache-bits",
+        "log2 of the number of per-vCPU TB jump cache entries");
+
+    object_class_property_add(oc, "tb-jmp-cache-ways", "int",
+        tcg_get_jmp_cache_ways, tcg_set_jmp_cache_ways,
+        NULL, NULL);
+    object_class_property_set_description(oc, "tb-jmp-cache-ways",
+        "Associativity of the TB jump cache (1 or 2)");
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
         "Map jit pages into separate RW and RX regions");
+
+    object_class_property_add_bool(oc, "idle-warp",
+        tcg_get_idle_warp, tcg_set_idle_warp);
+    object_class_property_set_description(oc, "idle-warp",
+        "Advance the virtual clock to the next timer when all vCPUs are idle");
 }
 
 static const TypeInfo tcg_accel_type = {
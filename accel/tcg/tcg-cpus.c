@@ -374,7 +374,8 @@ static void *tcg_rr_cpu_thread_fn(void *arg)
             qatomic_mb_set(&cpu->exit_request, 0);
         }
 
-        if (icount_enabled() && all_cpu_threads_idle()) {
+        if ((icount_enabled() || cpu_idle_warp_enabled()) &&
+            all_cpu_threads_idle()) {
             /*
              * When all cpus are sleeping (e.g in WFI), to avoid a deadlock
              * in the main_loop, wake it up in order to start the warp timer.
@@ -452,6 +453,11 @@ static void *tcg_cpu_thread_fn(void *arg)
         }
 
         qatomic_mb_set(&cpu->exit_request, 0);
+        if (cpu_idle_warp_enabled() && cpu_thread_is_idle(cpu) &&
+            all_cpu_threads_idle()) {
+            /* The last vCPU to halt lets the main loop warp the clock */
+            qemu_notify_event();
+        }
         qemu_wait_io_event(cpu);
     } while (!cpu->unplug || cpu_can_run(cpu));
 
@@ -462,11 +468,12 @@ static void *tcg_cpu_thread_fn(void *arg)
     return NULL;
 }
 
+static QemuCond *single_tcg_halt_cond;
+static QemuThread *single_tcg_cpu_thread;
+
 static void tcg_start_vcpu_thread(CPUState *cpu)
 {
     char thread_name[VCPU_THREAD_NAME_SIZE];
-    static QemuCond *single_tcg_halt_cond;
-    static QemuThread *single_tcg_cpu_thread;
     static int tcg_region_inited;
 
     assert(tcg_enabled());
@@ -518,6 +525,14 @@ static void tcg_start_vcpu_thread(CPUState *cpu)
     }
 }
 
+static void tcg_forget_vcpu_threads(void)
+{
+    /* The regions are kept, the new threads register their contexts again */
+    single_tcg_halt_cond = NULL;
+    single_tcg_cpu_thread = NULL;
+    tcg_region_forget_threads();
+}
+
 static int64_t tcg_get_virtual_clock(void)
 {
     if (icount_enabled()) {
@@ -567,4 +582,6 @@ const CpusAccel tcg_cpus = {
 
     .get_virtual_clock = tcg_get_virtual_clock,
     .get_elapsed_ticks = tcg_get_elapsed_ticks,
+
+    .forget_vcpu_threads = tcg_forget_vcpu_threads,
 };
@@ -149,6 +149,18 @@ uint64_t HELPER(ctpop_i64)(uint64_t arg)
     return ctpop64(arg);
 }
 
+static inline void log_chain(CPUState *cpu, TranslationBlock *tb,
+                             target_ulong pc, target_ulong cs_base,
+                             target_ulong cs_top, uint32_t cheri_flags,
+                             uint32_t flags)
+{
+    qemu_log_mask_and_addr(CPU_LOG_EXEC, pc,
+                           "Chain %d: %p [" TARGET_FMT_lx "/" TARGET_FMT_lx
+                           "/" TARGET_FMT_lx "/%#x/%#x] %s\n",
+                           cpu->cpu_index, tb->tc.ptr, cs_base, pc, cs_top,
+                           cheri_flags, flags, lookup_symbol(pc));
+}
+
 const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
 {
     CPUState *cpu = env_cpu(env);
@@ -162,11 +174,101 @@ const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
     if (tb == NULL) {
         return tcg_code_gen_epilogue;
     }
-    qemu_log_mask_and_addr(CPU_LOG_EXEC, pc,
-                           "Chain %d: %p [" TARGET_FMT_lx "/" TARGET_FMT_lx
-                           "/" TARGET_FMT_lx "/%#x/%#x] %s\n",
-                           cpu->cpu_index, tb->tc.ptr, cs_base, pc, cs_top,
-                           cheri_flags, flags, lookup_symbol(pc));
+    log_chain(cpu, tb, pc, cs_base, cs_top, cheri_flags, flags);
+    return tb->tc.ptr;
+}
+
+static inline TBInlineCacheEntry *tb_ic_entry(CPUState *cpu,
+                                              const TranslationBlock *site)
+{
+    uintptr_t h = (uintptr_t)site >> 6;
+    TBInlineCacheEntry *ic;
+
+    ic = &cpu->tb_ic[(h ^ (h >> TB_IC_BITS)) & (TB_IC_SIZE - 1)];
+    if (ic->site != site) {
+        ic->site = site;
+        ic->target = NULL;
+        ic->ret_target = NULL;
+    }
+    return ic;
+}
+
+/*
+ * Indirect jump from the end of @site through the inline cache of that
+ * call site. Returns that are predicted by the shadow return stack use the
+ * cache entry of the matching call site instead, so a function returning
+ * to many callers does not thrash a single entry.
+ *
+ * Cached TBs are validated exactly like tb_jmp_cache entries: TBs that
+ * have been invalidated carry CF_INVALID, and the whole cache is dropped
+ * together with tb_jmp_cache on tb_flush() and TLB flushes.
+ */
+const void *HELPER(lookup_tb_ptr_ic)(CPUArchState *env, const void *site_ptr,
+                                    target_ulong dest, uint32_t kind)
+{
+    CPUState *cpu = env_cpu(env);
+    const TranslationBlock *site = site_ptr;
+    TBIndirectStats *stats = &cpu->tb_ind_stats;
+    TBReturnStackEntry *ras;
+    TranslationBlock *tb, **slot = NULL;
+    target_ulong cs_base, cs_top, pc;
+    uint32_t cheri_flags, flags, cf_mask;
+
+    if (kind & TB_IND_FULL_STATE) {
+        cs_top = 0;
+        cheri_flags = 0;
+        cpu_get_tb_cpu_state_6(env, &pc, &cs_base, &cs_top, &cheri_flags,
+                               &flags);
+    } else {
+        /* The translator guarantees that only the pc changes. */
+        pc = dest;
+        cs_base = site->cs_base;
+        cs_top = site->cs_top;
+        cheri_flags = site->cheri_flags;
+        flags = site->flags;
+    }
+    cf_mask = tb_lookup_cf_mask(cpu, curr_cflags(cpu));
+
+    if (kind & TB_IND_RETURN) {
+        ras = &cpu->tb_ras[cpu->tb_ras_top];
+        cpu->tb_ras_top = (cpu->tb_ras_top - 1) & (TB_RAS_SIZE - 1);
+        if (ras->site && ras->ret_pc == pc) {
+            slot = &tb_ic_entry(cpu, ras->site)->ret_target;
+        }
+        ras->site = NULL;
+    }
+    if (slot == NULL) {
+        slot = &tb_ic_entry(cpu, site)->target;
+    }
+    if (kind & TB_IND_CALL) {
+        cpu->tb_ras_top = (cpu->tb_ras_top + 1) & (TB_RAS_SIZE - 1);
+        ras = &cpu->tb_ras[cpu->tb_ras_top];
+        ras->ret_pc = site->pc + site->size;
+        ras->site = site;
+    }
+
+    tb = *slot;
+    if (likely(tb && tb_lookup_matches(cpu, tb, pc, cs_base, cs_top,
+                                       cheri_flags, flags, cf_mask))) {
+        if (kind & TB_IND_RETURN) {
+            stats->ras_hits++;
+        } else {
+            stats->ic_hits++;
+        }
+    } else {
+        if (kind & TB_IND_RETURN) {
+            stats->ras_misses++;
+        } else {
+            stats->ic_misses++;
+        }
+        tb = tb_lookup__state(cpu, pc, cs_base, cs_top, cheri_flags, flags,
+                              cf_mask);
+        if (tb == NULL) {
+            return tcg_code_gen_epilogue;
+        }
+        *slot = tb;
+    }
+    log_chain(cpu, tb, pc, cs_base, cs_top, cheri_flags, flags);
     return tb->tc.ptr;
 }
 
@@ -25,6 +25,7 @@ DEF_HELPER_FLAGS_1(ctpop_i32, TCG_CALL_NO_RWG_SE, i32, i32)
 DEF_HELPER_FLAGS_1(ctpop_i64, TCG_CALL_NO_RWG_SE, i64, i64)
 
 DEF_HELPER_FLAGS_1(lookup_tb_ptr, TCG_CALL_NO_WG_SE, cptr, env)
+DEF_HELPER_FLAGS_4(lookup_tb_ptr_ic, TCG_CALL_NO_WG, cptr, env, cptr, tl, i32)
 
 DEF_HELPER_FLAGS_1(exit_atomic, TCG_CALL_NO_WG, noreturn, env)
 
@@ -350,6 +351,7 @@ DEF_HELPER_FLAGS_0(qemu_log_instr_allcpu_start, TCG_CALL_NO_WG, void)
 DEF_HELPER_FLAGS_0(qemu_log_instr_allcpu_user_start, TCG_CALL_NO_WG, void)
 DEF_HELPER_FLAGS_0(qemu_log_instr_allcpu_stop, TCG_CALL_NO_WG, void)
 DEF_HELPER_FLAGS_1(qemu_log_instr_commit, TCG_CALL_NO_WG, void, env)
+DEF_HELPER_FLAGS_1(qemu_log_instr_fast_flush, TCG_CALL_NO_WG, void, env)
 DEF_HELPER_FLAGS_4(qemu_log_instr_load64, TCG_CALL_NO_WG, void, env,
                    cap_checked_ptr, i64, memop_idx)
 DEF_HELPER_FLAGS_4(qemu_log_instr_store64, TCG_CALL_NO_WG, void, env,
@@ -1327,6 +1327,38 @@ static void tb_htable_init(void)
     qht_init(&tb_ctx.htable, tb_cmp, CODE_GEN_HTABLE_SIZE, mode);
 }
 
+static unsigned int tb_jmp_cache_bits = TB_JMP_CACHE_BITS;
+static unsigned int tb_jmp_cache_ways = 1;
+
+/* Must be called before the vCPUs are realized */
+void tcg_jmp_cache_configure(unsigned int bits, unsigned int ways)
+{
+    assert(bits >= TB_JMP_CACHE_BITS_MIN && bits <= TB_JMP_CACHE_BITS_MAX);
+    assert(ways == 1 || ways == 2);
+    tb_jmp_cache_bits = bits;
+    tb_jmp_cache_ways = ways;
+}
+
+void tb_jmp_cache_init(CPUState *cpu)
+{
+    TBJmpCache *jc = &cpu->tb_jmp_cache;
+
+    jc->way_bits = tb_jmp_cache_ways == 2;
+    jc->set_bits = tb_jmp_cache_bits - jc->way_bits;
+    jc->entries = g_new0(TranslationBlock *, 1u << tb_jmp_cache_bits);
+    jc->lru = jc->way_bits ? g_new0(uint8_t, 1u << jc->set_bits) : NULL;
+}
+
+void tb_jmp_cache_destroy(CPUState *cpu)
+{
+    TBJmpCache *jc = &cpu->tb_jmp_cache;
+
+    g_free(jc->entries);
+    g_free(jc->lru);
+    jc->entries = NULL;
+    jc->lru = NULL;
+}
+
 /* Must be called before using the QEMU cpus. 'tb_size' is the size
    (in bytes) allocated to the translation buffer. Zero means default
    size. */
@@ -1649,10 +1681,14 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    h = tb_jmp_cache_hash_func(tb->pc);
     CPU_FOREACH(cpu) {
-        if (qatomic_read(&cpu->tb_jmp_cache[h]) == tb) {
-            qatomic_set(&cpu->tb_jmp_cache[h], NULL);
+        TBJmpCache *jc = &cpu->tb_jmp_cache;
+        unsigned int i, i0 = tb_jmp_cache_hash_func(jc, tb->pc) << jc->way_bits;
+
+        for (i = i0; i < i0 + (1u << jc->way_bits); i++) {
+            if (qatomic_read(&jc->entries[i]) == tb) {
+                qatomic_set(&jc->entries[i], NULL);
+            }
         }
     }
 
@@ -2481,10 +2517,36 @@ void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr)
 
 static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
 {
-    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr);
+    TBJmpCache *jc = &cpu->tb_jmp_cache;
+    unsigned int i, i0 = tb_jmp_cache_hash_page(jc, page_addr) << jc->way_bits;
+    unsigned int n = 1u << (tb_jmp_page_bits(jc) + jc->way_bits);
 
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
-        qatomic_set(&cpu->tb_jmp_cache[i0 + i], NULL);
+    for (i = 0; i < n; i++) {
+        qatomic_set(&jc->entries[i0 + i], NULL);
+    }
+}
+
+static inline bool tb_ic_overlaps_page(TranslationBlock *tb,
+                                       target_ulong page_addr)
+{
+    target_ulong page = tb->pc & TARGET_PAGE_MASK;
+
+    return page == page_addr || page == page_addr - TARGET_PAGE_SIZE;
+}
+
+static void tb_ic_clear_page(CPUState *cpu, target_ulong page_addr)
+{
+    unsigned int i;
+
+    for (i = 0; i < TB_IC_SIZE; i++) {
+        TBInlineCacheEntry *ic = &cpu->tb_ic[i];
+
+        if (ic->target && tb_ic_overlaps_page(ic->target, page_addr)) {
+            ic->target = NULL;
+        }
+        if (ic->ret_target && tb_ic_overlaps_page(ic->ret_target, page_addr)) {
+            ic->ret_target = NULL;
+        }
     }
 }
 
@@ -2494,6 +2556,7 @@ void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
        overlap the flushed page.  */
     tb_jmp_cache_clear_page(cpu, addr - TARGET_PAGE_SIZE);
     tb_jmp_cache_clear_page(cpu, addr);
+    tb_ic_clear_page(cpu, addr & TARGET_PAGE_MASK);
 }
 
 static void print_qht_statistics(struct qht_stats hst)
@@ -2571,6 +2634,10 @@ void dump_exec_info(void)
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
     size_t nb_tbs, flush_full, flush_part, flush_elide;
+    TBIndirectStats ind = {};
+    uint64_t jmp_hits = 0, jmp_misses = 0, jmp_conflicts = 0;
+    uint64_t total;
+    CPUState *cpu;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -2612,6 +2679,32 @@ void dump_exec_info(void)
     qemu_printf("TLB full flushes    %zu\n", flush_full);
     qemu_printf("TLB partial flushes %zu\n", flush_part);
     qemu_printf("TLB elided flushes  %zu\n", flush_elide);
+
+    CPU_FOREACH(cpu) {
+        jmp_hits += qatomic_read_u64(&cpu->tb_jmp_cache.hits);
+        jmp_misses += qatomic_read_u64(&cpu->tb_jmp_cache.misses);
+        jmp_conflicts += qatomic_read_u64(&cpu->tb_jmp_cache.conflicts);
+        ind.ic_hits += qatomic_read_u64(&cpu->tb_ind_stats.ic_hits);
+        ind.ic_misses += qatomic_read_u64(&cpu->tb_ind_stats.ic_misses);
+        ind.ras_hits += qatomic_read_u64(&cpu->tb_ind_stats.ras_hits);
+        ind.ras_misses += qatomic_read_u64(&cpu->tb_ind_stats.ras_misses);
+    }
+    total = jmp_hits + jmp_misses;
+    qemu_printf("TB jump cache       %u entries, %u-way\n",
+                1u << tb_jmp_cache_bits,
+                tb_jmp_cache_ways);
+    qemu_printf("TB jump cache       %" PRIu64 " hits %" PRIu64
+                " misses %" PRIu64 " conflicts (%0.1f%% hit)\n",
+                jmp_hits, jmp_misses, jmp_conflicts,
+                total ? (double)jmp_hits * 100 / total : 0);
+    total = ind.ic_hits + ind.ic_misses;
+    qemu_printf("indirect jump IC    %" PRIu64 " hits %" PRIu64
+                " misses (%0.1f%% hit)\n", ind.ic_hits, ind.ic_misses,
+                total ? (double)ind.ic_hits * 100 / total : 0);
+    total = ind.ras_hits + ind.ras_misses;
+    qemu_printf("return stack        %" PRIu64 " hits %" PRIu64
+                " misses (%0.1f%% hit)\n", ind.ras_hits, ind.ras_misses,
+                total ? (double)ind.ras_hits * 100 / total : 0);
     tcg_dump_info();
 }
 
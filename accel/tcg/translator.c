@@ -16,6 +16,7 @@
 #include "exec/gen-icount.h"
 #include "exec/log.h"
 #include "exec/log_instr.h"
+#include "exec/log_instr_fast.h"
 #include "exec/translator.h"
 #include "exec/plugin-gen.h"
 #include "sysemu/replay.h"
@@ -47,6 +48,8 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
      * log level changes.
      */
     const bool log_instr_enabled = qemu_log_instr_enabled(cpu->env_ptr);
+    const bool log_instr_fast =
+        log_instr_enabled && qemu_log_instr_fast_enabled();
 #endif
 
     /* Initialize DisasContext */
@@ -66,6 +69,7 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
                        cap_get_top(cheri_get_recent_pcc(cpu->env_ptr)));
     db->cheri_flags = tb->cheri_flags;
     disas_capreg_reset_all(db);
+    cheri_statcounter_inc((CPUArchState *)cpu->env_ptr, TB_TRANSLATIONS);
     // TODO: verify cheri_flags are correct?
 #endif
     ops->init_disas_context(db, cpu);
@@ -92,8 +96,13 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
 #endif
     ops->tb_start(db, cpu);
 #ifdef CONFIG_TCG_LOG_INSTR
-    /* Commit previous instruction */
-    if (unlikely(log_instr_enabled)) {
+    /*
+     * Commit previous instruction. With fast logging, this is done when the
+     * record buffer is decoded and we only check that it has enough room.
+     */
+    if (unlikely(log_instr_fast)) {
+        gen_log_instr_fast_tb_start(cpu);
+    } else if (unlikely(log_instr_enabled)) {
         qemu_log_gen_printf_flush(db, true, true);
         gen_helper_qemu_log_instr_commit(cpu_env);
     }
@@ -183,7 +192,7 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
 
 #ifdef CONFIG_TCG_LOG_INSTR
         /* Commit this instruction */
-        if (unlikely(log_instr_enabled)) {
+        if (unlikely(log_instr_enabled && !log_instr_fast)) {
             /*
              * TODO: As long as the string stays around, we could delay this
              * till the end of a BB.
@@ -199,13 +208,18 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
      * Flush buffers for last instruction. Committing itself is done in the
      * next TB in order to capture results of exception handling.
      */
-    if (unlikely(log_instr_enabled)) {
+    if (unlikely(log_instr_enabled && !log_instr_fast)) {
         qemu_log_gen_printf_flush(db, true, false);
     }
 #endif
 
     /* Emit code to exit the TB, as indicated by db->is_jmp.  */
     ops->tb_stop(db, cpu);
+#ifdef CONFIG_TCG_LOG_INSTR
+    if (unlikely(log_instr_fast)) {
+        gen_log_instr_fast_tb_end();
+    }
+#endif
     gen_tb_end(db->tb, db->num_insns - bp_insn);
 
     if (plugin_enabled) {
@@ -1354,11 +1354,13 @@ int blk_make_zero(BlockBackend *blk, BdrvRequestFlags flags)
 void blk_inc_in_flight(BlockBackend *blk)
 {
     qatomic_inc(&blk->in_flight);
+    aio_inc_in_flight();
 }
 
 void blk_dec_in_flight(BlockBackend *blk)
 {
     qatomic_dec(&blk->in_flight);
+    aio_dec_in_flight();
     aio_wait_kick();
 }
 
@@ -856,6 +856,7 @@ static int bdrv_get_cluster_size(BlockDriverState *bs)
 void bdrv_inc_in_flight(BlockDriverState *bs)
 {
     qatomic_inc(&bs->in_flight);
+    aio_inc_in_flight();
 }
 
 void bdrv_wakeup(BlockDriverState *bs)
@@ -866,6 +867,7 @@ void bdrv_wakeup(BlockDriverState *bs)
 void bdrv_dec_in_flight(BlockDriverState *bs)
 {
     qatomic_dec(&bs->in_flight);
+    aio_dec_in_flight();
     bdrv_wakeup(bs);
 }
 
@@ -66,6 +66,23 @@ static InsnClassExecCount aarch64_insn_classes[] = {
     { "  UDEF",              "udef",   0xffff0000, 0x00000000, COUNT_NONE},
     { "  SVE",               "sve",    0x1e000000, 0x04000000, COUNT_CLASS},
     { "Reserved",            "res",    0x1e000000, 0x00000000, COUNT_CLASS},
+    /* Morello (see target/arm/cheri.decode) */
+    { "  Cap BLR/BR/RET",    "cbr",    0xffff9c1c, 0xc2c21000, COUNT_CLASS},
+    { "  Cap BLR/BR (ind)",  "cbri",   0xfff01c1e, 0xc2d01000, COUNT_CLASS},
+    { "  Cap BLRS/BRS",      "cbrs",   0xffe09c1f, 0xc2c08400, COUNT_CLASS},
+    { "  Cap LDPBLR/LDPBR",  "cldpbr", 0xffff9c00, 0xc2c41000, COUNT_CLASS},
+    { "  Cap CPY/CLRTAG",    "ccpy",   0xffff9c00, 0xc2c19000, COUNT_CLASS},
+    { "  Cap SCBNDS",        "cscb",   0xffe03c00, 0xc2c03800, COUNT_CLASS},
+    { "  Cap Add/Sub (imm)", "casi",   0xff000000, 0x02000000, COUNT_CLASS},
+    { "  Cap ldst pair",     "cldstp", 0x9f000000, 0x02000000, COUNT_CLASS},
+    { "  Cap Load (lit)",    "cldlit", 0xffc00000, 0x82000000, COUNT_CLASS},
+    { "  Cap ldst (alt)",    "caldst", 0xffc00000, 0x82400000, COUNT_CLASS},
+    { "  Cap ldst (alt imm)","caldsti",0xff800000, 0x82800000, COUNT_CLASS},
+    { "  Cap ldst (alt reg)","caldstr",0xffe00400, 0xc2e00400, COUNT_CLASS},
+    { "  Cap ldst (uimm)",   "cldsti", 0xff800000, 0xc2000000, COUNT_CLASS},
+    { "  Cap ldst (alt unsc)","caldstu",0xff000000, 0xe2000000, COUNT_CLASS},
+    { "  Cap ldst/atomic",   "cldst",  0xff000000, 0xa2000000, COUNT_CLASS},
+    { "Morello",             "morello",0x1e000000, 0x02000000, COUNT_CLASS},
     /* Data Processing Immediate */
     { "  PCrel addr",        "pcrel",  0x1f000000, 0x10000000, COUNT_CLASS},
     { "  Add/Sub (imm,tags)","asit",   0x1f800000, 0x11800000, COUNT_CLASS},
@@ -0,0 +1,76 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Expand a cvtrace2 trace into a classic cvtrace file.
+ *
+ * Usage: qemu-cvtrace2-expand trace.cvt2 trace.cvtrace
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+
+#include "cvtrace2_reader.hh"
+
+int main(int argc, char **argv)
+{
+    cheri_trace_entry_t entry;
+    uint64_t nentries = 0;
+    FILE *out;
+
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s trace.cvt2 trace.cvtrace\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        cheri::cvtrace2_reader reader(argv[1]);
+
+        out = std::fopen(argv[2], "wb");
+        if (out == nullptr) {
+            std::perror(argv[2]);
+            return 1;
+        }
+        cheri::cvtrace2_reader::classic_header(entry);
+        std::fwrite(&entry, sizeof(entry), 1, out);
+        while (reader.next(entry)) {
+            std::fwrite(&entry, sizeof(entry), 1, out);
+            nentries++;
+        }
+        if (reader.truncated()) {
+            std::fprintf(stderr, "%s: trace is truncated\n", argv[1]);
+        }
+        if (std::fclose(out) != 0) {
+            std::perror(argv[2]);
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    std::printf("%" PRIu64 " entries\n", nentries);
+    return 0;
+}
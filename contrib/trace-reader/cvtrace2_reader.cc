@@ -0,0 +1,276 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "cvtrace2_reader.hh"
+
+namespace cheri
+{
+
+/* Classic cvtrace entries are big-endian */
+template <typename T> static inline T to_be(T value)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    switch (sizeof(T)) {
+    case 2:
+        return __builtin_bswap16(value);
+    case 4:
+        return __builtin_bswap32(value);
+    case 8:
+        return __builtin_bswap64(value);
+    }
+#endif
+    return value;
+}
+
+/* The cvtrace2 file header is little-endian */
+static inline uint32_t from_le32(uint32_t value)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap32(value);
+#else
+    return value;
+#endif
+}
+
+cvtrace2_reader::cvtrace2_reader(const std::string &path) : buf_(1 << 16)
+{
+    cvt2_file_header_t header;
+
+    file_ = gzopen(path.c_str(), "rb");
+    if (file_ == nullptr) {
+        throw std::runtime_error("can not open " + path + ": " +
+                                 std::strerror(errno));
+    }
+    try {
+        uint8_t *p = reinterpret_cast<uint8_t *>(&header);
+        for (size_t i = 0; i < sizeof(header); i++) {
+            if (!get_byte(p[i], i == 0)) {
+                throw std::runtime_error(path + ": truncated trace");
+            }
+        }
+        if (std::memcmp(header.magic, CVT2_MAGIC, sizeof(header.magic)) ||
+            from_le32(header.version) != CVT2_VERSION) {
+            throw std::runtime_error(path + ": not a cvtrace2 trace");
+        }
+    } catch (const truncated_member &) {
+        gzclose(file_);
+        throw std::runtime_error(path + ": truncated trace");
+    } catch (...) {
+        gzclose(file_);
+        throw;
+    }
+}
+
+cvtrace2_reader::~cvtrace2_reader()
+{
+    gzclose(file_);
+}
+
+void cvtrace2_reader::classic_header(cheri_trace_entry_t &header)
+{
+    char *buffer = reinterpret_cast<char *>(&header);
+
+    std::memset(&header, 0, sizeof(header));
+    buffer[0] = CTE_QEMU_VERSION;
+    std::strncpy(buffer + 1, CTE_QEMU_MAGIC, sizeof(header) - 2);
+}
+
+bool cvtrace2_reader::fill()
+{
+    int ret;
+    int err;
+
+    if (truncated_) {
+        return false;
+    }
+    ret = gzread(file_, buf_.data(), buf_.size());
+    if (ret <= 0) {
+        const char *msg = gzerror(file_, &err);
+        /*
+         * zlib reports a final gzip member that was cut short, e.g. because
+         * QEMU was killed before finishing it, as Z_BUF_ERROR after handing
+         * out everything that could be decompressed.
+         */
+        if (err == Z_BUF_ERROR) {
+            truncated_ = true;
+            ret = 0;
+        } else if (err != Z_OK) {
+            throw std::runtime_error(std::string("decompression failed: ") +
+                                     msg);
+        }
+    }
+    pos_ = 0;
+    len_ = ret;
+    return ret > 0;
+}
+
+/* Returns false at the end of the trace, which is only valid if @first */
+bool cvtrace2_reader::get_byte(uint8_t &byte, bool first)
+{
+    if (pos_ == len_ && !fill()) {
+        if (first) {
+            return false;
+        }
+        if (truncated_) {
+            throw truncated_member();
+        }
+        throw std::runtime_error("truncated cvtrace2 record");
+    }
+    byte = buf_[pos_++];
+    return true;
+}
+
+uint8_t cvtrace2_reader::byte()
+{
+    uint8_t b;
+
+    get_byte(b);
+    return b;
+}
+
+uint64_t cvtrace2_reader::varint(bool *overflow)
+{
+    uint64_t result = 0;
+    unsigned shift = 0;
+    uint8_t b;
+
+    do {
+        b = byte();
+        if (shift == 63 && (b & 0x7e)) {
+            /* Only a 65-bit value delta may set bit 64 */
+            if (overflow == nullptr || (b & 0x7c) || (b & 0x80)) {
+                throw std::runtime_error("invalid cvtrace2 varint");
+            }
+            *overflow = true;
+        }
+        if (shift > 63) {
+            throw std::runtime_error("invalid cvtrace2 varint");
+        }
+        result |= (uint64_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return result;
+}
+
+uint64_t cvtrace2_reader::value(uint64_t &prev)
+{
+    bool overflow = false;
+    uint64_t v = varint(&overflow);
+    uint64_t zz;
+
+    if (v == 0 && !overflow) {
+        return 0;
+    }
+    /* v - 1 as a 65-bit subtraction */
+    zz = overflow ? UINT64_MAX : v - 1;
+    prev += cvt2_unzigzag(zz);
+    return prev;
+}
+
+bool cvtrace2_reader::next(cheri_trace_entry_t &entry)
+{
+    try {
+        return decode(entry);
+    } catch (const truncated_member &) {
+        /* Drop the partial record at the end of a truncated member */
+        return false;
+    }
+}
+
+bool cvtrace2_reader::decode(cheri_trace_entry_t &entry)
+{
+    uint8_t flags;
+    uint64_t vals[5] = {};
+    int code;
+
+    if (!get_byte(flags, true)) {
+        return false;
+    }
+    code = flags & CVT2_TYPE_MASK;
+
+    if (flags & CVT2_F_CTX) {
+        thread_ = byte();
+        if (!threads_[thread_]) {
+            threads_[thread_].reset(new thread_state());
+        }
+        current_ = threads_[thread_].get();
+        current_->asid = byte();
+    }
+    if (current_ == nullptr) {
+        throw std::runtime_error("cvtrace2 record without thread");
+    }
+    thread_state &ts = *current_;
+
+    std::memset(&entry, 0, sizeof(entry));
+    entry.thread = thread_;
+    entry.asid = ts.asid;
+
+    ts.pc += 4;
+    if (flags & CVT2_F_PC) {
+        ts.pc += cvt2_unzigzag(varint());
+    }
+    insn_cache_entry &ic =
+        ts.insn_cache[(ts.pc >> 1) & (CVT2_INSN_CACHE_SIZE - 1)];
+    if (flags & CVT2_F_INSN) {
+        uint32_t insn = 0;
+        for (int i = 0; i < 4; i++) {
+            insn |= (uint32_t)byte() << (i * 8);
+        }
+        ic.pc = ts.pc;
+        ic.insn = insn;
+        ic.valid = true;
+    } else if (!ic.valid || ic.pc != ts.pc) {
+        throw std::runtime_error("cvtrace2 record refers to unknown insn");
+    }
+    entry.exception = (flags & CVT2_F_EXC) ? byte() : CTE_EXCEPTION_NONE;
+    ts.cycles += 1;
+    if (flags & CVT2_F_CYCLES) {
+        ts.cycles += (uint16_t)cvt2_unzigzag(varint());
+    }
+    entry.entry_type =
+        (code == CVT2_TYPE_RAW) ? byte() : cvt2_entry_type(code);
+
+    for (int i = 0; i < 5; i++) {
+        if (cvt2_type_has_val(code, i + 1)) {
+            vals[i] = value(ts.val[i]);
+        }
+    }
+
+    entry.pc = to_be(ts.pc);
+    entry.cycles = to_be(ts.cycles);
+    entry.inst = to_be(ic.insn);
+    entry.val1 = to_be(vals[0]);
+    entry.val2 = to_be(vals[1]);
+    entry.val3 = to_be(vals[2]);
+    entry.val4 = to_be(vals[3]);
+    entry.val5 = to_be(vals[4]);
+    return true;
+}
+
+} // namespace cheri
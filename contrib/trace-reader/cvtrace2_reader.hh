@@ -0,0 +1,113 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Decoder for the compressed cvtrace2 format produced by
+ * -cheri-trace-backend cvtrace2. See include/exec/log_instr_cvtrace.h for
+ * the layout.
+ *
+ * Records are expanded to classic cvtrace entries, in big-endian byte order
+ * as written by the cvtrace backend, so that existing tools can consume them.
+ *
+ * A trace whose last gzip member is truncated, because QEMU did not get to
+ * finish it, ends at the last complete record of that member.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+extern "C" {
+#include "exec/log_instr_cvtrace.h"
+}
+
+namespace cheri
+{
+
+class cvtrace2_reader
+{
+  public:
+    /* Open a trace and check its header, throws std::runtime_error */
+    explicit cvtrace2_reader(const std::string &path);
+    ~cvtrace2_reader();
+    cvtrace2_reader(const cvtrace2_reader &) = delete;
+    cvtrace2_reader &operator=(const cvtrace2_reader &) = delete;
+
+    /*
+     * Decode the next record. Returns false at the end of the trace,
+     * throws std::runtime_error if the trace is corrupt.
+     */
+    bool next(cheri_trace_entry_t &entry);
+
+    /* The trace ended in a truncated gzip member */
+    bool truncated() const { return truncated_; }
+
+    /* Classic cvtrace header record, to be written before the entries */
+    static void classic_header(cheri_trace_entry_t &header);
+
+  private:
+    struct insn_cache_entry {
+        uint64_t pc = 0;
+        uint32_t insn = 0;
+        bool valid = false;
+    };
+
+    /* Delta state of a thread, mirrors the writer */
+    struct thread_state {
+        uint64_t pc = 0;
+        uint64_t val[5] = {};
+        uint16_t cycles = 0xffff;
+        uint8_t asid = 0;
+        std::vector<insn_cache_entry> insn_cache =
+            std::vector<insn_cache_entry>(CVT2_INSN_CACHE_SIZE);
+    };
+
+    /* Thrown when a record runs into a truncated gzip member */
+    struct truncated_member {};
+
+    bool decode(cheri_trace_entry_t &entry);
+    bool fill();
+    bool get_byte(uint8_t &byte, bool first = false);
+    uint8_t byte();
+    uint64_t varint(bool *overflow = nullptr);
+    uint64_t value(uint64_t &prev);
+
+    gzFile file_;
+    std::vector<uint8_t> buf_;
+    size_t pos_ = 0;
+    size_t len_ = 0;
+    bool truncated_ = false;
+    std::array<std::unique_ptr<thread_state>, 256> threads_;
+    thread_state *current_ = nullptr;
+    uint8_t thread_ = 0;
+};
+
+} // namespace cheri
@@ -0,0 +1,183 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Example parallel scan of a chunked instruction trace.
+ *
+ * Usage: qemu-trace-scan [-j threads] [-p pid] [-f cpu:icount] trace
+ *
+ * Chunks are selected from the index (optionally restricted to one guest
+ * process) and decoded by a pool of worker threads. The scan reports the
+ * number of entries and decoded bytes for each guest process. With -f,
+ * only the chunk holding the given entry is located and printed.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "trace_reader.hh"
+
+namespace
+{
+
+struct ctx_stats {
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+};
+
+void usage(const char *name)
+{
+    std::fprintf(stderr, "usage: %s [-j threads] [-p pid] [-f cpu:icount] trace\n",
+                 name);
+    std::exit(1);
+}
+
+void print_chunk(const lic_index_entry_t &chunk)
+{
+    const lic_chunk_header_t &hdr = chunk.header;
+
+    std::printf("chunk @%" PRIu64 ": cpu %u pid %" PRIu64 " cid %" PRIu64
+                " entries %" PRIu64 "-%" PRIu64 " pc [0x%" PRIx64
+                ", 0x%" PRIx64 "] %u -> %u bytes\n",
+                chunk.offset, hdr.cpu, hdr.ctx_pid, hdr.ctx_cid,
+                hdr.icount_first, hdr.icount_last, hdr.pc_min, hdr.pc_max,
+                hdr.raw_size, hdr.compressed_size);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned nthreads = std::thread::hardware_concurrency();
+    bool filter_pid = false;
+    bool find = false;
+    uint64_t pid = 0;
+    uint32_t find_cpu = 0;
+    uint64_t find_icount = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:p:f:")) != -1) {
+        switch (opt) {
+        case 'j':
+            nthreads = std::strtoul(optarg, nullptr, 0);
+            break;
+        case 'p':
+            filter_pid = true;
+            pid = std::strtoull(optarg, nullptr, 0);
+            break;
+        case 'f':
+            if (std::sscanf(optarg, "%u:%" SCNu64, &find_cpu, &find_icount) != 2) {
+                usage(argv[0]);
+            }
+            find = true;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+    }
+    nthreads = std::max(nthreads, 1U);
+
+    try {
+        cheri::chunked_trace_reader reader(argv[optind]);
+
+        if (find) {
+            const lic_index_entry_t *chunk =
+                reader.find_chunk(find_cpu, find_icount);
+            if (chunk == nullptr) {
+                std::fprintf(stderr, "entry %u:%" PRIu64 " not found\n",
+                             find_cpu, find_icount);
+                return 1;
+            }
+            print_chunk(*chunk);
+            return 0;
+        }
+
+        std::vector<const lic_index_entry_t *> selected;
+        for (const auto &chunk : reader.index()) {
+            if (!filter_pid || chunk.header.ctx_pid == pid) {
+                selected.push_back(&chunk);
+            }
+        }
+
+        std::atomic<size_t> next(0);
+        std::mutex stats_lock;
+        std::map<uint64_t, ctx_stats> stats;
+        std::vector<std::thread> workers;
+
+        for (unsigned i = 0; i < nthreads; i++) {
+            workers.emplace_back([&]() {
+                std::map<uint64_t, ctx_stats> local;
+                size_t n;
+
+                while ((n = next++) < selected.size()) {
+                    const lic_index_entry_t *chunk = selected[n];
+                    std::vector<uint8_t> raw = reader.read_chunk(*chunk);
+                    /* Backend-specific record decoding would go here */
+                    ctx_stats &s = local[chunk->header.ctx_pid];
+                    s.entries += chunk->header.nentries;
+                    s.bytes += raw.size();
+                    s.chunks++;
+                }
+                std::lock_guard<std::mutex> guard(stats_lock);
+                for (const auto &kv : local) {
+                    ctx_stats &s = stats[kv.first];
+                    s.entries += kv.second.entries;
+                    s.bytes += kv.second.bytes;
+                    s.chunks += kv.second.chunks;
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        std::printf("backend %u, %zu chunks\n", reader.file_header().backend,
+                    reader.index().size());
+        for (const auto &kv : stats) {
+            std::printf("pid %" PRIu64 ": %" PRIu64 " entries, %" PRIu64
+                        " bytes in %" PRIu64 " chunks\n",
+                        kv.first, kv.second.entries, kv.second.bytes,
+                        kv.second.chunks);
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
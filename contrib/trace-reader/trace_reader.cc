@@ -0,0 +1,192 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "trace_reader.hh"
+
+namespace cheri
+{
+
+chunked_trace_reader::chunked_trace_reader(const std::string &path)
+{
+    struct stat st;
+    lic_footer_t footer;
+
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("can not open " + path + ": " +
+                                 std::strerror(errno));
+    }
+    try {
+        if (fstat(fd_, &st) < 0 ||
+            st.st_size < (off_t)(sizeof(header_) + sizeof(footer))) {
+            throw std::runtime_error(path + ": truncated trace");
+        }
+        pread_exact(&header_, sizeof(header_), 0);
+        if (std::memcmp(header_.magic, LIC_FILE_MAGIC, sizeof(header_.magic)) ||
+            header_.version != LIC_VERSION) {
+            throw std::runtime_error(path + ": not a chunked trace");
+        }
+        if (!find_footer(st.st_size, footer)) {
+            throw std::runtime_error(path + ": missing or corrupt index");
+        }
+        index_.resize(footer.nchunks);
+        pread_exact(index_.data(), index_.size() * sizeof(lic_index_entry_t),
+                    footer.index_offset);
+    } catch (...) {
+        close(fd_);
+        throw;
+    }
+
+    for (size_t i = 0; i < index_.size(); i++) {
+        uint32_t cpu = index_[i].header.cpu;
+        if (cpu >= by_cpu_.size()) {
+            by_cpu_.resize(cpu + 1);
+        }
+        by_cpu_[cpu].push_back(i);
+    }
+    for (auto &positions : by_cpu_) {
+        std::sort(positions.begin(), positions.end(), [this](size_t a, size_t b) {
+            return index_[a].header.icount_first < index_[b].header.icount_first;
+        });
+    }
+}
+
+chunked_trace_reader::~chunked_trace_reader()
+{
+    close(fd_);
+}
+
+/*
+ * Find the last footer that directly follows its index. This is the end of
+ * the file for a complete trace, but QEMU may have exited abnormally after
+ * appending more chunks or part of a new index.
+ */
+bool chunked_trace_reader::find_footer(uint64_t size,
+                                       lic_footer_t &footer) const
+{
+    std::vector<uint8_t> buf(1 << 20);
+    uint64_t end = size;
+
+    while (end - sizeof(header_) >= sizeof(footer)) {
+        uint64_t start = std::max<uint64_t>(
+            sizeof(header_), end > buf.size() ? end - buf.size() : 0);
+        size_t len = end - start;
+
+        pread_exact(buf.data(), len, start);
+        for (size_t pos = len - sizeof(footer) + 1; pos-- > 0;) {
+            uint64_t footer_offset = start + pos;
+
+            std::memcpy(&footer, &buf[pos], sizeof(footer));
+            if (footer.magic == LIC_FOOTER_MAGIC &&
+                footer.index_offset >= sizeof(header_) &&
+                footer.index_offset <= footer_offset &&
+                footer.nchunks == (footer_offset - footer.index_offset) /
+                                      sizeof(lic_index_entry_t) &&
+                footer.index_offset + footer.nchunks *
+                        sizeof(lic_index_entry_t) == footer_offset) {
+                return true;
+            }
+        }
+        if (start == sizeof(header_)) {
+            break;
+        }
+        /* The next window also covers footers crossing this boundary */
+        end = start + sizeof(footer) - 1;
+    }
+    return false;
+}
+
+void chunked_trace_reader::pread_exact(void *buf, size_t len,
+                                       uint64_t offset) const
+{
+    uint8_t *p = static_cast<uint8_t *>(buf);
+
+    while (len > 0) {
+        ssize_t ret = pread(fd_, p, len, offset);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            throw std::runtime_error("short read from trace");
+        }
+        p += ret;
+        len -= ret;
+        offset += ret;
+    }
+}
+
+const lic_index_entry_t *
+chunked_trace_reader::find_chunk(uint32_t cpu, uint64_t icount) const
+{
+    if (cpu >= by_cpu_.size()) {
+        return nullptr;
+    }
+    const auto &positions = by_cpu_[cpu];
+    /* First chunk that starts after icount, the match is the one before */
+    auto it = std::upper_bound(positions.begin(), positions.end(), icount,
+                               [this](uint64_t value, size_t pos) {
+                                   return value < index_[pos].header.icount_first;
+                               });
+    if (it == positions.begin()) {
+        return nullptr;
+    }
+    const lic_index_entry_t *chunk = &index_[*(it - 1)];
+    return (icount <= chunk->header.icount_last) ? chunk : nullptr;
+}
+
+std::vector<uint8_t>
+chunked_trace_reader::read_chunk(const lic_index_entry_t &chunk) const
+{
+    lic_chunk_header_t hdr;
+    std::vector<uint8_t> compressed(chunk.header.compressed_size);
+    std::vector<uint8_t> raw(chunk.header.raw_size);
+    uLongf raw_len = raw.size();
+
+    pread_exact(&hdr, sizeof(hdr), chunk.offset);
+    if (hdr.magic != LIC_CHUNK_MAGIC ||
+        std::memcmp(&hdr, &chunk.header, sizeof(hdr)) != 0) {
+        throw std::runtime_error("chunk header does not match the index");
+    }
+    pread_exact(compressed.data(), compressed.size(),
+                chunk.offset + sizeof(hdr));
+    if (uncompress(raw.data(), &raw_len, compressed.data(),
+                   compressed.size()) != Z_OK ||
+        raw_len != raw.size()) {
+        throw std::runtime_error("failed to decompress chunk");
+    }
+    return raw;
+}
+
+} // namespace cheri
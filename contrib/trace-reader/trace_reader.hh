@@ -0,0 +1,80 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Reader for the chunked instruction trace container produced by
+ * -cheri-trace-chunked. See include/exec/log_instr_chunked.h for the layout.
+ *
+ * The reader only loads the index when opened. Chunks are fetched with
+ * pread() so that a single reader can be shared by multiple decoding threads.
+ * The container is little-endian and so is the reader's host for now.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "exec/log_instr_chunked.h"
+}
+
+namespace cheri
+{
+
+class chunked_trace_reader
+{
+  public:
+    /* Open a trace and load its index, throws std::runtime_error */
+    explicit chunked_trace_reader(const std::string &path);
+    ~chunked_trace_reader();
+    chunked_trace_reader(const chunked_trace_reader &) = delete;
+    chunked_trace_reader &operator=(const chunked_trace_reader &) = delete;
+
+    const lic_file_header_t &file_header() const { return header_; }
+    const std::vector<lic_index_entry_t> &index() const { return index_; }
+
+    /*
+     * Find the chunk containing the given per-CPU entry sequence number.
+     * Returns nullptr if there is no such chunk.
+     */
+    const lic_index_entry_t *find_chunk(uint32_t cpu, uint64_t icount) const;
+
+    /* Read and decompress a chunk. This is safe to call concurrently. */
+    std::vector<uint8_t> read_chunk(const lic_index_entry_t &chunk) const;
+
+  private:
+    bool find_footer(uint64_t size, lic_footer_t &footer) const;
+    void pread_exact(void *buf, size_t len, uint64_t offset) const;
+
+    int fd_;
+    lic_file_header_t header_;
+    std::vector<lic_index_entry_t> index_;
+    /* Per-CPU index positions, sorted by icount_first */
+    std::vector<std::vector<size_t>> by_cpu_;
+};
+
+} // namespace cheri
@@ -130,6 +130,9 @@ void cpu_exec_unrealizefn(CPUState *cpu)
     CPUClass *cc = CPU_GET_CLASS(cpu);
 
     tlb_destroy(cpu);
+    if (tcg_enabled()) {
+        tb_jmp_cache_destroy(cpu);
+    }
     cpu_list_remove(cpu);
 
 #ifdef CONFIG_USER_ONLY
@@ -184,6 +187,9 @@ void cpu_exec_realizefn(CPUState *cpu, Error **errp)
         cc->tcg_initialize();
         qemu_log_printf_create_globals();
     }
+    if (tcg_enabled()) {
+        tb_jmp_cache_init(cpu);
+    }
     tlb_init(cpu);
 
     qemu_plugin_vcpu_init_hook(cpu);
@@ -241,6 +241,21 @@ static inline bool can_use_fpu(const float_status *s)
                   s->float_rounding_mode == float_round_nearest_even);
 }
 
+/*
+ * Targets that clear the flags before every operation (e.g. to compute a
+ * per-instruction cause, like MIPS) never have inexact set on entry. For
+ * those, operations that can tell from the host result alone whether it
+ * was exact may still use the FPU; see the *_exact functions below. This
+ * relies on the compiler not keeping excess precision in intermediates.
+ */
+static inline bool can_use_fpu_exact(const float_status *s)
+{
+    if (QEMU_NO_HARDFLOAT || FLT_EVAL_METHOD != 0) {
+        return false;
+    }
+    return likely(s->float_rounding_mode == float_round_nearest_even);
+}
+
 /*
  * Hardfloat generation functions. Each operation can have two flavors:
  * either using softfloat primitives (e.g. float32_is_zero_or_normal) for
@@ -266,6 +281,16 @@ typedef union {
 typedef bool (*f32_check_fn)(union_float32 a, union_float32 b);
 typedef bool (*f64_check_fn)(union_float64 a, union_float64 b);
 
+/*
+ * Given the operands and the (finite, not tiny) host result, return 1 if
+ * the result is exact, 0 if it is inexact, or -1 if that cannot be told
+ * cheaply and softfloat should be used instead.
+ */
+typedef int (*f32_exact_fn)(union_float32 a, union_float32 b,
+                            union_float32 r);
+typedef int (*f64_exact_fn)(union_float64 a, union_float64 b,
+                            union_float64 r);
+
 typedef float32 (*soft_f32_op2_fn)(float32 a, float32 b, float_status *s);
 typedef float64 (*soft_f64_op2_fn)(float64 a, float64 b, float_status *s);
 typedef float   (*hard_f32_op2_fn)(float a, float b);
@@ -342,14 +367,14 @@ static inline bool f64_is_inf(union_float64 a)
 static inline float32
 float32_gen2(float32 xa, float32 xb, float_status *s,
              hard_f32_op2_fn hard, soft_f32_op2_fn soft,
-             f32_check_fn pre, f32_check_fn post)
+             f32_check_fn pre, f32_check_fn post, f32_exact_fn exact)
 {
     union_float32 ua, ub, ur;
 
     ua.s = xa;
     ub.s = xb;
 
-    if (unlikely(!can_use_fpu(s))) {
+    if (unlikely(!can_use_fpu(s)) && (!exact || !can_use_fpu_exact(s))) {
         goto soft;
     }
 
@@ -360,9 +385,18 @@ float32_gen2(float32 xa, float32 xb, float_status *s,
 
     ur.h = hard(ua.h, ub.h);
     if (unlikely(f32_is_inf(ur))) {
-        s->float_exception_flags |= float_flag_overflow;
+        s->float_exception_flags |= float_flag_overflow | float_flag_inexact;
     } else if (unlikely(fabsf(ur.h) <= FLT_MIN) && post(ua, ub)) {
         goto soft;
+    } else if (exact && !(s->float_exception_flags & float_flag_inexact)) {
+        int e = exact(ua, ub, ur);
+
+        if (unlikely(e < 0)) {
+            goto soft;
+        }
+        if (e == 0) {
+            s->float_exception_flags |= float_flag_inexact;
+        }
     }
     return ur.s;
 
@@ -373,14 +407,14 @@ float32_gen2(float32 xa, float32 xb, float_status *s,
 static inline float64
 float64_gen2(float64 xa, float64 xb, float_status *s,
              hard_f64_op2_fn hard, soft_f64_op2_fn soft,
-             f64_check_fn pre, f64_check_fn post)
+             f64_check_fn pre, f64_check_fn post, f64_exact_fn exact)
 {
     union_float64 ua, ub, ur;
 
     ua.s = xa;
     ub.s = xb;
 
-    if (unlikely(!can_use_fpu(s))) {
+    if (unlikely(!can_use_fpu(s)) && (!exact || !can_use_fpu_exact(s))) {
         goto soft;
     }
 
@@ -391,9 +425,18 @@ float64_gen2(float64 xa, float64 xb, float_status *s,
 
     ur.h = hard(ua.h, ub.h);
     if (unlikely(f64_is_inf(ur))) {
-        s->float_exception_flags |= float_flag_overflow;
+        s->float_exception_flags |= float_flag_overflow | float_flag_inexact;
     } else if (unlikely(fabs(ur.h) <= DBL_MIN) && post(ua, ub)) {
         goto soft;
+    } else if (exact && !(s->float_exception_flags & float_flag_inexact)) {
+        int e = exact(ua, ub, ur);
+
+        if (unlikely(e < 0)) {
+            goto soft;
+        }
+        if (e == 0) {
+            s->float_exception_flags |= float_flag_inexact;
+        }
     }
     return ur.s;
 
@@ -1127,6 +1170,76 @@ static double hard_f64_sub(double a, double b)
     return a - b;
 }
 
+/*
+ * TwoSum: in round-to-nearest the rounding error of r = a + b is itself
+ * representable, and this recovers it exactly as long as nothing overflows.
+ */
+static int f32_add_exact(union_float32 a, union_float32 b, union_float32 r)
+{
+    float bb = r.h - a.h;
+
+    return (a.h - (r.h - bb)) + (b.h - bb) == 0;
+}
+
+static int f32_sub_exact(union_float32 a, union_float32 b, union_float32 r)
+{
+    b.h = -b.h;
+    return f32_add_exact(a, b, r);
+}
+
+static int f64_add_exact(union_float64 a, union_float64 b, union_float64 r)
+{
+    double bb = r.h - a.h;
+
+    return (a.h - (r.h - bb)) + (b.h - bb) == 0;
+}
+
+static int f64_sub_exact(union_float64 a, union_float64 b, union_float64 r)
+{
+    b.h = -b.h;
+    return f64_add_exact(a, b, r);
+}
+
+/*
+ * Whether x * y == z exactly, with the same return convention as the
+ * f64_exact_fn callbacks. The error term of a product is only representable
+ * when it does not underflow, hence the lower bound on z. Without a fast
+ * fused multiply-add, use Dekker's TwoProduct, which also needs x and y
+ * small enough to be split without overflowing.
+ */
+static int f64_is_product(double x, double y, double z)
+{
+    if (z == 0) {
+        return x == 0 || y == 0;
+    }
+    if (unlikely(fabs(z) < 0x1p-969)) {
+        return -1;
+    }
+#ifdef __FP_FAST_FMA
+    return fma(x, y, -z) == 0;
+#else
+    {
+        const double split = 0x1p27 + 1;
+        double p, t, xh, xl, yh, yl;
+
+        if (unlikely(fabs(x) > 0x1p995 || fabs(y) > 0x1p995)) {
+            return -1;
+        }
+        p = x * y;
+        if (p != z) {
+            return 0;
+        }
+        t = split * x;
+        xh = t - (t - x);
+        xl = x - xh;
+        t = split * y;
+        yh = t - (t - y);
+        yl = y - yh;
+        return ((xh * yh - p) + xh * yl + xl * yh) + xl * yl == 0;
+    }
+#endif
+}
+
 static bool f32_addsubmul_post(union_float32 a, union_float32 b)
 {
     if (QEMU_HARDFLOAT_2F32_USE_FP) {
@@ -1145,41 +1258,47 @@ static bool f64_addsubmul_post(union_float64 a, union_float64 b)
 }
 
 static float32 float32_addsub(float32 a, float32 b, float_status *s,
-                              hard_f32_op2_fn hard, soft_f32_op2_fn soft)
+                              hard_f32_op2_fn hard, soft_f32_op2_fn soft,
+                              f32_exact_fn exact)
 {
     return float32_gen2(a, b, s, hard, soft,
-                        f32_is_zon2, f32_addsubmul_post);
+                        f32_is_zon2, f32_addsubmul_post, exact);
 }
 
 static float64 float64_addsub(float64 a, float64 b, float_status *s,
-                              hard_f64_op2_fn hard, soft_f64_op2_fn soft)
+                              hard_f64_op2_fn hard, soft_f64_op2_fn soft,
+                              f64_exact_fn exact)
 {
     return float64_gen2(a, b, s, hard, soft,
-                        f64_is_zon2, f64_addsubmul_post);
+                        f64_is_zon2, f64_addsubmul_post, exact);
 }
 
 float32 QEMU_FLATTEN
 float32_add(float32 a, float32 b, float_status *s)
 {
-    return float32_addsub(a, b, s, hard_f32_add, soft_f32_add);
+    return float32_addsub(a, b, s, hard_f32_add, soft_f32_add,
+                          f32_add_exact);
 }
 
 float32 QEMU_FLATTEN
 float32_sub(float32 a, float32 b, float_status *s)
 {
-    return float32_addsub(a, b, s, hard_f32_sub, soft_f32_sub);
+    return float32_addsub(a, b, s, hard_f32_sub, soft_f32_sub,
+                          f32_sub_exact);
 }
 
 float64 QEMU_FLATTEN
 float64_add(float64 a, float64 b, float_status *s)
 {
-    return float64_addsub(a, b, s, hard_f64_add, soft_f64_add);
+    return float64_addsub(a, b, s, hard_f64_add, soft_f64_add,
+                          f64_add_exact);
 }
 
 float64 QEMU_FLATTEN
 float64_sub(float64 a, float64 b, float_status *s)
 {
-    return float64_addsub(a, b, s, hard_f64_sub, soft_f64_sub);
+    return float64_addsub(a, b, s, hard_f64_sub, soft_f64_sub,
+                          f64_sub_exact);
 }
 
 /*
@@ -1292,18 +1411,29 @@ static double hard_f64_mul(double a, double b)
     return a * b;
 }
 
+/* The product of two singles is always exact as a double */
+static int f32_mul_exact(union_float32 a, union_float32 b, union_float32 r)
+{
+    return (double)a.h * (double)b.h == r.h;
+}
+
+static int f64_mul_exact(union_float64 a, union_float64 b, union_float64 r)
+{
+    return f64_is_product(a.h, b.h, r.h);
+}
+
 float32 QEMU_FLATTEN
 float32_mul(float32 a, float32 b, float_status *s)
 {
     return float32_gen2(a, b, s, hard_f32_mul, soft_f32_mul,
-                        f32_is_zon2, f32_addsubmul_post);
+                        f32_is_zon2, f32_addsubmul_post, f32_mul_exact);
 }
 
 float64 QEMU_FLATTEN
 float64_mul(float64 a, float64 b, float_status *s)
 {
     return float64_gen2(a, b, s, hard_f64_mul, soft_f64_mul,
-                        f64_is_zon2, f64_addsubmul_post);
+                        f64_is_zon2, f64_addsubmul_post, f64_mul_exact);
 }
 
 /*
@@ -1871,18 +2001,29 @@ static bool f64_div_post(union_float64 a, union_float64 b)
     return !float64_is_zero(a.s);
 }
 
+/* A quotient is exact iff multiplying it back gives the dividend */
+static int f32_div_exact(union_float32 a, union_float32 b, union_float32 r)
+{
+    return (double)r.h * (double)b.h == a.h;
+}
+
+static int f64_div_exact(union_float64 a, union_float64 b, union_float64 r)
+{
+    return f64_is_product(r.h, b.h, a.h);
+}
+
 float32 QEMU_FLATTEN
 float32_div(float32 a, float32 b, float_status *s)
 {
     return float32_gen2(a, b, s, hard_f32_div, soft_f32_div,
-                        f32_div_pre, f32_div_post);
+                        f32_div_pre, f32_div_post, f32_div_exact);
 }
 
 float64 QEMU_FLATTEN
 float64_div(float64 a, float64 b, float_status *s)
 {
     return float64_gen2(a, b, s, hard_f64_div, soft_f64_div,
-                        f64_div_pre, f64_div_post);
+                        f64_div_pre, f64_div_post, f64_div_exact);
 }
 
 /*
@@ -2009,8 +2150,26 @@ float16 float64_to_float16(float64 a, bool ieee, float_status *s)
 
 float32 float64_to_float32(float64 a, float_status *s)
 {
-    FloatParts p = float64_unpack_canonical(a, s);
-    FloatParts pr = float_to_float(p, &float32_params, s);
+    FloatParts p, pr;
+
+    if (likely(float64_is_normal(a)) && can_use_fpu_exact(s)) {
+        union_float64 ud;
+        union_float32 uf;
+
+        ud.s = a;
+        uf.h = ud.h;
+        /* Leave overflow and tininess to softfloat */
+        if (likely(fabs(ud.h) > FLT_MIN && !isinf(uf.h))) {
+            if ((double)uf.h != ud.h) {
+                s->float_exception_flags |= float_flag_inexact;
+            }
+            return uf.s;
+        }
+    } else if (float64_is_zero(a)) {
+        return float32_set_sign(float32_zero, float64_is_neg(a));
+    }
+    p = float64_unpack_canonical(a, s);
+    pr = float_to_float(p, &float32_params, s);
     return float32_round_pack_canonical(pr, s);
 }
 
@@ -2240,6 +2399,59 @@ static int64_t round_to_int_and_pack(FloatParts in, FloatRoundMode rmode,
     }
 }
 
+/*
+ * Hardfloat fast path for float-to-integer conversions of zero or normal
+ * inputs with no scaling, when the value is well inside the int64 range.
+ * Host truncation is exact there, and the fraction it drops tells both
+ * whether the result is inexact and which way to round it. Results outside
+ * [min, max] are left to softfloat, which raises invalid.
+ */
+static bool hard_float_to_int(double d, FloatRoundMode rmode, int scale,
+                              int64_t min, int64_t max, int64_t *ret,
+                              float_status *s)
+{
+    double frac;
+    int64_t r;
+
+    if (QEMU_NO_HARDFLOAT || scale != 0 || !(fabs(d) < 0x1p62)) {
+        return false;
+    }
+    r = (int64_t)d;
+    frac = d - (double)r;
+    if (frac != 0) {
+        switch (rmode) {
+        case float_round_nearest_even:
+            if (fabs(frac) > 0.5 || (fabs(frac) == 0.5 && (r & 1))) {
+                r += frac < 0 ? -1 : 1;
+            }
+            break;
+        case float_round_ties_away:
+            if (fabs(frac) >= 0.5) {
+                r += frac < 0 ? -1 : 1;
+            }
+            break;
+        case float_round_to_zero:
+            break;
+        case float_round_up:
+            r += frac > 0;
+            break;
+        case float_round_down:
+            r -= frac < 0;
+            break;
+        default:
+            return false;
+        }
+    }
+    if (r < min || r > max) {
+        return false;
+    }
+    if (frac != 0) {
+        s->float_exception_flags |= float_flag_inexact;
+    }
+    *ret = r;
+    return true;
+}
+
 int8_t float16_to_int8_scalbn(float16 a, FloatRoundMode rmode, int scale,
                               float_status *s)
 {
@@ -2278,6 +2490,13 @@ int16_t float32_to_int16_scalbn(float32 a, FloatRoundMode rmode, int scale,
 int32_t float32_to_int32_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
+    union_float32 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float32_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, INT32_MIN, INT32_MAX, &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float32_unpack_canonical(a, s),
                                  rmode, scale, INT32_MIN, INT32_MAX, s);
 }
@@ -2285,6 +2504,13 @@ int32_t float32_to_int32_scalbn(float32 a, FloatRoundMode rmode, int scale,
 int64_t float32_to_int64_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
+    union_float32 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float32_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, INT64_MIN, INT64_MAX, &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float32_unpack_canonical(a, s),
                                  rmode, scale, INT64_MIN, INT64_MAX, s);
 }
@@ -2299,6 +2525,13 @@ int16_t float64_to_int16_scalbn(float64 a, FloatRoundMode rmode, int scale,
 int32_t float64_to_int32_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
+    union_float64 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float64_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, INT32_MIN, INT32_MAX, &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float64_unpack_canonical(a, s),
                                  rmode, scale, INT32_MIN, INT32_MAX, s);
 }
@@ -2306,6 +2539,13 @@ int32_t float64_to_int32_scalbn(float64 a, FloatRoundMode rmode, int scale,
 int64_t float64_to_int64_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
+    union_float64 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float64_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, INT64_MIN, INT64_MAX, &r, s)) {
+        return r;
+    }
     return round_to_int_and_pack(float64_unpack_canonical(a, s),
                                  rmode, scale, INT64_MIN, INT64_MAX, s);
 }
@@ -2559,6 +2799,13 @@ uint16_t float32_to_uint16_scalbn(float32 a, FloatRoundMode rmode, int scale,
 uint32_t float32_to_uint32_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                   float_status *s)
 {
+    union_float32 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float32_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, 0, UINT32_MAX, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float32_unpack_canonical(a, s),
                                   rmode, scale, UINT32_MAX, s);
 }
@@ -2566,6 +2813,13 @@ uint32_t float32_to_uint32_scalbn(float32 a, FloatRoundMode rmode, int scale,
 uint64_t float32_to_uint64_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                   float_status *s)
 {
+    union_float32 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float32_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, 0, INT64_MAX, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float32_unpack_canonical(a, s),
                                   rmode, scale, UINT64_MAX, s);
 }
@@ -2580,6 +2834,13 @@ uint16_t float64_to_uint16_scalbn(float64 a, FloatRoundMode rmode, int scale,
 uint32_t float64_to_uint32_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                   float_status *s)
 {
+    union_float64 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float64_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, 0, UINT32_MAX, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float64_unpack_canonical(a, s),
                                   rmode, scale, UINT32_MAX, s);
 }
@@ -2587,6 +2848,13 @@ uint32_t float64_to_uint32_scalbn(float64 a, FloatRoundMode rmode, int scale,
 uint64_t float64_to_uint64_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                   float_status *s)
 {
+    union_float64 ua = { .s = a };
+    int64_t r;
+
+    if (likely(float64_is_zero_or_normal(a)) &&
+        hard_float_to_int(ua.h, rmode, scale, 0, INT64_MAX, &r, s)) {
+        return r;
+    }
     return round_to_uint_and_pack(float64_unpack_canonical(a, s),
                                   rmode, scale, UINT64_MAX, s);
 }
@@ -2813,7 +3081,16 @@ float16 int8_to_float16(int8_t a, float_status *status)
 
 float32 int64_to_float32_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (likely(scale == 0 && a >= -(1LL << 24) && a <= (1LL << 24))) {
+        /* Small enough to be represented exactly */
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+    pa = int_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -2844,7 +3121,16 @@ float32 int16_to_float32(int16_t a, float_status *status)
 
 float64 int64_to_float64_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (likely(scale == 0 && a >= -(1LL << 53) && a <= (1LL << 53))) {
+        /* Small enough to be represented exactly */
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+    pa = int_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -2978,7 +3264,16 @@ float16 uint8_to_float16(uint8_t a, float_status *status)
 
 float32 uint64_to_float32_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (likely(scale == 0 && a <= (1LL << 24))) {
+        /* Small enough to be represented exactly */
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+    pa = uint_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -3009,7 +3304,16 @@ float32 uint16_to_float32(uint16_t a, float_status *status)
 
 float64 uint64_to_float64_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (likely(scale == 0 && a <= (1LL << 53))) {
+        /* Small enough to be represented exactly */
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+    pa = uint_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -3179,6 +3483,50 @@ MINMAX(16, max, false, false, false)
 MINMAX(16, maxnum, false, true, false)
 MINMAX(16, maxnummag, false, true, true)
 
+#undef MINMAX
+
+/*
+ * When neither input is a NaN or a denormal, the result is one of the
+ * inputs unchanged and no flags are raised, so pick it by comparing the
+ * sign-magnitude encodings directly instead of unpacking both operands.
+ * This makes the same choice as minmax_floats().
+ */
+static inline bool minmax_pick_b(uint64_t a, uint64_t b, uint64_t sign_bit,
+                                 bool ismin, bool ismag)
+{
+    bool a_sign = a & sign_bit;
+    bool b_sign = b & sign_bit;
+    bool a_less = (a & ~sign_bit) < (b & ~sign_bit);
+
+    if (ismag && (a & ~sign_bit) != (b & ~sign_bit)) {
+        return a_less ^ ismin;
+    }
+    if (a_sign == b_sign) {
+        return a_sign ^ a_less ^ ismin;
+    }
+    return a_sign ^ ismin;
+}
+
+#define MINMAX(sz, name, ismin, isiee, ismag)                           \
+float ## sz float ## sz ## _ ## name(float ## sz a, float ## sz b,      \
+                                     float_status *s)                   \
+{                                                                       \
+    FloatParts pa, pb, pr;                                              \
+                                                                        \
+    if (likely((float ## sz ## _is_zero_or_normal(a) ||                 \
+                float ## sz ## _is_infinity(a)) &&                      \
+               (float ## sz ## _is_zero_or_normal(b) ||                 \
+                float ## sz ## _is_infinity(b)))) {                     \
+        return minmax_pick_b(float ## sz ## _val(a), float ## sz ## _val(b), \
+                             1ULL << (sz - 1), ismin, ismag) ? b : a;   \
+    }                                                                   \
+    pa = float ## sz ## _unpack_canonical(a, s);                        \
+    pb = float ## sz ## _unpack_canonical(b, s);                        \
+    pr = minmax_floats(pa, pb, ismin, isiee, ismag, s);                 \
+                                                                        \
+    return float ## sz ## _round_pack_canonical(pr, s);                 \
+}
+
 MINMAX(32, min, true, false, false)
 MINMAX(32, minnum, true, true, false)
 MINMAX(32, minnummag, true, true, true)
@@ -3540,7 +3888,7 @@ float32 QEMU_FLATTEN float32_sqrt(float32 xa, float_status *s)
     union_float32 ua, ur;
 
     ua.s = xa;
-    if (unlikely(!can_use_fpu(s))) {
+    if (unlikely(!can_use_fpu(s)) && !can_use_fpu_exact(s)) {
         goto soft;
     }
 
@@ -3556,6 +3904,10 @@ float32 QEMU_FLATTEN float32_sqrt(float32 xa, float_status *s)
         goto soft;
     }
     ur.h = sqrtf(ua.h);
+    if (!(s->float_exception_flags & float_flag_inexact) &&
+        (double)ur.h * (double)ur.h != ua.h) {
+        s->float_exception_flags |= float_flag_inexact;
+    }
     return ur.s;
 
  soft:
@@ -3567,7 +3919,7 @@ float64 QEMU_FLATTEN float64_sqrt(float64 xa, float_status *s)
     union_float64 ua, ur;
 
     ua.s = xa;
-    if (unlikely(!can_use_fpu(s))) {
+    if (unlikely(!can_use_fpu(s)) && !can_use_fpu_exact(s)) {
         goto soft;
     }
 
@@ -3583,6 +3935,16 @@ float64 QEMU_FLATTEN float64_sqrt(float64 xa, float_status *s)
         goto soft;
     }
     ur.h = sqrt(ua.h);
+    if (!(s->float_exception_flags & float_flag_inexact)) {
+        int e = f64_is_product(ur.h, ur.h, ua.h);
+
+        if (unlikely(e < 0)) {
+            goto soft;
+        }
+        if (e == 0) {
+            s->float_exception_flags |= float_flag_inexact;
+        }
+    }
     return ur.s;
 
  soft:
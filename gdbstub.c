@@ -29,6 +29,7 @@
 #include "qemu/error-report.h"
 #include "qemu/ctype.h"
 #include "qemu/cutils.h"
+#include "qemu/units.h"
 #include "qemu/module.h"
 #include "trace/trace-root.h"
 #ifdef CONFIG_USER_ONLY
@@ -52,6 +53,7 @@
 #include "hw/semihosting/semihost.h"
 #include "exec/exec-all.h"
 #include "sysemu/replay.h"
+#include "cheri_tagmem.h"
 
 #ifdef CONFIG_USER_ONLY
 #define GDB_ATTACHED "0"
@@ -2157,6 +2159,123 @@ static void handle_query_rcmd(GdbCmdContext *gdb_ctx, void *user_ctx)
 }
 #endif
 
+#ifdef TARGET_CHERI
+/* Largest CHERI bulk transfer reply, before binary escaping */
+#define CHERI_MAX_BULK_LENGTH (256 * KiB)
+
+static GDBRegisterState *gdb_find_cheri_regs(CPUState *cpu)
+{
+    GDBRegisterState *r;
+
+    for (r = cpu->gdb_regs; r; r = r->next) {
+        if (strstr(r->xml, "cheri")) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * qXfer:capregs:read::offset,length
+ *
+ * The object is the target's whole CHERI register feature in the same
+ * encoding as individual register reads (including the tag mask), so the
+ * capability register file can be fetched in one round trip.
+ */
+static void handle_query_xfer_capregs(GdbCmdContext *gdb_ctx, void *user_ctx)
+{
+    CPUState *cpu = gdbserver_state.g_cpu;
+    GDBRegisterState *r = gdb_find_cheri_regs(cpu);
+    unsigned long addr, len, total_len;
+    int i;
+
+    if (gdb_ctx->num_params < 2) {
+        put_packet("E22");
+        return;
+    }
+    if (!r) {
+        put_packet("");
+        return;
+    }
+
+    g_byte_array_set_size(gdbserver_state.mem_buf, 0);
+    for (i = 0; i < r->num_regs; i++) {
+        r->get_reg(cpu->env_ptr, gdbserver_state.mem_buf, i);
+    }
+
+    addr = gdb_ctx->params[0].val_ul;
+    len = gdb_ctx->params[1].val_ul;
+    total_len = gdbserver_state.mem_buf->len;
+    if (addr > total_len) {
+        put_packet("E00");
+        return;
+    }
+
+    len = MIN(len, CHERI_MAX_BULK_LENGTH);
+    if (len < total_len - addr) {
+        g_string_assign(gdbserver_state.str_buf, "m");
+    } else {
+        g_string_assign(gdbserver_state.str_buf, "l");
+        len = total_len - addr;
+    }
+    memtox(gdbserver_state.str_buf,
+           (const char *)gdbserver_state.mem_buf->data + addr, len);
+
+    put_packet_binary(gdbserver_state.str_buf->str,
+                      gdbserver_state.str_buf->len, true);
+}
+
+#ifndef CONFIG_USER_ONLY
+/*
+ * qqemu.cheri.TaggedMem:addr,length
+ *
+ * Reads a capability aligned range of virtual memory together with its tags.
+ * The binary (x-encoded) reply is the tag bitmap, one bit per capability
+ * starting at the LSB of the first byte, followed by the memory contents.
+ */
+static void handle_query_qemu_cheri_tagged_mem(GdbCmdContext *gdb_ctx,
+                                               void *user_ctx)
+{
+    CPUState *cpu = gdbserver_state.g_cpu;
+    target_ulong addr, len;
+    size_t tags_len;
+    g_autofree uint8_t *tags = NULL;
+
+    if (gdb_ctx->num_params != 2) {
+        put_packet("E22");
+        return;
+    }
+
+    addr = gdb_ctx->params[0].val_ull;
+    len = gdb_ctx->params[1].val_ull;
+    if (phy_memory_mode || len > CHERI_MAX_BULK_LENGTH ||
+        !QEMU_IS_ALIGNED(addr, CHERI_CAP_SIZE) ||
+        !QEMU_IS_ALIGNED(len, CHERI_CAP_SIZE)) {
+        put_packet("E22");
+        return;
+    }
+
+    tags_len = DIV_ROUND_UP(len / CHERI_CAP_SIZE, BITS_PER_BYTE);
+    tags = g_malloc(tags_len);
+    g_byte_array_set_size(gdbserver_state.mem_buf, len);
+    cpu_synchronize_state(cpu);
+    if (cheri_tag_get_many_debug(cpu, addr, len, tags) ||
+        cpu_memory_rw_debug(cpu, addr, gdbserver_state.mem_buf->data, len,
+                            false)) {
+        put_packet("E14");
+        return;
+    }
+
+    g_string_truncate(gdbserver_state.str_buf, 0);
+    memtox(gdbserver_state.str_buf, (const char *)tags, tags_len);
+    memtox(gdbserver_state.str_buf,
+           (const char *)gdbserver_state.mem_buf->data, len);
+    put_packet_binary(gdbserver_state.str_buf->str,
+                      gdbserver_state.str_buf->len, true);
+}
+#endif
+#endif
+
 static void handle_query_supported(GdbCmdContext *gdb_ctx, void *user_ctx)
 {
     CPUClass *cc;
@@ -2166,6 +2285,11 @@ static void handle_query_supported(GdbCmdContext *gdb_ctx, void *user_ctx)
     if (cc->gdb_core_xml_file) {
         g_string_append(gdbserver_state.str_buf, ";qXfer:features:read+");
     }
+#ifdef TARGET_CHERI
+    if (gdb_find_cheri_regs(first_cpu)) {
+        g_string_append(gdbserver_state.str_buf, ";qXfer:capregs:read+");
+    }
+#endif
 
     if (replay_mode == REPLAY_MODE_PLAY) {
         g_string_append(gdbserver_state.str_buf,
@@ -2243,6 +2367,9 @@ static void handle_query_qemu_supported(GdbCmdContext *gdb_ctx, void *user_ctx)
     g_string_printf(gdbserver_state.str_buf, "sstepbits;sstep");
 #ifndef CONFIG_USER_ONLY
     g_string_append(gdbserver_state.str_buf, ";PhyMemMode");
+#endif
+#if defined(TARGET_CHERI) && !defined(CONFIG_USER_ONLY)
+    g_string_append(gdbserver_state.str_buf, ";cheri.TaggedMem");
 #endif
     put_strbuf();
 }
@@ -2338,6 +2465,14 @@ static GdbCmdParseEntry gdb_gen_query_table[] = {
         .cmd_startswith = 1,
         .schema = "s:l,l0"
     },
+#ifdef TARGET_CHERI
+    {
+        .handler = handle_query_xfer_capregs,
+        .cmd = "Xfer:capregs:read::",
+        .cmd_startswith = 1,
+        .schema = "l,l0"
+    },
+#endif
     {
         .handler = handle_query_attached,
         .cmd = "Attached:",
@@ -2356,6 +2491,14 @@ static GdbCmdParseEntry gdb_gen_query_table[] = {
         .handler = handle_query_qemu_phy_mem_mode,
         .cmd = "qemu.PhyMemMode",
     },
+#ifdef TARGET_CHERI
+    {
+        .handler = handle_query_qemu_cheri_tagged_mem,
+        .cmd = "qemu.cheri.TaggedMem:",
+        .cmd_startswith = 1,
+        .schema = "L,L0"
+    },
+#endif
 #endif
 };
 
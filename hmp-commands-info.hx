@@ -252,6 +252,23 @@ SRST
     Show the active virtual memory mappings.
 ERST
 
+#if defined(TARGET_CHERI)
+    {
+        .name       = "statcounters",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show the CHERI statcounters for each CPU",
+        .cmd        = hmp_info_statcounters,
+    },
+#endif
+
+SRST
+  ``info statcounters``
+    Show the per-CPU CHERI statcounters (TLB misses, capability loads and
+    stores, tag operations, exceptions, translated blocks and page table
+    walks).
+ERST
+
     {
         .name       = "mtree",
         .args_type  = "flatview:-f,dispatch_tree:-d,owner:-o,disabled:-D",
@@ -33,6 +33,7 @@
 #include "sysemu/reset.h"
 #include "sysemu/runstate.h"
 #include "qemu/error-report.h"
+#include "qemu/main-loop.h"
 #include "trace.h"
 #include "hw/qdev-properties.h"
 
@@ -997,20 +998,85 @@ static const TypeInfo serial_info = {
     .class_init = serial_class_init,
 };
 
+/*
+ * Answer register reads that have no side effects without taking the
+ * BQL. Guests poll LSR around every byte they send, and on SMP boards
+ * this otherwise serializes all vCPUs behind the console. Everything
+ * else touches the FIFOs, timers, chardev or IRQ line and returns
+ * false so the caller goes through serial_ioport_read under the BQL.
+ */
+static bool serial_read_nolock(SerialState *s, hwaddr addr, uint64_t *ret)
+{
+    uint8_t val;
+
+    switch (addr) {
+    case 1:
+        if (qatomic_read(&s->lcr) & UART_LCR_DLAB) {
+            return false;
+        }
+        val = qatomic_read(&s->ier);
+        break;
+    case 3:
+        val = qatomic_read(&s->lcr);
+        break;
+    case 4:
+        val = qatomic_read(&s->mcr);
+        break;
+    case 5:
+        val = qatomic_read(&s->lsr);
+        /* reading BI/OE clears them, which may lower the interrupt */
+        if (val & (UART_LSR_BI | UART_LSR_OE)) {
+            return false;
+        }
+        break;
+    case 7:
+        val = qatomic_read(&s->scr);
+        break;
+    default:
+        return false;
+    }
+    trace_serial_read(addr, val);
+    *ret = val;
+    return true;
+}
+
 /* Memory mapped interface */
 static uint64_t serial_mm_read(void *opaque, hwaddr addr,
                                unsigned size)
 {
     SerialMM *s = SERIAL_MM(opaque);
-    return serial_ioport_read(&s->serial, addr >> s->regshift, 1);
+    bool locked = false;
+    uint64_t ret;
+
+    if (serial_read_nolock(&s->serial, addr >> s->regshift, &ret)) {
+        return ret;
+    }
+    if (!qemu_mutex_iothread_locked()) {
+        qemu_mutex_lock_iothread();
+        locked = true;
+    }
+    ret = serial_ioport_read(&s->serial, addr >> s->regshift, 1);
+    if (locked) {
+        qemu_mutex_unlock_iothread();
+    }
+    return ret;
 }
 
 static void serial_mm_write(void *opaque, hwaddr addr,
                             uint64_t value, unsigned size)
 {
     SerialMM *s = SERIAL_MM(opaque);
+    bool locked = false;
+
     value &= 255;
+    if (!qemu_mutex_iothread_locked()) {
+        qemu_mutex_lock_iothread();
+        locked = true;
+    }
     serial_ioport_write(&s->serial, addr >> s->regshift, value, 1);
+    if (locked) {
+        qemu_mutex_unlock_iothread();
+    }
 }
 
 static const MemoryRegionOps serial_mm_ops[3] = {
@@ -29,6 +29,17 @@
 #include "hw/intc/sifive_clint.h"
 #include "qemu/timer.h"
 
+/*
+ * The CLINT region does not take the BQL (see sifive_clint_realize).
+ * Each hart's timecmp is only written by MMIO and read by the timer
+ * callback. The pending bit is updated through riscv_cpu_update_mip(),
+ * which takes the BQL only when the bit actually changes.
+ */
+struct SiFiveCLINTHart {
+    RISCVCPU *cpu;
+    uint32_t timebase_freq;
+};
+
 static uint64_t cpu_riscv_read_rtc(uint32_t timebase_freq)
 {
     return muldiv64(qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL),
@@ -36,19 +47,19 @@ static uint64_t cpu_riscv_read_rtc(uint32_t timebase_freq)
 }
 
 /*
- * Called when timecmp is written to update the QEMU timer or immediately
- * trigger timer interrupt if mtimecmp <= current timer value.
+ * Raise the timer interrupt if timecmp is not in the future, otherwise
+ * arm the QEMU timer for it. The timer is armed before MTIP is lowered,
+ * so a callback for an older deadline cannot be lost in between.
  */
-static void sifive_clint_write_timecmp(RISCVCPU *cpu, uint64_t value,
-                                       uint32_t timebase_freq)
+static void sifive_clint_update_timer(RISCVCPU *cpu, uint64_t timecmp,
+                                      uint32_t timebase_freq)
 {
     uint64_t next;
     uint64_t diff;
 
     uint64_t rtc_r = cpu_riscv_read_rtc(timebase_freq);
 
-    cpu->env.timecmp = value;
-    if (cpu->env.timecmp <= rtc_r) {
+    if (timecmp <= rtc_r) {
         /* if we're setting an MTIMECMP value in the "past",
            immediately raise the timer interrupt */
         riscv_cpu_update_mip(cpu, MIP_MTIP, BOOL_TO_MASK(1));
@@ -56,22 +67,48 @@ static void sifive_clint_write_timecmp(RISCVCPU *cpu, uint64_t value,
     }
 
     /* otherwise, set up the future timer interrupt */
-    riscv_cpu_update_mip(cpu, MIP_MTIP, BOOL_TO_MASK(0));
-    diff = cpu->env.timecmp - rtc_r;
+    diff = timecmp - rtc_r;
     /* back to ns (note args switched in muldiv64) */
     next = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) +
         muldiv64(diff, NANOSECONDS_PER_SECOND, timebase_freq);
     timer_mod(cpu->env.timer, next);
+    riscv_cpu_update_mip(cpu, MIP_MTIP, BOOL_TO_MASK(0));
+}
+
+/*
+ * Called when timecmp is written to update the QEMU timer or immediately
+ * trigger timer interrupt if mtimecmp <= current timer value.
+ */
+static void sifive_clint_write_timecmp(RISCVCPU *cpu, uint64_t value,
+                                       uint32_t timebase_freq)
+{
+    qatomic_set_u64(&cpu->env.timecmp, value);
+    /* Pairs with the barrier in sifive_clint_timer_cb */
+    smp_mb();
+    sifive_clint_update_timer(cpu, value, timebase_freq);
 }
 
 /*
  * Callback used when the timer set using timer_mod expires.
  * Should raise the timer interrupt line
+ *
+ * timecmp may be rewritten by its hart while this runs. Re-evaluate
+ * until it is stable: a write that lands after the re-read below sees
+ * the MTIP value set here and corrects it itself.
  */
 static void sifive_clint_timer_cb(void *opaque)
 {
-    RISCVCPU *cpu = opaque;
-    riscv_cpu_update_mip(cpu, MIP_MTIP, BOOL_TO_MASK(1));
+    SiFiveCLINTHart *hart = opaque;
+    RISCVCPU *cpu = hart->cpu;
+    uint64_t timecmp = qatomic_read_u64(&cpu->env.timecmp);
+    uint64_t prev;
+
+    do {
+        sifive_clint_update_timer(cpu, timecmp, hart->timebase_freq);
+        smp_mb();
+        prev = timecmp;
+        timecmp = qatomic_read_u64(&cpu->env.timecmp);
+    } while (timecmp != prev);
 }
 
 /* CPU wants to read rtc or timecmp register */
@@ -86,7 +123,7 @@ static uint64_t sifive_clint_read(void *opaque, hwaddr addr, unsigned size)
         if (!env) {
             error_report("clint: invalid timecmp hartid: %zu", hartid);
         } else if ((addr & 0x3) == 0) {
-            return (env->mip & MIP_MSIP) > 0;
+            return (qatomic_read__nocheck(&env->mip) & MIP_MSIP) > 0;
         } else {
             error_report("clint: invalid read: %08x", (uint32_t)addr);
             return 0;
@@ -101,11 +138,11 @@ static uint64_t sifive_clint_read(void *opaque, hwaddr addr, unsigned size)
             error_report("clint: invalid timecmp hartid: %zu", hartid);
         } else if ((addr & 0x7) == 0) {
             /* timecmp_lo */
-            uint64_t timecmp = env->timecmp;
+            uint64_t timecmp = qatomic_read_u64(&env->timecmp);
             return timecmp & 0xFFFFFFFF;
         } else if ((addr & 0x7) == 4) {
             /* timecmp_hi */
-            uint64_t timecmp = env->timecmp;
+            uint64_t timecmp = qatomic_read_u64(&env->timecmp);
             return (timecmp >> 32) & 0xFFFFFFFF;
         } else {
             error_report("clint: invalid read: %08x", (uint32_t)addr);
@@ -152,13 +189,13 @@ static void sifive_clint_write(void *opaque, hwaddr addr, uint64_t value,
             error_report("clint: invalid timecmp hartid: %zu", hartid);
         } else if ((addr & 0x7) == 0) {
             /* timecmp_lo */
-            uint64_t timecmp_hi = env->timecmp >> 32;
+            uint64_t timecmp_hi = qatomic_read_u64(&env->timecmp) >> 32;
             sifive_clint_write_timecmp(RISCV_CPU(cpu),
                 timecmp_hi << 32 | (value & 0xFFFFFFFF), clint->timebase_freq);
             return;
         } else if ((addr & 0x7) == 4) {
             /* timecmp_hi */
-            uint64_t timecmp_lo = env->timecmp;
+            uint64_t timecmp_lo = qatomic_read_u64(&env->timecmp);
             sifive_clint_write_timecmp(RISCV_CPU(cpu),
                 value << 32 | (timecmp_lo & 0xFFFFFFFF), clint->timebase_freq);
         } else {
@@ -202,8 +239,29 @@ static Property sifive_clint_properties[] = {
 static void sifive_clint_realize(DeviceState *dev, Error **errp)
 {
     SiFiveCLINTState *s = SIFIVE_CLINT(dev);
+    int i;
+
+    s->harts = g_new0(SiFiveCLINTHart, s->num_harts);
+    for (i = 0; i < s->num_harts; i++) {
+        CPUState *cpu = qemu_get_cpu(s->hartid_base + i);
+        CPURISCVState *env = cpu ? cpu->env_ptr : NULL;
+        if (!env) {
+            continue;
+        }
+        s->harts[i].cpu = RISCV_CPU(cpu);
+        s->harts[i].timebase_freq = s->timebase_freq;
+        env->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL,
+                                  &sifive_clint_timer_cb, &s->harts[i]);
+        env->timecmp = 0;
+    }
+
     memory_region_init_io(&s->mmio, OBJECT(dev), &sifive_clint_ops, s,
                           TYPE_SIFIVE_CLINT, s->aperture_size);
+    /*
+     * Timer and IPI accesses are frequent on SMP guests; dispatch them
+     * without the BQL so that harts do not serialize on each other.
+     */
+    memory_region_clear_global_locking(&s->mmio);
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->mmio);
 }
 
@@ -247,9 +305,6 @@ DeviceState *sifive_clint_create(hwaddr addr, hwaddr size,
         if (provide_rdtime) {
             riscv_cpu_set_rdtime_fn(env, cpu_riscv_read_rtc, timebase_freq);
         }
-        env->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL,
-                                  &sifive_clint_timer_cb, cpu);
-        env->timecmp = 0;
     }
 
     DeviceState *dev = qdev_new(TYPE_SIFIVE_CLINT);
@@ -31,6 +31,7 @@
 #include "target/riscv/cpu.h"
 #include "sysemu/sysemu.h"
 #include "migration/vmstate.h"
+#include "qemu/main-loop.h"
 
 #define RISCV_DEBUG_PLIC 0
 
@@ -133,30 +134,55 @@ static int sifive_plic_irqs_pending(SiFivePLICState *plic, uint32_t addrid)
     return 0;
 }
 
-static void sifive_plic_update(SiFivePLICState *plic)
+static uint32_t sifive_plic_mip_bit(PLICMode mode)
+{
+    switch (mode) {
+    case PLICMode_M:
+        return MIP_MEIP;
+    case PLICMode_S:
+        return MIP_SEIP;
+    default:
+        return 0;
+    }
+}
+
+/* Called with plic->lock held */
+static bool sifive_plic_update_needed(SiFivePLICState *plic)
+{
+    int addrid;
+
+    for (addrid = 0; addrid < plic->num_addrs; addrid++) {
+        uint32_t hartid = plic->addr_config[addrid].hartid;
+        uint32_t mip = sifive_plic_mip_bit(plic->addr_config[addrid].mode);
+        CPUState *cpu = qemu_get_cpu(hartid);
+        CPURISCVState *env = cpu ? cpu->env_ptr : NULL;
+        if (!env || !mip) {
+            continue;
+        }
+        if (!(qatomic_read__nocheck(&env->mip) & mip) !=
+            !sifive_plic_irqs_pending(plic, addrid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Called with the BQL and plic->lock held */
+static void sifive_plic_update_locked(SiFivePLICState *plic)
 {
     int addrid;
 
     /* raise irq on harts where this irq is enabled */
     for (addrid = 0; addrid < plic->num_addrs; addrid++) {
         uint32_t hartid = plic->addr_config[addrid].hartid;
-        PLICMode mode = plic->addr_config[addrid].mode;
+        uint32_t mip = sifive_plic_mip_bit(plic->addr_config[addrid].mode);
         CPUState *cpu = qemu_get_cpu(hartid);
         CPURISCVState *env = cpu ? cpu->env_ptr : NULL;
-        if (!env) {
+        if (!env || !mip) {
             continue;
         }
         int level = sifive_plic_irqs_pending(plic, addrid);
-        switch (mode) {
-        case PLICMode_M:
-            riscv_cpu_update_mip(RISCV_CPU(cpu), MIP_MEIP, BOOL_TO_MASK(level));
-            break;
-        case PLICMode_S:
-            riscv_cpu_update_mip(RISCV_CPU(cpu), MIP_SEIP, BOOL_TO_MASK(level));
-            break;
-        default:
-            break;
-        }
+        riscv_cpu_update_mip(RISCV_CPU(cpu), mip, BOOL_TO_MASK(level));
     }
 
     if (RISCV_DEBUG_PLIC) {
@@ -164,6 +190,35 @@ static void sifive_plic_update(SiFivePLICState *plic)
     }
 }
 
+/*
+ * Propagate the PLIC state to the harts' external interrupt lines.
+ *
+ * MMIO accesses run without the BQL, but changing a hart's pending
+ * interrupts needs it, and sifive_plic_irq_request is called with it
+ * held. The lock order is therefore the BQL, then plic->lock. An MMIO
+ * access that changes no line skips the BQL entirely; otherwise the
+ * lines are recomputed from the latest state once both locks are held,
+ * so a concurrent update can never be overwritten by a stale one.
+ *
+ * Called with plic->lock held.
+ */
+static void sifive_plic_update(SiFivePLICState *plic)
+{
+    if (qemu_mutex_iothread_locked()) {
+        sifive_plic_update_locked(plic);
+        return;
+    }
+
+    if (!sifive_plic_update_needed(plic)) {
+        return;
+    }
+    qemu_mutex_unlock(&plic->lock);
+    qemu_mutex_lock_iothread();
+    qemu_mutex_lock(&plic->lock);
+    sifive_plic_update_locked(plic);
+    qemu_mutex_unlock_iothread();
+}
+
 static uint32_t sifive_plic_claim(SiFivePLICState *plic, uint32_t addrid)
 {
     int i, j;
@@ -195,9 +250,8 @@ static uint32_t sifive_plic_claim(SiFivePLICState *plic, uint32_t addrid)
     return max_irq;
 }
 
-static uint64_t sifive_plic_read(void *opaque, hwaddr addr, unsigned size)
+static uint64_t sifive_plic_do_read(SiFivePLICState *plic, hwaddr addr)
 {
-    SiFivePLICState *plic = opaque;
 
     /* writes must be 4 byte words */
     if ((addr & 0x3) != 0) {
@@ -269,10 +323,9 @@ err:
     return 0;
 }
 
-static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
-        unsigned size)
+static void sifive_plic_do_write(SiFivePLICState *plic, hwaddr addr,
+                                 uint64_t value)
 {
-    SiFivePLICState *plic = opaque;
 
     /* writes must be 4 byte words */
     if ((addr & 0x3) != 0) {
@@ -350,6 +403,27 @@ err:
                   __func__, addr);
 }
 
+static uint64_t sifive_plic_read(void *opaque, hwaddr addr, unsigned size)
+{
+    SiFivePLICState *plic = opaque;
+    uint64_t value;
+
+    qemu_mutex_lock(&plic->lock);
+    value = sifive_plic_do_read(plic, addr);
+    qemu_mutex_unlock(&plic->lock);
+    return value;
+}
+
+static void sifive_plic_write(void *opaque, hwaddr addr, uint64_t value,
+        unsigned size)
+{
+    SiFivePLICState *plic = opaque;
+
+    qemu_mutex_lock(&plic->lock);
+    sifive_plic_do_write(plic, addr, value);
+    qemu_mutex_unlock(&plic->lock);
+}
+
 static const MemoryRegionOps sifive_plic_ops = {
     .read = sifive_plic_read,
     .write = sifive_plic_write,
@@ -436,8 +510,10 @@ static void sifive_plic_irq_request(void *opaque, int irq, int level)
     if (RISCV_DEBUG_PLIC) {
         qemu_log("sifive_plic_irq_request: irq=%d level=%d\n", irq, level);
     }
+    qemu_mutex_lock(&plic->lock);
     sifive_plic_set_pending(plic, irq, level > 0);
     sifive_plic_update(plic);
+    qemu_mutex_unlock(&plic->lock);
 }
 
 static void sifive_plic_realize(DeviceState *dev, Error **errp)
@@ -445,8 +521,14 @@ static void sifive_plic_realize(DeviceState *dev, Error **errp)
     SiFivePLICState *plic = SIFIVE_PLIC(dev);
     int i;
 
+    qemu_mutex_init(&plic->lock);
     memory_region_init_io(&plic->mmio, OBJECT(dev), &sifive_plic_ops, plic,
                           TYPE_SIFIVE_PLIC, plic->aperture_size);
+    /*
+     * Claim/complete and priority accesses are serialized by plic->lock
+     * rather than the BQL, see sifive_plic_update.
+     */
+    memory_region_clear_global_locking(&plic->mmio);
     parse_hart_config(plic);
     plic->bitfield_words = (plic->num_sources + 31) >> 5;
     plic->num_enables = plic->bitfield_words * plic->num_addrs;
@@ -518,6 +518,7 @@ static void virt_machine_init(MachineState *machine)
     uint32_t fdt_load_addr;
     uint64_t kernel_entry;
     DeviceState *mmio_plic, *virtio_plic, *pcie_plic;
+    SerialMM *uart;
     int i, j, base_hartid, hart_count;
 
     /* Check socket count limit */
@@ -689,9 +690,16 @@ static void virt_machine_init(MachineState *machine)
                          memmap[VIRT_PCIE_PIO].base,
                          DEVICE(pcie_plic), true);
 
-    serial_mm_init(system_memory, memmap[VIRT_UART0].base,
+    uart = serial_mm_init(system_memory, memmap[VIRT_UART0].base,
         0, qdev_get_gpio_in(DEVICE(mmio_plic), UART0_IRQ), 399193,
         serial_hd(0), DEVICE_LITTLE_ENDIAN);
+    /*
+     * serial_mm_read/write take the BQL themselves when needed. Only boards
+     * whose UART interrupt controller has been audited for this may drop
+     * the global lock, the PLIC takes the BQL before changing a line.
+     */
+    memory_region_clear_global_locking(
+        sysbus_mmio_get_region(SYS_BUS_DEVICE(uart), 0));
 
     sysbus_create_simple("goldfish_rtc", memmap[VIRT_RTC].base,
         qdev_get_gpio_in(DEVICE(mmio_plic), RTC_IRQ));
@@ -713,6 +721,13 @@ static void virt_machine_instance_init(Object *obj)
 static void virt_machine_class_init(ObjectClass *oc, void *data)
 {
     MachineClass *mc = MACHINE_CLASS(oc);
+    /*
+     * Kick virtio-mmio queues through an eventfd, so that requests are
+     * handled by the main loop or an iothread rather than the vCPU thread.
+     */
+    static GlobalProperty compat[] = {
+        { "virtio-mmio", "ioeventfd", "on" },
+    };
 
     mc->desc = "RISC-V VirtIO board";
     mc->init = virt_machine_init;
@@ -723,6 +738,7 @@ static void virt_machine_class_init(ObjectClass *oc, void *data)
     mc->cpu_index_to_instance_props = riscv_numa_cpu_index_to_props;
     mc->get_default_cpu_node_id = riscv_numa_get_default_cpu_node_id;
     mc->numa_mem_supported = true;
+    compat_props_add(mc->compat_props, compat, G_N_ELEMENTS(compat));
 }
 
 static const TypeInfo virt_machine_typeinfo = {
@@ -103,6 +103,23 @@ extern AioWait global_aio_wait;
     qatomic_dec(&wait_->num_waiters);                              \
     waited_; })
 
+/**
+ * aio_inc_in_flight:
+ *
+ * Count an I/O request in flight in the block layer or in a thread pool of
+ * any AioContext, until the matching aio_dec_in_flight().
+ */
+void aio_inc_in_flight(void);
+void aio_dec_in_flight(void);
+
+/**
+ * aio_any_in_flight:
+ *
+ * Return whether some I/O request counted by aio_inc_in_flight() has not
+ * completed yet, so that its completion may still raise a guest interrupt.
+ */
+bool aio_any_in_flight(void);
+
 /**
  * aio_wait_kick:
  * Wake up the main thread if it is waiting on AIO_WAIT_WHILE().  During
@@ -703,6 +703,18 @@ AioContext *qemu_get_current_aio_context(void);
  */
 void aio_context_setup(AioContext *ctx);
 
+/**
+ * aio_context_after_fork:
+ * @ctx: the aio context
+ * @errp: pointer to Error*, to store an error if it happens.
+ *
+ * Give @ctx its own event notifier and fd monitoring instance in a child
+ * process created by fork(). They are otherwise shared with the parent and
+ * its other children, which can then steal each other's notifications.
+ * Must be called in the child before @ctx is used.
+ */
+void aio_context_after_fork(AioContext *ctx, Error **errp);
+
 /**
  * aio_context_destroy:
  * @ctx: the aio context
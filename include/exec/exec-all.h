@@ -549,6 +549,17 @@ static inline uint32_t tb_cflags(const TranslationBlock *tb)
 }
 
 /* current cflags for hashing/comparison */
+/*
+ * Kinds of indirect TB exit, see tcg_gen_lookup_and_goto_ptr_ic().
+ * Unless TB_IND_FULL_STATE is given the jump must not change any of the
+ * state hashed into the TB (flags, cs_base, ...), so only the new pc has
+ * to be checked against the cached target.
+ */
+#define TB_IND_JUMP         0
+#define TB_IND_CALL         1 /* return address is the end of the TB */
+#define TB_IND_RETURN       2
+#define TB_IND_FULL_STATE   4
+
 static inline uint32_t curr_cflags(CPUState *cpu)
 {
     uint32_t flags = (parallel_cpus ? CF_PARALLEL : 0) |
@@ -568,6 +579,8 @@ void tb_invalidate_phys_range(target_ulong start, target_ulong end);
 void tb_invalidate_phys_addr(AddressSpace *as, hwaddr addr, MemTxAttrs attrs);
 #endif
 void tb_flush(CPUState *cpu);
+void tb_jmp_cache_init(CPUState *cpu);
+void tb_jmp_cache_destroy(CPUState *cpu);
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
                                    target_ulong cs_base, target_ulong cs_top,
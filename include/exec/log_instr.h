@@ -51,6 +51,9 @@
  * - bool cpu_log_instr_event_regdump(env, event)
  *   Builds a register dump for the target, returns true if the register dump
  *   was not produced and the event should be cancelled.
+ * - void cpu_log_instr_lazy_regs(env, regs)
+ *   Only for targets that define TARGET_LOG_INSTR_LAZY_REGS, log the current
+ *   value of the general purpose registers in the @regs bitmap.
  *
  * - Each target should implement their own register update logging helpers that
  *   call into qemu_log_instr_gpr(), qemu_log_instr_cap() and similar interface
@@ -232,6 +235,12 @@ void qemu_log_instr_mode_switch(CPUArchState *env,
                                 qemu_log_instr_cpu_mode_t mode,
                                 target_ulong pc);
 
+/*
+ * Must be called before changing the state that cpu_get_asid() depends on,
+ * so that buffered records are not logged with the new ASID.
+ */
+void qemu_log_instr_asid_change(CPUArchState *env);
+
 /*
  * Emit all buffered instruction logs.
  * This is only relevant when tracing in buffered mode.
@@ -307,9 +316,12 @@ void qemu_log_instr_asid(CPUArchState *env, uint16_t asid);
 
 /*
  * Log exception event.
+ * The epc is the address of the trapping instruction, it is used to tell
+ * whether the trap belongs to the instruction currently being logged.
  */
 void qemu_log_instr_exception(CPUArchState *env, uint32_t code,
-                              target_ulong vector, target_ulong faultaddr);
+                              target_ulong vector, target_ulong faultaddr,
+                              target_ulong epc);
 
 /*
  * Log interrupt event.
@@ -330,6 +342,25 @@ void qemu_log_instr_event(CPUArchState *env, log_event_t *evt);
  */
 bool cpu_log_instr_event_regdump(CPUArchState *env, log_event_t *evt);
 
+/*
+ * Targets that define TARGET_LOG_INSTR_LAZY_REGS implement this to log the
+ * current value of the general purpose registers set in @regs.
+ */
+void cpu_log_instr_lazy_regs(CPUArchState *env, uint64_t regs);
+
+/*
+ * Lazy register capture. The translator records the set of general purpose
+ * registers written by each instruction, instead of logging every write,
+ * and their values are read back from the CPU state when the instruction
+ * is committed.
+ */
+bool qemu_log_instr_lazy_regs_enabled(void);
+
+/*
+ * Set the registers written by the instruction being logged.
+ */
+void qemu_log_instr_lazy_regs(CPUArchState *env, uint64_t regs);
+
 /*
  * Interface to fill register dump log_event_t entries.
  * This mirrors the qemu_log_instr_reg/cap/cap_int functions.
@@ -361,6 +392,7 @@ void qemu_log_instr_counter(CPUState *cpu, QEMUDebugCounter name, long value);
 #define qemu_log_instr_start(env, mode, pc)
 #define qemu_log_instr_stop(env, mode, pc)
 #define qemu_log_instr_mode_switch(...)
+#define qemu_log_instr_asid_change(env)
 #define qemu_log_instr_flush(env)
 #define qemu_log_instr_reg(...)
 #define qemu_log_instr_cap(...)
@@ -375,6 +407,8 @@ void qemu_log_instr_counter(CPUState *cpu, QEMUDebugCounter name, long value);
 #define qemu_log_instr_extra(...)
 #define qemu_log_instr_event(...)
 #define qemu_log_instr_commit(...)
+#define qemu_log_instr_lazy_regs_enabled() false
+#define qemu_log_instr_lazy_regs(...)
 #define qemu_log_gen_printf(...)
 #define qemu_log_gen_printf_flush(base, flush_early, force_flush)
 #define qemu_log_printf_create_globals(...)
@@ -0,0 +1,104 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Chunked instruction trace container format.
+ *
+ * This header only depends on <stdint.h> so that external trace readers
+ * can share the on-disk layout with QEMU.
+ *
+ * The container wraps the records produced by a trace backend into chunks
+ * that are compressed independently with zlib. All fields are little-endian.
+ *
+ *   lic_file_header_t
+ *   { lic_chunk_header_t, compressed records } ...
+ *   lic_index_entry_t[nchunks]
+ *   lic_footer_t
+ *
+ * Each chunk only holds entries from a single CPU and guest context, so the
+ * index can be used to select and decode chunks in parallel without scanning
+ * the rest of the file.
+ *
+ * Every time the trace buffers are synchronized, an index of all the chunks
+ * so far and a footer are appended. The chunks written afterwards follow
+ * that footer instead of overwriting it, so the file may contain stale
+ * indexes between chunks. A complete trace ends with the latest footer. If
+ * QEMU exits abnormally, the file may end with partial data instead: readers
+ * then search backwards for the last footer whose index ends right before
+ * it, and lose the chunks written after the last sync.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define LIC_FILE_MAGIC   "QEMUTRCC"
+#define LIC_CHUNK_MAGIC  0x4b4e4843U /* "CHNK" */
+#define LIC_FOOTER_MAGIC 0x58444954U /* "TIDX" */
+#define LIC_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    /* qemu_log_instr_backend_t that produced the records */
+    uint32_t backend;
+    /* Maximum number of entries in a chunk */
+    uint32_t chunk_entries;
+    uint32_t reserved;
+} __attribute__((packed)) lic_file_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cpu;
+    /* Guest context of all the entries in the chunk */
+    uint64_t ctx_pid;
+    uint64_t ctx_cid;
+    /* Per-CPU sequence number of the first and last entry, inclusive */
+    uint64_t icount_first;
+    uint64_t icount_last;
+    /*
+     * Range of the pc of the entries with instruction data, pc_min is
+     * greater than pc_max if there are none.
+     */
+    uint64_t pc_min;
+    uint64_t pc_max;
+    uint32_t nentries;
+    /* Size of the records before and after compression */
+    uint32_t raw_size;
+    uint32_t compressed_size;
+    uint32_t reserved;
+} __attribute__((packed)) lic_chunk_header_t;
+
+typedef struct {
+    /* File offset of the chunk header */
+    uint64_t offset;
+    lic_chunk_header_t header;
+} __attribute__((packed)) lic_index_entry_t;
+
+typedef struct {
+    uint64_t index_offset;
+    uint32_t nchunks;
+    uint32_t magic;
+} __attribute__((packed)) lic_footer_t;
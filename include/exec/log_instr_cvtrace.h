@@ -0,0 +1,191 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * CHERI binary trace formats.
+ *
+ * This header only depends on <stdint.h> so that external trace readers
+ * can share the on-disk layout with QEMU.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * CHERI binary trace format, originally used for MIPS only.
+ * The format is limited to one entry per instruction, each
+ * entry can hold at most one register modification and one
+ * memory address.
+ * Note that the CHERI format is the legacy MIPS format and
+ * assumes big-endian byte order.
+ */
+typedef struct {
+    uint8_t entry_type;
+#define CTE_NO_REG 0   /* No register is changed. */
+#define CTE_GPR    1   /* GPR change (val2) */
+#define CTE_LD_GPR 2   /* Load into GPR (val2) from address (val1) */
+#define CTE_ST_GPR 3   /* Store from GPR (val2) to address (val1) */
+#define CTE_CAP    11  /* Cap change (val2,val3,val4,val5) */
+#define CTE_LD_CAP 12  /* Load Cap (val2,val3,val4,val5) from addr (val1) */
+#define CTE_ST_CAP 13  /* Store Cap (val2,val3,val4,val5) to addr (val1) */
+    uint8_t exception; /* 0=none, 1=TLB Mod, 2=TLB Load, 3=TLB Store, etc. */
+#define CTE_EXCEPTION_NONE 31
+    uint16_t cycles; /* Currently not used. */
+    uint32_t inst;   /* Encoded instruction. */
+    uint64_t pc;     /* PC value of instruction. */
+    uint64_t val1;   /* val1 is used for memory address. */
+    uint64_t val2;   /* val2, val3, val4, val5 are used for reg content. */
+    uint64_t val3;
+    uint64_t val4;
+    uint64_t val5;
+    uint8_t thread; /* Hardware thread/CPU (i.e. cpu->cpu_index ) */
+    uint8_t asid;   /* Address Space ID */
+} __attribute__((packed)) cheri_trace_entry_t;
+
+/*
+ * Version 3 Cheri Stream Trace header info.
+ * The header is a cheri_trace_entry_t sized record holding the version byte
+ * followed by the magic string.
+ */
+#define CTE_QEMU_VERSION (0x80U + 3)
+#define CTE_QEMU_MAGIC   "CheriTraceV03"
+
+/*
+ * Compressed cvtrace variant (cvtrace2).
+ *
+ * The file is a gzip stream, possibly made of multiple members, holding a
+ * cvt2_file_header_t followed by variable-length records. Each record
+ * expands to exactly one classic cheri_trace_entry_t, fields that are not
+ * used by the entry type expand to zero.
+ *
+ * A record starts with a flags byte. The low bits hold the entry type as a
+ * CVT2_TYPE_* code, the other bits tell which of the following fields are
+ * present, in this order:
+ *
+ *   CVT2_F_CTX    thread and asid bytes
+ *   CVT2_F_PC     zigzag varint, pc - (previous pc + 4)
+ *   CVT2_F_INSN   instruction, 4 bytes little-endian
+ *   CVT2_F_EXC    exception byte, CTE_EXCEPTION_NONE otherwise
+ *   CVT2_F_CYCLES zigzag varint, cycles - (previous cycles + 1)
+ *
+ * For CVT2_TYPE_RAW, the classic entry_type byte follows. Then come the
+ * values used by the entry type:
+ *
+ *   val1 for the load and store types, the memory address
+ *   val2 for all types but CVT2_TYPE_NO_REG
+ *   val3, val4 and val5 for the capability types
+ *   val1 to val5 for CVT2_TYPE_RAW
+ *
+ * Each value is a varint v relative to the previous value p of the same
+ * field on the same thread: v = 0 encodes zero and leaves p unchanged,
+ * otherwise the value is p + unzigzag(v - 1), so v may need 65 bits
+ * (ten varint bytes) for a delta of -2^63. Writers use CVT2_TYPE_RAW
+ * for entries that have non-zero values outside of the fields used by
+ * their type.
+ *
+ * Varints are unsigned LEB128, deltas are computed modulo 2^64 (2^16 for
+ * cycles) and zigzag encoded as (d << 1) ^ (d >> 63).
+ *
+ * Records without CVT2_F_CTX belong to the thread of the previous record,
+ * with the same asid. All delta state is kept per thread and starts at zero,
+ * except for cycles that starts at 0xffff.
+ *
+ * When CVT2_F_INSN is missing, the instruction is the one last seen at the
+ * same pc, looked up in a per-thread direct-mapped cache of
+ * CVT2_INSN_CACHE_SIZE entries indexed by (pc >> 1). Both writer and reader
+ * update the cache with every instruction present in a record.
+ */
+#define CVT2_MAGIC   "QEMUCVT2"
+#define CVT2_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} __attribute__((packed)) cvt2_file_header_t;
+
+#define CVT2_TYPE_MASK  0x07
+#define CVT2_F_CTX      0x08
+#define CVT2_F_PC       0x10
+#define CVT2_F_INSN     0x20
+#define CVT2_F_EXC      0x40
+#define CVT2_F_CYCLES   0x80
+
+/* Entry type codes, in the CVT2_TYPE_MASK bits of the flags */
+#define CVT2_TYPE_NO_REG 0
+#define CVT2_TYPE_GPR    1
+#define CVT2_TYPE_LD_GPR 2
+#define CVT2_TYPE_ST_GPR 3
+#define CVT2_TYPE_CAP    4
+#define CVT2_TYPE_LD_CAP 5
+#define CVT2_TYPE_ST_CAP 6
+#define CVT2_TYPE_RAW    7
+
+#define CVT2_INSN_CACHE_SIZE 4096
+
+/* Longest encoded record: flags, ctx, type, 7 varints, insn and exception */
+#define CVT2_MAX_RECORD_SIZE (1 + 2 + 1 + 7 * 10 + 4 + 1)
+
+/* Type code of a classic entry type, CVT2_TYPE_RAW if it has none */
+static inline int cvt2_type_code(uint8_t entry_type)
+{
+    if (entry_type <= CTE_ST_GPR) {
+        return entry_type;
+    } else if (entry_type >= CTE_CAP && entry_type <= CTE_ST_CAP) {
+        return entry_type - CTE_CAP + CVT2_TYPE_CAP;
+    }
+    return CVT2_TYPE_RAW;
+}
+
+static inline uint8_t cvt2_entry_type(int code)
+{
+    return code >= CVT2_TYPE_CAP ? code - CVT2_TYPE_CAP + CTE_CAP : code;
+}
+
+/* Whether val1 to val5 are encoded for the given type code */
+static inline int cvt2_type_has_val(int code, int val)
+{
+    switch (val) {
+    case 1:
+        return code == CVT2_TYPE_LD_GPR || code == CVT2_TYPE_ST_GPR ||
+               code == CVT2_TYPE_LD_CAP || code == CVT2_TYPE_ST_CAP ||
+               code == CVT2_TYPE_RAW;
+    case 2:
+        return code != CVT2_TYPE_NO_REG;
+    default:
+        return code >= CVT2_TYPE_CAP;
+    }
+}
+
+static inline uint64_t cvt2_zigzag(uint64_t delta)
+{
+    return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+}
+
+static inline uint64_t cvt2_unzigzag(uint64_t value)
+{
+    return (value >> 1) ^ -(value & 1);
+}
@@ -0,0 +1,147 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Fast instruction logging.
+ *
+ * With -cheri-trace-fast, translated code appends fixed-size records to a
+ * per-CPU buffer with inline stores instead of calling a logging helper for
+ * every instruction, register write and memory access. The buffer is
+ * decoded into the usual cpu_log_entry_t, through the qemu_log_instr_*
+ * interface, when it fills up or before any logging operation that needs the
+ * current entry to be complete (exceptions, events, mode switches, log level
+ * changes and syncs).
+ *
+ * Each instruction reserves one record for its header and one for every
+ * register write or memory access that the translator emits for it. The
+ * buffer is zeroed before reuse, so records skipped by a branch in the
+ * generated code decode as empty slots. The physical address of the
+ * instruction is looked up at translation time, which is valid for every
+ * execution of the TB. The ASID is looked up when the buffer is decoded, so
+ * targets call qemu_log_instr_asid_change() before changing it.
+ *
+ * When the buffer is decoded in the middle of an instruction, e.g. by a
+ * helper that logs an event, the reserved records of that instruction that
+ * have not been written yet are decoded by the next sync instead.
+ *
+ * Logging performed by C helpers is appended after the reserved records of
+ * the current instruction. Capability values are stored in the records that
+ * follow the LIF_CAP and LIF_*_CAP records.
+ */
+
+#pragma once
+
+#include "tcg/tcg.h"
+
+typedef enum {
+    LIF_EMPTY = 0,
+    LIF_INSN,
+    LIF_REG,
+    LIF_CAP_INT,
+    LIF_CAP,
+    LIF_LOAD,
+    LIF_STORE,
+    LIF_LOAD_CAP,
+    LIF_STORE_CAP,
+} log_instr_fast_type_t;
+
+typedef struct log_instr_fast_rec {
+    /* Instruction pc, memory address or register name pointer */
+    uint64_t addr;
+    /* Instruction physical address, register or memory value */
+    uint64_t value;
+    /* Opcode or TCGMemOpIdx of memory accesses */
+    uint32_t info;
+    /* log_instr_fast_type_t */
+    uint16_t type;
+    /* LIF_INSN_SIZE() or number of trailing payload records */
+    uint16_t size;
+} log_instr_fast_rec_t;
+
+/*
+ * The size of an instruction header holds the instruction size in bytes and
+ * the number of records reserved by the instruction, including the header.
+ */
+#define LIF_INSN_SIZE(bytes, nrecs) ((uint16_t)((bytes) | ((nrecs) << 8)))
+#define LIF_INSN_BYTES(size) ((size) & 0xff)
+#define LIF_INSN_RECS(size) ((size) >> 8)
+#define LIF_INSN_MAX_RECS 0xff
+
+/*
+ * The type and size fields are written by a single 32-bit store from
+ * translated code.
+ */
+#ifdef HOST_WORDS_BIGENDIAN
+#define LIF_HEADER(type, size) (((uint32_t)(type) << 16) | (uint16_t)(size))
+#else
+#define LIF_HEADER(type, size) ((uint16_t)(type) | ((uint32_t)(size) << 16))
+#endif
+
+#ifdef CONFIG_TCG_LOG_INSTR
+/*
+ * Whether -cheri-trace-fast was given.
+ */
+bool qemu_log_instr_fast_enabled(void);
+
+/*
+ * Called by the translator loop at the start of a logged TB.
+ * Checks that the buffer has room for all the records reserved by the TB
+ * and decodes the buffer otherwise.
+ */
+void gen_log_instr_fast_tb_start(CPUState *cpu);
+
+/*
+ * Called by the translator loop at the end of a logged TB, after tb_stop.
+ */
+void gen_log_instr_fast_tb_end(void);
+
+/*
+ * Emit the header record of a new instruction. The opcode bytes are in
+ * host byte-order, as for qemu_log_instr().
+ */
+void gen_log_instr_fast_insn(target_ulong pc, uint32_t opcode, int size);
+
+/*
+ * Emit a register write record for the current instruction.
+ * Returns false if no instruction is open and the caller must use the
+ * logging helpers instead.
+ */
+bool gen_log_instr_fast_reg(const char *reg_name, TCGv value);
+
+/*
+ * Emit a memory access record for the current instruction.
+ * Returns false if no instruction is open and the caller must use the
+ * logging helpers instead.
+ */
+bool gen_log_instr_fast_mem(TCGv_cap_checked_ptr addr, TCGv_i64 value,
+                            TCGMemOpIdx oi, bool store);
+bool gen_log_instr_fast_mem_i32(TCGv_cap_checked_ptr addr, TCGv_i32 value,
+                                TCGMemOpIdx oi, bool store);
+#else /* ! CONFIG_TCG_LOG_INSTR */
+#define qemu_log_instr_fast_enabled() false
+#define gen_log_instr_fast_reg(reg_name, value) false
+#define gen_log_instr_fast_mem(addr, value, oi, store) false
+#define gen_log_instr_fast_mem_i32(addr, value, oi, store) false
+#endif /* ! CONFIG_TCG_LOG_INSTR */
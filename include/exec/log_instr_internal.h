@@ -108,6 +108,9 @@ typedef struct cpu_log_entry {
     GArray *events;
     /* Extra text-only log */
     GString *txt_buffer;
+    /* Guest context the entry was committed in, set on commit */
+    uint64_t ctx_pid;
+    uint64_t ctx_cid;
 } cpu_log_entry_t;
 
 /*
@@ -155,20 +158,119 @@ struct trace_backend_hooks {
     void (*sync)(CPUArchState *env);
     void (*emit_debug)(CPUArchState *env, QEMUDebugCounter name, long value);
     void (*emit_instr)(CPUArchState *env, cpu_log_entry_t *entry);
+    /*
+     * Reopen the outputs of all CPUs in a child process created by fork(),
+     * after the log file. Backends that have an init hook but no after_fork
+     * hook can not be used across fork().
+     */
+    void (*after_fork)(void);
 };
 typedef struct trace_backend_hooks trace_backend_hooks_t;
 
+/* Name of the output @path in a forked child, the caller must free it */
+char *qemu_log_instr_fork_path(const char *path);
+
 /*
  * Instruction entry filter function.
  * Return false if the entry should be dropped, true otherwise.
  */
 typedef bool (*cpu_log_instr_filter_fn_t)(struct cpu_log_entry *entry);
 
+/*
+ * Per guest context output streams.
+ * When the output is split, each stream is a separate file with its own
+ * buffered writer thread.
+ */
+typedef struct qemu_log_instr_stream qemu_log_instr_stream_t;
+typedef void (*qemu_log_instr_stream_init_fn_t)(qemu_log_instr_stream_t *);
+
+bool qemu_log_instr_split_enabled(void);
+/*
+ * Fetch the stream for the context of @entry, creating it on first use.
+ * @init is called on new streams, e.g. to write a file header.
+ * Returns NULL if the output is not split.
+ */
+qemu_log_instr_stream_t *
+qemu_log_instr_get_stream(CPUArchState *env, cpu_log_entry_t *entry,
+                          const char *suffix,
+                          qemu_log_instr_stream_init_fn_t init);
+void qemu_log_instr_stream_write(qemu_log_instr_stream_t *stream,
+                                 const void *data, size_t len);
+/* Wait for all the streams to be written out */
+void qemu_log_instr_sync_streams(void);
+void qemu_log_instr_split_after_fork(void);
+
+/*
+ * Chunked trace container output.
+ * Backends call qemu_log_instr_chunk_begin() once for each trace entry and
+ * then append the records encoding it.
+ */
+bool qemu_log_instr_chunked_enabled(void);
+void qemu_log_instr_chunk_begin(CPUArchState *env, cpu_log_entry_t *entry);
+void qemu_log_instr_chunk_append(CPUArchState *env, const void *data,
+                                 size_t len);
+/* Write out the partial chunk of this CPU and update the index */
+void qemu_log_instr_chunk_sync(CPUArchState *env);
+void qemu_log_instr_chunk_after_fork(void);
+
+/*
+ * Fast logging record buffer, see exec/log_instr_fast.h.
+ * While fast logging is enabled, the per-entry logging functions append
+ * records with qemu_log_instr_fast_append(), which returns false when the
+ * records are being decoded and the entry must be updated directly. The
+ * other logging functions call qemu_log_instr_fast_sync() first.
+ */
+void qemu_log_instr_fast_init(CPUState *cpu);
+/* qemu_log_instr() with a physical address looked up by the caller */
+void qemu_log_instr_paddr(CPUArchState *env, target_ulong pc, hwaddr paddr,
+                          const char *insn, uint32_t size);
+void qemu_log_instr_fast_sync(CPUArchState *env);
+/* Sync and empty the buffer, only valid between TBs */
+void qemu_log_instr_fast_rewind(CPUArchState *env);
+bool qemu_log_instr_fast_append(CPUArchState *env, int type,
+                                uint64_t addr, uint64_t value, uint32_t info,
+                                const void *payload, size_t len);
+
+/*
+ * Per-CPU instruction dictionary, see -cheri-trace-insn-dict.
+ * Backends emit a definition record for new entries and refer to known
+ * ones by id. Ids are unique within the dictionary of each CPU.
+ */
+typedef struct log_instr_dict_entry {
+    uint32_t id;
+    uint32_t hash;
+    hwaddr paddr;
+    target_ulong pc;
+    int insn_size;
+    char insn_bytes[TARGET_MAX_INSN_SIZE];
+    /* Disassembly, computed once when the entry is created */
+    char *disas;
+} log_instr_dict_entry_t;
+
+bool qemu_log_instr_insn_dict_enabled(void);
+/*
+ * Find the dictionary entry for the instruction of @entry, creating it if
+ * needed. @is_new is set when the caller must emit a definition record.
+ */
+log_instr_dict_entry_t *qemu_log_instr_dict_lookup(CPUArchState *env,
+                                                   cpu_log_entry_t *entry,
+                                                   bool *is_new);
+
 /* Text backend */
+void init_text_backend(CPUArchState *env);
+void sync_text_backend(CPUArchState *env);
 void emit_text_instr(CPUArchState *env, cpu_log_entry_t *entry);
+void reopen_text_backend(void);
+bool qemu_log_instr_text_per_cpu_enabled(void);
 /* CVTrace backend */
 void emit_cvtrace_header(CPUArchState *env);
 void emit_cvtrace_entry(CPUArchState *env, cpu_log_entry_t *entry);
+void reopen_cvtrace_backend(void);
+/* Compressed CVTrace backend */
+void init_cvtrace2_backend(CPUArchState *env);
+void sync_cvtrace2_backend(CPUArchState *env);
+void emit_cvtrace2_entry(CPUArchState *env, cpu_log_entry_t *entry);
+void reopen_cvtrace2_backend(void);
 #ifdef CONFIG_TRACE_PERFETTO
 /* Perfetto backend */
 void init_perfetto_backend(CPUArchState *env);
@@ -180,15 +282,18 @@ void emit_perfetto_entry(CPUArchState *env, cpu_log_entry_t *entry);
 void init_protobuf_backend(CPUArchState *env);
 void sync_protobuf_backend(CPUArchState *env);
 void emit_protobuf_entry(CPUArchState *env, cpu_log_entry_t *entry);
+void reopen_protobuf_backend(void);
 #endif
 #ifdef CONFIG_TRACE_JSON
 void init_json_backend(CPUArchState *env);
 void sync_json_backend(CPUArchState *env);
 void emit_json_entry(CPUArchState *env, cpu_log_entry_t *entry);
+void reopen_json_backend(void);
 #endif
 #ifdef CONFIG_TRACE_DRCACHESIM
 void init_drcachesim_backend(CPUArchState *env);
 void emit_drcachesim_entry(CPUArchState *env, cpu_log_entry_t *entry);
+void reopen_drcachesim_backend(void);
 #endif
 
 #ifdef CONFIG_DEBUG_TCG
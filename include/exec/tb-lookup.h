@@ -16,37 +16,85 @@
 #include "exec/exec-all.h"
 #include "exec/tb-hash.h"
 
-/* Might cause an exception, so have a longjmp destination ready */
+static inline bool
+tb_lookup_matches(CPUState *cpu, const TranslationBlock *tb, target_ulong pc,
+                  target_ulong cs_base, target_ulong cs_top,
+                  uint32_t cheri_flags, uint32_t flags, uint32_t cf_mask)
+{
+    return tb->pc == pc && tb->cs_base == cs_base && tb->cs_top == cs_top &&
+           tb->cheri_flags == cheri_flags && tb->flags == flags &&
+           tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+           (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask;
+}
+
+static inline uint32_t tb_lookup_cf_mask(CPUState *cpu, uint32_t cf_mask)
+{
+    cf_mask &= ~CF_CLUSTER_MASK;
+    return cf_mask | cpu->cluster_index << CF_CLUSTER_SHIFT;
+}
+
+/* Insert @tb into the jump cache set of @pc, replacing the LRU way */
+static inline void tb_jmp_cache_insert(CPUState *cpu, target_ulong pc,
+                                       TranslationBlock *tb)
+{
+    TBJmpCache *jc = &cpu->tb_jmp_cache;
+    unsigned int set = tb_jmp_cache_hash_func(jc, pc);
+    unsigned int way = jc->lru ? jc->lru[set] : 0;
+    unsigned int idx = (set << jc->way_bits) + way;
+
+    if (qatomic_read(&jc->entries[idx])) {
+        jc->conflicts++;
+    }
+    qatomic_set(&jc->entries[idx], tb);
+    if (jc->lru) {
+        jc->lru[set] = way ^ 1;
+    }
+}
+
+/* Look up a TB for an already computed CPU state; @cf_mask must be final */
 static inline TranslationBlock *
-tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
-                     target_ulong *cs_top, uint32_t *cheri_flags,
-                     uint32_t *flags, uint32_t cf_mask)
+tb_lookup__state(CPUState *cpu, target_ulong pc, target_ulong cs_base,
+                 target_ulong cs_top, uint32_t cheri_flags, uint32_t flags,
+                 uint32_t cf_mask)
 {
-    CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+    TBJmpCache *jc = &cpu->tb_jmp_cache;
+    unsigned int set = tb_jmp_cache_hash_func(jc, pc);
+    TranslationBlock **entries = &jc->entries[set << jc->way_bits];
     TranslationBlock *tb;
-    uint32_t hash;
-
-    cpu_get_tb_cpu_state_6(env, pc, cs_base, cs_top, cheri_flags, flags);
-    hash = tb_jmp_cache_hash_func(*pc);
-    tb = qatomic_rcu_read(&cpu->tb_jmp_cache[hash]);
+    unsigned int way;
 
-    cf_mask &= ~CF_CLUSTER_MASK;
-    cf_mask |= cpu->cluster_index << CF_CLUSTER_SHIFT;
-
-    if (likely(tb && tb->pc == *pc && tb->cs_base == *cs_base &&
-               tb->cs_top == *cs_top && tb->cheri_flags == *cheri_flags &&
-               tb->flags == *flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
-        return tb;
+    for (way = 0; way < 1u << jc->way_bits; way++) {
+        tb = qatomic_rcu_read(&entries[way]);
+        if (likely(tb && tb_lookup_matches(cpu, tb, pc, cs_base, cs_top,
+                                           cheri_flags, flags, cf_mask))) {
+            if (jc->lru) {
+                jc->lru[set] = way ^ 1;
+            }
+            jc->hits++;
+            return tb;
+        }
     }
-    tb = tb_htable_lookup(cpu, *pc, *cs_base, *cs_top, *cheri_flags, *flags,
+    jc->misses++;
+    tb = tb_htable_lookup(cpu, pc, cs_base, cs_top, cheri_flags, flags,
                           cf_mask);
     if (tb == NULL) {
         return NULL;
     }
-    qatomic_set(&cpu->tb_jmp_cache[hash], tb);
+    tb_jmp_cache_insert(cpu, pc, tb);
     return tb;
 }
 
+/* Might cause an exception, so have a longjmp destination ready */
+static inline TranslationBlock *
+tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
+                     target_ulong *cs_top, uint32_t *cheri_flags,
+                     uint32_t *flags, uint32_t cf_mask)
+{
+    CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+
+    cpu_get_tb_cpu_state_6(env, pc, cs_base, cs_top, cheri_flags, flags);
+    return tb_lookup__state(cpu, *pc, *cs_base, *cs_top, *cheri_flags, *flags,
+                            tb_lookup_cf_mask(cpu, cf_mask));
+}
+
 #endif /* EXEC_TB_LOOKUP_H */
@@ -285,8 +285,53 @@ struct kvm_run;
 
 struct hax_vcpu_state;
 
+/* Default and limits of the "tb-jmp-cache-bits" accelerator property */
 #define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+#define TB_JMP_CACHE_BITS_MIN 6
+#define TB_JMP_CACHE_BITS_MAX 20
+
+/*
+ * Per-vCPU cache of recently executed TBs indexed by guest virtual pc.
+ * There are (1 << set_bits) sets of (1 << way_bits) consecutive entries.
+ * For 2-way caches @lru holds, per set, the way to replace next.
+ */
+typedef struct TBJmpCache {
+    struct TranslationBlock **entries;
+    uint8_t *lru;
+    unsigned int set_bits;
+    unsigned int way_bits;
+    /* Statistics for "info jit", only updated by the vCPU thread */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t conflicts;
+} TBJmpCache;
+
+#define TB_IC_BITS 8
+#define TB_IC_SIZE (1 << TB_IC_BITS)
+#define TB_RAS_SIZE 16
+
+/*
+ * Inline cache for the indirect exit of one TB (the call site): the TB
+ * it last jumped to and, if it is a call, the TB its callee returned to.
+ */
+typedef struct TBInlineCacheEntry {
+    const struct TranslationBlock *site;
+    struct TranslationBlock *target;
+    struct TranslationBlock *ret_target;
+} TBInlineCacheEntry;
+
+/* Shadow return-address stack entry, pushed by calls */
+typedef struct TBReturnStackEntry {
+    vaddr ret_pc;
+    const struct TranslationBlock *site;
+} TBReturnStackEntry;
+
+typedef struct TBIndirectStats {
+    uint64_t ic_hits;
+    uint64_t ic_misses;
+    uint64_t ras_hits;
+    uint64_t ras_misses;
+} TBIndirectStats;
 
 /* work queue */
 
@@ -413,8 +458,17 @@ struct CPUState {
     void *env_ptr; /* CPUArchState */
     IcountDecr *icount_decr_ptr;
 
-    /* Accessed in parallel; all accesses must be atomic */
-    struct TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
+    /* Entries are accessed in parallel; all accesses must be atomic */
+    TBJmpCache tb_jmp_cache;
+
+    /*
+     * Indirect branch prediction for helper_lookup_tb_ptr_ic(). Only
+     * accessed by the vCPU thread or with all vCPUs stopped.
+     */
+    TBInlineCacheEntry tb_ic[TB_IC_SIZE];
+    TBReturnStackEntry tb_ras[TB_RAS_SIZE];
+    unsigned int tb_ras_top;
+    TBIndirectStats tb_ind_stats;
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -492,11 +546,16 @@ extern __thread CPUState *current_cpu;
 
 static inline void cpu_tb_jmp_cache_clear(CPUState *cpu)
 {
+    TBJmpCache *jc = &cpu->tb_jmp_cache;
     unsigned int i;
 
-    for (i = 0; i < TB_JMP_CACHE_SIZE; i++) {
-        qatomic_set(&cpu->tb_jmp_cache[i], NULL);
+    if (jc->entries) {
+        for (i = 0; i < 1u << (jc->set_bits + jc->way_bits); i++) {
+            qatomic_set(&jc->entries[i], NULL);
+        }
     }
+    memset(cpu->tb_ic, 0, sizeof(cpu->tb_ic));
+    memset(cpu->tb_ras, 0, sizeof(cpu->tb_ras));
 }
 
 /**
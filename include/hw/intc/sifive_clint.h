@@ -27,6 +27,8 @@
 #define SIFIVE_CLINT(obj) \
     OBJECT_CHECK(SiFiveCLINTState, (obj), TYPE_SIFIVE_CLINT)
 
+typedef struct SiFiveCLINTHart SiFiveCLINTHart;
+
 typedef struct SiFiveCLINTState {
     /*< private >*/
     SysBusDevice parent_obj;
@@ -40,6 +42,7 @@ typedef struct SiFiveCLINTState {
     uint32_t time_base;
     uint32_t aperture_size;
     uint32_t timebase_freq;
+    SiFiveCLINTHart *harts;
 } SiFiveCLINTState;
 
 DeviceState *sifive_clint_create(hwaddr addr, hwaddr size,
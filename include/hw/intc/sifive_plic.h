@@ -23,6 +23,7 @@
 
 #include "hw/sysbus.h"
 #include "qom/object.h"
+#include "qemu/thread.h"
 
 #define TYPE_SIFIVE_PLIC "riscv.sifive.plic"
 
@@ -49,6 +50,7 @@ struct SiFivePLICState {
 
     /*< public >*/
     MemoryRegion mmio;
+    QemuMutex lock;
     uint32_t num_addrs;
     uint32_t num_harts;
     uint32_t bitfield_words;
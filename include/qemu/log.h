@@ -154,6 +154,7 @@ void qemu_set_log(int log_flags);
 void qemu_set_log_internal(int log_flags);
 void qemu_log_needs_buffers(void);
 void qemu_set_log_filename(const char *filename, Error **errp);
+void qemu_log_reopen_after_fork(Error **errp);
 void qemu_set_dfilter_ranges(const char *ranges, Error **errp);
 bool qemu_log_in_addr_range(uint64_t addr);
 int qemu_str_to_log_mask(const char *str);
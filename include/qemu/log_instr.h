@@ -69,6 +69,7 @@ typedef enum {
 #ifdef CONFIG_TRACE_DRCACHESIM
     QEMU_LOG_INSTR_BACKEND_DRCACHESIM = 6,
 #endif
+    QEMU_LOG_INSTR_BACKEND_CVTRACE2 = 7,
 } qemu_log_instr_backend_t;
 
 extern qemu_log_instr_backend_t qemu_log_instr_backend;
@@ -219,10 +220,30 @@ typedef enum {
 } QEMUDebugCounter;
 
 #ifdef CONFIG_TRACE_PERFETTO
+/*
+ * Perfetto tracing session configuration.
+ * Zero values keep the backend defaults.
+ */
+typedef struct {
+    /* Trace buffer size, per vCPU if per_cpu_buffers is set */
+    uint64_t buffer_size_kb;
+    /* Producer shared memory buffer size */
+    uint64_t shm_size_kb;
+    uint32_t flush_period_ms;
+    uint32_t file_write_period_ms;
+    /* Number of vCPUs the buffer is scaled by if per_cpu_buffers is set */
+    unsigned int ncpus;
+    bool per_cpu_buffers;
+    /* Drop new data when the buffer is full instead of overwriting */
+    bool fill_discard;
+} qemu_log_instr_perfetto_session_conf_t;
+
 /* Perfetto backend configuration hooks */
 #ifdef __cplusplus
 extern "C" {
 #endif
+void qemu_log_instr_perfetto_conf_session(
+    const qemu_log_instr_perfetto_session_conf_t *conf);
 void qemu_log_instr_perfetto_conf_logfile(const char *name);
 int qemu_log_instr_perfetto_conf_categories(const char *category_list);
 void qemu_log_instr_perfetto_enable_interceptor(void);
@@ -285,6 +306,8 @@ typedef struct qemu_log_instr_stats {
     uint64_t entries_emitted;
     uint64_t trace_start;
     uint64_t trace_stop;
+    /* Fast logging records that did not fit in the buffer */
+    uint64_t fast_dropped;
 } qemu_log_instr_stats_t;
 
 #define QEMU_LOG_INSTR_INC_STAT(cpu_state, stat)                               \
@@ -321,6 +344,30 @@ typedef struct {
     void *backend_data;
     /* Statistics for debugging */
     qemu_log_instr_stats_t stats;
+    /* Guest context currently running, from the last context switch event */
+    uint64_t ctx_pid;
+    uint64_t ctx_cid;
+    /* Registers written by the current instruction, read back on commit */
+    uint64_t lazy_regs;
+    /* Instruction dictionary, see exec/log_instr_internal.h */
+    struct log_instr_dict *insn_dict;
+    /* Last per-context output stream used by this CPU */
+    struct qemu_log_instr_stream *split_stream;
+    /* Chunk being filled for the chunked trace container */
+    struct qemu_log_instr_chunk *chunk;
+    /* Record buffer for fast logging, see exec/log_instr_fast.h */
+    struct log_instr_fast_rec *fast_buf;
+    /* Next free record, advanced by translated code */
+    struct log_instr_fast_rec *fast_ptr;
+    /* A TB only starts if the records it reserves end below this */
+    struct log_instr_fast_rec *fast_limit;
+    struct log_instr_fast_rec *fast_end;
+    /* First record that has not been decoded yet */
+    struct log_instr_fast_rec *fast_drained;
+    /* Reserved records of the open instruction that were still empty */
+    struct log_instr_fast_rec *fast_pending;
+    struct log_instr_fast_rec *fast_pending_end;
+    bool fast_draining;
 } cpu_log_instr_state_t;
 
 /*
@@ -334,6 +381,7 @@ typedef struct {
 typedef enum {
     LOG_INSTR_FILTER_MEM_RANGE = 0,
     LOG_FILTER_EVENTS = 1,
+    LOG_INSTR_FILTER_CONTEXT = 2,
     LOG_INSTR_FILTER_MAX
 } cpu_log_instr_filter_t;
 
@@ -347,6 +395,19 @@ void qemu_log_instr_init(CPUState *env);
  */
 void qemu_log_instr_sync_buffers(void);
 
+/*
+ * Check that the trace outputs can be reopened with
+ * qemu_log_instr_after_fork(), before forking.
+ */
+void qemu_log_instr_check_fork(Error **errp);
+
+/*
+ * Reopen the trace outputs in a child process created by fork(), after
+ * qemu_log_reopen_after_fork(). The pid of the child is appended to the
+ * name of the output files, the vCPUs must not have run yet.
+ */
+void qemu_log_instr_after_fork(void);
+
 /*
  * Global instruction logging hook from qemu tracing commands.
  */
@@ -366,6 +427,32 @@ void qemu_log_instr_set_buffer_size(unsigned long buffer_size);
  */
 void qemu_log_instr_set_cli_filters(const char *filter_spec, Error **errp);
 
+/*
+ * Only trace the guest contexts in the allow-list. The spec is a comma
+ * separated list of pid=N and cid=N items. An entry is kept if both its
+ * process and its compartment are allowed; an empty list allows anything.
+ */
+void qemu_log_instr_set_ctx_filter(const char *spec, Error **errp);
+
+/*
+ * Wrap the trace backend output into a seekable container of compressed
+ * chunks. The spec is file=path[,entries=N].
+ */
+void qemu_log_instr_set_chunked_output(const char *spec, Error **errp);
+
+/*
+ * Split the trace output into one file per guest process or compartment.
+ * The spec is by=pid|cid[,dir=path].
+ */
+void qemu_log_instr_set_split_output(const char *spec, Error **errp);
+
+/*
+ * Write the text backend output to one file per CPU instead of the qemu log.
+ * The spec is file=path[,timestamps=on|off], path must contain a single %d
+ * that is replaced by the CPU index.
+ */
+void qemu_log_instr_set_text_per_cpu(const char *spec, Error **errp);
+
 /*
  * Add a trace filter during startup. This will be activated on all the CPUs
  * that are initialized after the call.
@@ -385,6 +472,26 @@ void qemu_log_instr_mem_filter_update(void);
  * Enable debug statistics recording.
  */
 void qemu_log_instr_enable_trace_debug(void);
+
+/*
+ * Log from translated code through a per-CPU record buffer instead of
+ * helper calls. Only supported by targets that define TARGET_LOG_INSTR_FAST.
+ */
+void qemu_log_instr_enable_fast(void);
+
+/*
+ * Log general purpose register values on instruction commit instead of
+ * calling a helper for each register write. Only supported by targets that
+ * define TARGET_LOG_INSTR_LAZY_REGS.
+ */
+void qemu_log_instr_enable_lazy_regs(void);
+
+/*
+ * Emit each distinct instruction once as a dictionary definition and refer
+ * to it by id in the trace entries. Supported by the json backend, the
+ * protobuf backend only uses it to cache the disassembly.
+ */
+void qemu_log_instr_enable_insn_dict(void);
 #endif /* ! __cplusplus */
 
 #else /* ! CONFIG_TCG_LOG_INSTR */
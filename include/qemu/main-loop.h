@@ -44,6 +44,16 @@
  */
 int qemu_init_main_loop(Error **errp);
 
+/**
+ * qemu_main_loop_after_fork: Prepare the main loop of a forked child.
+ *
+ * The main loop AioContexts of a child process created by fork() after
+ * qemu_init_main_loop() share their event notifiers with the parent. This
+ * gives them their own ones, it must be called in the child before the main
+ * loop runs.
+ */
+void qemu_main_loop_after_fork(Error **errp);
+
 /**
  * main_loop_wait: Run one iteration of the main loop.
  *
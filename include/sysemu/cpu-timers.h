@@ -83,6 +83,25 @@ int64_t cpu_get_clock(void);
 
 void qemu_timer_notify_cb(void *opaque, QEMUClockType type);
 
+/*
+ * Idle warp - a cheaper alternative to "-icount sleep=off" that keeps
+ * QEMU_CLOCK_VIRTUAL tied to the host clock while vCPUs run, but jumps
+ * it to the next virtual timer deadline once they are all halted (e.g.
+ * in WFI or WAIT), the main loop has nothing else to do and no I/O is in
+ * flight (see aio_any_in_flight()).
+ */
+
+/* enable idle warp, only valid without icount */
+void cpu_idle_warp_enable(void);
+bool cpu_idle_warp_enabled(void);
+/*
+ * return how far QEMU_CLOCK_VIRTUAL can be warped now, or -1 if it must
+ * advance in real time. Caller must hold BQL.
+ */
+int64_t cpu_idle_warp_deadline(void);
+/* warp QEMU_CLOCK_VIRTUAL if possible. Caller must hold BQL */
+void cpu_idle_warp(void);
+
 /* get the VIRTUAL clock and VM elapsed ticks via the cpus accel interface */
 int64_t cpus_get_virtual_clock(void);
 int64_t cpus_get_elapsed_ticks(void);
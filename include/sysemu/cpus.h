@@ -20,6 +20,9 @@ typedef struct CpusAccel {
 
     int64_t (*get_virtual_clock)(void);
     int64_t (*get_elapsed_ticks)(void);
+
+    /* Drop the vCPU threads that did not survive fork(), may be NULL */
+    void (*forget_vcpu_threads)(void);
 } CpusAccel;
 
 /* register accel-specific cpus interface implementation */
@@ -49,6 +52,11 @@ void cpu_handle_guest_debug(CPUState *cpu);
 bool qemu_in_vcpu_thread(void);
 void qemu_init_cpu_loop(void);
 void resume_all_vcpus(void);
+/*
+ * Start new vCPU threads in a child process created by fork(), which only
+ * inherits the calling thread. The vCPUs must not have run yet.
+ */
+void qemu_recreate_vcpus_after_fork(Error **errp);
 void pause_all_vcpus(void);
 void cpu_stop_current(void);
 
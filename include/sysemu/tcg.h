@@ -9,6 +9,7 @@
 #define SYSEMU_TCG_H
 
 void tcg_exec_init(unsigned long tb_size, int splitwx);
+void tcg_jmp_cache_configure(unsigned int bits, unsigned int ways);
 
 #ifdef CONFIG_TCG
 extern bool tcg_allowed;
@@ -844,6 +844,26 @@ void tcg_gen_goto_tb(unsigned idx);
  */
 void tcg_gen_lookup_and_goto_ptr(void);
 
+/**
+ * tcg_gen_lookup_and_goto_ptr_ic() - indirect jump through an inline cache
+ * @tb: TB being translated (the call site)
+ * @dest: new guest pc, only used without TB_IND_FULL_STATE (may be NULL then)
+ * @kind: TB_IND_* flags describing the jump
+ *
+ * Like tcg_gen_lookup_and_goto_ptr(), but first tries the target that the
+ * exit of @tb jumped to last time. Calls push the address following @tb on
+ * a shadow return stack which is used to predict the target of returns.
+ */
+void tcg_gen_lookup_and_goto_ptr_ic(const TranslationBlock *tb, TCGv dest,
+                                    unsigned kind);
+
+/**
+ * tcg_gen_push_return_addr() - record a direct call on the shadow stack
+ * @tb: TB being translated (the call site)
+ * @ret_pc: guest address the callee will return to
+ */
+void tcg_gen_push_return_addr(const TranslationBlock *tb, target_ulong ret_pc);
+
 static inline void tcg_gen_plugin_cb_start(unsigned from, unsigned type,
                                            unsigned wr)
 {
@@ -1344,6 +1364,17 @@ static inline void tcg_gen_addi_ptr(TCGv_ptr r, TCGv_ptr a, intptr_t b)
     glue(tcg_gen_addi_,PTR)((NAT)r, (NAT)a, b);
 }
 
+static inline void tcg_gen_movi_ptr(TCGv_ptr r, intptr_t b)
+{
+    glue(tcg_gen_movi_,PTR)((NAT)r, b);
+}
+
+static inline void tcg_gen_brcond_ptr(TCGCond cond, TCGv_ptr a,
+                                      TCGv_ptr b, TCGLabel *label)
+{
+    glue(tcg_gen_brcond_,PTR)(cond, (NAT)a, (NAT)b, label);
+}
+
 static inline void tcg_gen_brcondi_ptr(TCGCond cond, TCGv_ptr a,
                                        intptr_t b, TCGLabel *label)
 {
@@ -699,6 +699,21 @@ struct TCGContext {
     QSIMPLEQ_HEAD(, TCGOp) plugin_ops;
 #endif
 
+#ifdef CONFIG_TCG_LOG_INSTR
+    /* Fast instruction logging state, see exec/log_instr_fast.h */
+    TCGv_ptr log_fast_cur;      /* header record of the current insn */
+    TCGOp *log_fast_tb_op;      /* patched with the bytes reserved by the TB */
+    TCGOp *log_fast_insn_op;    /* patched with the bytes reserved by insn */
+    TCGOp *log_fast_hdr_op;     /* patched with the records reserved by insn */
+    int log_fast_tb_slots;
+    int log_fast_insn_slots;    /* 0 if no instruction is open */
+    int log_fast_insn_bytes;
+    CPUState *log_fast_cpu;
+    /* Last page looked up for instruction physical addresses */
+    uint64_t log_fast_vpage;
+    uint64_t log_fast_ppage;
+#endif
+
     TCGTempSet free_temps[TCG_TYPE_COUNT * 2];
     TCGTemp temps[TCG_MAX_TEMPS]; /* globals first, temps after */
 
@@ -914,6 +929,7 @@ TranslationBlock *tcg_tb_alloc(TCGContext *s);
 void tcg_region_init(void);
 void tb_destroy(TranslationBlock *tb);
 void tcg_region_reset_all(void);
+void tcg_region_forget_threads(void);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
@@ -113,10 +113,13 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "-accel [accel=]accelerator[,prop[=value][,...]]\n"
     "                select accelerator (kvm, xen, hax, hvf, whpx or tcg; use 'help' for a list)\n"
     "                igd-passthru=on|off (enable Xen integrated Intel graphics passthrough, default=off)\n"
+    "                idle-warp=on|off (skip idle virtual time without icount, default=off)\n"
     "                kernel-irqchip=on|off|split controls accelerated irqchip support (default=on)\n"
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                tb-jmp-cache-bits=n (log2 of TCG jump cache entries per vCPU)\n"
+    "                tb-jmp-cache-ways=1|2 (TCG jump cache associativity)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n", QEMU_ARCH_ALL)
 SRST
 ``-accel name[,prop=value[,...]]``
@@ -131,6 +134,16 @@ SRST
         integrated graphics devices can be passed through to the guest
         (default=off)
 
+    ``idle-warp=on|off``
+        When TCG is in use and every vCPU is halted (e.g. in WFI or
+        WAIT) with no I/O pending, including block requests and thread
+        pool work in I/O threads, advance the virtual clock straight to
+        the next virtual timer instead of waiting for it in real time
+        (default=off). Unlike ``-icount sleep=off`` guest code still
+        runs at full speed, so the guest sees a clock that is not
+        deterministic. The total time skipped is reported at exit.
+        Incompatible with ``-icount``.
+
     ``kernel-irqchip=on|off|split``
         Controls KVM in-kernel irqchip support. The default is full
         acceleration of the interrupt controllers. On x86, split irqchip
@@ -150,6 +163,16 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``tb-jmp-cache-bits=n``
+        Sets the number of entries of the per-vCPU cache that maps guest
+        virtual pcs to translation blocks to 2^n (default 12, range 6 to
+        20). Large guest kernels together with userland may benefit from
+        a bigger cache; "info jit" reports its hit rate.
+
+    ``tb-jmp-cache-ways=1|2``
+        Selects a direct-mapped (default) or 2-way associative jump cache
+        with LRU replacement.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefor taking advantage of
@@ -4117,10 +4140,16 @@ SRST
 ERST
 
 DEF("cheri-trace-backend", HAS_ARG, QEMU_OPTION_cheri_trace_backend, \
-"-cheri-trace-backend [text|cvtrace|nop|perfetto|protobuf|drcachesim]     Select CHERI trace mode.\n", QEMU_ARCH_ALL)
+"-cheri-trace-backend [text|cvtrace|cvtrace2|nop|perfetto|protobuf|drcachesim]     Select CHERI trace mode.\n", QEMU_ARCH_ALL)
 SRST
 ``-cheri-trace-backend type``
-    Set CHERI trace backend to <type> (text, cvtrace, nop, perfetto, protobuf or drcachesim)
+    Set CHERI trace backend to <type> (text, cvtrace, cvtrace2, nop, perfetto, protobuf or drcachesim)
+
+    ``cvtrace2`` writes the cvtrace entries delta and varint encoded,
+    through a gzip compressor. The format is described in
+    ``include/exec/log_instr_cvtrace.h``; ``qemu-cvtrace2-expand`` from
+    ``contrib/trace-reader`` converts it back to a classic cvtrace file.
+    Per-context and chunked output are not supported.
 ERST
 
 DEF("cheri-trace-perfetto-logfile", HAS_ARG, QEMU_OPTION_trace_perfetto_logfile, \
@@ -4153,6 +4182,37 @@ SRST
     Enable perfetto interceptor, skips normal perfetto tracing service.
 ERST
 
+DEF("cheri-trace-perfetto-config", HAS_ARG, QEMU_OPTION_trace_perfetto_config, \
+"-cheri-trace-perfetto-config [buffer-size=size][,smb-size=size][,flush-period=ms]\n"
+"                [,write-period=ms][,per-cpu=on|off][,fill-policy=ring|discard]\n"
+"                Configure the perfetto tracing session.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-perfetto-config [buffer-size=size][,smb-size=size][,flush-period=ms][,write-period=ms][,per-cpu=on|off][,fill-policy=ring|discard]``
+    Configure the perfetto tracing session.
+
+    ``buffer-size=size``
+        Size of the trace buffer, defaults to 512M.
+
+    ``smb-size=size``
+        Size of the shared memory buffer between the tracing producer and
+        the in-process service, defaults to 32M.
+
+    ``flush-period=ms``, ``write-period=ms``
+        Period of the producer flushes (default 5000) and of the writes of
+        the trace buffer into the output file (default 1000).
+
+    ``per-cpu=on|off``
+        Make ``buffer-size`` a per vCPU size. The trace buffer is scaled by
+        the number of vCPUs.
+
+    ``fill-policy=ring|discard``
+        When the trace buffer is full either overwrite the oldest data
+        (``ring``, the default) or drop new data (``discard``).
+
+    Buffer statistics, including the number of lost chunks, are printed
+    when tracing stops.
+ERST
+
 DEF("cheri-trace-protobuf-logfile", HAS_ARG, QEMU_OPTION_trace_protobuf_logfile, \
 "-cheri-trace-protobuf-logfile [logfile]     \
  Set log file for protobuf traces, defaults to qemu_trace.pb.\n", QEMU_ARCH_ALL)
@@ -4184,6 +4244,96 @@ SRST
     Set CHERI trace filters to use. Available filters are: events.
 ERST
 
+DEF("cheri-trace-context-filter", HAS_ARG, QEMU_OPTION_cheri_trace_context_filter, \
+"-cheri-trace-context-filter pid=N,cid=M[,...]     Only trace the given guest contexts.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-context-filter pid=N,cid=M[,...]``
+    Only trace instructions executed by the given guest processes and
+    compartments, as reported by the guest context switch events. Each of
+    pid and cid may be repeated; when only one kind is given, the other
+    is not restricted. Entries from other contexts are dropped before they
+    reach the trace backend.
+ERST
+
+DEF("cheri-trace-split", HAS_ARG, QEMU_OPTION_cheri_trace_split, \
+"-cheri-trace-split by=pid|cid[,dir=path]     Write one trace file per guest context.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-split by=pid|cid[,dir=path]``
+    Write a separate trace file for each guest process or compartment,
+    named ``trace-pidN.cvtrace`` or ``trace-cidN.cvtrace`` in ``dir``
+    (defaults to the current directory). Each file is written by its own
+    thread. Only supported by the cvtrace backend.
+ERST
+
+DEF("cheri-trace-chunked", HAS_ARG, QEMU_OPTION_cheri_trace_chunked, \
+"-cheri-trace-chunked file=path[,entries=N]     Write the trace as indexed compressed chunks.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-chunked file=path[,entries=N]``
+    Wrap the trace backend output in a seekable container. Entries are
+    grouped into independently compressed chunks of at most ``N`` entries
+    (default 65536) from a single CPU and guest context. Each chunk header
+    records the entry range, CPU, context and PC range, and a trailing index
+    allows random access and parallel decoding. The layout is described in
+    ``include/exec/log_instr_chunked.h`` and a reader library is provided in
+    ``contrib/trace-reader``. Supported by the cvtrace, protobuf and
+    drcachesim backends.
+ERST
+
+DEF("cheri-trace-text-per-cpu", HAS_ARG, QEMU_OPTION_cheri_trace_text_per_cpu, \
+"-cheri-trace-text-per-cpu file=path[,timestamps=on|off]     Write one text trace file per CPU.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-text-per-cpu file=path[,timestamps=on|off]``
+    Write the text backend output of each CPU to its own file instead of
+    the ``-D`` log, so that CPUs do not contend on the log lock. ``path``
+    must contain a single ``%d`` that is replaced by the CPU index, e.g.
+    ``trace-%d.log``. Each file is written in large chunks. With
+    ``timestamps=on`` every entry is preceded by a ``@ns`` line holding the
+    host time, which ``scripts/merge-text-traces.py`` uses to interleave
+    the files; without timestamps the files are merged in entry order.
+ERST
+
+DEF("cheri-trace-fast", 0, QEMU_OPTION_cheri_trace_fast, \
+"-cheri-trace-fast     Record instruction traces from translated code without helper calls.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-fast``
+    Instead of calling a logging helper for every instruction, register
+    write and memory access, translated code stores fixed-size records in
+    a per-CPU buffer that is decoded into trace entries when it fills up
+    and before exceptions, interrupts, mode switches and trace events.
+    The address space ID and physical addresses are looked up when the
+    records are decoded. Extra text and ``qemu_log_gen_printf`` output are
+    not recorded. Supported by the cvtrace, drcachesim and nop backends
+    and only implemented for RISC-V.
+ERST
+
+DEF("cheri-trace-lazy-regs", 0, QEMU_OPTION_cheri_trace_lazy_regs, \
+"-cheri-trace-lazy-regs     Log register values on instruction commit.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-lazy-regs``
+    Instead of calling a logging helper for every general purpose register
+    write, translated code only records which registers each instruction
+    writes, and their values are read from the CPU state when the
+    instruction is committed. A register written more than once by an
+    instruction is logged once, with its final value, and registers are
+    not logged for instructions that trap. Capability register writes are
+    still logged individually. Only implemented for RISC-V and can not be
+    combined with ``-cheri-trace-fast``.
+ERST
+
+DEF("cheri-trace-insn-dict", 0, QEMU_OPTION_cheri_trace_insn_dict, \
+"-cheri-trace-insn-dict     Emit each traced instruction once and refer to it by id.\n", QEMU_ARCH_ALL)
+SRST
+``-cheri-trace-insn-dict``
+    Keep a per-CPU dictionary of the traced instructions, keyed by
+    physical address, virtual address and opcode bytes, and disassemble
+    each instruction only once. The json backend writes a definition
+    object with ``def``, ``cpu``, ``paddr``, ``pc``, ``bytes`` and
+    ``insn`` the first time an instruction is seen, and later entries
+    replace ``insn`` with ``insn_id``. Ids are unique per CPU. The
+    protobuf backend keeps its message format and only reuses the
+    disassembly. Other backends do not support the dictionary.
+ERST
+
 DEF("cheri-trace-debug", 0, QEMU_OPTION_cheri_trace_debug, \
 "-cheri-trace-debug     Enable debug stats.\n", QEMU_ARCH_ALL)
 SRST
@@ -4225,6 +4375,29 @@ SRST
 ``-rvfi-dii-debug``
     Print RVFI-DII debug messages.
 ERST
+DEF("rvfi-dii-batch", 0, QEMU_OPTION_rvfi_dii_batch, \
+    "-rvfi-dii-batch     Buffer RVFI-DII commands and trace replies\n", QEMU_ARCH_RISCV)
+SRST
+``-rvfi-dii-batch``
+    Read RVFI-DII commands from the socket in large chunks and buffer the
+    trace replies until all buffered commands have been processed (or a
+    halt/reset is reached) instead of doing one ``read()`` and one
+    ``write()`` per injected instruction. The wire format is unchanged.
+ERST
+DEF("rvfi-dii-sessions", HAS_ARG, QEMU_OPTION_rvfi_dii_sessions, \
+    "-rvfi-dii-sessions <n>     Serve up to <n> RVFI-DII connections in parallel\n", QEMU_ARCH_RISCV)
+SRST
+``-rvfi-dii-sessions n``
+    Serve up to <n> RVFI-DII connections in parallel. QEMU keeps accepting
+    connections on the RVFI-DII port and forks a new process for each of
+    them. The fork happens after the board has been initialized, so the
+    sessions skip the machine setup and share the memory of the initial
+    machine until they modify it. Each session starts its own vCPU threads
+    and reopens the ``-D`` log file and the instruction trace outputs with
+    its process id appended to their name (a ``%d`` in the ``-D`` file
+    name is expanded instead). The perfetto trace backend and I/O threads
+    can not be used with more than one session.
+ERST
 #endif
 
 
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# Merge the per-CPU text instruction traces written with
+# -cheri-trace-text-per-cpu into a single trace.
+#
+# When the traces were recorded with timestamps=on, entries are ordered by
+# the host time in their "@ns" line. Otherwise they are interleaved in
+# instruction order: the n-th entry of every CPU is emitted before the
+# (n+1)-th entry of any CPU. In that case an entry starts at each line
+# beginning with "[cpu:asid]", other lines belong to the preceding entry.
+#
+# Example of usage:
+#   merge-text-traces.py -o trace.log trace-0.log trace-1.log
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import argparse
+import heapq
+import sys
+
+
+def timestamp_entries(f):
+    """Yield (timestamp, lines) for the entries of a timestamped trace"""
+    key = 0
+    lines = []
+    for line in f:
+        if line.startswith(b'@'):
+            if lines:
+                yield key, lines
+            key = int(line[1:])
+            lines = []
+        else:
+            lines.append(line)
+    if lines:
+        yield key, lines
+
+
+def ordered_entries(f):
+    """Yield (index, lines) for the entries of a trace without timestamps"""
+    index = 0
+    lines = []
+    for line in f:
+        if line.startswith(b'[') and lines:
+            yield index, lines
+            index += 1
+            lines = []
+        lines.append(line)
+    if lines:
+        yield index, lines
+
+
+def is_timestamped(path):
+    with open(path, 'rb') as f:
+        return f.readline().startswith(b'@')
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Merge per-CPU text instruction traces')
+    parser.add_argument('traces', nargs='+',
+                        help='per-CPU trace files, in CPU order')
+    parser.add_argument('-o', '--output', help='output file (default stdout)')
+    parser.add_argument('--keep-timestamps', action='store_true',
+                        help='keep the "@ns" lines in the output')
+    args = parser.parse_args()
+
+    timestamped = [is_timestamped(path) for path in args.traces]
+    if any(timestamped) and not all(timestamped):
+        sys.exit('Cannot merge traces with and without timestamps')
+    entries = timestamp_entries if timestamped[0] else ordered_entries
+
+    files = [open(path, 'rb') for path in args.traces]
+    out = open(args.output, 'wb') if args.output else sys.stdout.buffer
+    # the CPU number breaks ties, so that the merge is stable
+    streams = [((key, cpu, lines) for key, lines in entries(f))
+               for cpu, f in enumerate(files)]
+    for key, _, lines in heapq.merge(*streams):
+        if timestamped[0] and args.keep_timestamps:
+            out.write(b'@%d\n' % key)
+        out.writelines(lines)
+
+    out.flush()
+    for f in files:
+        f.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+#
+# Measure how a timer-heavy workload scales with the number of vCPUs on the
+# RISC-V virt machine. Every vCPU runs a loop of short sleeps, so the guest
+# constantly reprograms the CLINT timer, takes timer interrupts and polls
+# the UART, which is the MMIO traffic that used to be serialized by the BQL.
+#
+# The total iteration rate is printed for each vCPU count together with the
+# speedup over a single vCPU. Pass --baseline to run the same workload with
+# a second QEMU binary, e.g. one where all MMIO still takes the BQL.
+#
+# The guest kernel and root filesystem are not provided; the root
+# filesystem must contain busybox (taskset, usleep) and start a shell on
+# the serial console.
+#
+# Example of usage:
+#   riscv_timer_scaling.py --qemu build/qemu-system-riscv64 \
+#       --kernel Image --rootfs rootfs.ext2 --bios opensbi.elf \
+#       --baseline old-build/qemu-system-riscv64
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import argparse
+import os
+import sys
+import time
+
+sys.path.append(os.path.dirname(__file__))
+from virtio_mmio_fio import ConsoleReader, marker_command, wait_for  # noqa
+
+sys.path.append(os.path.join(os.path.dirname(__file__), '..', '..', 'python'))
+from qemu.machine import QEMUMachine  # noqa: E402
+
+
+def workload(args, ncpus, echo):
+    loop = ('i=0; while [ $i -lt %d ]; do usleep %d; i=$((i+1)); done' %
+            (args.iterations, args.sleep_us))
+    jobs = ' '.join("taskset -c %d sh -c '%s' &" % (cpu, loop)
+                    for cpu in range(ncpus))
+    return '%s wait; %s' % (jobs, echo)
+
+
+def run_smp(args, qemu, ncpus):
+    vm = QEMUMachine(qemu)
+    vm.set_machine('virt')
+    vm.set_console()
+    vm.add_args('-smp', str(ncpus), '-m', args.memory,
+                '-kernel', args.kernel,
+                '-append', 'console=ttyS0 root=/dev/vda rw ' + args.append,
+                '-drive', 'if=none,id=root,format=raw,file=' + args.rootfs,
+                '-device', 'virtio-blk-device,drive=root')
+    if args.bios:
+        vm.add_args('-bios', args.bios)
+
+    vm.launch()
+    try:
+        vm.console_socket.settimeout(5)
+        console = ConsoleReader(vm.console_socket)
+        echo, pattern = marker_command('READY')
+        wait_for(vm, console, pattern, args.boot_timeout, poke=echo)
+
+        echo, pattern = marker_command('DONE')
+        start = time.monotonic()
+        vm.console_socket.sendall((workload(args, ncpus, echo) +
+                                   '\r').encode())
+        wait_for(vm, console, pattern, args.timeout)
+        elapsed = time.monotonic() - start
+    finally:
+        vm.shutdown()
+
+    return ncpus * args.iterations / elapsed
+
+
+def run_all(args, qemu, name):
+    results = {}
+    for ncpus in args.smp:
+        results[ncpus] = run_smp(args, qemu, ncpus)
+        print('%-10s smp=%-3d %10.1f iterations/s' %
+              (name, ncpus, results[ncpus]), flush=True)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Measure timer-heavy workload scaling on RISC-V virt')
+    parser.add_argument('--qemu', required=True,
+                        help='qemu-system-riscv64 binary')
+    parser.add_argument('--baseline',
+                        help='qemu-system-riscv64 binary to compare with')
+    parser.add_argument('--kernel', required=True)
+    parser.add_argument('--rootfs', required=True,
+                        help='raw root filesystem image containing busybox')
+    parser.add_argument('--bios', help='firmware, e.g. OpenSBI')
+    parser.add_argument('--append', default='', help='extra kernel arguments')
+    parser.add_argument('--boot-timeout', type=int, default=300)
+    parser.add_argument('--timeout', type=int, default=600,
+                        help='timeout of a single workload run')
+    parser.add_argument('--smp', default='1,2,4,8',
+                        help='comma separated list of vCPU counts')
+    parser.add_argument('--memory', default='1G')
+    parser.add_argument('--iterations', type=int, default=2000,
+                        help='sleeps per vCPU')
+    parser.add_argument('--sleep-us', type=int, default=100)
+    args = parser.parse_args()
+    args.smp = [int(n) for n in args.smp.split(',')]
+
+    runs = [('qemu', args.qemu)]
+    if args.baseline:
+        runs.append(('baseline', args.baseline))
+
+    results = {name: run_all(args, qemu, name) for name, qemu in runs}
+
+    print()
+    for name, _ in runs:
+        base = results[name][args.smp[0]]
+        for ncpus in args.smp:
+            print('%-10s smp=%-3d %9.2fx' %
+                  (name, ncpus, results[name][ncpus] / base))
+    if args.baseline:
+        for ncpus in args.smp:
+            print('qemu/baseline smp=%-3d %9.2fx' %
+                  (ncpus, results['qemu'][ncpus] /
+                   results['baseline'][ncpus]))
+
+
+if __name__ == '__main__':
+    main()
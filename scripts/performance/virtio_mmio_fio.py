@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# Run fio inside a RISC-V virt guest against a virtio-blk disk and compare
+# where queue notifications are processed:
+#
+#   vcpu      - ioeventfd=off, requests are handled in the vCPU thread
+#   mainloop  - ioeventfd=on, requests are handled by the main loop
+#   iothread  - ioeventfd=on, virtio-blk dataplane on a dedicated iothread
+#
+# The guest kernel and root filesystem are not provided; the root
+# filesystem must contain fio and start a shell on the serial console.
+#
+# Example of usage:
+#   virtio_mmio_fio.py --qemu build/qemu-system-riscv64 \
+#       --kernel Image --rootfs rootfs.ext2 --bios opensbi.elf
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import argparse
+import os
+import socket
+import sys
+import tempfile
+import time
+
+sys.path.append(os.path.join(os.path.dirname(__file__), '..', '..', 'python'))
+from qemu.machine import QEMUMachine  # noqa: E402
+
+
+MODES = ('vcpu', 'mainloop', 'iothread')
+
+
+def marker_command(name):
+    # quoted so that the echoed command line itself does not match
+    return "echo FIO-BENCH-''%s" % name, 'FIO-BENCH-' + name
+
+
+class ConsoleReader:
+    """Line reader that, unlike socket.makefile(), survives timeouts"""
+    def __init__(self, sock):
+        self.sock = sock
+        self.buf = b''
+
+    def readline(self):
+        while b'\n' not in self.buf:
+            data = self.sock.recv(4096)
+            if not data:
+                sys.exit('Guest console closed')
+            self.buf += data
+        line, self.buf = self.buf.split(b'\n', 1)
+        return line.decode(errors='replace')
+
+
+def wait_for(vm, console, pattern, timeout, poke=None):
+    """
+    Collect console lines until one contains pattern. If poke is given,
+    it is (re)sent whenever the console stays quiet, e.g. while the guest
+    is still booting.
+    """
+    deadline = time.monotonic() + timeout
+    lines = []
+    if poke:
+        vm.console_socket.sendall((poke + '\r').encode())
+    while time.monotonic() < deadline:
+        try:
+            line = console.readline()
+        except socket.timeout:
+            if poke:
+                vm.console_socket.sendall((poke + '\r').encode())
+            continue
+        line = line.strip()
+        lines.append(line)
+        if pattern in line:
+            return lines
+    sys.exit('Timed out waiting for "%s" on the guest console' % pattern)
+
+
+def run_mode(args, mode, scratch):
+    vm = QEMUMachine(args.qemu)
+    vm.set_machine('virt')
+    vm.set_console()
+    vm.add_args('-smp', str(args.smp), '-m', args.memory,
+                '-kernel', args.kernel,
+                '-append', 'console=ttyS0 root=/dev/vda rw ' + args.append,
+                '-drive', 'if=none,id=root,format=raw,file=' + args.rootfs,
+                '-device', 'virtio-blk-device,drive=root',
+                '-drive', 'if=none,id=scratch,format=raw,cache=none,'
+                          'file=' + scratch)
+    if args.bios:
+        vm.add_args('-bios', args.bios)
+
+    if mode == 'vcpu':
+        vm.add_args('-global', 'virtio-mmio.ioeventfd=off',
+                    '-device', 'virtio-blk-device,drive=scratch')
+    elif mode == 'mainloop':
+        vm.add_args('-device', 'virtio-blk-device,drive=scratch')
+    else:
+        vm.add_args('-object', 'iothread,id=iothread0',
+                    '-device', 'virtio-blk-device,drive=scratch,'
+                               'iothread=iothread0')
+
+    vm.launch()
+    try:
+        vm.console_socket.settimeout(5)
+        console = ConsoleReader(vm.console_socket)
+        echo, pattern = marker_command('READY')
+        wait_for(vm, console, pattern, args.boot_timeout, poke=echo)
+
+        # the scratch disk is the second virtio-blk device
+        echo, pattern = marker_command('DONE')
+        fio = ('fio --name=bench --filename=/dev/vdb --direct=1 '
+               '--ioengine=libaio --rw=%s --bs=%s --iodepth=%d '
+               '--numjobs=%d --group_reporting --runtime=%d --time_based '
+               '--output-format=terse; %s' %
+               (args.rw, args.bs, args.iodepth, args.numjobs, args.runtime,
+                echo))
+        vm.console_socket.sendall((fio + '\r').encode())
+        lines = wait_for(vm, console, pattern, args.runtime + 120)
+    finally:
+        vm.shutdown()
+
+    # terse v3: field 7 is read IOPS, field 48 is write IOPS
+    for line in lines:
+        fields = line.split(';')
+        if len(fields) > 48 and fields[0] == '3':
+            return int(fields[7]) + int(fields[48])
+    sys.exit('No fio terse output found for mode %s' % mode)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare virtio-blk notification handling with fio')
+    parser.add_argument('--qemu', required=True,
+                        help='qemu-system-riscv64 binary')
+    parser.add_argument('--kernel', required=True)
+    parser.add_argument('--rootfs', required=True,
+                        help='raw root filesystem image containing fio')
+    parser.add_argument('--bios', help='firmware, e.g. OpenSBI')
+    parser.add_argument('--append', default='', help='extra kernel arguments')
+    parser.add_argument('--boot-timeout', type=int, default=300)
+    parser.add_argument('--smp', type=int, default=4)
+    parser.add_argument('--memory', default='1G')
+    parser.add_argument('--disk-size', default='1G')
+    parser.add_argument('--rw', default='randread')
+    parser.add_argument('--bs', default='4k')
+    parser.add_argument('--iodepth', type=int, default=32)
+    parser.add_argument('--numjobs', type=int, default=4)
+    parser.add_argument('--runtime', type=int, default=30)
+    parser.add_argument('--modes', default=','.join(MODES),
+                        help='comma separated subset of ' + ', '.join(MODES))
+    args = parser.parse_args()
+
+    modes = args.modes.split(',')
+    for mode in modes:
+        if mode not in MODES:
+            sys.exit('Unknown mode %s' % mode)
+
+    with tempfile.NamedTemporaryFile(suffix='.img') as scratch:
+        units = {'K': 1 << 10, 'M': 1 << 20, 'G': 1 << 30}
+        size = args.disk_size
+        if size[-1].upper() in units:
+            size = int(size[:-1]) * units[size[-1].upper()]
+        scratch.truncate(int(size))
+        scratch.flush()
+
+        results = {}
+        for mode in modes:
+            results[mode] = run_mode(args, mode, scratch.name)
+            print('%-10s %10d IOPS' % (mode, results[mode]), flush=True)
+
+    base = results.get('vcpu')
+    if base:
+        for mode in modes:
+            print('%-10s %9.2fx' % (mode, results[mode] / base))
+
+
+if __name__ == '__main__':
+    main()
@@ -30,6 +30,7 @@
 #include "qemu/error-report.h"
 #include "exec/exec-all.h"
 #include "sysemu/cpus.h"
+#include "block/aio-wait.h"
 #include "sysemu/qtest.h"
 #include "qemu/main-loop.h"
 #include "qemu/option.h"
@@ -39,7 +40,9 @@
 #include "hw/core/cpu.h"
 #include "sysemu/cpu-timers.h"
 #include "sysemu/cpu-throttle.h"
+#include "sysemu/sysemu.h"
 #include "timers-state.h"
+#include "trace.h"
 
 /* clock and ticks */
 
@@ -266,6 +269,77 @@ void qemu_timer_notify_cb(void *opaque, QEMUClockType type)
     }
 }
 
+/* idle warp: skip idle virtual time without icount */
+
+static void idle_warp_report(Notifier *n, void *data)
+{
+    if (timers_state.idle_warp_total) {
+        info_report("idle-warp: advanced the virtual clock by %" PRId64
+                    " ms while all vCPUs were idle",
+                    timers_state.idle_warp_total / SCALE_MS);
+    }
+}
+
+static Notifier idle_warp_exit_notifier = {
+    .notify = idle_warp_report,
+};
+
+void cpu_idle_warp_enable(void)
+{
+    assert(!icount_enabled());
+    timers_state.idle_warp = true;
+    qemu_add_exit_notifier(&idle_warp_exit_notifier);
+}
+
+bool cpu_idle_warp_enabled(void)
+{
+    return timers_state.idle_warp;
+}
+
+int64_t cpu_idle_warp_deadline(void)
+{
+    int64_t deadline;
+
+    if (!timers_state.idle_warp || !runstate_is_running() ||
+        qtest_enabled() || !all_cpu_threads_idle()) {
+        return -1;
+    }
+    /*
+     * Block and thread pool requests (including the ones of iothreads)
+     * complete in real time, don't let guest timeouts expire before them.
+     */
+    if (aio_any_in_flight()) {
+        return -1;
+    }
+
+    /* Like icount, ignore timers that track the outside world */
+    deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL,
+                                          ~QEMU_TIMER_ATTR_EXTERNAL);
+    return deadline > 0 ? deadline : -1;
+}
+
+void cpu_idle_warp(void)
+{
+    int64_t deadline = cpu_idle_warp_deadline();
+
+    if (deadline < 0) {
+        return;
+    }
+
+    /*
+     * Only ever add to the offset, so QEMU_CLOCK_VIRTUAL stays monotonic
+     * and lands exactly on the deadline of the earliest pending timer.
+     */
+    seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                       &timers_state.vm_clock_lock);
+    timers_state.cpu_clock_offset += deadline;
+    seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                         &timers_state.vm_clock_lock);
+    timers_state.idle_warp_total += deadline;
+    trace_cpu_idle_warp(deadline, timers_state.idle_warp_total);
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+}
+
 TimersState timers_state;
 
 /* initialize timers state and the cpu throttle for convenience */
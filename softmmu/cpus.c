@@ -626,6 +626,29 @@ void qemu_init_vcpu(CPUState *cpu)
     }
 }
 
+void qemu_recreate_vcpus_after_fork(Error **errp)
+{
+    CPUState *cpu;
+
+    g_assert(cpus_accel != NULL);
+    if (cpus_accel->forget_vcpu_threads == NULL) {
+        error_setg(errp, "The accelerator can not recreate its vCPU threads");
+        return;
+    }
+    cpus_accel->forget_vcpu_threads();
+
+    CPU_FOREACH(cpu) {
+        cpu->created = false;
+        cpu->thread = NULL;
+        cpu->halt_cond = NULL;
+        cpus_accel->create_vcpu_thread(cpu);
+
+        while (!cpu->created) {
+            qemu_cond_wait(&qemu_cpu_cond, &qemu_global_mutex);
+        }
+    }
+}
+
 void cpu_stop_current(void)
 {
     if (current_cpu) {
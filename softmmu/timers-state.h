@@ -57,6 +57,10 @@ typedef struct TimersState {
     QEMUTimer *icount_rt_timer;
     QEMUTimer *icount_vm_timer;
     QEMUTimer *icount_warp_timer;
+
+    /* idle warp without icount, protected by BQL */
+    bool idle_warp;
+    int64_t idle_warp_total;
 } TimersState;
 
 extern TimersState timers_state;
@@ -180,8 +180,9 @@ bool cheri_debugger_on_trap = false;
 #ifdef CONFIG_RVFI_DII
 int rvfi_client_fd = 0;
 bool rvfi_debug_output = false;
+bool rvfi_dii_batch = false;
 
-static int rvfi_dii_socket_init(uint16_t port) {
+static int rvfi_dii_socket_init(uint16_t port, int backlog) {
     int rvfi_listen_fd = qemu_socket(AF_INET, SOCK_STREAM, 0);
     if (rvfi_listen_fd == -1) {
         error_report("RVFI-DII failed to create socket on port %d: %s (%d)\n", port, strerror(errno), errno);
@@ -206,7 +207,7 @@ static int rvfi_dii_socket_init(uint16_t port) {
         exit(EXIT_FAILURE);
     }
 
-    if (listen(rvfi_listen_fd, 1) == -1) {
+    if (listen(rvfi_listen_fd, backlog) == -1) {
         error_report("RVFI-DII listen() failed: %s (%d)\n", strerror(errno), errno);
         exit(EXIT_FAILURE);
     }
@@ -220,6 +221,87 @@ static int rvfi_dii_socket_init(uint16_t port) {
     info_report("Listening for remote rvfi_dii connection on port %d.\n", ntohs(addr.sin_port));
     return rvfi_listen_fd;
 }
+
+static int rvfi_dii_is_iothread(Object *obj, void *opaque)
+{
+    return object_dynamic_cast(obj, TYPE_IOTHREAD) != NULL;
+}
+
+/*
+ * Set up a session in a forked child. Only the calling thread survives
+ * fork(), so the vCPU threads are started again, and the main loop
+ * notifiers, the log and the trace outputs that would be shared with the
+ * parent are replaced with ones of our own.
+ */
+static void rvfi_dii_session_init(void)
+{
+    qemu_main_loop_after_fork(&error_fatal);
+    qemu_recreate_vcpus_after_fork(&error_fatal);
+    qemu_log_reopen_after_fork(&error_fatal);
+#ifdef CONFIG_TCG_LOG_INSTR
+    qemu_log_instr_after_fork();
+#endif
+}
+
+/*
+ * Accept a connection on @listen_fd. If @max_sessions is greater than one we
+ * act as a fork server: the parent process keeps accepting connections and
+ * forks a child for each of them (running at most @max_sessions children at
+ * a time). Each child returns the client fd and starts the machine on its
+ * own.
+ *
+ * This is called once the board is initialized, so the children share its
+ * memory with the parent until they write to it. The vCPUs must not have
+ * run yet, and there must be no other thread than the vCPU threads and the
+ * call_rcu thread, which is restarted by the RCU atfork handlers.
+ */
+static int rvfi_dii_accept(int listen_fd, int max_sessions)
+{
+    int active_sessions = 0;
+
+    if (max_sessions <= 1) {
+        return accept(listen_fd, NULL, NULL);
+    }
+    while (true) {
+        /* Reap all sessions that have finished. */
+        while (active_sessions > 0 && waitpid(-1, NULL, WNOHANG) > 0) {
+            active_sessions--;
+        }
+        if (active_sessions >= max_sessions) {
+            if (waitpid(-1, NULL, 0) > 0) {
+                active_sessions--;
+            }
+            continue;
+        }
+        int client_fd = accept(listen_fd, NULL, NULL);
+        if (client_fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_report("RVFI-DII accept() failed: %s (%d)", strerror(errno),
+                         errno);
+            exit(EXIT_FAILURE);
+        }
+        /* Don't let the children write out our buffered output again */
+        fflush(NULL);
+        rcu_enable_atfork();
+        pid_t pid = fork();
+        rcu_disable_atfork();
+        if (pid == -1) {
+            error_report("RVFI-DII fork() failed: %s (%d)", strerror(errno),
+                         errno);
+            exit(EXIT_FAILURE);
+        } else if (pid == 0) {
+            close(listen_fd);
+            rvfi_dii_session_init();
+            return client_fd;
+        }
+        close(client_fd);
+        active_sessions++;
+        info_report("Started RVFI-DII session in process %d (%d active)",
+                    (int)pid, active_sessions);
+    }
+}
 #endif
 
 /* The bytes in qemu_uuid are in the order specified by RFC4122, _not_ in the
@@ -532,6 +614,60 @@ static QemuOptsList qemu_icount_opts = {
     },
 };
 
+#ifdef CONFIG_TRACE_PERFETTO
+static QemuOptsList qemu_perfetto_opts = {
+    .name = "cheri-trace-perfetto-config",
+    .merge_lists = true,
+    .head = QTAILQ_HEAD_INITIALIZER(qemu_perfetto_opts.head),
+    .desc = {
+        {
+            .name = "buffer-size",
+            .type = QEMU_OPT_SIZE,
+        }, {
+            .name = "smb-size",
+            .type = QEMU_OPT_SIZE,
+        }, {
+            .name = "flush-period",
+            .type = QEMU_OPT_NUMBER,
+        }, {
+            .name = "write-period",
+            .type = QEMU_OPT_NUMBER,
+        }, {
+            .name = "per-cpu",
+            .type = QEMU_OPT_BOOL,
+        }, {
+            .name = "fill-policy",
+            .type = QEMU_OPT_STRING,
+        },
+        { /* end of list */ }
+    },
+};
+
+static void configure_perfetto_session(QemuOpts *opts, unsigned int ncpus)
+{
+    qemu_log_instr_perfetto_session_conf_t conf = {
+        .buffer_size_kb = qemu_opt_get_size(opts, "buffer-size", 0) / KiB,
+        .shm_size_kb = qemu_opt_get_size(opts, "smb-size", 0) / KiB,
+        .flush_period_ms = qemu_opt_get_number(opts, "flush-period", 0),
+        .file_write_period_ms = qemu_opt_get_number(opts, "write-period", 0),
+        .ncpus = ncpus,
+        .per_cpu_buffers = qemu_opt_get_bool(opts, "per-cpu", false),
+    };
+    const char *fill_policy = qemu_opt_get(opts, "fill-policy");
+
+    if (fill_policy == NULL || strcmp(fill_policy, "ring") == 0) {
+        conf.fill_discard = false;
+    } else if (strcmp(fill_policy, "discard") == 0) {
+        conf.fill_discard = true;
+    } else {
+        error_report("Invalid fill-policy '%s', expected ring or discard",
+                     fill_policy);
+        exit(1);
+    }
+    qemu_log_instr_perfetto_conf_session(&conf);
+}
+#endif
+
 static QemuOptsList qemu_fw_cfg_opts = {
     .name = "fw_cfg",
     .implied_opt_name = "name",
@@ -2979,6 +3115,7 @@ void qemu_init(int argc, char **argv, char **envp)
     uint64_t cl_breakcount = 0L;
 #ifdef CONFIG_RVFI_DII
     int rvfi_dii_port = 0;
+    int rvfi_dii_sessions = 1;
 #endif
     bool list_data_dirs = false;
     char **dirs;
@@ -3036,6 +3173,9 @@ void qemu_init(int argc, char **argv, char **envp)
     qemu_add_opts(&qemu_icount_opts);
     qemu_add_opts(&qemu_semihosting_config_opts);
     qemu_add_opts(&qemu_fw_cfg_opts);
+#ifdef CONFIG_TRACE_PERFETTO
+    qemu_add_opts(&qemu_perfetto_opts);
+#endif
     module_call_init(MODULE_INIT_OPTS);
 
     runstate_init();
@@ -3755,6 +3895,8 @@ void qemu_init(int argc, char **argv, char **envp)
                     qemu_log_instr_set_backend(QEMU_LOG_INSTR_BACKEND_TEXT);
                 } else if (strcmp(optarg, "cvtrace") == 0) {
                     qemu_log_instr_set_backend(QEMU_LOG_INSTR_BACKEND_CVTRACE);
+                } else if (strcmp(optarg, "cvtrace2") == 0) {
+                    qemu_log_instr_set_backend(QEMU_LOG_INSTR_BACKEND_CVTRACE2);
                 } else if (strcmp(optarg, "nop") == 0) {
                     qemu_log_instr_set_backend(QEMU_LOG_INSTR_BACKEND_NOP);
 #ifdef CONFIG_TRACE_PERFETTO
@@ -3790,6 +3932,14 @@ void qemu_init(int argc, char **argv, char **envp)
                 break;
             case QEMU_OPTION_trace_perfetto_interceptor_logfile:
                 qemu_log_instr_perfetto_interceptor_logfile(optarg);
+                break;
+            case QEMU_OPTION_trace_perfetto_config:
+                if (!qemu_opts_parse_noisily(
+                        qemu_find_opts("cheri-trace-perfetto-config"), optarg,
+                        false)) {
+                    exit(1);
+                }
+                break;
 #endif
 #ifdef CONFIG_TRACE_PROTOBUF
             case QEMU_OPTION_trace_protobuf_logfile:
@@ -3810,6 +3960,27 @@ void qemu_init(int argc, char **argv, char **envp)
             case QEMU_OPTION_cheri_trace_filters:
                 qemu_log_instr_set_cli_filters(optarg, &error_fatal);
                 break;
+            case QEMU_OPTION_cheri_trace_context_filter:
+                qemu_log_instr_set_ctx_filter(optarg, &error_fatal);
+                break;
+            case QEMU_OPTION_cheri_trace_split:
+                qemu_log_instr_set_split_output(optarg, &error_fatal);
+                break;
+            case QEMU_OPTION_cheri_trace_chunked:
+                qemu_log_instr_set_chunked_output(optarg, &error_fatal);
+                break;
+            case QEMU_OPTION_cheri_trace_text_per_cpu:
+                qemu_log_instr_set_text_per_cpu(optarg, &error_fatal);
+                break;
+            case QEMU_OPTION_cheri_trace_fast:
+                qemu_log_instr_enable_fast();
+                break;
+            case QEMU_OPTION_cheri_trace_lazy_regs:
+                qemu_log_instr_enable_lazy_regs();
+                break;
+            case QEMU_OPTION_cheri_trace_insn_dict:
+                qemu_log_instr_enable_insn_dict();
+                break;
             case QEMU_OPTION_cheri_trace_debug:
                 qemu_log_instr_enable_trace_debug();
                 break;
@@ -3830,6 +4001,16 @@ void qemu_init(int argc, char **argv, char **envp)
             case QEMU_OPTION_rvfi_dii_debug:
                 rvfi_debug_output = true;
                 break;
+            case QEMU_OPTION_rvfi_dii_batch:
+                rvfi_dii_batch = true;
+                break;
+            case QEMU_OPTION_rvfi_dii_sessions:
+                rvfi_dii_sessions = strtol(optarg, NULL, 0);
+                if (rvfi_dii_sessions <= 0) {
+                    error_report("Invalid RVFI-DII session count '%s'", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case QEMU_OPTION_rvfi_dii_port:
                 rvfi_dii_port = strtoull(optarg, NULL, 0);
                 if (rvfi_dii_port == 0 || rvfi_dii_port > USHRT_MAX) {
@@ -4193,6 +4374,13 @@ void qemu_init(int argc, char **argv, char **envp)
         exit(1);
     }
 
+#ifdef CONFIG_TRACE_PERFETTO
+    /* Needs the vCPU count, and must happen before any CPU starts tracing */
+    configure_perfetto_session(
+        qemu_opts_find(qemu_find_opts("cheri-trace-perfetto-config"), NULL),
+        current_machine->smp.cpus);
+#endif
+
     if (mem_prealloc) {
         char *val;
 
@@ -4715,9 +4903,22 @@ void qemu_init(int argc, char **argv, char **envp)
             error_report("RVFI-DII: maxram_size must be 8 MiB.");
             exit(EXIT_FAILURE);
         }
-        int rvfi_listen_fd = rvfi_dii_socket_init(rvfi_dii_port);
+        if (rvfi_dii_sessions > 1) {
+            /* Their threads would not exist in the forked sessions */
+            if (object_child_foreach(object_get_objects_root(),
+                                     rvfi_dii_is_iothread, NULL)) {
+                error_report("RVFI-DII: I/O threads can not be used with "
+                             "more than one session");
+                exit(EXIT_FAILURE);
+            }
+#ifdef CONFIG_TCG_LOG_INSTR
+            qemu_log_instr_check_fork(&error_fatal);
+#endif
+        }
+        int rvfi_listen_fd =
+            rvfi_dii_socket_init(rvfi_dii_port, rvfi_dii_sessions);
         info_report("Waiting for incoming RVFI socket packets");
-        rvfi_client_fd = accept(rvfi_listen_fd, NULL, NULL);
+        rvfi_client_fd = rvfi_dii_accept(rvfi_listen_fd, rvfi_dii_sessions);
         autostart = true;
         assert(!incoming);
         singlestep = true;
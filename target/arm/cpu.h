@@ -226,6 +226,7 @@ typedef struct ARMPACKey {
 
 #ifdef TARGET_CHERI
 #include "cheri-lazy-capregs-types.h"
+#include "cheri-statcounters.h"
 typedef aligned_cap_register_t AARCH_REG_TYPE;
 #else
 typedef uint64_t AARCH_REG_TYPE;
@@ -781,14 +782,7 @@ typedef struct CPUARMState {
     uint64_t chcr_el2;
     uint64_t cscr_el3;
 
-    // Some statcounters:
-    uint64_t statcounters_cap_read;
-    uint64_t statcounters_cap_read_tagged;
-    uint64_t statcounters_cap_write;
-    uint64_t statcounters_cap_write_tagged;
-
-    uint64_t statcounters_imprecise_setbounds;
-    uint64_t statcounters_unrepresentable_caps;
+    CheriStatcounters statcounters;
 
 #endif
 } CPUARMState;
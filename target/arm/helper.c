@@ -1372,6 +1372,34 @@ static int64_t zero_event_ns_per(uint64_t cycles)
     return -1;
 }
 
+#ifdef TARGET_CHERI
+#define DEFINE_STATCOUNTER_EVENT(name)                                         \
+    static uint64_t statcounter_##name##_get_count(CPUARMState *env)           \
+    {                                                                          \
+        return env->statcounters.counters[CHERI_STATCOUNTER_##name];           \
+    }
+
+DEFINE_STATCOUNTER_EVENT(CAP_READ)
+DEFINE_STATCOUNTER_EVENT(CAP_READ_TAGGED)
+DEFINE_STATCOUNTER_EVENT(CAP_WRITE)
+DEFINE_STATCOUNTER_EVENT(CAP_WRITE_TAGGED)
+DEFINE_STATCOUNTER_EVENT(IMPRECISE_SETBOUNDS)
+DEFINE_STATCOUNTER_EVENT(UNREPRESENTABLE_CAPS)
+DEFINE_STATCOUNTER_EVENT(TAG_GET_MANY)
+DEFINE_STATCOUNTER_EVENT(TAG_SET_MANY)
+DEFINE_STATCOUNTER_EVENT(EXCEPTIONS)
+DEFINE_STATCOUNTER_EVENT(TB_TRANSLATIONS)
+DEFINE_STATCOUNTER_EVENT(SOFTMMU_ITLB_MISS)
+DEFINE_STATCOUNTER_EVENT(SOFTMMU_DTLB_MISS)
+
+#define STATCOUNTER_EVENT(num, name)                                           \
+    { .number = num,                                                           \
+      .supported = event_always_supported,                                     \
+      .get_count = statcounter_##name##_get_count,                             \
+      .ns_per_count = zero_event_ns_per,                                       \
+    }
+#endif
+
 static const pm_event pm_events[] = {
     { .number = 0x000, /* SW_INCR */
       .supported = event_always_supported,
@@ -1405,15 +1433,37 @@ static const pm_event pm_events[] = {
       .get_count = zero_event_get_count,
       .ns_per_count = zero_event_ns_per,
     },
+#ifdef TARGET_CHERI
+    /*
+     * The CHERI statcounters are IMPLEMENTATION DEFINED events. These event
+     * numbers are guest ABI: existing entries must not be changed.
+     */
+    STATCOUNTER_EVENT(0x0c0, CAP_READ),
+    STATCOUNTER_EVENT(0x0c1, CAP_READ_TAGGED),
+    STATCOUNTER_EVENT(0x0c2, CAP_WRITE),
+    STATCOUNTER_EVENT(0x0c3, CAP_WRITE_TAGGED),
+    STATCOUNTER_EVENT(0x0c4, IMPRECISE_SETBOUNDS),
+    STATCOUNTER_EVENT(0x0c5, UNREPRESENTABLE_CAPS),
+    STATCOUNTER_EVENT(0x0c6, TAG_GET_MANY),
+    STATCOUNTER_EVENT(0x0c7, TAG_SET_MANY),
+    STATCOUNTER_EVENT(0x0c8, EXCEPTIONS),
+    STATCOUNTER_EVENT(0x0c9, TB_TRANSLATIONS),
+    STATCOUNTER_EVENT(0x0ca, SOFTMMU_ITLB_MISS),
+    STATCOUNTER_EVENT(0x0cb, SOFTMMU_DTLB_MISS),
+#endif
 };
 
 /*
- * Note: Before increasing MAX_EVENT_ID beyond 0x3f into the 0x40xx range of
+ * Note: Before increasing MAX_EVENT_ID beyond 0xff into the 0x40xx range of
  * events (i.e. the statistical profiling extension), this implementation
  * should first be updated to something sparse instead of the current
  * supported_event_map[] array.
  */
+#ifdef TARGET_CHERI
+#define MAX_EVENT_ID 0xcb
+#else
 #define MAX_EVENT_ID 0x3c
+#endif
 #define UNSUPPORTED_EVENT UINT16_MAX
 static uint16_t supported_event_map[MAX_EVENT_ID + 1];
 
@@ -1441,15 +1491,18 @@ void pmu_init(ARMCPU *cpu)
         const pm_event *cnt = &pm_events[i];
         assert(cnt->number <= MAX_EVENT_ID);
         /* We do not currently support events in the 0x40xx range */
-        assert(cnt->number <= 0x3f);
+        assert(cnt->number <= 0xff);
 
         if (cnt->supported(&cpu->env)) {
             supported_event_map[cnt->number] = i;
-            uint64_t event_mask = 1ULL << (cnt->number & 0x1f);
-            if (cnt->number & 0x20) {
-                cpu->pmceid1 |= event_mask;
-            } else {
-                cpu->pmceid0 |= event_mask;
+            /* PMCEID[01] only describe the common events */
+            if (cnt->number <= 0x3f) {
+                uint64_t event_mask = 1ULL << (cnt->number & 0x1f);
+                if (cnt->number & 0x20) {
+                    cpu->pmceid1 |= event_mask;
+                } else {
+                    cpu->pmceid0 |= event_mask;
+                }
             }
         }
     }
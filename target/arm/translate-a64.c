@@ -1665,6 +1665,7 @@ static void disas_uncond_b_imm(DisasContext *s, uint32_t insn)
     if (insn & (1U << 31)) {
         /* BL Branch with link */
         gen_a64_set_link_register(s);
+        tcg_gen_push_return_addr(s->base.tb, s->base.pc_next);
     }
 
     /* B Branch / BL Branch with link */
@@ -2884,6 +2885,8 @@ static void disas_uncond_b_reg(DisasContext *s, uint32_t insn)
         break;
     }
 
+    s->ind_kind = btype_mod == 1 ? TB_IND_CALL :
+                  btype_mod == 2 ? TB_IND_RETURN : TB_IND_JUMP;
     s->base.is_jmp = DISAS_JUMP;
 }
 
@@ -15444,6 +15447,7 @@ static void aarch64_tr_init_disas_context(DisasContextBase *dcbase,
 
     dc->isar = &arm_cpu->isar;
     dc->condjmp = 0;
+    dc->ind_kind = TB_IND_JUMP;
 
     dc->aarch64 = 1;
     /* If we are coming from secure EL0 in a system with a 32-bit EL3, then
@@ -15629,7 +15633,9 @@ static void aarch64_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
             gen_a64_set_pc_im(dc->base.pc_next);
             /* fall through */
         case DISAS_JUMP:
-            tcg_gen_lookup_and_goto_ptr();
+            /* BTYPE and (for Morello) PCC may change, check all state. */
+            tcg_gen_lookup_and_goto_ptr_ic(dc->base.tb, NULL,
+                                           dc->ind_kind | TB_IND_FULL_STATE);
             break;
         case DISAS_NORETURN:
         case DISAS_SWI:
@@ -340,7 +340,11 @@ static inline __attribute__((always_inline)) bool load_store_implementation(
     }
 
     // Just special casing capabilities for now until we get better TCG handling
-    // for caps
+    // for caps. Capability loads/stores (including pairs, exclusives and swap)
+    // deliberately stay helper-only: the helpers own the tag memory accesses
+    // and the fault ordering. The only inline capability fast path is the
+    // register move in CLRTAG_CPY. Use contrib/plugins/howvec ("Cap ..."
+    // classes) to see how often these are executed before inlining more.
     if (size == 4 && !vector) {
         uint32_t base_reg = capability_base ? rn
                                             : (pcc_base ? CHERI_EXC_REGNUM_PCC
@@ -1163,6 +1167,8 @@ TRANS_F(BLR_BR_RET_CHKD)
         tcg_temp_free_i32(target_regnum);
         tcg_temp_free_i32(link_regnum);
 
+        ctx->ind_kind = a->opc == 0b01 ? TB_IND_CALL :
+                        a->opc == 0b10 ? TB_IND_RETURN : TB_IND_JUMP;
         ctx->base.is_jmp = DISAS_JUMP;
     }
 
@@ -1192,6 +1198,7 @@ TRANS_F(BR_BLR)
     tcg_temp_free(link_addr);
     tcg_temp_free_i32(flags);
 
+    ctx->ind_kind = a->link ? TB_IND_CALL : TB_IND_JUMP;
     ctx->base.is_jmp = DISAS_JUMP;
 
     return true;
@@ -1228,6 +1235,7 @@ TRANS_F(BRS)
     tcg_temp_free_i32(linkreg);
     tcg_temp_free_i64(link_addr);
 
+    ctx->ind_kind = link ? TB_IND_CALL : TB_IND_JUMP;
     ctx->base.is_jmp = DISAS_JUMP;
 
     return true;
@@ -1448,9 +1456,13 @@ TRANS_F(CLRTAG_CPY)
     if (capabilities_enabled_exception(ctx))
         return true;
 
-    gen_move_cap_gp_gp(ctx, a->Cd, a->Cn);
-    if (!(a->opc))
+    if (a->opc) {
+        // A plain copy does not need the decompressed fields
+        gen_move_cap_gp_gp_lazy(ctx, a->Cd, a->Cn);
+    } else {
+        gen_move_cap_gp_gp(ctx, a->Cd, a->Cn);
         gen_cap_clear_tag(ctx, a->Cd);
+    }
 
     gen_reg_modified_cap(ctx, a->Cd);
 
@@ -1661,6 +1673,7 @@ TRANS_F(LDPBR)
     tcg_temp_free_i32(pair_regnum);
     tcg_temp_free_i32(link_regnum);
 
+    ctx->ind_kind = link ? TB_IND_CALL : TB_IND_JUMP;
     ctx->base.is_jmp = DISAS_JUMP;
 
     return true;
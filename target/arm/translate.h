@@ -100,6 +100,8 @@ typedef struct DisasContext {
     int c15_cpar;
     /* TCG op of the current insn_start.  */
     TCGOp *insn_start;
+    /* TB_IND_* kind of a DISAS_JUMP exit (A64 only) */
+    unsigned ind_kind;
 #define TMP_A64_MAX 16
     int tmp_a64_count;
     TCGv_i64 tmp_a64[TMP_A64_MAX];
@@ -46,7 +46,7 @@ extern bool cheri_debugger_on_unrepresentable;
 static inline void
 _became_unrepresentable(CPUArchState *env, uint16_t reg, uintptr_t retpc)
 {
-    env->statcounters_unrepresentable_caps++;
+    cheri_statcounter_inc(env, UNREPRESENTABLE_CAPS);
 #ifdef TARGET_MIPS
     if (cheri_debugger_on_unrepresentable)
         do_raise_exception(env, EXCP_DEBUG, retpc);
@@ -0,0 +1,97 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#pragma once
+#ifdef TARGET_CHERI
+
+// This needs to be a separate header so that cpu.h can include it.
+
+/*
+ * Per-vCPU event counters that are shared by all CHERI targets.
+ * They are exposed to the guest via the architecture-specific statcounters
+ * interfaces (RDHWR on MIPS, the hpmcounter CSRs on RISC-V and PMU events
+ * on Morello) and can be inspected from the monitor with
+ * "info statcounters" or the query-cheri-statcounters QMP command.
+ *
+ * The order of this enum is not guest-visible, each target maps counters
+ * to its guest interface with an explicit table.
+ */
+typedef enum CheriStatcounter {
+    /* Guest TLB refills (MIPS only, the other targets walk page tables) */
+    CHERI_STATCOUNTER_ITLB_MISS,
+    CHERI_STATCOUNTER_DTLB_MISS,
+    /*
+     * QEMU softmmu TLB misses. These depend on the softmmu TLB size and
+     * flushes, not on the guest.
+     */
+    CHERI_STATCOUNTER_SOFTMMU_ITLB_MISS,
+    CHERI_STATCOUNTER_SOFTMMU_DTLB_MISS,
+    CHERI_STATCOUNTER_CAP_READ,
+    CHERI_STATCOUNTER_CAP_READ_TAGGED,
+    CHERI_STATCOUNTER_CAP_WRITE,
+    CHERI_STATCOUNTER_CAP_WRITE_TAGGED,
+    CHERI_STATCOUNTER_IMPRECISE_SETBOUNDS,
+    CHERI_STATCOUNTER_UNREPRESENTABLE_CAPS,
+    CHERI_STATCOUNTER_TAG_GET_MANY,
+    CHERI_STATCOUNTER_TAG_SET_MANY,
+    CHERI_STATCOUNTER_EXCEPTIONS,
+    CHERI_STATCOUNTER_TB_TRANSLATIONS,
+    /* Hardware page table walks (currently RISC-V only) */
+    CHERI_STATCOUNTER_PAGE_WALKS,
+    CHERI_STATCOUNTER_PAGE_WALK_CACHE_HITS,
+    CHERI_STATCOUNTER_PAGE_WALK_PTE_LOADS,
+    CHERI_STATCOUNTER_NUM
+} CheriStatcounter;
+
+/* Exceptions are also counted by (target-specific) exception_index. */
+#define CHERI_STATCOUNTERS_NUM_EXCP_CAUSES 64
+
+/*
+ * Note: this is embedded in the per-vCPU CPUArchState, so there is no sharing
+ * of counter cache lines between vCPUs. We don't use QEMU_ALIGNED(64) since
+ * the CPU objects are allocated with g_malloc() which does not guarantee it.
+ */
+typedef struct CheriStatcounters {
+    uint64_t counters[CHERI_STATCOUNTER_NUM];
+    uint64_t exceptions_by_cause[CHERI_STATCOUNTERS_NUM_EXCP_CAUSES];
+} CheriStatcounters;
+
+#define cheri_statcounter_inc(env, name)                                       \
+    ((env)->statcounters.counters[CHERI_STATCOUNTER_##name]++)
+
+static inline void cheri_statcounter_count_exception(CheriStatcounters *sc,
+                                                     int exception_index)
+{
+    sc->counters[CHERI_STATCOUNTER_EXCEPTIONS]++;
+    if (exception_index >= 0 &&
+        exception_index < CHERI_STATCOUNTERS_NUM_EXCP_CAUSES) {
+        sc->exceptions_by_cause[exception_index]++;
+    }
+}
+
+extern const char *const cheri_statcounter_names[CHERI_STATCOUNTER_NUM];
+
+void cheri_statcounters_reset(CheriStatcounters *sc);
+
+#endif /* TARGET_CHERI */
@@ -37,6 +37,7 @@
 #include "cheri-lazy-capregs-types.h"
 #include "tcg-target.h"
 #include "exec/log_instr.h"
+#include "exec/log_instr_fast.h"
 
 #ifdef TARGET_CHERI
 
@@ -760,6 +761,18 @@ static inline void disas_capreg_state_remove(DisasContext *ctx, int reg,
 #endif
 }
 
+// Copy the static state of one register to another
+static inline void disas_capreg_state_copy(DisasContext *ctx, int dest,
+                                           int source)
+{
+#ifdef ENABLE_STATIC_CAP_OPTS
+    if (lazy_capreg_number_is_special(dest))
+        return;
+    ctx->base.cap_compression_states[dest] =
+        ctx->base.cap_compression_states[source];
+#endif
+}
+
 // Decompress only if not fully decompressed
 static inline void gen_conditional_cap_decompress(DisasContext *ctx, int regnum)
 {
@@ -862,7 +875,8 @@ static inline void gen_reg_modified_cap(DisasContext *ctx, int regnum)
 static inline void gen_reg_modified_int_base(DisasContext *ctx,
                                              const char *str_name, TCGv new_val)
 {
-    if (qemu_ctx_logging_enabled(ctx)) {
+    if (qemu_ctx_logging_enabled(ctx) &&
+        !gen_log_instr_fast_reg(str_name, new_val)) {
         TCGv_ptr name = tcg_const_ptr(str_name);
         gen_helper_qemu_log_instr_reg(cpu_env, name, new_val);
         tcg_temp_free_ptr(name);
@@ -1030,9 +1044,9 @@ static inline void gen_move_cap_sp_gp(DisasContext *ctx, uint32_t dest_off,
     gen_move_cap(dest_off, gp_register_offset(source_num));
 }
 
-// TODO Its probably only worth doing the whole move if decompressed. If
-// compressed just copy pesbt. Move a GP register to a GP register. Currently
-// decompresses before move.
+// Move a GP register to a GP register. Decompresses before move so the
+// destination can be modified field by field. See gen_move_cap_gp_gp_lazy for
+// a move that keeps a compressed source compressed.
 static inline void gen_move_cap_gp_gp(DisasContext *ctx, int dest_num,
                                       int source_num)
 {
@@ -1049,6 +1063,60 @@ static inline void gen_move_cap_gp_gp(DisasContext *ctx, int dest_num,
     disas_capreg_state_set(ctx, dest_num, CREG_FULLY_DECOMPRESSED);
 }
 
+// Move a GP register to a GP register without forcing a decompression. If the
+// source is still compressed, only pesbt, cursor and the lazy state are
+// copied and the destination stays compressed. Only use this if the
+// destination is not then modified as a decompressed capability.
+static inline void gen_move_cap_gp_gp_lazy(DisasContext *ctx, int dest_num,
+                                           int source_num)
+{
+    if (dest_num == NULL_CAPREG_INDEX || dest_num == source_num)
+        return;
+    // Special registers are always decompressed, so can never hold a
+    // compressed value.
+    if (lazy_capreg_number_is_special(dest_num) ||
+        lazy_capreg_number_is_special(source_num) ||
+        disas_capreg_state_must_be(ctx, source_num,
+                                   CREG_FULLY_DECOMPRESSED)) {
+        gen_move_cap_gp_gp(ctx, dest_num, source_num);
+        return;
+    }
+
+    cheri_tcg_printf_verbose("cc", "Lazy move to %d from %d\n", dest_num,
+                             source_num);
+    gen_cap_sync_cursor(ctx, source_num);
+
+    uint32_t dest_off = gp_register_offset(dest_num);
+    uint32_t source_off = gp_register_offset(source_num);
+    TCGLabel *l_done = NULL;
+    TCGLabel *l_full = NULL;
+    TCGv_i32 state = tcg_temp_local_new_i32();
+    gen_lazy_cap_get_state_i32(ctx, source_num, state);
+    if (disas_capreg_state_could_be(ctx, source_num,
+                                    CREG_FULLY_DECOMPRESSED)) {
+        l_done = gen_new_label();
+        l_full = gen_new_label();
+        tcg_gen_brcondi_i32(TCG_COND_EQ, state, CREG_FULLY_DECOMPRESSED,
+                            l_full);
+    }
+
+    // Compressed: pesbt + cursor + lazy state is the whole value
+    gen_move_compressed_cap(dest_off, source_off);
+    tcg_gen_st8_i32(state, cpu_env,
+                    dest_off + offsetof(cap_register_t, cr_extra));
+
+    if (l_full) {
+        tcg_gen_br(l_done);
+        gen_set_label(l_full);
+        gen_move_cap(dest_off, source_off);
+        gen_set_label(l_done);
+    }
+    tcg_temp_free_i32(state);
+
+    gen_cap_invalidate_cursor(ctx, dest_num);
+    disas_capreg_state_copy(ctx, dest_num, source_num);
+}
+
 // Does GP register file operation of dest_reg = (value cond 0) ? true_reg :
 // false_reg
 static inline void gen_move_cap_gp_select_gp(DisasContext *ctx, int dest_num,
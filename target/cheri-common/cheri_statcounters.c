@@ -0,0 +1,125 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "qemu/osdep.h"
+#include "cpu.h"
+#include "cheri-statcounters.h"
+#include "hw/core/cpu.h"
+#include "monitor/monitor.h"
+#include "monitor/hmp-target.h"
+#ifndef CONFIG_USER_ONLY
+#include "qapi/qapi-commands-misc-target.h"
+#endif
+
+const char *const cheri_statcounter_names[CHERI_STATCOUNTER_NUM] = {
+    [CHERI_STATCOUNTER_ITLB_MISS] = "itlb_miss",
+    [CHERI_STATCOUNTER_DTLB_MISS] = "dtlb_miss",
+    [CHERI_STATCOUNTER_SOFTMMU_ITLB_MISS] = "softmmu_itlb_miss",
+    [CHERI_STATCOUNTER_SOFTMMU_DTLB_MISS] = "softmmu_dtlb_miss",
+    [CHERI_STATCOUNTER_CAP_READ] = "cap_read",
+    [CHERI_STATCOUNTER_CAP_READ_TAGGED] = "cap_read_tagged",
+    [CHERI_STATCOUNTER_CAP_WRITE] = "cap_write",
+    [CHERI_STATCOUNTER_CAP_WRITE_TAGGED] = "cap_write_tagged",
+    [CHERI_STATCOUNTER_IMPRECISE_SETBOUNDS] = "imprecise_setbounds",
+    [CHERI_STATCOUNTER_UNREPRESENTABLE_CAPS] = "unrepresentable_caps",
+    [CHERI_STATCOUNTER_TAG_GET_MANY] = "tag_get_many",
+    [CHERI_STATCOUNTER_TAG_SET_MANY] = "tag_set_many",
+    [CHERI_STATCOUNTER_EXCEPTIONS] = "exceptions",
+    [CHERI_STATCOUNTER_TB_TRANSLATIONS] = "tb_translations",
+    [CHERI_STATCOUNTER_PAGE_WALKS] = "page_walks",
+    [CHERI_STATCOUNTER_PAGE_WALK_CACHE_HITS] = "page_walk_cache_hits",
+    [CHERI_STATCOUNTER_PAGE_WALK_PTE_LOADS] = "page_walk_pte_loads",
+};
+
+void cheri_statcounters_reset(CheriStatcounters *sc)
+{
+    memset(sc, 0, sizeof(*sc));
+}
+
+#ifndef CONFIG_USER_ONLY
+void hmp_info_statcounters(Monitor *mon, const QDict *qdict)
+{
+    CPUState *cs;
+
+    CPU_FOREACH(cs) {
+        CPUArchState *env = cs->env_ptr;
+        /* Take a snapshot so that we print a consistent set of values. */
+        CheriStatcounters snapshot = env->statcounters;
+
+        monitor_printf(mon, "CPU#%d:\n", cs->cpu_index);
+        for (unsigned i = 0; i < CHERI_STATCOUNTER_NUM; i++) {
+            monitor_printf(mon, "  %-24s %" PRIu64 "\n",
+                           cheri_statcounter_names[i], snapshot.counters[i]);
+        }
+        for (unsigned i = 0; i < CHERI_STATCOUNTERS_NUM_EXCP_CAUSES; i++) {
+            if (snapshot.exceptions_by_cause[i]) {
+                monitor_printf(mon, "  exception[%-2u]            %" PRIu64 "\n",
+                               i, snapshot.exceptions_by_cause[i]);
+            }
+        }
+    }
+}
+
+CheriCpuStatcountersList *qmp_query_cheri_statcounters(Error **errp)
+{
+    CheriCpuStatcountersList *head = NULL, **tail = &head;
+    CPUState *cs;
+
+    CPU_FOREACH(cs) {
+        CPUArchState *env = cs->env_ptr;
+        CheriStatcounters snapshot = env->statcounters;
+        CheriCpuStatcounters *info = g_new0(CheriCpuStatcounters, 1);
+        CheriStatcounterValueList **ctail = &info->counters;
+        CheriExceptionCountList **etail = &info->exceptions;
+
+        info->cpu_index = cs->cpu_index;
+        for (unsigned i = 0; i < CHERI_STATCOUNTER_NUM; i++) {
+            CheriStatcounterValue *value = g_new0(CheriStatcounterValue, 1);
+
+            value->name = g_strdup(cheri_statcounter_names[i]);
+            value->value = snapshot.counters[i];
+            *ctail = g_new0(CheriStatcounterValueList, 1);
+            (*ctail)->value = value;
+            ctail = &(*ctail)->next;
+        }
+        for (unsigned i = 0; i < CHERI_STATCOUNTERS_NUM_EXCP_CAUSES; i++) {
+            CheriExceptionCount *count;
+
+            if (!snapshot.exceptions_by_cause[i]) {
+                continue;
+            }
+            count = g_new0(CheriExceptionCount, 1);
+            count->cause = i;
+            count->count = snapshot.exceptions_by_cause[i];
+            *etail = g_new0(CheriExceptionCountList, 1);
+            (*etail)->value = count;
+            etail = &(*etail)->next;
+        }
+        *tail = g_new0(CheriCpuStatcountersList, 1);
+        (*tail)->value = info;
+        tail = &(*tail)->next;
+    }
+    return head;
+}
+#endif
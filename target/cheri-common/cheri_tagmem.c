@@ -196,27 +196,68 @@ tagblock_set_tag_tagmem(void *tagmem, size_t block_index)
     qatomic_or(p, BIT_MASK(block_index));
 }
 
+/* Replace the bits selected by @p mask in @p p with @p bits. */
 static inline QEMU_ALWAYS_INLINE void
-tagblock_set_tag_many_tagmem(void *tagmem, size_t block_index, uint8_t tags)
+tagblock_update_word(unsigned long *p, unsigned long mask, unsigned long bits)
 {
-    unsigned long *p = (unsigned long *)tagmem + BIT_WORD(block_index);
-    size_t shift = block_index % BITS_PER_LONG;
-    unsigned long mask = CAP_TAG_GET_MANY_MASK << shift;
-    unsigned long tags_shifted = ((unsigned long)tags << shift) & mask;
-
-    if (likely(tags_shifted == 0)) {
+    if (likely(bits == 0)) {
         qatomic_and(p, ~mask);
     } else {
         unsigned long old, new, cmp;
         cmp = qatomic_read(p);
         do {
             old = cmp;
-            new = (old & ~mask) | tags_shifted;
+            new = (old & ~mask) | bits;
             cmp = qatomic_cmpxchg(p, old, new);
         } while (cmp != old);
     }
 }
 
+static inline QEMU_ALWAYS_INLINE void
+tagblock_set_tag_many_tagmem(void *tagmem, size_t block_index, uint8_t tags)
+{
+    unsigned long *p = (unsigned long *)tagmem + BIT_WORD(block_index);
+    size_t shift = block_index % BITS_PER_LONG;
+    unsigned long mask = CAP_TAG_GET_MANY_MASK << shift;
+    unsigned long tags_shifted = ((unsigned long)tags << shift) & mask;
+
+    tagblock_update_word(p, mask, tags_shifted);
+}
+
+/*
+ * Read @p nbits (at most BITS_PER_LONG) tags starting at @p index. Unlike
+ * tagblock_get_tag_many_tagmem() the range need not be aligned and may span
+ * two bitmap words.
+ */
+static inline unsigned long tagblock_get_bits_tagmem(void *tagmem, size_t index,
+                                                     size_t nbits)
+{
+    unsigned long *p = (unsigned long *)tagmem + BIT_WORD(index);
+    size_t shift = index % BITS_PER_LONG;
+    unsigned long word = qatomic_read(p) >> shift;
+
+    if (shift && shift + nbits > BITS_PER_LONG) {
+        word |= qatomic_read(p + 1) << (BITS_PER_LONG - shift);
+    }
+    return nbits == BITS_PER_LONG ? word : word & ((1UL << nbits) - 1);
+}
+
+static inline void tagblock_set_bits_tagmem(void *tagmem, size_t index,
+                                            size_t nbits, unsigned long bits)
+{
+    while (nbits) {
+        unsigned long *p = (unsigned long *)tagmem + BIT_WORD(index);
+        size_t shift = index % BITS_PER_LONG;
+        size_t n = MIN(nbits, BITS_PER_LONG - shift);
+        unsigned long mask = BITMAP_LAST_WORD_MASK(n) << shift;
+
+        tagblock_update_word(p, mask, (bits << shift) & mask);
+        bits = n == BITS_PER_LONG ? 0 : bits >> n;
+        index += n;
+        nbits -= n;
+    }
+}
+
 static inline QEMU_ALWAYS_INLINE void tagblock_clear_tag_tagmem(void *tagmem,
                                                                 size_t index)
 {
@@ -500,6 +541,81 @@ void cheri_tag_phys_invalidate(CPUArchState *env, RAMBlock *ram,
     }
 }
 
+void cheri_tag_phys_invalidate_all(RAMBlock *ram)
+{
+    if (!ram->cheri_tags) {
+        return;
+    }
+    // Only visit the tag blocks that have been allocated, most of them will
+    // still be NULL for sparsely used memory.
+    CheriTagBlock **tagmem = (CheriTagBlock **)ram->cheri_tags;
+    for (size_t i = 0; i < num_tagblocks(ram); i++) {
+        CheriTagBlock *tagblk = qatomic_read(&tagmem[i]);
+        if (tagblk) {
+            bitmap_zero(tagblk->tag_bitmap, CAP_TAGBLK_SIZE);
+        }
+    }
+}
+
+#ifndef CONFIG_USER_ONLY
+int cheri_tag_get_many_debug(CPUState *cpu, target_ulong vaddr,
+                             target_ulong len, uint8_t *tags)
+{
+    cheri_debug_assert(QEMU_IS_ALIGNED(vaddr, CHERI_CAP_SIZE));
+    cheri_debug_assert(QEMU_IS_ALIGNED(len, CHERI_CAP_SIZE));
+    size_t tag_bit = 0;
+
+    memset(tags, 0, DIV_ROUND_UP(len / CHERI_CAP_SIZE, BITS_PER_BYTE));
+    while (len > 0) {
+        MemTxAttrs attrs;
+        target_ulong page = vaddr & TARGET_PAGE_MASK;
+        target_ulong l = MIN(page + TARGET_PAGE_SIZE - vaddr, len);
+        hwaddr phys_addr = cpu_get_phys_page_attrs_debug(cpu, page, &attrs);
+        if (phys_addr == -1) {
+            return -1;
+        }
+        phys_addr += vaddr & ~TARGET_PAGE_MASK;
+
+        WITH_RCU_READ_LOCK_GUARD() {
+            int asidx = cpu_asidx_from_attrs(cpu, attrs);
+            // The page may be split across several memory regions, translate
+            // and read each part instead of leaving the bits past the first
+            // region at zero.
+            for (target_ulong done = 0; done < l;) {
+                hwaddr xlat, plen = l - done;
+                MemoryRegion *mr = address_space_translate(
+                    cpu->cpu_ases[asidx].as, phys_addr + done, &xlat, &plen,
+                    false, attrs);
+                RAMBlock *ram = memory_region_is_ram(mr) ? mr->ram_block : NULL;
+                size_t bit = tag_bit + done / CHERI_CAP_SIZE;
+                // Memory without tag storage (or an unallocated tag block)
+                // simply reads as untagged, as does a capability straddling
+                // two regions.
+                if (ram && ram->cheri_tags &&
+                    QEMU_IS_ALIGNED(xlat, CHERI_CAP_SIZE)) {
+                    uint64_t tag = xlat / CHERI_CAP_SIZE;
+                    for (size_t i = 0; i < plen / CHERI_CAP_SIZE; i++) {
+                        CheriTagBlock *tagblk = cheri_tag_block(tag + i, ram);
+                        if (tagblock_get_tag(tagblk, CAP_TAGBLK_IDX(tag + i))) {
+                            tags[(bit + i) / BITS_PER_BYTE] |=
+                                1 << ((bit + i) % BITS_PER_BYTE);
+                        }
+                    }
+                }
+                if (plen == 0) {
+                    break; // The rest stays zeroed by the memset() above
+                }
+                done += QEMU_ALIGN_UP(plen, CHERI_CAP_SIZE);
+            }
+        }
+        tag_bit += l / CHERI_CAP_SIZE;
+        vaddr += l;
+        len -= l;
+    }
+    return 0;
+}
+#endif
+
 /*
  * TODO: Basically nothing uses this physical address. Tag set probably should
  * not have to return it.
@@ -620,6 +736,7 @@ int cheri_tag_get_many(CPUArchState *env, target_ulong vaddr, int reg,
         hwaddr *ret_paddr, uintptr_t pc)
 {
 
+    cheri_statcounter_inc(env, TAG_GET_MANY);
     const int mmu_idx = cpu_mmu_index(env, false);
     probe_read(env, vaddr, CAP_TAG_MANY_DATA_SIZE, mmu_idx, pc);
     handle_paddr_return(read);
@@ -647,6 +764,7 @@ void cheri_tag_set_many(CPUArchState *env, uint32_t tags, target_ulong vaddr,
 {
     tags &= CAP_TAG_GET_MANY_MASK;
 
+    cheri_statcounter_inc(env, TAG_SET_MANY);
     const int mmu_idx = cpu_mmu_index(env, false);
     store_capcause_reg(env, reg);
     /*
@@ -685,3 +803,90 @@ void cheri_tag_set_many(CPUArchState *env, uint32_t tags, target_ulong vaddr,
 
     tagblock_set_tag_many_tagmem(tagmem, page_vaddr_to_tag_offset(vaddr), tags);
 }
+
+void cheri_tag_copy_page(CPUArchState *env, target_ulong dest_vaddr,
+                         target_ulong src_vaddr, size_t len, int reg,
+                         uintptr_t pc)
+{
+    const int mmu_idx = cpu_mmu_index(env, false);
+    const size_t ntags = len / CHERI_CAP_SIZE;
+    const size_t src_index = page_vaddr_to_tag_offset(src_vaddr);
+    const size_t dest_index = page_vaddr_to_tag_offset(dest_vaddr);
+    uintptr_t src_flags, dest_flags;
+    bool have_tags = false;
+
+    cheri_debug_assert(QEMU_IS_ALIGNED(src_vaddr, CHERI_CAP_SIZE));
+    cheri_debug_assert(QEMU_IS_ALIGNED(dest_vaddr, CHERI_CAP_SIZE));
+    cheri_debug_assert(QEMU_IS_ALIGNED(len, CHERI_CAP_SIZE) && len != 0);
+    cheri_debug_assert(-(src_vaddr | TARGET_PAGE_MASK) >= len);
+    cheri_debug_assert(-(dest_vaddr | TARGET_PAGE_MASK) >= len);
+
+    probe_read(env, src_vaddr, len, mmu_idx, pc);
+    void *src_tagmem = get_tagmem_from_iotlb_entry(env, src_vaddr, mmu_idx,
+                                                   /*write=*/false, &src_flags);
+    if (src_flags & TLBENTRYCAP_FLAG_TRAP_ANY) {
+        raise_load_tag_exception(env, src_vaddr, reg, pc);
+    }
+    if (src_tagmem != ALL_ZERO_TAGBLK &&
+        !(src_flags & TLBENTRYCAP_FLAG_CLEAR)) {
+        for (size_t i = 0; i < ntags; i += BITS_PER_LONG) {
+            size_t n = MIN(ntags - i, BITS_PER_LONG);
+            unsigned long bits =
+                tagblock_get_bits_tagmem(src_tagmem, src_index + i, n);
+            if (bits) {
+                if (src_flags & TLBENTRYCAP_FLAG_TRAP) {
+                    raise_load_tag_exception(
+                        env, src_vaddr + (i + ctzl(bits)) * CHERI_CAP_SIZE,
+                        reg, pc);
+                }
+                have_tags = true;
+                break;
+            }
+        }
+    }
+
+    /* As in cheri_tag_set_many(), only tagged stores may raise cap faults. */
+    store_capcause_reg(env, reg);
+    if (have_tags) {
+        probe_cap_write(env, dest_vaddr, len, mmu_idx, pc);
+    } else {
+        probe_write(env, dest_vaddr, len, mmu_idx, pc);
+    }
+    clear_capcause_reg(env);
+
+    void *dest_tagmem = get_tagmem_from_iotlb_entry(env, dest_vaddr, mmu_idx,
+                                                    /*write=*/true,
+                                                    &dest_flags);
+    if (dest_tagmem == ALL_ZERO_TAGBLK) {
+        /* Either no tags can be stored here or there are none to clear. */
+        cheri_debug_assert(!have_tags ||
+                           (dest_flags & TLBENTRYCAP_FLAG_CLEAR));
+        return;
+    }
+    cheri_debug_assert(!(dest_flags & TLBENTRYCAP_FLAG_TRAP));
+
+    qemu_maybe_log_instr_extra(env, "    Cap Tag Copy [" TARGET_FMT_lx
+        "] -> [" TARGET_FMT_lx "] %zu tags\n", src_vaddr, dest_vaddr, ntags);
+
+    if (!have_tags) {
+        tagblock_set_bits_tagmem(dest_tagmem, dest_index, ntags, 0);
+        return;
+    }
+    /* Copy one bitmap word at a time, backwards if the ranges may overlap. */
+    if (dest_vaddr > src_vaddr) {
+        for (size_t end = ntags; end > 0;) {
+            size_t n = MIN(end, BITS_PER_LONG);
+            end -= n;
+            tagblock_set_bits_tagmem(
+                dest_tagmem, dest_index + end, n,
+                tagblock_get_bits_tagmem(src_tagmem, src_index + end, n));
+        }
+    } else {
+        for (size_t i = 0; i < ntags; i += BITS_PER_LONG) {
+            size_t n = MIN(ntags - i, BITS_PER_LONG);
+            tagblock_set_bits_tagmem(
+                dest_tagmem, dest_index + i, n,
+                tagblock_get_bits_tagmem(src_tagmem, src_index + i, n));
+        }
+    }
+}
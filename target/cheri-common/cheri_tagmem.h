@@ -41,6 +41,8 @@
 void cheri_tag_phys_invalidate(CPUArchState *env, RAMBlock *ram,
                                ram_addr_t offset, size_t len,
                                const target_ulong *vaddr);
+/** Clear all tags in @p ram (only touches the allocated tag blocks). */
+void cheri_tag_phys_invalidate_all(RAMBlock *ram);
 void cheri_tag_init(MemoryRegion* mr, uint64_t memory_size);
 /**
  * Generic tag invalidation function to be called for a *single* data store:
@@ -72,6 +74,15 @@ int cheri_tag_get_many(CPUArchState *env, target_ulong vaddr, int reg,
                        hwaddr *ret_paddr, uintptr_t pc);
 void cheri_tag_set_many(CPUArchState *env, uint32_t tags, target_ulong vaddr,
                         int reg, hwaddr *ret_paddr, uintptr_t pc);
+/**
+ * Copy the tags of [@p src_vaddr, @p src_vaddr + @p len) to the granules at
+ * @p dest_vaddr with the semantics of a capability load/store loop, but one
+ * bitmap word at a time. Both ranges must be capability aligned and must not
+ * cross a page boundary. All faults are raised before any tag is modified.
+ */
+void cheri_tag_copy_page(CPUArchState *env, target_ulong dest_vaddr,
+                         target_ulong src_vaddr, size_t len, int reg,
+                         uintptr_t pc);
 
 /**
  * Update a tag for virtual address @vaddr.
@@ -80,6 +91,19 @@ void cheri_tag_set_many(CPUArchState *env, uint32_t tags, target_ulong vaddr,
 void *cheri_tag_set(CPUArchState *env, target_ulong vaddr, int reg,
                     hwaddr *ret_paddr, uintptr_t pc, int mmu_idx);
 
+#ifndef CONFIG_USER_ONLY
+/**
+ * Debugger access to the tags for [@p vaddr, @p vaddr + @p len). Unlike
+ * cheri_tag_get_many() this does not use the TLB and never raises a guest
+ * exception. One bit per capability is written to @p tags (LSB first), which
+ * must hold len / CHERI_CAP_SIZE bits. @p vaddr and @p len must be capability
+ * aligned.
+ * @return 0 on success, -1 if part of the range is not mapped.
+ */
+int cheri_tag_get_many_debug(CPUState *cpu, target_ulong vaddr,
+                             target_ulong len, uint8_t *tags);
+#endif
+
 void *cheri_tagmem_for_addr(CPUArchState *env, target_ulong vaddr,
                             RAMBlock *ram, ram_addr_t ram_offset, size_t size,
                             int *prot, bool tag_write);
@@ -979,7 +979,7 @@ static void do_setbounds(bool must_be_exact, CPUArchState *env, uint32_t cd,
      */
     const bool exact = CAP_cc(setbounds)(&result, new_base, new_top);
     if (!exact)
-        env->statcounters_imprecise_setbounds++;
+        cheri_statcounter_inc(env, IMPRECISE_SETBOUNDS);
     if (must_be_exact && !exact) {
         raise_cheri_exception_or_invalidate(env, CapEx_InexactBounds, cb);
     }
@@ -1292,9 +1292,9 @@ bool load_cap_from_memory_raw_tag_mmu_idx(
     if (tag)
         squash_mutable_permissions(env, pesbt, source);
 
-    env->statcounters_cap_read++;
+    cheri_statcounter_inc(env, CAP_READ);
     if (tag)
-        env->statcounters_cap_read_tagged++;
+        cheri_statcounter_inc(env, CAP_READ_TAGGED);
 
 #if defined(TARGET_RISCV) && defined(CONFIG_RVFI_DII)
     env->rvfi_dii_trace.MEM.rvfi_mem_addr = vaddr;
@@ -1391,10 +1391,10 @@ void store_cap_to_memory_mmu_index(CPUArchState *env, uint32_t cs,
      * tag logic, is not multi-TCG-thread safe.
      */
 
-    env->statcounters_cap_write++;
+    cheri_statcounter_inc(env, CAP_WRITE);
     void *host = NULL;
     if (tag) {
-        env->statcounters_cap_write_tagged++;
+        cheri_statcounter_inc(env, CAP_WRITE_TAGGED);
         host = cheri_tag_set(env, vaddr, cs, NULL, retpc, mmu_idx);
     } else {
         host = cheri_tag_invalidate_aligned(env, vaddr, retpc, mmu_idx);
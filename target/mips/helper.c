@@ -79,17 +79,129 @@ int fixed_mmu_map_address(CPUMIPSState *env, hwaddr *physical, int *prot,
 }
 
 /* MIPS32/MIPS64 R4000-style MMU emulation */
+/* TLB hash index */
+static inline unsigned r4k_tlb_hash(target_ulong vpn2)
+{
+    uint64_t key = vpn2 >> (TARGET_PAGE_BITS + 1);
+
+    return (key * 0x9e3779b97f4a7c15ULL) >> (64 - MIPS_TLB_HASH_BITS);
+}
+
+static void r4k_tlb_index_remove(CPUMIPSState *env, int idx)
+{
+    typeof(env->tlb->mmu.r4k) *r4k = &env->tlb->mmu.r4k;
+    int bucket = r4k->hash_bucket[idx];
+    int16_t *p;
+
+    if (bucket < 0) {
+        r4k->large_pages[idx / 64] &= ~(1ULL << (idx % 64));
+        return;
+    }
+    for (p = &r4k->hash_head[bucket]; *p != idx; p = &r4k->hash_next[*p]) {
+        assert(*p >= 0);
+    }
+    *p = r4k->hash_next[idx];
+}
+
+static void r4k_tlb_index_insert(CPUMIPSState *env, int idx)
+{
+    typeof(env->tlb->mmu.r4k) *r4k = &env->tlb->mmu.r4k;
+    r4k_tlb_t *tlb = &r4k->tlb[idx];
+    int bucket;
+
+    if (tlb->PageMask & (TARGET_PAGE_MASK << 1)) {
+        r4k->hash_bucket[idx] = -1;
+        r4k->large_pages[idx / 64] |= 1ULL << (idx % 64);
+        return;
+    }
+    bucket = r4k_tlb_hash(tlb->VPN & (TARGET_PAGE_MASK << 1));
+    r4k->hash_bucket[idx] = bucket;
+    r4k->hash_next[idx] = r4k->hash_head[bucket];
+    r4k->hash_head[bucket] = idx;
+}
+
+/* Must be called whenever the VPN or PageMask of a TLB slot changes. */
+void r4k_tlb_index_update(CPUMIPSState *env, int idx)
+{
+    r4k_tlb_index_remove(env, idx);
+    r4k_tlb_index_insert(env, idx);
+}
+
+void r4k_tlb_index_rebuild(CPUMIPSState *env)
+{
+    typeof(env->tlb->mmu.r4k) *r4k = &env->tlb->mmu.r4k;
+    int i;
+
+    memset(r4k->hash_head, -1, sizeof(r4k->hash_head));
+    memset(r4k->large_pages, 0, sizeof(r4k->large_pages));
+    for (i = 0; i < MIPS_TLB_MAX; i++) {
+        r4k_tlb_index_insert(env, i);
+    }
+}
+
+static inline bool r4k_tlb_match(CPUMIPSState *env, r4k_tlb_t *tlb,
+                                 target_ulong address, uint32_t MMID, bool mi)
+{
+    /* 1k pages are not supported. */
+    target_ulong mask = tlb->PageMask | ~(TARGET_PAGE_MASK << 1);
+    target_ulong tag = address & ~mask;
+    target_ulong VPN = tlb->VPN & ~mask;
+    uint32_t tlb_mmid = mi ? tlb->MMID : (uint32_t) tlb->ASID;
+
+#if defined(TARGET_MIPS64)
+    tag &= env->SEGMask;
+#endif
+    /* Check ASID/MMID, virtual page number & size */
+    return (tlb->G == 1 || tlb_mmid == MMID) && VPN == tag && !tlb->EHINV;
+}
+
+/*
+ * Return the lowest TLB slot below @limit matching @address in the
+ * current ASID/MMID, or -1. This is the entry a linear scan of the TLB
+ * would find, including when several entries match.
+ */
+static int r4k_tlb_find(CPUMIPSState *env, target_ulong address, int limit)
+{
+    typeof(env->tlb->mmu.r4k) *r4k = &env->tlb->mmu.r4k;
+    bool mi = !!((env->CP0_Config5 >> CP0C5_MI) & 1);
+    uint16_t ASID = env->CP0_EntryHi & env->CP0_EntryHi_ASID_mask;
+    uint32_t MMID = mi ? env->CP0_MemoryMapID : (uint32_t) ASID;
+    target_ulong vpn2 = address & (TARGET_PAGE_MASK << 1);
+    int best = limit;
+    int i, w;
+
+#if defined(TARGET_MIPS64)
+    vpn2 &= env->SEGMask;
+#endif
+    for (i = r4k->hash_head[r4k_tlb_hash(vpn2)]; i >= 0;
+         i = r4k->hash_next[i]) {
+        if (i < best && r4k_tlb_match(env, &r4k->tlb[i], address, MMID, mi)) {
+            best = i;
+        }
+    }
+    for (w = 0; w < ARRAY_SIZE(r4k->large_pages) && w * 64 < best; w++) {
+        uint64_t bits = r4k->large_pages[w];
+
+        while (bits) {
+            i = w * 64 + ctz64(bits);
+            if (i >= best) {
+                break;
+            }
+            if (r4k_tlb_match(env, &r4k->tlb[i], address, MMID, mi)) {
+                best = i;
+                break;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return best < limit ? best : -1;
+}
+
 int r4k_map_address(CPUMIPSState *env, hwaddr *physical, int *prot,
                     target_ulong address, int rw, int access_type)
 {
-    uint16_t ASID = env->CP0_EntryHi & env->CP0_EntryHi_ASID_mask;
-    uint32_t MMID = env->CP0_MemoryMapID;
-    bool mi = !!((env->CP0_Config5 >> CP0C5_MI) & 1);
-    uint32_t tlb_mmid;
     int i;
 
-    MMID = mi ? MMID : (uint32_t) ASID;
-
 #if defined(TARGET_CHERI)
     unsigned gclg_bit;
     if (address < 0x4000000000000000) {
@@ -111,87 +223,79 @@ int r4k_map_address(CPUMIPSState *env, hwaddr *physical, int *prot,
     bool gclg = !!(env->CP0_EntryHi & (1UL << gclg_bit));
 #endif
 
-    for (i = 0; i < env->tlb->tlb_in_use; i++) {
-        r4k_tlb_t *tlb = &env->tlb->mmu.r4k.tlb[i];
-        /* 1k pages are not supported. */
-        target_ulong mask = tlb->PageMask | ~(TARGET_PAGE_MASK << 1);
-        target_ulong tag = address & ~mask;
-        target_ulong VPN = tlb->VPN & ~mask;
-#if defined(TARGET_MIPS64)
-        tag &= env->SEGMask;
-#endif
+    i = r4k_tlb_find(env, address, env->tlb->tlb_in_use);
+    if (i < 0) {
+        return TLBRET_NOMATCH;
+    }
 
-        /* Check ASID/MMID, virtual page number & size */
-        tlb_mmid = mi ? tlb->MMID : (uint32_t) tlb->ASID;
-        if ((tlb->G == 1 || tlb_mmid == MMID) && VPN == tag && !tlb->EHINV) {
-            /* TLB match */
-            int n = !!(address & mask & ~(mask >> 1));
-            /* Check access rights */
-            if (!(n ? tlb->V1 : tlb->V0)) {
-                return TLBRET_INVALID;
-            }
+    /* TLB match */
+    r4k_tlb_t *tlb = &env->tlb->mmu.r4k.tlb[i];
+    /* 1k pages are not supported. */
+    target_ulong mask = tlb->PageMask | ~(TARGET_PAGE_MASK << 1);
+    int n = !!(address & mask & ~(mask >> 1));
+    /* Check access rights */
+    if (!(n ? tlb->V1 : tlb->V0)) {
+        return TLBRET_INVALID;
+    }
 #if defined(TARGET_CHERI)
-            if (rw == MMU_DATA_CAP_STORE) {
-                /*
-                 * If we're trying to do a cap-store, first check for the
-                 * dirty/store-permitted bit before looking at the the
-                 * store-capability inhibit.
-                 */
-                if (!(n ? tlb->D1 : tlb->D0)) {
-                    return TLBRET_DIRTY;
-                }
-                if (n ? tlb->S1 : tlb->S0) {
-                    return TLBRET_S;
-                }
-            }
+    if (rw == MMU_DATA_CAP_STORE) {
+        /*
+         * If we're trying to do a cap-store, first check for the
+         * dirty/store-permitted bit before looking at the the
+         * store-capability inhibit.
+         */
+        if (!(n ? tlb->D1 : tlb->D0)) {
+            return TLBRET_DIRTY;
+        }
+        if (n ? tlb->S1 : tlb->S0) {
+            return TLBRET_S;
+        }
+    }
 
-            if (n ? tlb->S1 : tlb->S0) {
-                *prot |= PAGE_SC_TRAP;
-            }
+    if (n ? tlb->S1 : tlb->S0) {
+        *prot |= PAGE_SC_TRAP;
+    }
 #else
-            if (rw == MMU_INST_FETCH && (n ? tlb->XI1 : tlb->XI0)) {
-                return TLBRET_XI;
-            }
-            if (rw == MMU_DATA_LOAD && (n ? tlb->RI1 : tlb->RI0)) {
-                return TLBRET_RI;
-            }
+    if (rw == MMU_INST_FETCH && (n ? tlb->XI1 : tlb->XI0)) {
+        return TLBRET_XI;
+    }
+    if (rw == MMU_DATA_LOAD && (n ? tlb->RI1 : tlb->RI0)) {
+        return TLBRET_RI;
+    }
 #endif /* TARGET_CHERI */
 
-            if (( (rw != MMU_DATA_STORE)
+    if (( (rw != MMU_DATA_STORE)
 #if defined(TARGET_CHERI)
-                  && (rw != MMU_DATA_CAP_STORE)
+          && (rw != MMU_DATA_CAP_STORE)
 #endif
-                ) || (n ? tlb->D1 : tlb->D0)) {
+        ) || (n ? tlb->D1 : tlb->D0)) {
 
-                *physical = tlb->PFN[n] | (address & (mask >> 1));
-                *prot = PAGE_READ;
-                if (n ? tlb->D1 : tlb->D0) {
-                    *prot |= PAGE_WRITE;
-                }
+        *physical = tlb->PFN[n] | (address & (mask >> 1));
+        *prot = PAGE_READ;
+        if (n ? tlb->D1 : tlb->D0) {
+            *prot |= PAGE_WRITE;
+        }
 #if !defined(TARGET_CHERI)
-                if (!(n ? tlb->XI1 : tlb->XI0)) {
+        if (!(n ? tlb->XI1 : tlb->XI0)) {
 #else
-                if (true) {
+        if (true) {
 #endif
-                    *prot |= PAGE_EXEC;
-                }
+            *prot |= PAGE_EXEC;
+        }
 
 #if defined(TARGET_CHERI)
-                if (n ? tlb->L1 : tlb->L0) {
-                    *prot |= PAGE_LC_CLEAR;
-                }
-                bool pclg = n ? tlb->CLG1 : tlb->CLG0;
-                if (pclg != gclg) {
-                    *prot |= PAGE_LC_TRAP;
-                }
+        if (n ? tlb->L1 : tlb->L0) {
+            *prot |= PAGE_LC_CLEAR;
+        }
+        bool pclg = n ? tlb->CLG1 : tlb->CLG0;
+        if (pclg != gclg) {
+            *prot |= PAGE_LC_TRAP;
+        }
 #endif
 
-                return TLBRET_MATCH;
-            }
-            return TLBRET_DIRTY;
-        }
+        return TLBRET_MATCH;
     }
-    return TLBRET_NOMATCH;
+    return TLBRET_DIRTY;
 }
 
 static int is_seg_am_mapped(unsigned int am, bool eu, int mmu_idx)
@@ -632,9 +736,9 @@ static void raise_mmu_exception(CPUMIPSState *env, target_ulong address,
     env->error_code = error_code;
 #ifdef TARGET_CHERI
     if (rw == MMU_INST_FETCH)
-        env->statcounters_itlb_miss++;
+        cheri_statcounter_inc(env, ITLB_MISS);
     else
-        env->statcounters_dtlb_miss++;
+        cheri_statcounter_inc(env, DTLB_MISS);
 #endif
 }
 
@@ -1220,6 +1324,9 @@ void mips_cpu_do_interrupt(CPUState *cs)
     MIPSCPU *cpu = MIPS_CPU(cs);
     CPUMIPSState *env = &cpu->env;
     tcg_debug_assert(pc_is_current(env));
+#ifdef CONFIG_TCG_LOG_INSTR
+    target_ulong log_epc = PC_ADDR(env);
+#endif
     bool update_badinstr = 0;
     target_ulong offset;
     int cause = -1;
@@ -1573,7 +1680,7 @@ void mips_cpu_do_interrupt(CPUState *cs)
             log_cause = cause;
 #endif
             qemu_log_instr_exception(env, log_cause, PC_ADDR(env),
-                                     env->CP0_BadVAddr);
+                                     env->CP0_BadVAddr, log_epc);
         }
 #ifdef TARGET_CHERI
         /* Log extra changed register information */
@@ -1624,37 +1731,15 @@ bool mips_cpu_exec_interrupt(CPUState *cs, int interrupt_request)
 #if !defined(CONFIG_USER_ONLY)
 bool r4k_lookup_tlb(CPUMIPSState *env, int *matching, bool use_extra)
 {
-    bool mi = !!((env->CP0_Config5 >> CP0C5_MI) & 1);
-    r4k_tlb_t *tlb;
-    target_ulong mask;
-    target_ulong tag;
-    target_ulong VPN;
-    uint16_t ASID = env->CP0_EntryHi & env->CP0_EntryHi_ASID_mask;
-    uint32_t MMID = env->CP0_MemoryMapID;
-    uint32_t tlb_mmid;
-    int i;
     int limit = (use_extra) ? env->tlb->tlb_in_use : env->tlb->nb_tlb;
+    int i = r4k_tlb_find(env, env->CP0_EntryHi, limit);
 
-    MMID = mi ? MMID : (uint32_t) ASID;
-    for (i = 0; i < limit; i++) {
-        tlb = &env->tlb->mmu.r4k.tlb[i];
-        /* 1k pages are not supported. */
-        mask = tlb->PageMask | ~(TARGET_PAGE_MASK << 1);
-        tag = env->CP0_EntryHi & ~mask;
-        VPN = tlb->VPN & ~mask;
-#if defined(TARGET_MIPS64)
-        tag &= env->SEGMask;
-#endif
-        tlb_mmid = mi ? tlb->MMID : (uint32_t) tlb->ASID;
-        /* Check ASID/MMID, virtual page number & size */
-        if ((tlb->G == 1 || tlb_mmid == MMID) && VPN == tag && !tlb->EHINV) {
-            if (matching)
-                *matching = i;
-            return true;
-        }
+    if (i < 0) {
+        return false;
     }
-
-    return false;
+    if (matching)
+        *matching = i;
+    return true;
 }
 
 void r4k_invalidate_tlb(CPUMIPSState *env, int idx, int use_extra)
@@ -1688,6 +1773,7 @@ void r4k_invalidate_tlb(CPUMIPSState *env, int idx, int use_extra)
          * tell that it's there.
          */
         env->tlb->mmu.r4k.tlb[env->tlb->tlb_in_use] = *tlb;
+        r4k_tlb_index_update(env, env->tlb->tlb_in_use);
         env->tlb->tlb_in_use++;
         return;
     }
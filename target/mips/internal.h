@@ -147,6 +147,18 @@ struct CPUMIPSTLBContext {
     union {
         struct {
             r4k_tlb_t tlb[MIPS_TLB_MAX];
+            /*
+             * Hash index of the TLB entries by VPN2, to avoid scanning the
+             * whole TLB on each refill of the qemu TLB. Only entries with
+             * the smallest page size are hashed, entries for larger pages
+             * are kept in the large_pages bitmap and always checked.
+             * Each slot is in exactly one of the two sets. The index is
+             * derived state and is rebuilt after migration.
+             */
+            int16_t hash_head[MIPS_TLB_HASH_SIZE];
+            int16_t hash_next[MIPS_TLB_MAX];
+            int16_t hash_bucket[MIPS_TLB_MAX];
+            uint64_t large_pages[MIPS_TLB_MAX / 64];
         } r4k;
     } mmu;
 };
@@ -165,6 +177,8 @@ void r4k_helper_tlbinv(CPUMIPSState *env);
 void r4k_helper_tlbinvf(CPUMIPSState *env);
 void r4k_invalidate_tlb(CPUMIPSState *env, int idx, int use_extra);
 bool r4k_lookup_tlb(CPUMIPSState *env, int *matching, bool use_extra);
+void r4k_tlb_index_update(CPUMIPSState *env, int idx);
+void r4k_tlb_index_rebuild(CPUMIPSState *env);
 uint32_t cpu_mips_get_random(CPUMIPSState *env);
 
 void mips_cpu_do_transaction_failed(CPUState *cs, hwaddr physaddr,
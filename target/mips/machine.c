@@ -12,6 +12,9 @@ static int cpu_post_load(void *opaque, int version_id)
     restore_msa_fp_status(env);
     compute_hflags(env);
     restore_pamask(env);
+    if (env->tlb->map_address == r4k_map_address) {
+        r4k_tlb_index_rebuild(env);
+    }
 
     return 0;
 }
@@ -9,6 +9,8 @@
 
 /* Real pages are variable size... */
 #define MIPS_TLB_MAX 128
+#define MIPS_TLB_HASH_BITS 8
+#define MIPS_TLB_HASH_SIZE (1 << MIPS_TLB_HASH_BITS)
 
 /*
  * bit definitions for insn_flags (ISAs/ASEs flags)
@@ -737,6 +737,7 @@ static void r4k_fill_tlb(CPUMIPSState *env, int idx)
     tlb->RI1 = (env->CP0_EntryLo1 >> CP0EnLo_RI) & 1;
 #endif /* TARGET_CHERI */
     tlb->PFN[1] = (get_tlb_pfn_from_entrylo(env->CP0_EntryLo1) & ~mask) << 12;
+    r4k_tlb_index_update(env, idx);
 }
 
 void r4k_helper_tlbinv(CPUMIPSState *env)
@@ -1918,6 +1919,62 @@ store_u32_and_clear_tag(CPUMIPSState *env, target_ulong vaddr, uint32_t val,
 #define CHECK_AND_ADD_DDC(env, perms, ptr, len, retpc) ptr
 #endif
 
+/*
+ * Copy @p len bytes that cross no page boundary in either buffer through the
+ * host mappings of both pages. If src and dest have the same alignment within
+ * a capability the tags of all whole capabilities are copied as a CLC/CSC loop
+ * would do, otherwise the destination tags are cleared.
+ * Returns false if either page is not backed by RAM, or if instruction logging
+ * is enabled: the byte-wise slow path then records every load and store.
+ */
+static bool magic_memmove_page(CPUMIPSState *env, target_ulong dest,
+                               target_ulong src, target_ulong len,
+                               int mmu_idx, uintptr_t ra)
+{
+    if (qemu_log_instr_enabled(env)) {
+        return false;
+    }
+    // These might trap, but $v0 already records the progress so far.
+    void *src_host = probe_read(env, src, len, mmu_idx, ra);
+    void *dest_host = probe_write(env, dest, len, mmu_idx, ra);
+    if (!src_host || !dest_host) {
+        return false;
+    }
+#ifdef TARGET_CHERI
+    const target_ulong first_cap = QEMU_ALIGN_UP(dest, CHERI_CAP_SIZE);
+    const target_ulong end_cap = QEMU_ALIGN_DOWN(dest + len, CHERI_CAP_SIZE);
+    const bool copy_tags = ((src ^ dest) & (CHERI_CAP_SIZE - 1)) == 0 &&
+        first_cap < end_cap;
+    // Any tag fault must be raised before we modify memory since the chunk
+    // is repeated on continuation and memmove() is not idempotent.
+    if (copy_tags) {
+        cheri_tag_copy_page(env, first_cap, src + (first_cap - dest),
+                            end_cap - first_cap, CHERI_EXC_REGNUM_DDC, ra);
+    }
+#endif
+    memmove(dest_host, src_host, len);
+#ifdef TARGET_CHERI
+    // Partially overwritten capabilities lose their tags
+    ram_addr_t ram_offset;
+    RAMBlock *block = qemu_ram_block_from_host(dest_host, false, &ram_offset);
+    if (!copy_tags) {
+        cheri_tag_phys_invalidate(env, block, ram_offset, len, &dest);
+    } else {
+        if (dest < first_cap) {
+            cheri_tag_phys_invalidate(env, block, ram_offset, first_cap - dest,
+                                      &dest);
+        }
+        if (end_cap < dest + len) {
+            cheri_tag_phys_invalidate(env, block, ram_offset + (end_cap - dest),
+                                      dest + len - end_cap, &end_cap);
+        }
+    }
+#endif
+    qemu_maybe_log_instr_extra(env, "%s: Copied " TARGET_FMT_lu " bytes from 0x"
+        TARGET_FMT_lx " to 0x" TARGET_FMT_lx "\n", __func__, len, src, dest);
+    return true;
+}
+
 static bool do_magic_memmove(CPUMIPSState *env, uint64_t ra, int dest_regnum, int src_regnum)
 {
     tcg_debug_assert(dest_regnum != src_regnum);
@@ -1965,110 +2022,41 @@ static bool do_magic_memmove(CPUMIPSState *env, uint64_t ra, int dest_regnum, in
     // Mark this as a continuation in $v1 (so that we continue sensibly if we get a tlb miss and longjump out)
     env->active_tc.gpr[MIPS_REGNUM_V1] = (MAGIC_LIBCALL_HELPER_CONTINUATION_FLAG << 32) | env->active_tc.gpr[3];
 
-    const target_ulong dest_past_end = original_dest + original_len;
-    const target_ulong src_past_end = original_src + original_len;
-#if 0 // FIXME: for some reason this causes errors
-    const bool dest_same_page = (original_dest & TARGET_PAGE_MASK) == ((dest_past_end - 1) & TARGET_PAGE_MASK);
-    const bool src_same_page = (original_dest & TARGET_PAGE_MASK) == ((dest_past_end - 1) & TARGET_PAGE_MASK);
-    // If neither src nor dest buffer cross a page boundary we can just do an address_space_read+write
-    // Fast case: less than a page and neither of the buffers crosses a page boundary
-    CPUState *cs = env_cpu(env);
-    if (dest_same_page && src_same_page) {
-        tcg_debug_assert(already_written == 0);
-        tcg_debug_assert(len <= TARGET_PAGE_SIZE);
-        // The translation operation might trap and longjump out!
-        hwaddr src_paddr = do_translate_address(env, original_src, MMU_DATA_LOAD, ra);
-        hwaddr dest_paddr = do_translate_address(env, original_dest, MMU_DATA_STORE, ra);
-        // Do a single load+store to update the MMU flags
-        // uint8_t first_value = helper_ret_ldub_mmu(env, original_src, oi, ra);
-        // Note: address_space_write will also clear the tag bits!
-        MemTxResult result = MEMTX_ERROR;
-        uint8_t buffer[TARGET_PAGE_SIZE];
-        result = address_space_read(cs->as, src_paddr, MEMTXATTRS_UNSPECIFIED, buffer, len);
-        if (result != MEMTX_OK) {
-            warn_report("magic memmove: error reading %d bytes from paddr %"HWADDR_PRIx
-                        ". Unmapped memory? Error code was %d\r", (int)len, src_paddr, result);
-            // same ignored error would happen with normal loads/stores -> just continue
-        }
-        fprintf(stderr, "Used fast path to read %d bytes\r\n", (int)len);
-        // do_hexdump(stderr, buffer, len, original_src);
-        // fprintf(stderr, "\r");
-        // also write one byte to the target buffer to ensure that the flags are updated
-        // store_byte_and_clear_tag(env, original_dest, first_value, oi, ra); // might trap
-        result = address_space_write(cs->as, dest_paddr, MEMTXATTRS_UNSPECIFIED, buffer, len);
-#ifdef CONFIG_TCG_LOG_INSTR
-        if (qemu_log_instr_enabled(env)) {
-            for (int i = 0; i < len; i++) {
-                helper_qemu_log_instr_load64(env, original_src + i, buffer[i], MO_8);
-                helper_qemu_log_instr_store64(env, original_dest + i, buffer[i], MO_8);
-            }
-        }
-#endif
-        if (result != MEMTX_OK) {
-            warn_report("magic memmove: error writing %d bytes to paddr %"HWADDR_PRIx
-                        ". Unmapped memory? Error code was %d\r", (int)len, dest_paddr, result);
-            // same ignored error would happen with normal loads/stores -> just continue
-        }
-        already_written += len;
-        env->active_tc.gpr[MIPS_REGNUM_V0] = already_written;
-        goto success;
-    }
-#endif
-
-    const bool has_overlap = MAX(original_dest, original_src) >= MAX(dest_past_end, src_past_end);
-    if (has_overlap) {
-        warn_report("Found multipage magic memmove with overlap: dst=" TARGET_FMT_plx " src=" TARGET_FMT_plx
-                    " len=0x" TARGET_FMT_lx "\r", original_dest, original_src, original_len);
-        // slow path: byte copies
-    }
-
+    // If dest overlaps the end of src we have to start copying at the end.
+    // $v0 counts the bytes copied so far from whichever end we started at.
     const bool copy_backwards = original_src < original_dest;
-    if (copy_backwards) {
-        target_ulong current_dest_cursor = original_dest + len - 1;
-        target_ulong current_src_cursor = original_src + len - 1;
-        /* Slow path (probably attempt to do this to an I/O device or
-         * similar, or clearing of a block of code we have translations
-         * cached for). Just do a series of byte writes as the architecture
-         * demands. It's not worth trying to use a cpu_physical_memory_map(),
-         * memset(), unmap() sequence here because:
-         *  + we'd need to account for the blocksize being larger than a page
-         *  + the direct-RAM access case is almost always going to be dealt
-         *    with in the fastpath code above, so there's no speed benefit
-         *  + we would have to deal with the map returning NULL because the
-         *    bounce buffer was in use
-         */
-        tcg_debug_assert(original_len - already_written == len);
-        collect_magic_nop_stats(env, &magic_memmove_slowpath, len);
-        while (already_written < original_len) {
-            uint8_t value = helper_ret_ldub_mmu(env, current_src_cursor, oi, ra);
-            store_byte_and_clear_tag(env, current_dest_cursor, value, oi, ra); // might trap
-             current_dest_cursor--;
-            current_src_cursor--;
-            already_written++;
+    tcg_debug_assert(original_len - already_written == len);
+    while (already_written < original_len) {
+        const target_ulong remaining = original_len - already_written;
+        target_ulong src, dest, chunk;
+        // Split the copy into chunks that cross no page boundary in either buffer
+        if (copy_backwards) {
+            const target_ulong src_end = original_src + remaining;
+            const target_ulong dest_end = original_dest + remaining;
+            chunk = MIN(remaining, MIN(((src_end - 1) & ~TARGET_PAGE_MASK) + 1,
+                                       ((dest_end - 1) & ~TARGET_PAGE_MASK) + 1));
+            src = src_end - chunk;
+            dest = dest_end - chunk;
+        } else {
+            src = original_src + already_written;
+            dest = original_dest + already_written;
+            chunk = MIN(remaining, MIN(-(src | TARGET_PAGE_MASK),
+                                       -(dest | TARGET_PAGE_MASK)));
+        }
+        if (magic_memmove_page(env, dest, src, chunk, mmu_idx, ra)) {
+            already_written += chunk;
             env->active_tc.gpr[MIPS_REGNUM_V0] = already_written;
+            continue;
         }
-    } else {
-        // copy forwards
-        target_ulong current_dest_cursor = original_dest + already_written;
-        target_ulong current_src_cursor = original_src + already_written;
         /* Slow path (probably attempt to do this to an I/O device or
-         * similar, or clearing of a block of code we have translations
-         * cached for). Just do a series of byte writes as the architecture
-         * demands. It's not worth trying to use a cpu_physical_memory_map(),
-         * memset(), unmap() sequence here because:
-         *  + we'd need to account for the blocksize being larger than a page
-         *  + the direct-RAM access case is almost always going to be dealt
-         *    with in the fastpath code above, so there's no speed benefit
-         *  + we would have to deal with the map returning NULL because the
-         *    bounce buffer was in use
+         * similar). Just do a series of byte copies as the architecture
+         * demands.
          */
-        tcg_debug_assert(original_len - already_written == len);
-        collect_magic_nop_stats(env, &magic_memmove_slowpath, len);
-        while (already_written < original_len) {
-            uint8_t value = helper_ret_ldub_mmu(env, current_src_cursor, oi, ra);
-            store_byte_and_clear_tag(env, current_dest_cursor, value, oi, ra); // might trap
-            current_dest_cursor++;
-            current_src_cursor++;
+        collect_magic_nop_stats(env, &magic_memmove_slowpath, chunk);
+        for (target_ulong i = 0; i < chunk; i++) {
+            const target_ulong offset = copy_backwards ? chunk - 1 - i : i;
+            uint8_t value = helper_ret_ldub_mmu(env, src + offset, oi, ra);
+            store_byte_and_clear_tag(env, dest + offset, value, oi, ra); // might trap
             already_written++;
             env->active_tc.gpr[MIPS_REGNUM_V0] = already_written;
         }
@@ -2184,31 +2172,14 @@ static bool do_magic_memset(CPUMIPSState *env, uint64_t ra, uint pattern_length)
         }
         tcg_debug_assert(l_adj_nitems != 0);
         tcg_debug_assert(((dest + l_adj_bytes - 1) & TARGET_PAGE_MASK) == (dest & TARGET_PAGE_MASK) && "should not cross a page boundary!");
-        void* hostaddr = NULL;
-#if 0
-        for (int try = 0; try < 2; try++) {
-            hostaddr = tlb_vaddr_to_host(env, dest, 1, mmu_idx);
-            if (hostaddr)
-                break;
-            /* OK, try a store and see if we can populate the tlb. This
-             * might cause an exception if the memory isn't writable,
-             * in which case we will longjmp out of here. We must for
-             * this purpose use the actual register value passed to us
-             * so that we get the fault address right.
-             */
-            store_byte_and_clear_tag(env, dest, 0xff, oi, ra);
-            // This should definitely fill the host TLB. If not we are probably writing to I/O memory
-            // FIXME: tlb_vaddr_to_host() also returns null if the notdirty flag is set (not sure if that's a bug
-            probe_write(env, dest, 1, mmu_idx, ra);
-        }
-#endif
+        // This might trap, but $v0 already records the progress so far.
+        // NULL means we are writing to something strange (e.g. I/O memory).
+        void *hostaddr = probe_write(env, dest, l_adj_bytes, mmu_idx, ra);
         if (hostaddr) {
             /* If it's all in the TLB it's fair game for just writing to;
              * we know we don't need to update dirty status, etc.
              */
             tcg_debug_assert(dest + total_len_nbytes == original_dest + original_len_bytes && "continuation broken?");
-            // Do one store byte to update MMU flags (not sure this is necessary)
-            store_byte_and_clear_tag(env, dest, value, oi, ra);
             do_memset_pattern_hostaddr(hostaddr, value, l_adj_nitems, pattern_length, ra);
 #ifdef TARGET_CHERI
             // We also need to invalidate the tags bits written by the memset
@@ -91,8 +91,8 @@ target_ulong helper_rdhwr_statcounters_icount(CPUMIPSState *env, uint32_t sel)
     case 1: return env->statcounters_icount_user;
     case 2: return env->statcounters_icount_kernel;
 #ifdef TARGET_CHERI
-    case 3: return env->statcounters_imprecise_setbounds;
-    case 4: return env->statcounters_unrepresentable_caps;
+    case 3: return env->statcounters.counters[CHERI_STATCOUNTER_IMPRECISE_SETBOUNDS];
+    case 4: return env->statcounters.counters[CHERI_STATCOUNTER_UNREPRESENTABLE_CAPS];
 #endif
     default: return 0xdeadbeef;
     }
@@ -103,14 +103,14 @@ target_ulong helper_rdhwr_statcounters_itlb_miss(CPUMIPSState *env)
 {
     qemu_maybe_log_instr_extra(env, "%s\n", __func__);
     check_hwrena(env, 5, GETPC());
-    return env->statcounters_itlb_miss;
+    return env->statcounters.counters[CHERI_STATCOUNTER_ITLB_MISS];
 }
 
 target_ulong helper_rdhwr_statcounters_dtlb_miss(CPUMIPSState *env)
 {
     qemu_maybe_log_instr_extra(env, "%s\n", __func__);
     check_hwrena(env, 6, GETPC());
-    return env->statcounters_dtlb_miss;
+    return env->statcounters.counters[CHERI_STATCOUNTER_DTLB_MISS];
 }
 
 target_ulong helper_rdhwr_statcounters_memory(CPUMIPSState *env, uint32_t sel)
@@ -120,19 +120,21 @@ target_ulong helper_rdhwr_statcounters_memory(CPUMIPSState *env, uint32_t sel)
     switch (sel) {
     case 2: return env->statcounters_icount_user;
     case 4: return env->statcounters_icount_kernel;
-    case 8: return env->statcounters_cap_read;
-    case 9: return env->statcounters_cap_write;
-    case 10: return env->statcounters_cap_read_tagged;
-    case 11: return env->statcounters_cap_write_tagged;
+    case 8: return env->statcounters.counters[CHERI_STATCOUNTER_CAP_READ];
+    case 9: return env->statcounters.counters[CHERI_STATCOUNTER_CAP_WRITE];
+    case 10: return env->statcounters.counters[CHERI_STATCOUNTER_CAP_READ_TAGGED];
+    case 11: return env->statcounters.counters[CHERI_STATCOUNTER_CAP_WRITE_TAGGED];
     default: return 0xdeadbeef;
     }
 }
 
 target_ulong helper_rdhwr_statcounters_reset(CPUMIPSState *env)
 {
-    // TODO: actually implement this
     qemu_maybe_log_instr_extra(env, "%s\n", __func__);
     check_hwrena(env, 7, GETPC());
+    // The icount values are not cleared since they are also used for the
+    // statistics printed on exit.
+    cheri_statcounters_reset(&env->statcounters);
     return 0;
 }
 
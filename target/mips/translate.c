@@ -2823,6 +2823,7 @@ typedef struct DisasContext {
     MemOp default_tcg_memop_mask;
     uint32_t hflags, saved_hflags;
     target_ulong btarget;
+    unsigned ind_kind; /* TB_IND_* kind of the pending branch */
     bool ulri;
     int kscrexist;
     bool rxi;
@@ -6972,6 +6973,7 @@ static void gen_compute_branch(DisasContext *ctx, uint32_t opc,
     TCGv t0 = tcg_temp_new();
     TCGv t1 = tcg_temp_new();
 
+    ctx->ind_kind = TB_IND_JUMP;
     // Note: For CHERI btgt is an absolute address not an offset relative
     // to PCC.base.
 #if defined(TARGET_CHERI)
@@ -7134,6 +7136,9 @@ static void gen_compute_branch(DisasContext *ctx, uint32_t opc,
             break;
         case OPC_JR:
             ctx->hflags |= MIPS_HFLAG_BR;
+            if (rs == 31) {
+                ctx->ind_kind = TB_IND_RETURN;
+            }
             break;
         case OPC_JALR:
             blink = rt;
@@ -7247,6 +7252,7 @@ static void gen_compute_branch(DisasContext *ctx, uint32_t opc,
         int post_delay = insn_bytes + delayslot_size;
         int lowbit = !!(ctx->hflags & MIPS_HFLAG_M16);
 
+        ctx->ind_kind = TB_IND_CALL;
         tcg_gen_movi_tl(cpu_gpr[blink],
                         /* Subtract PCC.base from r[blink] */
                         ctx->base.pc_next + post_delay + lowbit - pcc_base(ctx));
@@ -14309,6 +14315,10 @@ static void gen_branch(DisasContext *ctx, int insn_bytes)
             if (proc_hflags & MIPS_HFLAG_BX) {
                 tcg_gen_xori_i32(hflags, hflags, MIPS_HFLAG_M16);
             }
+            if (ctx->ind_kind & TB_IND_CALL) {
+                tcg_gen_push_return_addr(ctx->base.tb,
+                                         ctx->base.pc_next + insn_bytes);
+            }
             gen_goto_tb(ctx, 0, ctx->btarget);
             break;
         case MIPS_HFLAG_BL:
@@ -14351,7 +14361,12 @@ static void gen_branch(DisasContext *ctx, int insn_bytes)
                 save_cpu_state(ctx, 0);
                 gen_helper_raise_exception_debug(cpu_env);
             }
-            tcg_gen_lookup_and_goto_ptr();
+            /*
+             * Instructions in the delay slot may have changed hflags at
+             * run time, so the full TB state has to be checked.
+             */
+            tcg_gen_lookup_and_goto_ptr_ic(ctx->base.tb, NULL,
+                                           ctx->ind_kind | TB_IND_FULL_STATE);
             break;
 #ifdef TARGET_CHERI
         case MIPS_HFLAG_BRCCALL:
@@ -14373,7 +14388,16 @@ static void gen_branch(DisasContext *ctx, int insn_bytes)
                 save_cpu_state(ctx, 0);
                 gen_helper_0e0i(raise_exception, EXCP_DEBUG);
             }
-            tcg_gen_exit_tb(NULL, 0);
+            /*
+             * PCC has just been replaced, so the TB lookup key (cs_base,
+             * cs_top and cheri_flags) of the target differs from this TB.
+             * TB_IND_FULL_STATE makes helper_lookup_tb_ptr_ic recompute the
+             * whole key from env with cpu_get_tb_cpu_state_6() after
+             * copy_cap_btarget_to_pcc, and tb_lookup_matches() checks all
+             * of it, so no TB translated for the old PCC can be chained.
+             */
+            tcg_gen_lookup_and_goto_ptr_ic(ctx->base.tb, NULL,
+                                           ctx->ind_kind | TB_IND_FULL_STATE);
             break;
 #endif /* TARGET_CHERI */
         default:
@@ -32391,6 +32415,7 @@ static void mips_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
 
     ctx->page_start = ctx->base.pc_first & TARGET_PAGE_MASK;
     ctx->saved_pc = -1;
+    ctx->ind_kind = TB_IND_JUMP;
     ctx->insn_flags = env->insn_flags;
     ctx->CP0_Config1 = env->CP0_Config1;
     ctx->CP0_Config2 = env->CP0_Config2;
@@ -196,6 +196,7 @@ static inline void generate_cjalr(DisasContext *ctx, int32_t cd, int32_t cb)
         gen_helper_cjalr(cpu_env, tcd, tcb, toff, link_addr);
         /* Set branch and delay slot flags */
         ctx->hflags |= (MIPS_HFLAG_BRC | MIPS_HFLAG_BDS32);
+        ctx->ind_kind = TB_IND_CALL;
         /* Save capability register index that is new PCC */
         // ctx->btcr = cb;
         save_cpu_state(ctx, 0);
@@ -221,6 +222,8 @@ static inline void generate_cjr(DisasContext *ctx, int32_t cb)
         gen_helper_cjr(btarget, cpu_env, tcb);
         /* Set branch and delay slot flags */
         ctx->hflags |= (MIPS_HFLAG_BRC | MIPS_HFLAG_BDS32);
+        /* $c17 is the capability return address register */
+        ctx->ind_kind = cb == 17 ? TB_IND_RETURN : TB_IND_JUMP;
         /* Save capability register index that is new PCC */
         // ctx->btcr = cb;
         save_cpu_state(ctx, 0);
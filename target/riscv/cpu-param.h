@@ -31,6 +31,10 @@
 
 #ifdef CONFIG_TCG_LOG_INSTR
 #define TARGET_MAX_INSN_SIZE 4
+/* The translator emits fast logging records, see exec/log_instr_fast.h */
+#define TARGET_LOG_INSTR_FAST 1
+/* The translator supports lazy register logging on instruction commit */
+#define TARGET_LOG_INSTR_LAZY_REGS 1
 #endif
 
 #endif
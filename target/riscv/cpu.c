@@ -22,6 +22,10 @@
 #include "qemu/ctype.h"
 #include "qemu/log.h"
 #include "qemu/main-loop.h"
+#include "qemu/iov.h"
+#include "qemu/units.h"
+#include "exec/address-spaces.h"
+#include "exec/ram_addr.h"
 #include "cpu.h"
 #include "internals.h"
 #include "exec/exec-all.h"
@@ -42,6 +46,7 @@
 
 #ifdef TARGET_CHERI
 #include "cheri-lazy-capregs.h"
+#include "cheri_tagmem.h"
 #endif
 
 /* RISC-V CPU definitions */
@@ -383,18 +388,106 @@ void restore_state_to_opc(CPURISCVState *env, TranslationBlock *tb,
 #ifdef CONFIG_RVFI_DII
 extern int rvfi_client_fd;
 extern bool rvfi_debug_output;
+extern bool rvfi_dii_batch;
 
-static void send_rvfi_dii_packet(const void *data, size_t len)
+/*
+ * In batched mode (-rvfi-dii-batch) the command stream is read from the socket
+ * in large chunks and the trace replies are accumulated in a reusable buffer.
+ * Replies are only written out once we run out of buffered commands (the
+ * remote end may be waiting for them before sending more), when the buffer
+ * fills up, or on halt/reset. The wire format is identical to the unbatched
+ * mode, we just avoid two syscalls per injected instruction.
+ */
+#define RVFI_DII_RX_BUF_SIZE (64 * KiB)
+#define RVFI_DII_REPLY_BUF_SIZE (64 * KiB)
+static uint8_t rvfi_dii_rx_buf[RVFI_DII_RX_BUF_SIZE];
+static size_t rvfi_dii_rx_start;
+static size_t rvfi_dii_rx_end;
+static uint8_t rvfi_dii_reply_buf[RVFI_DII_REPLY_BUF_SIZE];
+static size_t rvfi_dii_reply_len;
+
+static void rvfi_dii_flush_replies(void)
 {
-    if (rvfi_debug_output) {
-        qemu_hexdump(stderr, "PACKET", data, len);
+    if (rvfi_dii_reply_len == 0) {
+        return;
     }
-    ssize_t nbytes = write(rvfi_client_fd, data, len);
-    if (nbytes != len) {
-        error_report("Failed to write packet to socket: %zd (%s)", nbytes,
-                     strerror(errno));
+    ssize_t nbytes =
+        qemu_write_full(rvfi_client_fd, rvfi_dii_reply_buf, rvfi_dii_reply_len);
+    if (nbytes != rvfi_dii_reply_len) {
+        error_report("Failed to write %zd bytes of packets to socket: %zd (%s)",
+                     rvfi_dii_reply_len, nbytes, strerror(errno));
         exit(EXIT_FAILURE);
     }
+    rvfi_dii_reply_len = 0;
+}
+
+static void send_rvfi_dii_packet_iov(const struct iovec *iov, int iovcnt)
+{
+    size_t len = iov_size(iov, iovcnt);
+    if (rvfi_debug_output) {
+        for (int i = 0; i < iovcnt; i++) {
+            qemu_hexdump(stderr, "PACKET", iov[i].iov_base, iov[i].iov_len);
+        }
+    }
+    if (!rvfi_dii_batch) {
+        ssize_t nbytes = writev(rvfi_client_fd, iov, iovcnt);
+        if (nbytes != len) {
+            error_report("Failed to write packet to socket: %zd (%s)", nbytes,
+                         strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    assert(len <= sizeof(rvfi_dii_reply_buf));
+    if (rvfi_dii_reply_len + len > sizeof(rvfi_dii_reply_buf)) {
+        rvfi_dii_flush_replies();
+    }
+    rvfi_dii_reply_len += iov_to_buf(iov, iovcnt, 0,
+                                     rvfi_dii_reply_buf + rvfi_dii_reply_len,
+                                     len);
+}
+
+static void send_rvfi_dii_packet(const void *data, size_t len)
+{
+    struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+    send_rvfi_dii_packet_iov(&iov, 1);
+}
+
+static void rvfi_dii_read_command(rvfi_dii_command_t *cmd)
+{
+    if (!rvfi_dii_batch) {
+        // Should be blocking, so we only read fewer bytes on EOF
+        ssize_t nbytes = read(rvfi_client_fd, cmd, sizeof(*cmd));
+        if (nbytes != sizeof(*cmd)) {
+            error_report("GOT EOF/Error reading from socket: %zd (%s)", nbytes,
+                         strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    while (rvfi_dii_rx_end - rvfi_dii_rx_start < sizeof(*cmd)) {
+        // No complete command left in the buffer. The remote end could be
+        // waiting for the outstanding replies, so send them before blocking.
+        rvfi_dii_flush_replies();
+        size_t remaining = rvfi_dii_rx_end - rvfi_dii_rx_start;
+        memmove(rvfi_dii_rx_buf, rvfi_dii_rx_buf + rvfi_dii_rx_start,
+                remaining);
+        rvfi_dii_rx_start = 0;
+        rvfi_dii_rx_end = remaining;
+        ssize_t nbytes = read(rvfi_client_fd, rvfi_dii_rx_buf + rvfi_dii_rx_end,
+                              sizeof(rvfi_dii_rx_buf) - rvfi_dii_rx_end);
+        if (nbytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbytes <= 0) {
+            error_report("GOT EOF/Error reading from socket: %zd (%s)", nbytes,
+                         strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        rvfi_dii_rx_end += nbytes;
+    }
+    memcpy(cmd, rvfi_dii_rx_buf + rvfi_dii_rx_start, sizeof(*cmd));
+    rvfi_dii_rx_start += sizeof(*cmd);
 }
 
 static void rvfi_dii_send_v1_trace(CPURISCVState* env)
@@ -443,25 +536,29 @@ static void rvfi_dii_send_v2_trace(CPURISCVState *env)
         .pc_data = env->rvfi_dii_trace.PC,
         .basic_info = env->rvfi_dii_trace.INST,
     };
-    GByteArray *buf = g_byte_array_new();
-    g_byte_array_append(buf, (const guint8*)&trace, sizeof(trace));
+    // Gather the packet directly from env instead of copying it into a
+    // temporary buffer first.
+    struct iovec iov[5];
+    int iovcnt = 0;
+    iov[iovcnt++] = (struct iovec){ &trace, sizeof(trace) };
     if (env->rvfi_dii_trace.available_fields & RVFI_INTEGER_DATA) {
-        g_byte_array_append(buf, (const guint8 *)"int-data", 8);
-        g_byte_array_append(buf, (const guint8 *)&env->rvfi_dii_trace.INTEGER,
-                            sizeof(env->rvfi_dii_trace.INTEGER));
+        iov[iovcnt++] = (struct iovec){ (void *)"int-data", 8 };
+        iov[iovcnt++] = (struct iovec){ &env->rvfi_dii_trace.INTEGER,
+                                        sizeof(env->rvfi_dii_trace.INTEGER) };
     }
     if (env->rvfi_dii_trace.available_fields & RVFI_MEM_DATA) {
-        g_byte_array_append(buf, (const guint8 *)"mem-data", 8);
-        g_byte_array_append(buf, (const guint8 *)&env->rvfi_dii_trace.MEM,
-                            sizeof(env->rvfi_dii_trace.MEM));
+        iov[iovcnt++] = (struct iovec){ (void *)"mem-data", 8 };
+        iov[iovcnt++] = (struct iovec){ &env->rvfi_dii_trace.MEM,
+                                        sizeof(env->rvfi_dii_trace.MEM) };
     }
     // Now that we know the total size, we can update the trace header:
-    ((struct rvfi_dii_trace_v2 *)buf->data)->trace_size = buf->len;
+    trace.trace_size = iov_size(iov, iovcnt);
     if (rvfi_debug_output) {
         fprintf(stderr,
             "Sending %u bytes: %jd PCWD: 0x%08jx, RD: %02d, RWD: 0x%08jx, MA: "
             "0x%08jx, MWD: 0x%08jx, MWM: 0x%08x, I: 0x%016jx H:%u T:%u\n",
-            buf->len, (uintmax_t)env->rvfi_dii_trace.INST.rvfi_order,
+            (unsigned)trace.trace_size,
+            (uintmax_t)env->rvfi_dii_trace.INST.rvfi_order,
             (uintmax_t)env->rvfi_dii_trace.PC.rvfi_pc_wdata,
             env->rvfi_dii_trace.INTEGER.rvfi_rd_addr,
             (uintmax_t)env->rvfi_dii_trace.INTEGER.rvfi_rd_wdata,
@@ -472,8 +569,7 @@ static void rvfi_dii_send_v2_trace(CPURISCVState *env)
             (unsigned)env->rvfi_dii_trace.INST.rvfi_halt,
             (unsigned)env->rvfi_dii_trace.INST.rvfi_trap);
     }
-    send_rvfi_dii_packet(buf->data, buf->len);
-    g_byte_array_free(buf, true);
+    send_rvfi_dii_packet_iov(iov, iovcnt);
 }
 
 static void rvfi_dii_send_trace(CPURISCVState *env, unsigned version)
@@ -488,6 +584,54 @@ static void rvfi_dii_send_trace(CPURISCVState *env, unsigned version)
     }
 }
 
+/*
+ * Zeroing all 8 MiB of RAM (and flushing all translated code) for every test
+ * is orders of magnitude more expensive than running a typical TestRIG
+ * sequence that only touches a few pages. Instead we enable dirty logging for
+ * the RAM region and only clear the pages that were written since the last
+ * reset. The first reset sees all pages as dirty and clears everything.
+ */
+static void rvfi_dii_reset_ram(void)
+{
+    static MemoryRegion *ram_mr;
+    static hwaddr ram_offset;
+
+    if (!ram_mr) {
+        MemoryRegionSection section = memory_region_find(
+            get_system_memory(), RVFI_DII_RAM_START, RVFI_DII_RAM_SIZE);
+        assert(section.mr && memory_region_is_ram(section.mr));
+        assert(int128_get64(section.size) == RVFI_DII_RAM_SIZE);
+        // Keep the reference returned by memory_region_find().
+        ram_mr = section.mr;
+        ram_offset = section.offset_within_region;
+        memory_region_set_log(ram_mr, true, DIRTY_MEMORY_VGA);
+    }
+    DirtyBitmapSnapshot *snap = memory_region_snapshot_and_clear_dirty(
+        ram_mr, ram_offset, RVFI_DII_RAM_SIZE, DIRTY_MEMORY_VGA);
+    uint8_t *host = (uint8_t *)memory_region_get_ram_ptr(ram_mr) + ram_offset;
+    ram_addr_t ram_addr = memory_region_get_ram_addr(ram_mr) + ram_offset;
+    size_t dirty_pages = 0;
+    for (hwaddr offset = 0; offset < RVFI_DII_RAM_SIZE;
+         offset += TARGET_PAGE_SIZE) {
+        if (!memory_region_snapshot_get_dirty(ram_mr, snap, ram_offset + offset,
+                                              TARGET_PAGE_SIZE)) {
+            continue;
+        }
+        memset(host + offset, 0, TARGET_PAGE_SIZE);
+        // Only code on modified pages can be stale.
+        tb_invalidate_phys_range(ram_addr + offset,
+                                 ram_addr + offset + TARGET_PAGE_SIZE);
+        dirty_pages++;
+    }
+    g_free(snap);
+#ifdef TARGET_CHERI
+    cheri_tag_phys_invalidate_all(ram_mr->ram_block);
+#endif
+    if (rvfi_debug_output) {
+        info_report("RVFI-DII reset: cleared %zd dirty pages", dirty_pages);
+    }
+}
+
 void rvfi_dii_communicate(CPUState* cs, CPURISCVState* env, bool was_trap) {
     // needs to be global since this function is called for each instruction
     // that is executed.
@@ -520,13 +664,7 @@ void rvfi_dii_communicate(CPUState* cs, CPURISCVState* env, bool was_trap) {
             memset(&env->rvfi_dii_trace, 0, sizeof(env->rvfi_dii_trace));
             env->rvfi_dii_trace.INST.rvfi_order = old_instret;
         }
-        // Should be blocking, so we only read fewer bytes on EOF
-        ssize_t nbytes = read(rvfi_client_fd, &cmd_buf, sizeof(cmd_buf));
-        if (nbytes != sizeof(cmd_buf)) {
-            error_report("GOT EOF/Error reading from socket: %zd (%s)", nbytes,
-                         strerror(errno));
-            exit(EXIT_FAILURE);
-        }
+        rvfi_dii_read_command(&cmd_buf);
         if (rvfi_debug_output) {
             info_report("Handling RVFI-DII command %d", cmd_buf.rvfi_dii_cmd);
         }
@@ -550,23 +688,11 @@ void rvfi_dii_communicate(CPUState* cs, CPURISCVState* env, bool was_trap) {
             env->resetvec = RVFI_DII_RAM_START;
             // Reset the processor (and ensure that it resets to 0x80000000)
             cpu_reset(cs);
-            // FIXME: Hopefully this resets RAM?
+            // Reset devices, this does not reset the contents of RAM.
             qemu_system_reset(SHUTDOWN_CAUSE_HOST_SIGNAL);
             cs->cflags_next_tb |= CF_NOCACHE;
-            hwaddr system_ram_addr = cpu_get_phys_page_debug(cs, PC_ADDR(env));
-            hwaddr system_ram_size = RVFI_DII_RAM_SIZE;
-            void *ram_ptr = cpu_physical_memory_map(
-                system_ram_addr, &system_ram_size, /*is_write=*/true);
-            assert(system_ram_size == RVFI_DII_RAM_SIZE);
-            // TODO: would be nice to do this lazily instead of writing 8 MiB
-            // FIXME: is it safe to do a munmap/mmap? We could also MAP_FIXED over
-            // the existing mapping. This should be faster since we rarely use more
-            // than one page.
-            memset(ram_ptr, 0, system_ram_size);
-            // Unmap: this should invalidate all caches for that regio.
-            cpu_physical_memory_unmap(ram_ptr, system_ram_size, /*is_write=*/true, system_ram_size);
-            // Flush the TCG state:
-            tb_flush(cs);
+            // Zero the pages (and tags) that were modified by the last test.
+            rvfi_dii_reset_ram();
             tlb_flush(cs); // Flush the QEMU guest->host tlb
 
             // TestRIG expects all capability registers to be max perms
@@ -574,6 +700,8 @@ void rvfi_dii_communicate(CPUState* cs, CPURISCVState* env, bool was_trap) {
             set_max_perms_capregs(env);
 #endif
             rvfi_dii_send_trace(env, rvfi_dii_version);
+            // The halt packet terminates a test, send it out right away.
+            rvfi_dii_flush_replies();
             memset(&env->rvfi_dii_trace, 0, sizeof(env->rvfi_dii_trace));
             continue;
         }
@@ -594,6 +722,7 @@ void rvfi_dii_communicate(CPUState* cs, CPURISCVState* env, bool was_trap) {
                 uint64_t version;
             } version_response = {"version=", rvfi_dii_version};
             send_rvfi_dii_packet(&version_response, sizeof(version_response));
+            rvfi_dii_flush_replies();
             continue;
         }
         case 'B': {
@@ -605,6 +734,7 @@ void rvfi_dii_communicate(CPUState* cs, CPURISCVState* env, bool was_trap) {
             // The remote disconnected.
             fprintf(stderr, "Received a quit command. Quitting.\n");
             info_report("Received a quit command. Quitting.\n");
+            rvfi_dii_flush_replies();
             close(rvfi_client_fd);
             rvfi_client_fd = 0;
             exit(EXIT_SUCCESS);
@@ -678,6 +808,7 @@ static void riscv_cpu_reset(DeviceState *dev)
 
     mcc->parent_reset(dev);
 #ifndef CONFIG_USER_ONLY
+    riscv_pwc_flush(env);
     env->priv = PRV_M;
     env->mstatus &= ~(MSTATUS_MIE | MSTATUS_MPRV);
     env->mcause = 0;
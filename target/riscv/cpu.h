@@ -102,6 +102,7 @@ typedef struct CPURISCVState CPURISCVState;
 
 #ifdef TARGET_CHERI
 #include "cheri-lazy-capregs-types.h"
+#include "cheri-statcounters.h"
 #endif
 #include "pmp.h"
 
@@ -113,6 +114,34 @@ FIELD(VTYPE, VEDIV, 5, 2)
 FIELD(VTYPE, RESERVED, 7, sizeof(target_ulong) * 8 - 9)
 FIELD(VTYPE, VILL, sizeof(target_ulong) * 8 - 1, 1)
 
+#ifndef CONFIG_USER_ONLY
+/*
+ * Page-walk cache for single-stage translation.
+ * Each entry remembers the next-level page table reached by a non-leaf PTE
+ * at a given level, keyed by the root page table and the VPN bits that were
+ * used to reach it, so that TLB refills can skip the upper levels of the
+ * walk. The host pointer of the next-level table is cached when it is in
+ * RAM. The cache is private to the vCPU thread and is flushed on
+ * sfence.vma, satp and PMP updates and memory map changes.
+ */
+#define RISCV_PWC_SIZE 64
+
+typedef struct RISCVPageWalkCacheEntry {
+    bool valid;
+    int8_t level;
+    target_ulong vpn;
+    hwaddr root;
+    hwaddr base;
+    void *host;
+} RISCVPageWalkCacheEntry;
+
+typedef struct RISCVPageWalkCache {
+    RISCVPageWalkCacheEntry entries[RISCV_PWC_SIZE];
+    /* Memory map the host pointers were resolved in */
+    void *flatview;
+} RISCVPageWalkCache;
+#endif
+
 struct CPURISCVState {
 #ifdef TARGET_CHERI
     struct GPCapRegs gpcapregs;
@@ -284,6 +313,9 @@ struct CPURISCVState {
     /* physical memory protection */
     pmp_table_t pmp_state;
 
+    /* page-walk cache of non-leaf PTEs */
+    RISCVPageWalkCache pwc;
+
     /* True if in debugger mode.  */
     bool debugger;
 #endif
@@ -291,14 +323,7 @@ struct CPURISCVState {
     float_status fp_status;
 
 #ifdef TARGET_CHERI
-    // Some statcounters:
-    uint64_t statcounters_cap_read;
-    uint64_t statcounters_cap_read_tagged;
-    uint64_t statcounters_cap_write;
-    uint64_t statcounters_cap_write_tagged;
-
-    uint64_t statcounters_imprecise_setbounds;
-    uint64_t statcounters_unrepresentable_caps;
+    CheriStatcounters statcounters;
 
 #endif
 
@@ -622,6 +647,9 @@ void riscv_cpu_set_rdtime_fn(CPURISCVState *env, uint64_t (*fn)(uint32_t),
                              uint32_t arg);
 #endif
 void riscv_cpu_set_mode(CPURISCVState *env, target_ulong newpriv);
+#ifndef CONFIG_USER_ONLY
+void riscv_pwc_flush(CPURISCVState *env);
+#endif
 
 void riscv_translate_init(void);
 int riscv_cpu_signal_handler(int host_signum, void *pinfo, void *puc);
@@ -287,15 +287,27 @@ uint32_t riscv_cpu_update_mip(RISCVCPU *cpu, uint32_t mask, uint32_t value)
 {
     CPURISCVState *env = &cpu->env;
     CPUState *cs = CPU(cpu);
-    uint32_t old = env->mip;
+    uint32_t old = qatomic_read__nocheck(&env->mip);
     bool locked = false;
 
+    /*
+     * Devices such as the CLINT and PLIC call this from MMIO handlers
+     * that run without the BQL. Only the interrupt_request update needs
+     * it, so skip taking the lock when the bits are already in place.
+     * A concurrent change is ordered after this call, as it would have
+     * been had it taken the lock.
+     */
+    if ((old & mask) == (value & mask)) {
+        return old;
+    }
+
     if (!qemu_mutex_iothread_locked()) {
         locked = true;
         qemu_mutex_lock_iothread();
     }
 
-    env->mip = (env->mip & ~mask) | (value & mask);
+    old = env->mip;
+    qatomic_set__nocheck(&env->mip, (old & ~mask) | (value & mask));
 
     if (env->mip) {
         cpu_interrupt(cs, CPU_INTERRUPT_HARD);
@@ -359,6 +371,78 @@ extern bool rvfi_debug_output;
 #define RISCV_PTE_TRAPPY 0
 #endif
 
+void riscv_pwc_flush(CPURISCVState *env)
+{
+    memset(&env->pwc, 0, sizeof(env->pwc));
+}
+
+static inline target_ulong pwc_vpn(target_ulong addr, int levels,
+                                   int ptidxbits, int level)
+{
+    return addr >> (PGSHIFT + (levels - 1 - level) * ptidxbits);
+}
+
+static inline RISCVPageWalkCacheEntry *pwc_entry(CPURISCVState *env,
+                                                 target_ulong vpn, int level)
+{
+    return &env->pwc.entries[(vpn ^ ((target_ulong)level << 4)) &
+                             (RISCV_PWC_SIZE - 1)];
+}
+
+/*
+ * Find the deepest cached non-leaf PTE on the walk for @addr.
+ * On a hit, returns the level to resume the walk from and sets @base and
+ * @host to the page table at that level. Returns 0 on a miss.
+ */
+static int pwc_lookup(CPURISCVState *env, hwaddr root, target_ulong addr,
+                      int levels, int ptidxbits, hwaddr *base, void **host)
+{
+    FlatView *fv = address_space_to_flatview(env_cpu(env)->as);
+    RISCVPageWalkCacheEntry *e;
+    target_ulong vpn;
+    int i;
+
+    if (unlikely(env->pwc.flatview != fv)) {
+        /* Host pointers may be stale after a memory map change */
+        riscv_pwc_flush(env);
+        env->pwc.flatview = fv;
+        return 0;
+    }
+    for (i = levels - 2; i >= 0; i--) {
+        vpn = pwc_vpn(addr, levels, ptidxbits, i);
+        e = pwc_entry(env, vpn, i);
+        if (e->valid && e->level == i && e->vpn == vpn && e->root == root) {
+            *base = e->base;
+            *host = e->host;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static void pwc_insert(CPURISCVState *env, hwaddr root, target_ulong addr,
+                       int levels, int ptidxbits, int level, hwaddr base)
+{
+    target_ulong vpn = pwc_vpn(addr, levels, ptidxbits, level);
+    RISCVPageWalkCacheEntry *e = pwc_entry(env, vpn, level);
+    hwaddr len = 1 << PGSHIFT;
+    hwaddr offset;
+    MemoryRegion *mr;
+
+    mr = address_space_translate(env_cpu(env)->as, base, &offset, &len, false,
+                                 MEMTXATTRS_UNSPECIFIED);
+    if (memory_region_is_ram(mr) && len == (1 << PGSHIFT)) {
+        e->host = qemu_map_ram_ptr(mr->ram_block, offset);
+    } else {
+        e->host = NULL;
+    }
+    e->valid = true;
+    e->level = level;
+    e->vpn = vpn;
+    e->root = root;
+    e->base = base;
+}
+
 /* get_physical_address - get the physical address for this virtual address
  *
  * Do a page table walk to obtain the physical address corresponding to a
@@ -510,11 +594,35 @@ static int get_physical_address(CPURISCVState *env, hwaddr *physical,
 
     int ptshift = (levels - 1) * ptidxbits;
     int i;
+    /*
+     * The page-walk cache is only used for single-stage walks done by the
+     * vCPU itself, debug accesses from other threads bypass it.
+     */
+    bool use_pwc = first_stage && !two_stage && current_cpu == cs;
+    hwaddr root = base;
+    void *pte_host = NULL;
+    int start_level = 0;
+
+    if (use_pwc) {
+        start_level = pwc_lookup(env, root, addr, levels, ptidxbits, &base,
+                                 &pte_host);
+#ifdef TARGET_CHERI
+        cheri_statcounter_inc(env, PAGE_WALKS);
+        if (start_level > 0) {
+            cheri_statcounter_inc(env, PAGE_WALK_CACHE_HITS);
+        }
+#endif
+    }
+    hwaddr start_base = base;
+    void *start_host = pte_host;
 
 #if !TCG_OVERSIZED_GUEST
 restart:
 #endif
-    for (i = 0; i < levels; i++, ptshift -= ptidxbits) {
+    base = start_base;
+    pte_host = start_host;
+    ptshift = (levels - 1 - start_level) * ptidxbits;
+    for (i = start_level; i < levels; i++, ptshift -= ptidxbits) {
         target_ulong idx;
         if (i == 0) {
             idx = (addr >> (PGSHIFT + ptshift)) &
@@ -554,11 +662,26 @@ restart:
             return TRANSLATE_PMP_FAIL;
         }
 
+        target_ulong pte;
+#ifdef TARGET_CHERI
+        cheri_statcounter_inc(env, PAGE_WALK_PTE_LOADS);
+#endif
+        if (pte_host) {
+            /* Resuming from the page-walk cache, the table is in RAM */
 #if defined(TARGET_RISCV32)
-        target_ulong pte = address_space_ldl(cs->as, pte_addr, attrs, &res);
+            pte = ldl_le_p((uint8_t *)pte_host + idx * ptesize);
 #elif defined(TARGET_RISCV64)
-        target_ulong pte = address_space_ldq(cs->as, pte_addr, attrs, &res);
+            pte = ldq_le_p((uint8_t *)pte_host + idx * ptesize);
 #endif
+            pte_host = NULL;
+            res = MEMTX_OK;
+        } else {
+#if defined(TARGET_RISCV32)
+            pte = address_space_ldl(cs->as, pte_addr, attrs, &res);
+#elif defined(TARGET_RISCV64)
+            pte = address_space_ldq(cs->as, pte_addr, attrs, &res);
+#endif
+        }
         if (res != MEMTX_OK) {
             qemu_log_mask(
                 CPU_LOG_MMU,
@@ -586,6 +709,9 @@ restart:
         } else if (!(pte & (PTE_R | PTE_W | PTE_X))) {
             /* Inner PTE, continue walking */
             base = ppn << PGSHIFT;
+            if (use_pwc && i < levels - 1) {
+                pwc_insert(env, root, addr, levels, ptidxbits, i, base);
+            }
         } else if ((pte & (PTE_R | PTE_W | PTE_X)) == PTE_W) {
             /* Reserved leaf PTE flags: PTE_W */
             qemu_log_mask(CPU_LOG_MMU, "%s Translate fail: Reserved WRX 100\n",
@@ -1191,6 +1317,9 @@ void riscv_cpu_do_interrupt(CPUState *cs)
     target_ulong tval = 0;
     target_ulong htval = 0;
     target_ulong mtval2 = 0;
+#ifdef CONFIG_TCG_LOG_INSTR
+    target_ulong log_epc = PC_ADDR(env);
+#endif
 
     bool log_inst = true;
     if (!async) {
@@ -1401,7 +1530,7 @@ void riscv_cpu_do_interrupt(CPUState *cs)
                 GET_SPECIAL_REG_ADDR(env, pc, PCC));
         } else {
             qemu_log_instr_exception(env, cause,
-                GET_SPECIAL_REG_ADDR(env, pc, PCC), tval);
+                GET_SPECIAL_REG_ADDR(env, pc, PCC), tval, log_epc);
         }
     }
 #endif
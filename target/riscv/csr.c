@@ -468,6 +468,60 @@ static int read_zero(CPURISCVState *env, int csrno, target_ulong *val)
     return *val = 0;
 }
 
+#ifdef TARGET_CHERI
+/*
+ * CHERI statcounters exposed as hpmcounter3 onwards (and the mhpmcounter
+ * aliases). This is guest ABI: existing entries must not be changed and new
+ * counters are appended. The counters above the end of the table read as
+ * zero. There is no guest TLB, so the TLB miss counters are the QEMU
+ * softmmu misses, which each cause a page table walk.
+ */
+static const CheriStatcounter riscv_hpmcounter_map[] = {
+    CHERI_STATCOUNTER_SOFTMMU_ITLB_MISS,     /* hpmcounter3 */
+    CHERI_STATCOUNTER_SOFTMMU_DTLB_MISS,     /* hpmcounter4 */
+    CHERI_STATCOUNTER_CAP_READ,              /* hpmcounter5 */
+    CHERI_STATCOUNTER_CAP_READ_TAGGED,       /* hpmcounter6 */
+    CHERI_STATCOUNTER_CAP_WRITE,             /* hpmcounter7 */
+    CHERI_STATCOUNTER_CAP_WRITE_TAGGED,      /* hpmcounter8 */
+    CHERI_STATCOUNTER_IMPRECISE_SETBOUNDS,   /* hpmcounter9 */
+    CHERI_STATCOUNTER_UNREPRESENTABLE_CAPS,  /* hpmcounter10 */
+    CHERI_STATCOUNTER_TAG_GET_MANY,          /* hpmcounter11 */
+    CHERI_STATCOUNTER_TAG_SET_MANY,          /* hpmcounter12 */
+    CHERI_STATCOUNTER_EXCEPTIONS,            /* hpmcounter13 */
+    CHERI_STATCOUNTER_TB_TRANSLATIONS,       /* hpmcounter14 */
+    CHERI_STATCOUNTER_PAGE_WALKS,            /* hpmcounter15 */
+    CHERI_STATCOUNTER_PAGE_WALK_CACHE_HITS,  /* hpmcounter16 */
+    CHERI_STATCOUNTER_PAGE_WALK_PTE_LOADS,   /* hpmcounter17 */
+};
+
+static uint64_t hpmcounter_value(CPURISCVState *env, int csrno)
+{
+    unsigned index = (csrno & 0x1f) - 3;
+
+    if (index >= ARRAY_SIZE(riscv_hpmcounter_map)) {
+        return 0;
+    }
+    return env->statcounters.counters[riscv_hpmcounter_map[index]];
+}
+
+static int read_hpmcounter(CPURISCVState *env, int csrno, target_ulong *val)
+{
+    *val = hpmcounter_value(env, csrno);
+    return 0;
+}
+
+#if defined(TARGET_RISCV32)
+static int read_hpmcounterh(CPURISCVState *env, int csrno, target_ulong *val)
+{
+    *val = hpmcounter_value(env, csrno) >> 32;
+    return 0;
+}
+#endif
+#else
+#define read_hpmcounter read_zero
+#define read_hpmcounterh read_zero
+#endif
+
 static int read_mhartid(CPURISCVState *env, int csrno, target_ulong *val)
 {
     *val = env->mhartid;
@@ -948,7 +1002,13 @@ static int write_satp(CPURISCVState *env, int csrno, target_ulong val)
         } else {
             if ((val ^ env->satp) & SATP_ASID) {
                 tlb_flush(env_cpu(env));
+#ifdef CONFIG_TCG_LOG_INSTR
+                if (qemu_log_instr_enabled(env)) {
+                    qemu_log_instr_asid_change(env);
+                }
+#endif
             }
+            riscv_pwc_flush(env);
             env->satp = val;
         }
     }
@@ -1716,12 +1776,12 @@ static riscv_csr_operations csr_ops[CSR_TABLE_SIZE] = {
     [CSR_PMPADDR0 ... CSR_PMPADDR15] = CSR_OP_NOLOG_RW(pmp, pmpaddr),
 
     /* Performance Counters */
-    [CSR_HPMCOUNTER3   ... CSR_HPMCOUNTER31] =    CSR_OP_FN_R(ctr, read_zero, "hpmcounterN"),
-    [CSR_MHPMCOUNTER3  ... CSR_MHPMCOUNTER31] =   CSR_OP_FN_R(ctr, read_zero, "mhpmcounterN"),
+    [CSR_HPMCOUNTER3   ... CSR_HPMCOUNTER31] =    CSR_OP_FN_R(ctr, read_hpmcounter, "hpmcounterN"),
+    [CSR_MHPMCOUNTER3  ... CSR_MHPMCOUNTER31] =   CSR_OP_FN_R(ctr, read_hpmcounter, "mhpmcounterN"),
     [CSR_MHPMEVENT3    ... CSR_MHPMEVENT31] =     CSR_OP_FN_R(ctr, read_zero, "mhpmeventN"),
 #if defined(TARGET_RISCV32)
-    [CSR_HPMCOUNTER3H  ... CSR_HPMCOUNTER31H] =   CSR_OP_FN_R(ctr, read_zero, "hpmcounterNh"),
-    [CSR_MHPMCOUNTER3H ... CSR_MHPMCOUNTER31H] =  CSR_OP_FN_R(ctr, read_zero, "mhpmcounterNh"),
+    [CSR_HPMCOUNTER3H  ... CSR_HPMCOUNTER31H] =   CSR_OP_FN_R(ctr, read_hpmcounterh, "hpmcounterNh"),
+    [CSR_MHPMCOUNTER3H ... CSR_MHPMCOUNTER31H] =  CSR_OP_FN_R(ctr, read_hpmcounterh, "mhpmcounterNh"),
 #endif
 #endif /* !CONFIG_USER_ONLY */
 };
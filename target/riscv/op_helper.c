@@ -242,6 +242,7 @@ void helper_tlb_flush(CPURISCVState *env)
                get_field(env->hstatus, HSTATUS_VTVM)) {
         riscv_raise_exception(env, RISCV_EXCP_VIRT_INSTRUCTION_FAULT, GETPC());
     } else {
+        riscv_pwc_flush(env);
         tlb_flush(cs);
     }
 }
@@ -256,6 +257,7 @@ void helper_hyp_tlb_flush(CPURISCVState *env)
 
     if (env->priv == PRV_M ||
         (env->priv == PRV_S && !riscv_cpu_virt_enabled(env))) {
+        riscv_pwc_flush(env);
         tlb_flush(cs);
         return;
     }
@@ -31,6 +31,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/host-utils.h"
 #include "exec/log_instr.h"
 #include "exec/helper-proto.h"
 #include "cpu.h"
@@ -89,6 +90,33 @@ void HELPER(riscv_log_instr)(CPURISCVState *env, target_ulong pc,
     }
 }
 
+void HELPER(riscv_log_instr_lazy)(CPURISCVState *env, target_ulong pc,
+                                  uint32_t opcode, uint32_t opcode_size,
+                                  uint32_t regs)
+{
+    if (qemu_log_instr_enabled(env)) {
+        qemu_log_instr_asid(env, cpu_get_asid(env, pc));
+        qemu_log_instr(env, pc, (char *)&opcode, opcode_size);
+        qemu_log_instr_lazy_regs(env, regs);
+    }
+}
+
+/*
+ * Log the GPRs written by an instruction with lazy register logging.
+ * This runs on commit, so the register file holds the instruction results.
+ */
+void cpu_log_instr_lazy_regs(CPURISCVState *env, uint64_t regs)
+{
+    int regnum;
+
+    while (regs) {
+        regnum = ctz64(regs);
+        regs &= regs - 1;
+        qemu_log_instr_reg(env, riscv_int_regnames[regnum],
+                           get_gpr_value(env, regnum));
+    }
+}
+
 /*
  * Events are triggered by a magic no-op. The arguments for the event
  * are passed via the target ABI argument registers.
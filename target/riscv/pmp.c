@@ -190,6 +190,8 @@ void pmp_update_rule_nums(CPURISCVState *env)
             env->pmp_state.num_rules++;
         }
     }
+    /* Cached page table walks skip the PMP checks on upper level PTEs */
+    riscv_pwc_flush(env);
 }
 
 /* Convert cfg/addr reg values here into simple 'sa' --> start address and 'ea'
@@ -29,6 +29,7 @@
 #include "exec/translator.h"
 #include "exec/log.h"
 #include "exec/log_instr.h"
+#include "exec/log_instr_fast.h"
 
 #include "instmap.h"
 
@@ -79,6 +80,14 @@ typedef struct DisasContext {
     uint16_t vlen;
     uint16_t mlen;
     bool vl_eq_vlmax;
+#ifdef CONFIG_TCG_LOG_INSTR
+    /*
+     * With lazy register logging, the GPRs written by the current instruction
+     * and the op passing them to the logging helper, patched once known.
+     */
+    uint32_t log_lazy_regs;
+    TCGOp *log_lazy_op;
+#endif
 } DisasContext;
 
 #ifdef TARGET_RISCV64
@@ -180,6 +189,33 @@ static void lookup_and_goto_ptr(DisasContext *ctx)
     }
 }
 
+/* Like lookup_and_goto_ptr, but through the inline cache of this TB */
+static void lookup_and_goto_ptr_ic(DisasContext *ctx, TCGv dest,
+                                   unsigned kind)
+{
+    if (ctx->base.singlestep_enabled) {
+        gen_exception_debug();
+    } else {
+        tcg_gen_lookup_and_goto_ptr_ic(ctx->base.tb, dest, kind);
+    }
+}
+
+/*
+ * Classify a jump for the shadow return stack using the return-address
+ * stack hints of the ISA manual: writing x1/x5 is a call, otherwise reading
+ * x1/x5 is a return.
+ */
+static unsigned jalr_kind(int rd, int rs1)
+{
+    if (rd == 1 || rd == 5) {
+        return TB_IND_CALL;
+    }
+    if (rs1 == 1 || rs1 == 5) {
+        return TB_IND_RETURN;
+    }
+    return TB_IND_JUMP;
+}
+
 static void gen_exception_illegal(DisasContext *ctx)
 {
     generate_exception(ctx, RISCV_EXCP_ILLEGAL_INST);
@@ -254,7 +290,11 @@ static inline void _gen_set_gpr(DisasContext *ctx, int reg_num_dst, TCGv t,
         gen_rvfi_dii_set_field_zext_tl(INTEGER, rd_wdata, t);
 #ifdef CONFIG_TCG_LOG_INSTR
         // Log GPR writes here
-        if (unlikely(ctx->base.log_instr_enabled)) {
+        if (ctx->log_lazy_op) {
+            ctx->log_lazy_regs |= 1u << reg_num_dst;
+        } else if (unlikely(ctx->base.log_instr_enabled) &&
+                   !gen_log_instr_fast_reg(riscv_int_regnames[reg_num_dst],
+                                           t)) {
             TCGv_i32 tregnum = tcg_const_i32(reg_num_dst);
             gen_helper_riscv_log_gpr_write(cpu_env, tregnum, t);
             tcg_temp_free_i32(tregnum);
@@ -278,12 +318,17 @@ static inline void _gen_set_gpr_const(DisasContext *ctx, int reg_num_dst,
         gen_rvfi_dii_set_field_const_i64(INTEGER, rd_wdata, value);
 #ifdef CONFIG_TCG_LOG_INSTR
         // Log GPR writes here
-        if (unlikely(ctx->base.log_instr_enabled)) {
-            TCGv_i32 tregnum = tcg_const_i32(reg_num_dst);
+        if (ctx->log_lazy_op) {
+            ctx->log_lazy_regs |= 1u << reg_num_dst;
+        } else if (unlikely(ctx->base.log_instr_enabled)) {
             TCGv tval = tcg_const_tl(value);
-            gen_helper_riscv_log_gpr_write(cpu_env, tregnum, tval);
+            if (!gen_log_instr_fast_reg(riscv_int_regnames[reg_num_dst],
+                                        tval)) {
+                TCGv_i32 tregnum = tcg_const_i32(reg_num_dst);
+                gen_helper_riscv_log_gpr_write(cpu_env, tregnum, tval);
+                tcg_temp_free_i32(tregnum);
+            }
             tcg_temp_free(tval);
-            tcg_temp_free_i32(tregnum);
         }
 #endif
     }
@@ -296,7 +341,25 @@ static inline void _gen_set_gpr_const(DisasContext *ctx, int reg_num_dst,
 static inline void gen_riscv_log_instr(DisasContext *ctx, uint32_t opcode,
                                        int width)
 {
-    if (unlikely(ctx->base.log_instr_enabled)) {
+    if (unlikely(ctx->base.log_instr_enabled) &&
+        qemu_log_instr_fast_enabled()) {
+        gen_log_instr_fast_insn(ctx->base.pc_next, opcode, width);
+    } else if (unlikely(ctx->base.log_instr_enabled) &&
+               qemu_log_instr_lazy_regs_enabled()) {
+        TCGv tpc = tcg_const_tl(ctx->base.pc_next);
+        TCGv_i32 topc = tcg_const_i32(opcode);
+        TCGv_i32 twidth = tcg_const_i32(width);
+        TCGv_i32 tregs = tcg_temp_new_i32();
+        /* Patched with the registers written once the insn is translated */
+        tcg_gen_movi_i32(tregs, 0);
+        ctx->log_lazy_op = tcg_last_op();
+        ctx->log_lazy_regs = 0;
+        gen_helper_riscv_log_instr_lazy(cpu_env, tpc, topc, twidth, tregs);
+        tcg_temp_free(tpc);
+        tcg_temp_free_i32(topc);
+        tcg_temp_free_i32(twidth);
+        tcg_temp_free_i32(tregs);
+    } else if (unlikely(ctx->base.log_instr_enabled)) {
         TCGv tpc = tcg_const_tl(ctx->base.pc_next);
         TCGv_i32 topc = tcg_const_i32(opcode);
         TCGv_i32 twidth = tcg_const_i32(width);
@@ -484,6 +547,9 @@ static void gen_jal(DisasContext *ctx, int rd, target_ulong imm)
     }
     // For CHERI the result is an offset relative to PCC.base
     gen_set_gpr_const(rd, ctx->pc_succ_insn - pcc_base(ctx));
+    if (jalr_kind(rd, 0) == TB_IND_CALL) {
+        tcg_gen_push_return_addr(ctx->base.tb, ctx->pc_succ_insn);
+    }
 
     gen_goto_tb(ctx, 0, ctx->base.pc_next + imm, /*bounds_check=*/true); /* must use this for safety */
     ctx->base.is_jmp = DISAS_NORETURN;
@@ -515,7 +581,8 @@ static void gen_jalr(DisasContext *ctx, int rd, int rs1, target_ulong imm)
 
     // For CHERI the result is an offset relative to PCC.base
     gen_set_gpr_const(rd, ctx->pc_succ_insn - pcc_base(ctx));
-    lookup_and_goto_ptr(ctx);
+    /* JALR only changes the PCC cursor, so the TB flags stay the same. */
+    lookup_and_goto_ptr_ic(ctx, cpu_pc, jalr_kind(rd, rs1));
 
     if (misaligned) {
         gen_set_label(misaligned);
@@ -909,6 +976,9 @@ static void riscv_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     uint32_t tb_flags = ctx->base.tb->flags;
 
     ctx->pc_succ_insn = ctx->base.pc_first;
+#ifdef CONFIG_TCG_LOG_INSTR
+    ctx->log_lazy_op = NULL;
+#endif
     ctx->mem_idx = tb_flags & TB_FLAGS_MMU_MASK;
     ctx->mstatus_fs = tb_flags & TB_FLAGS_MSTATUS_FS;
 #ifdef TARGET_CHERI
@@ -969,6 +1039,12 @@ static void riscv_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     CPURISCVState *env = cpu->env_ptr;
 
     decode_opc(env, ctx);
+#ifdef CONFIG_TCG_LOG_INSTR
+    if (ctx->log_lazy_op) {
+        tcg_set_insn_param(ctx->log_lazy_op, 1, ctx->log_lazy_regs);
+        ctx->log_lazy_op = NULL;
+    }
+#endif
     ctx->base.pc_next = ctx->pc_succ_insn;
     gen_rvfi_dii_set_field_const_i64(PC, pc_wdata, ctx->base.pc_next);
 
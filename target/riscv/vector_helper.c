@@ -21,6 +21,7 @@
 #include "exec/memop.h"
 #include "exec/exec-all.h"
 #include "exec/helper-proto.h"
+#include "exec/log_instr.h"
 #include "fpu/softfloat.h"
 #include "tcg/tcg-gvec-desc.h"
 #include "internals.h"
@@ -370,6 +371,58 @@ GEN_VEXT_ST_STRIDE(vsse_v_d, int64_t, int64_t, ste_d)
  *** unit-stride: access elements stored contiguously in memory
  */
 
+/*
+ * Copy @len contiguous bytes between guest memory at @base and the register
+ * group at @vd with plain host memcpy. This is only possible when every page
+ * touched is host RAM (no MMIO or watchpoints) and nobody needs to see the
+ * individual accesses, so the caller falls back to the element-wise loop
+ * whenever this returns false.
+ *
+ * The register layout only matches memory for a single field with no
+ * extension, and only on a little-endian host. As the vector group is at
+ * most 512 bytes, the access spans at most two pages.
+ */
+static bool vext_ldst_us_host(void *vd, target_ulong base, CPURISCVState *env,
+                              uint32_t len, uintptr_t ra,
+                              MMUAccessType access_type)
+{
+#ifdef HOST_WORDS_BIGENDIAN
+    return false;
+#else
+    int mmu_idx = cpu_mmu_index(env, false);
+    uint32_t len0 = MIN(-(base | TARGET_PAGE_MASK), len);
+    void *host0, *host1 = NULL;
+
+    if (len == 0 || qemu_log_instr_enabled(env)) {
+        return false;
+    }
+    host0 = probe_access(env, base, len0, access_type, mmu_idx, ra);
+    if (!host0) {
+        return false;
+    }
+    if (len > len0) {
+        host1 = probe_access(env, base + len0, len - len0, access_type,
+                             mmu_idx, ra);
+        if (!host1) {
+            return false;
+        }
+    }
+
+    if (access_type == MMU_DATA_LOAD) {
+        memcpy(vd, host0, len0);
+        if (host1) {
+            memcpy(vd + len0, host1, len - len0);
+        }
+    } else {
+        memcpy(host0, vd, len0);
+        if (host1) {
+            memcpy(host1, vd + len0, len - len0);
+        }
+    }
+    return true;
+#endif
+}
+
 /* unmasked unit-stride load and store operation*/
 static void
 vext_ldst_us(void *vd, target_ulong base, CPURISCVState *env, uint32_t desc,
@@ -381,15 +434,18 @@ vext_ldst_us(void *vd, target_ulong base, CPURISCVState *env, uint32_t desc,
     uint32_t nf = vext_nf(desc);
     uint32_t vlmax = vext_maxsz(desc) / esz;
 
-    /* probe every access */
-    probe_pages(env, base, env->vl * nf * msz, ra, access_type);
-    /* load bytes from guest memory */
-    for (i = 0; i < env->vl; i++) {
-        k = 0;
-        while (k < nf) {
-            target_ulong addr = base + (i * nf + k) * msz;
-            ldst_elem(env, addr, i + k * vlmax, vd, ra);
-            k++;
+    if (nf != 1 || esz != msz ||
+        !vext_ldst_us_host(vd, base, env, env->vl * msz, ra, access_type)) {
+        /* probe every access */
+        probe_pages(env, base, env->vl * nf * msz, ra, access_type);
+        /* load bytes from guest memory */
+        for (i = 0; i < env->vl; i++) {
+            k = 0;
+            while (k < nf) {
+                target_ulong addr = base + (i * nf + k) * msz;
+                ldst_elem(env, addr, i + k * vlmax, vd, ra);
+                k++;
+            }
         }
     }
     /* clear tail elements */
@@ -1627,6 +1683,35 @@ GEN_VEXT_VX(vmax_vx_h, 2, 2, clearh)
 GEN_VEXT_VX(vmax_vx_w, 4, 4, clearl)
 GEN_VEXT_VX(vmax_vx_d, 8, 8, clearq)
 
+/* Out-of-line fallbacks for the unmasked VLMAX min/max-with-scalar gvec ops */
+#define GEN_VEC_MINMAXS(NAME, TYPE, OP)                              \
+void HELPER(NAME)(void *d, void *a, uint64_t b, uint32_t desc)       \
+{                                                                    \
+    intptr_t oprsz = simd_oprsz(desc);                               \
+    intptr_t i;                                                      \
+                                                                     \
+    for (i = 0; i < oprsz; i += sizeof(TYPE)) {                      \
+        *(TYPE *)(d + i) = OP(*(TYPE *)(a + i), (TYPE)b);            \
+    }                                                                \
+}
+
+GEN_VEC_MINMAXS(vec_umins8,  uint8_t,  DO_MIN)
+GEN_VEC_MINMAXS(vec_umins16, uint16_t, DO_MIN)
+GEN_VEC_MINMAXS(vec_umins32, uint32_t, DO_MIN)
+GEN_VEC_MINMAXS(vec_umins64, uint64_t, DO_MIN)
+GEN_VEC_MINMAXS(vec_smins8,  int8_t,   DO_MIN)
+GEN_VEC_MINMAXS(vec_smins16, int16_t,  DO_MIN)
+GEN_VEC_MINMAXS(vec_smins32, int32_t,  DO_MIN)
+GEN_VEC_MINMAXS(vec_smins64, int64_t,  DO_MIN)
+GEN_VEC_MINMAXS(vec_umaxs8,  uint8_t,  DO_MAX)
+GEN_VEC_MINMAXS(vec_umaxs16, uint16_t, DO_MAX)
+GEN_VEC_MINMAXS(vec_umaxs32, uint32_t, DO_MAX)
+GEN_VEC_MINMAXS(vec_umaxs64, uint64_t, DO_MAX)
+GEN_VEC_MINMAXS(vec_smaxs8,  int8_t,   DO_MAX)
+GEN_VEC_MINMAXS(vec_smaxs16, int16_t,  DO_MAX)
+GEN_VEC_MINMAXS(vec_smaxs32, int32_t,  DO_MAX)
+GEN_VEC_MINMAXS(vec_smaxs64, int64_t,  DO_MAX)
+
 /* Vector Single-Width Integer Multiply Instructions */
 #define DO_MUL(N, M) (N * M)
 RVVCALL(OPIVV2, vmul_vv_b, OP_SSS_B, H1, H1, H1, DO_MUL)
@@ -32,6 +32,7 @@
 #include "trace/mem.h"
 #include "exec/plugin-gen.h"
 #include "exec/log_instr.h"
+#include "exec/log_instr_fast.h"
 #include "cheri_defs.h"
 
 /* Reduce the number of ifdefs below.  This assumes that all uses of
@@ -2741,6 +2742,71 @@ void tcg_gen_lookup_and_goto_ptr(void)
     }
 }
 
+void tcg_gen_lookup_and_goto_ptr_ic(const TranslationBlock *tb, TCGv dest,
+                                    unsigned kind)
+{
+    if (TCG_TARGET_HAS_goto_ptr && !qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)) {
+        TCGv_ptr ptr, site;
+        TCGv_i32 tkind;
+        TCGv tdest = dest;
+
+        plugin_gen_disable_mem_helpers();
+        ptr = tcg_temp_new_ptr();
+        site = tcg_const_ptr(tb);
+        tkind = tcg_const_i32(kind);
+        if (dest == NULL) {
+            tcg_debug_assert(kind & TB_IND_FULL_STATE);
+            tdest = tcg_const_tl(0);
+        }
+        gen_helper_lookup_tb_ptr_ic(ptr, cpu_env, site, tdest, tkind);
+        tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
+        if (dest == NULL) {
+            tcg_temp_free(tdest);
+        }
+        tcg_temp_free_i32(tkind);
+        tcg_temp_free_ptr(site);
+        tcg_temp_free_ptr(ptr);
+    } else {
+        tcg_gen_exit_tb(NULL, 0);
+    }
+}
+
+void tcg_gen_push_return_addr(const TranslationBlock *tb, target_ulong ret_pc)
+{
+    const int top_ofs = offsetof(CPUState, tb_ras_top) - offsetof(ArchCPU, env);
+    const int ras_ofs = offsetof(CPUState, tb_ras) - offsetof(ArchCPU, env);
+    TCGv_i32 top;
+    TCGv_ptr entry, site;
+    TCGv_i64 pc;
+
+    if (!TCG_TARGET_HAS_goto_ptr) {
+        /* Nothing would ever pop the entry. */
+        return;
+    }
+    QEMU_BUILD_BUG_ON(TB_RAS_SIZE & (TB_RAS_SIZE - 1));
+
+    top = tcg_temp_new_i32();
+    tcg_gen_ld_i32(top, cpu_env, top_ofs);
+    tcg_gen_addi_i32(top, top, 1);
+    tcg_gen_andi_i32(top, top, TB_RAS_SIZE - 1);
+    tcg_gen_st_i32(top, cpu_env, top_ofs);
+    tcg_gen_muli_i32(top, top, sizeof(TBReturnStackEntry));
+
+    entry = tcg_temp_new_ptr();
+    tcg_gen_ext_i32_ptr(entry, top);
+    tcg_gen_add_ptr(entry, entry, cpu_env);
+    tcg_temp_free_i32(top);
+
+    pc = tcg_const_i64(ret_pc);
+    tcg_gen_st_i64(pc, entry,
+                   ras_ofs + offsetof(TBReturnStackEntry, ret_pc));
+    tcg_temp_free_i64(pc);
+    site = tcg_const_ptr(tb);
+    tcg_gen_st_ptr(site, entry, ras_ofs + offsetof(TBReturnStackEntry, site));
+    tcg_temp_free_ptr(site);
+    tcg_temp_free_ptr(entry);
+}
+
 static inline MemOp tcg_canonicalize_memop(MemOp op, bool is64, bool st)
 {
     /* Trigger the asserts within as early as possible.  */
@@ -2903,7 +2969,9 @@ void tcg_gen_qemu_ld_i32_with_checked_addr(TCGv_i32 val, TCGv_cap_checked_ptr ad
     }
 #if defined(CONFIG_TCG_LOG_INSTR)
     TCGv_i32 tcoi = tcg_const_i32(make_memop_idx(memop, idx));
-    if (tcg_ctx_logging_enabled) {
+    if (tcg_ctx_logging_enabled &&
+        !gen_log_instr_fast_mem_i32(saved_load_addr, val,
+                                    make_memop_idx(memop, idx), false)) {
         gen_helper_qemu_log_instr_load32(cpu_env, saved_load_addr, val, tcoi);
     }
     tcg_temp_free_i32(tcoi);
@@ -2967,7 +3035,9 @@ static void tcg_gen_qemu_st_i32_with_checked_addr_cond_invalidate(
 #if defined(TARGET_CHERI) || defined(CONFIG_TCG_LOG_INSTR)
     TCGv_i32 tcoi = tcg_const_i32(make_memop_idx(memop, idx));
 #if defined(CONFIG_TCG_LOG_INSTR)
-    if (tcg_ctx_logging_enabled) {
+    if (tcg_ctx_logging_enabled &&
+        !gen_log_instr_fast_mem_i32(addr, val, make_memop_idx(memop, idx),
+                                    true)) {
         gen_helper_qemu_log_instr_store32(cpu_env, addr, val, tcoi);
     }
 #endif
@@ -3067,7 +3137,9 @@ void tcg_gen_qemu_ld_i64_with_checked_addr(TCGv_i64 val, TCGv_cap_checked_ptr ad
     }
 #if defined(CONFIG_TCG_LOG_INSTR)
     TCGv_i32 tcop = tcg_const_i32(memop);
-    if (tcg_ctx_logging_enabled) {
+    if (tcg_ctx_logging_enabled &&
+        !gen_log_instr_fast_mem(saved_load_addr, val,
+                                make_memop_idx(memop, idx), false)) {
         gen_helper_qemu_log_instr_load64(cpu_env, saved_load_addr, val, tcop);
     }
     tcg_temp_free_i32(tcop);
@@ -3126,7 +3198,8 @@ void tcg_gen_qemu_st_i64_with_checked_addr_cond_invalidate(
 #if defined(TARGET_CHERI) || defined(CONFIG_TCG_LOG_INSTR)
     TCGv_i32 tcoi = tcg_const_i32(make_memop_idx(memop, idx));
 #if defined(CONFIG_TCG_LOG_INSTR)
-    if (tcg_ctx_logging_enabled) {
+    if (tcg_ctx_logging_enabled &&
+        !gen_log_instr_fast_mem(addr, val, make_memop_idx(memop, idx), true)) {
         gen_helper_qemu_log_instr_store64(cpu_env, addr, val, tcoi);
     }
 #endif
@@ -630,6 +630,20 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
+/*
+ * Forget the contexts of the TCG threads, e.g. because they did not survive
+ * fork(), so that new threads can register. This hands their regions out
+ * again, so no code may have been translated yet.
+ */
+void tcg_region_forget_threads(void)
+{
+    qemu_mutex_lock(&region.lock);
+    qatomic_set(&n_tcg_ctxs, 0);
+    region.current = 0;
+    region.agg_size_full = 0;
+    qemu_mutex_unlock(&region.lock);
+}
+
 #ifdef CONFIG_USER_ONLY
 static size_t tcg_n_regions(void)
 {
@@ -0,0 +1,27 @@
+# SPDX-License-Identifier: GPL-2.0-or-later
+import pytest
+from pathlib import Path
+
+def abspath(x):
+    return Path(x).absolute()
+
+def pytest_addoption(parser):
+    parser.addoption("--qemu", type=abspath, required=True,
+                     help="Path to a qemu-system binary built with instruction logging")
+    parser.addoption("--expand", type=abspath, required=True,
+                     help="Path to qemu-cvtrace2-expand")
+    parser.addoption("--kernel", type=abspath, required=True,
+                     help="Guest that powers off the machine when it is done")
+    parser.addoption("--machine", default="virt")
+    parser.addoption("--bios", default="none",
+                     help="Firmware, 'none' for a bare-metal --kernel")
+    parser.addoption("--timeout", type=int, default=300)
+    parser.addoption("--min-ratio", type=float, default=5.0,
+                     help="Expected size reduction of cvtrace2 over cvtrace")
+
+
+# noinspection PyUnresolvedReferences
+def pytest_configure(config):
+    pytest.cvtrace2_qemu = config.getoption("--qemu")
+    pytest.cvtrace2_expand = config.getoption("--expand")
+    print("QEMU is", pytest.cvtrace2_qemu)
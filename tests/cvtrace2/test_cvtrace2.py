@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#
+# Round-trip test for the cvtrace2 trace backend.
+#
+# The same guest is run twice with a deterministic instruction stream
+# (-icount, single vCPU), once with -cheri-trace-backend cvtrace and once
+# with cvtrace2. The cvtrace2 trace is expanded with qemu-cvtrace2-expand
+# and must be byte-identical to the cvtrace one. The size reduction is
+# reported and compared with --min-ratio.
+#
+# Example of usage:
+#   pytest tests/cvtrace2 --qemu build/qemu-system-riscv64cheri \
+#       --expand build/contrib/trace-reader/qemu-cvtrace2-expand \
+#       --kernel test.elf
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import filecmp
+import subprocess
+from pathlib import Path
+
+import pytest
+
+
+def run_traced(request, backend: str, logfile: Path):
+    opt = request.config.getoption
+    command = [str(opt("--qemu")), "-machine", opt("--machine"),
+               "-nographic", "-monitor", "none", "-smp", "1",
+               "-icount", "shift=0,sleep=off",
+               "-bios", opt("--bios"), "-kernel", str(opt("--kernel")),
+               "-d", "instr", "-D", str(logfile),
+               "-cheri-trace-backend", backend]
+    # Timeout will fail the test
+    sp = subprocess.run(command, stdout=subprocess.PIPE,
+                        stderr=subprocess.PIPE, timeout=opt("--timeout"))
+    if sp.returncode != 0:
+        pytest.fail("QEMU failed with " + backend + ":\n" +
+                    sp.stderr.decode("utf-8", errors="replace"))
+    assert logfile.stat().st_size > 0, logfile
+
+
+@pytest.fixture
+def traces(request, tmp_path: Path):
+    cvtrace = tmp_path / "trace.cvtrace"
+    cvtrace2 = tmp_path / "trace.cvt2"
+    run_traced(request, "cvtrace", cvtrace)
+    run_traced(request, "cvtrace2", cvtrace2)
+    return cvtrace, cvtrace2
+
+
+def test_cvtrace2_roundtrip(request, traces, tmp_path: Path):
+    cvtrace, cvtrace2 = traces
+    expanded = tmp_path / "expanded.cvtrace"
+    subprocess.run([str(request.config.getoption("--expand")),
+                    str(cvtrace2), str(expanded)], check=True, timeout=600)
+    if not filecmp.cmp(str(cvtrace), str(expanded), shallow=False):
+        pytest.fail("Expanded cvtrace2 differs from cvtrace: %d vs %d bytes" %
+                    (expanded.stat().st_size, cvtrace.stat().st_size))
+
+    ratio = cvtrace.stat().st_size / cvtrace2.stat().st_size
+    min_ratio = request.config.getoption("--min-ratio")
+    print("cvtrace %d bytes, cvtrace2 %d bytes, %.1fx smaller (target %.1fx)" %
+          (cvtrace.stat().st_size, cvtrace2.stat().st_size, ratio, min_ratio))
+    assert ratio >= min_ratio
+
+
+if __name__ == "__main__":
+    pytest.main()
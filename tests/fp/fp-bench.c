@@ -33,6 +33,10 @@ enum op {
     OP_FMA,
     OP_SQRT,
     OP_CMP,
+    OP_MIN,
+    OP_MAX,
+    OP_TO_INT,
+    OP_FROM_INT,
     OP_MAX_NR,
 };
 
@@ -44,6 +48,10 @@ static const char * const op_names[] = {
     [OP_FMA] = "mulAdd",
     [OP_SQRT] = "sqrt",
     [OP_CMP] = "cmp",
+    [OP_MIN] = "min",
+    [OP_MAX] = "max",
+    [OP_TO_INT] = "toInt",
+    [OP_FROM_INT] = "fromInt",
     [OP_MAX_NR] = NULL,
 };
 
@@ -119,6 +127,7 @@ static enum op operation;
 static enum tester tester;
 static uint64_t n_completed_ops;
 static unsigned int duration = DEFAULT_DURATION_SECS;
+static bool clear_flags;
 static int64_t ns_elapsed;
 /* disable optimizations with volatile */
 static volatile union fp res;
@@ -190,6 +199,41 @@ static void fill_random(union fp *ops, int n_ops, enum precision prec,
     }
 }
 
+/*
+ * Keep the inputs to float-to-integer conversions in [1, 2^30) so that
+ * they measure actual conversions rather than the invalid (overflow) case.
+ */
+static void limit_int_range(union fp *ops, int n_ops, enum precision prec)
+{
+    int i;
+
+    for (i = 0; i < n_ops; i++) {
+        switch (prec) {
+        case PREC_SINGLE:
+        case PREC_FLOAT32:
+        {
+            uint32_t r = float32_val(ops[i].f32);
+            uint32_t exp = 127 + ((r >> 23) & 0xff) % 30;
+
+            ops[i].f32 = make_float32((r & 0x807fffff) | (exp << 23));
+            break;
+        }
+        case PREC_DOUBLE:
+        case PREC_FLOAT64:
+        {
+            uint64_t r = float64_val(ops[i].f64);
+            uint64_t exp = 1023 + ((r >> 52) & 0x7ff) % 30;
+
+            ops[i].f64 = make_float64((r & 0x800fffffffffffffULL) |
+                                      (exp << 52));
+            break;
+        }
+        default:
+            g_assert_not_reached();
+        }
+    }
+}
+
 /*
  * The main benchmark function. Instead of (ab)using macros, we rely
  * on the compiler to unfold this at compile-time.
@@ -207,11 +251,15 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
         switch (prec) {
         case PREC_SINGLE:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TO_INT) {
+                limit_int_range(ops, n_ops, prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float a = ops[0].f;
                 float b = ops[1].f;
                 float c = ops[2].f;
+                int64_t ia = (int32_t)float32_val(ops[0].f32) >> 8;
 
                 switch (op) {
                 case OP_ADD:
@@ -235,6 +283,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_MIN:
+                    res.f = fminf(a, b);
+                    break;
+                case OP_MAX:
+                    res.f = fmaxf(a, b);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = llrintf(a);
+                    break;
+                case OP_FROM_INT:
+                    res.f = ia;
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -242,11 +302,15 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_DOUBLE:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TO_INT) {
+                limit_int_range(ops, n_ops, prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 double a = ops[0].d;
                 double b = ops[1].d;
                 double c = ops[2].d;
+                int64_t ia = (int64_t)float64_val(ops[0].f64) >> 11;
 
                 switch (op) {
                 case OP_ADD:
@@ -270,6 +334,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_MIN:
+                    res.d = fmin(a, b);
+                    break;
+                case OP_MAX:
+                    res.d = fmax(a, b);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = llrint(a);
+                    break;
+                case OP_FROM_INT:
+                    res.d = ia;
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -277,12 +353,19 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_FLOAT32:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TO_INT) {
+                limit_int_range(ops, n_ops, prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float32 a = ops[0].f32;
                 float32 b = ops[1].f32;
                 float32 c = ops[2].f32;
+                int64_t ia = (int32_t)float32_val(ops[0].f32) >> 8;
 
+                if (clear_flags) {
+                    soft_status.float_exception_flags = 0;
+                }
                 switch (op) {
                 case OP_ADD:
                     res.f32 = float32_add(a, b, &soft_status);
@@ -305,6 +388,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float32_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_MIN:
+                    res.f32 = float32_minnum(a, b, &soft_status);
+                    break;
+                case OP_MAX:
+                    res.f32 = float32_maxnum(a, b, &soft_status);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = float32_to_int64(a, &soft_status);
+                    break;
+                case OP_FROM_INT:
+                    res.f32 = int64_to_float32(ia, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -312,12 +407,19 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
             break;
         case PREC_FLOAT64:
             fill_random(ops, n_ops, prec, no_neg);
+            if (op == OP_TO_INT) {
+                limit_int_range(ops, n_ops, prec);
+            }
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float64 a = ops[0].f64;
                 float64 b = ops[1].f64;
                 float64 c = ops[2].f64;
+                int64_t ia = (int64_t)float64_val(ops[0].f64) >> 11;
 
+                if (clear_flags) {
+                    soft_status.float_exception_flags = 0;
+                }
                 switch (op) {
                 case OP_ADD:
                     res.f64 = float64_add(a, b, &soft_status);
@@ -340,6 +442,18 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float64_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_MIN:
+                    res.f64 = float64_minnum(a, b, &soft_status);
+                    break;
+                case OP_MAX:
+                    res.f64 = float64_maxnum(a, b, &soft_status);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = float64_to_int64(a, &soft_status);
+                    break;
+                case OP_FROM_INT:
+                    res.f64 = int64_to_float64(ia, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -377,6 +491,10 @@ GEN_BENCH_ALL_TYPES(mul, OP_MUL, 2)
 GEN_BENCH_ALL_TYPES(div, OP_DIV, 2)
 GEN_BENCH_ALL_TYPES(fma, OP_FMA, 3)
 GEN_BENCH_ALL_TYPES(cmp, OP_CMP, 2)
+GEN_BENCH_ALL_TYPES(min, OP_MIN, 2)
+GEN_BENCH_ALL_TYPES(max, OP_MAX, 2)
+GEN_BENCH_ALL_TYPES(to_int, OP_TO_INT, 1)
+GEN_BENCH_ALL_TYPES(from_int, OP_FROM_INT, 1)
 #undef GEN_BENCH_ALL_TYPES
 
 #define GEN_BENCH_ALL_TYPES_NO_NEG(name, op, n)                         \
@@ -407,6 +525,10 @@ static const bench_func_t bench_funcs[OP_MAX_NR][PREC_MAX_NR] = {
     GEN_BENCH_FUNCS(fma, OP_FMA),
     GEN_BENCH_FUNCS(sqrt, OP_SQRT),
     GEN_BENCH_FUNCS(cmp, OP_CMP),
+    GEN_BENCH_FUNCS(min, OP_MIN),
+    GEN_BENCH_FUNCS(max, OP_MAX),
+    GEN_BENCH_FUNCS(to_int, OP_TO_INT),
+    GEN_BENCH_FUNCS(from_int, OP_FROM_INT),
 };
 
 #undef GEN_BENCH_FUNCS
@@ -440,6 +562,9 @@ static void usage_complete(int argc, char *argv[])
 
     fprintf(stderr, "Usage: %s [options]\n", argv[0]);
     fprintf(stderr, "options:\n");
+    fprintf(stderr, " -c = clear the exception flags before every operation, "
+            "as targets that\n      compute a per-instruction cause do "
+            "(soft tester only). Default: disabled\n");
     fprintf(stderr, " -d = duration, in seconds. Default: %d\n",
             DEFAULT_DURATION_SECS);
     fprintf(stderr, " -h = show this help message.\n");
@@ -541,11 +666,14 @@ static void parse_args(int argc, char *argv[])
     int rounding = ROUND_EVEN;
 
     for (;;) {
-        c = getopt(argc, argv, "d:ho:p:r:t:zZ");
+        c = getopt(argc, argv, "cd:ho:p:r:t:zZ");
         if (c < 0) {
             break;
         }
         switch (c) {
+        case 'c':
+            clear_flags = true;
+            break;
         case 'd':
             duration = atoi(optarg);
             break;
@@ -244,6 +244,16 @@ for target in $target_list; do
                -mbranch-protection=standard -o $TMPE $TMPC; then
                 echo "CROSS_CC_HAS_ARMV8_BTI=y" >> $config_target_mak
             fi
+            if do_compiler "$target_compiler" $target_compiler_cflags \
+               -march=morello+c64 -mabi=purecap -o $TMPE $TMPC; then
+                echo "CROSS_CC_HAS_MORELLO=y" >> $config_target_mak
+            fi
+        ;;
+        riscv64-*)
+            if do_compiler "$target_compiler" $target_compiler_cflags \
+               -march=rv64gcv0p7 -o $TMPE $TMPC; then
+                echo "CROSS_CC_HAS_RVV_0_7=y" >> $config_target_mak
+            fi
         ;;
     esac
 
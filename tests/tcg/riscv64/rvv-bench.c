@@ -0,0 +1,138 @@
+/*
+ * RISC-V vector (v0.7.1) microbenchmarks.
+ *
+ * Each kernel strip-mines a large array with the widest register group
+ * (e32, m8) so nearly every iteration runs at vl == VLMAX with no mask,
+ * which is the case the translator expands inline. The kernels cover
+ * unit-stride loads and stores, vector-vector adds and min/max against a
+ * scalar. Results are folded into a checksum so the work cannot be
+ * optimised away, and per-kernel timings are printed so translator
+ * changes can be compared.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ITERATIONS 2048
+#define ELEMS 4096
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t checksum(const int32_t *a, size_t n)
+{
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        sum = sum * 31 + a[i];
+    }
+    return sum;
+}
+
+/* dst[i] = src[i] (VLE.V/VSE.V) */
+static void vcopy(int32_t *dst, const int32_t *src, size_t n)
+{
+    while (n > 0) {
+        size_t vl;
+
+        asm volatile("vsetvli %0, %1, e32, m8\n\t"
+                     "vle.v v8, (%2)\n\t"
+                     "vse.v v8, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(src), "r"(dst) : "memory");
+        src += vl;
+        dst += vl;
+        n -= vl;
+    }
+}
+
+/* dst[i] = a[i] + b[i] (VADD.VV) */
+static void vadd(int32_t *dst, const int32_t *a, const int32_t *b, size_t n)
+{
+    while (n > 0) {
+        size_t vl;
+
+        asm volatile("vsetvli %0, %1, e32, m8\n\t"
+                     "vle.v v8, (%2)\n\t"
+                     "vle.v v16, (%3)\n\t"
+                     "vadd.vv v8, v8, v16\n\t"
+                     "vse.v v8, (%4)"
+                     : "=&r"(vl) : "r"(n), "r"(a), "r"(b), "r"(dst)
+                     : "memory");
+        a += vl;
+        b += vl;
+        dst += vl;
+        n -= vl;
+    }
+}
+
+/* dst[i] = clamp(src[i], lo, hi) (VMAX.VX/VMIN.VX) */
+static void vclamp(int32_t *dst, const int32_t *src, size_t n,
+                   long lo, long hi)
+{
+    while (n > 0) {
+        size_t vl;
+
+        asm volatile("vsetvli %0, %1, e32, m8\n\t"
+                     "vle.v v8, (%2)\n\t"
+                     "vmax.vx v8, v8, %4\n\t"
+                     "vmin.vx v8, v8, %5\n\t"
+                     "vse.v v8, (%3)"
+                     : "=&r"(vl) : "r"(n), "r"(src), "r"(dst),
+                       "r"(lo), "r"(hi)
+                     : "memory");
+        src += vl;
+        dst += vl;
+        n -= vl;
+    }
+}
+
+int main(void)
+{
+    int32_t *a = malloc(ELEMS * sizeof(*a));
+    int32_t *b = malloc(ELEMS * sizeof(*b));
+    int32_t *c = malloc(ELEMS * sizeof(*c));
+    double t;
+
+    assert(a && b && c);
+    for (int i = 0; i < ELEMS; i++) {
+        a[i] = i * 2654435761u;
+        b[i] = ~i;
+    }
+
+    t = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        vcopy(c, a, ELEMS);
+    }
+    printf("copy:  %8.3fs (%08x)\n", now() - t, checksum(c, ELEMS));
+
+    t = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        vadd(c, a, b, ELEMS);
+    }
+    printf("add:   %8.3fs (%08x)\n", now() - t, checksum(c, ELEMS));
+
+    t = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        vclamp(c, a, ELEMS, -(1L << 20), 1L << 20);
+    }
+    printf("clamp: %8.3fs (%08x)\n", now() - t, checksum(c, ELEMS));
+
+    for (int i = 0; i < ELEMS; i++) {
+        int32_t v = a[i] < -(1 << 20) ? -(1 << 20) : a[i];
+        assert(c[i] == (v > (1 << 20) ? (1 << 20) : v));
+    }
+
+    free(c);
+    free(b);
+    free(a);
+    return 0;
+}
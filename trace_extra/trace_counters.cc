@@ -26,6 +26,11 @@
  * @BERI_LICENSE_HEADER_END@
  */
 
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
 #include "trace_extra/trace_counters.hh"
 #include "trace_extra/guest_context_tracker.hh"
 
@@ -36,8 +41,47 @@ namespace
 {
 /*
  * Global counter state.
+ * The intern lock only protects the id map and the creation of new
+ * counters. Counters are never removed from the table, so a handle can be
+ * used without locking once it has been handed out.
+ */
+std::mutex global_intern_lock;
+std::unordered_map<qemu_counter_id, qemu_counter_handle,
+                   tuple_hasher<qemu_counter_id>>
+    global_ids;
+std::array<std::unique_ptr<qemu_counter>, QEMU_MAX_GLOBAL_COUNTERS>
+    global_table;
+
+/*
+ * Find or allocate the handle for a global counter.
+ * On success, @p interned points to the name owned by the id map, which
+ * stays valid for the lifetime of the process.
  */
-qemu_counters_state global_counters;
+boost::optional<qemu_counter_handle>
+global_counter_intern(boost::string_view name, unsigned int slot,
+                      boost::string_view *interned)
+{
+    std::lock_guard<std::mutex> lock(global_intern_lock);
+    qemu_counter_id id = std::make_tuple(name.to_string(), slot);
+    auto it = global_ids.find(id);
+    if (it == global_ids.end()) {
+        qemu_counter_handle handle = global_ids.size();
+        if (handle >= QEMU_MAX_GLOBAL_COUNTERS) {
+            static bool warned = false;
+            if (!warned) {
+                std::cerr << "Too many trace counters, dropping "
+                          << std::get<0>(id) << std::endl;
+                warned = true;
+            }
+            return boost::none;
+        }
+        global_table[handle] =
+            std::make_unique<qemu_counter>(id, 0, perfetto::Track());
+        it = global_ids.emplace(std::move(id), handle).first;
+    }
+    *interned = std::get<0>(it->first);
+    return it->second;
+}
 
 } // namespace
 
@@ -85,7 +129,7 @@ void qemu_counter::emit(int64_t sample) const
         perfetto::protos::pbzero::TrackEvent::TYPE_COUNTER, track,
         [&](perfetto::EventContext ctx) {
             auto *event = ctx.event();
-            event->set_counter_value(value);
+            event->set_counter_value(sample);
         });
 }
 
@@ -107,7 +151,7 @@ boost::optional<int64_t> qemu_counters_state::try_fetch_add(qemu_counter_id id,
     std::shared_lock<std::shared_timed_mutex> lock(mutex);
     auto it = counters.find(id);
     if (it != counters.end()) {
-        value = it->second->value.fetch_add(value);
+        value = it->second->value.fetch_add(value) + value;
         it->second->emit(value);
         return value;
     }
@@ -145,7 +189,7 @@ int64_t qemu_counters_state::inc(qemu_counter_id id, int64_t value)
             auto emplaced = counters.emplace(id, std::move(counter));
             it = emplaced.first;
         } else {
-            value = it->second->value.fetch_add(value);
+            value = it->second->value.fetch_add(value) + value;
         }
         it->second->emit(value);
         return value;
@@ -153,14 +197,74 @@ int64_t qemu_counters_state::inc(qemu_counter_id id, int64_t value)
     return result.value();
 }
 
-void global_counter_inc_emit(qemu_counter_id id, int64_t value)
+std::size_t
+qemu_counter_batch::cache_key_hasher::operator()(const cache_key &key) const
 {
-    global_counters.inc(id, value);
+    std::size_t seed = boost::hash_range(key.first.begin(), key.first.end());
+    boost::hash_combine(seed, key.second);
+    return seed;
 }
 
-void global_counter_set_emit(qemu_counter_id id, int64_t value)
+boost::optional<qemu_counter_handle>
+qemu_counter_batch::lookup(const char *name, unsigned int slot)
 {
-    global_counters.set(id, value);
+    /* The guest name buffer is not NUL terminated if it is full */
+    boost::string_view name_view(
+        name, strnlen(name, QEMU_LOG_EVENT_MAX_NAMELEN));
+    auto it = cache.find(std::make_pair(name_view, slot));
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    boost::string_view interned;
+    auto handle = global_counter_intern(name_view, slot, &interned);
+    if (handle) {
+        cache.emplace(std::make_pair(interned, slot), *handle);
+    }
+    return handle;
+}
+
+void qemu_counter_batch::record(qemu_counter_handle handle, int64_t sample)
+{
+    /* Only the most recent sample of a counter in a batch is emitted */
+    for (auto &pending : samples) {
+        if (pending.first == handle) {
+            pending.second = sample;
+            return;
+        }
+    }
+    samples.emplace_back(handle, sample);
+    if (samples.size() >= max_samples) {
+        flush();
+    }
+}
+
+void qemu_counter_batch::inc(const char *name, unsigned int slot,
+                             int64_t value)
+{
+    auto handle = lookup(name, slot);
+    if (handle) {
+        auto &counter = global_table[*handle];
+        record(*handle, counter->value.fetch_add(value) + value);
+    }
+}
+
+void qemu_counter_batch::set(const char *name, unsigned int slot,
+                             int64_t value)
+{
+    auto handle = lookup(name, slot);
+    if (handle) {
+        global_table[*handle]->value.store(value);
+        record(*handle, value);
+    }
+}
+
+void qemu_counter_batch::flush()
+{
+    for (auto &pending : samples) {
+        global_table[pending.first]->emit(pending.second);
+    }
+    samples.clear();
 }
 
 } // namespace cheri
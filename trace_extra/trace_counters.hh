@@ -34,6 +34,7 @@
 #include <unordered_map>
 #include <utility>
 #include <string>
+#include <vector>
 #include <perfetto.h>
 #include <boost/optional.hpp>
 #include <boost/utility/string_view.hpp>
@@ -107,10 +108,48 @@ class qemu_counters_state
     int64_t inc(qemu_counter_id id, int64_t value);
 };
 
-/* Increment counter and emit value to trace, for incremental counter handling
+/* Small integer id interned for each global (counter_name, counter_slot) */
+using qemu_counter_handle = unsigned int;
+
+/* Maximum number of distinct global counters */
+constexpr qemu_counter_handle QEMU_MAX_GLOBAL_COUNTERS = 4096;
+
+/*
+ * Per-CPU interface to the global counters.
+ * Global counters are interned into small integer handles the first time
+ * they are seen, and their values then live in a fixed table of atomics
+ * indexed by handle. Each CPU caches the name to handle mapping and batches
+ * the samples to emit, so the common path does not allocate and does not
+ * take any lock. Only the first sighting of a counter on a CPU goes to the
+ * shared intern table.
  */
-void global_counter_inc_emit(qemu_counter_id id, int64_t value);
-/* Set counter value and emit, for absolute counter handling */
-void global_counter_set_emit(qemu_counter_id id, int64_t value);
+class qemu_counter_batch
+{
+    using cache_key = std::pair<boost::string_view, unsigned int>;
+    struct cache_key_hasher {
+        std::size_t operator()(const cache_key &key) const;
+    };
+
+    /* Keys point to the interned counter names, which are never freed */
+    std::unordered_map<cache_key, qemu_counter_handle, cache_key_hasher> cache;
+    /* Pending (handle, sample) pairs, at most one for each handle */
+    std::vector<std::pair<qemu_counter_handle, int64_t>> samples;
+
+    boost::optional<qemu_counter_handle> lookup(const char *name,
+                                                unsigned int slot);
+    void record(qemu_counter_handle handle, int64_t sample);
+
+  public:
+    static constexpr size_t max_samples = 64;
+
+    qemu_counter_batch() { samples.reserve(max_samples); }
+
+    /* Increment counter value, creating it if needed, and queue the sample */
+    void inc(const char *name, unsigned int slot, int64_t value);
+    /* Set counter value, creating it if needed, and queue the sample */
+    void set(const char *name, unsigned int slot, int64_t value);
+    /* Emit all queued samples */
+    void flush();
+};
 
 } // namespace cheri
@@ -47,6 +47,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <fstream>
+#include <iostream>
 // #include "qemu/cpu-defs.h"
 #include "qemu/log_instr.h"
 #include "exec/log_instr_internal.h"
@@ -79,6 +80,24 @@ bool enable_interceptor = false;
 /* category strings */
 std::vector<std::string> categories;
 
+/* Default tracing session configuration */
+qemu_log_instr_perfetto_session_conf_t default_session_conf()
+{
+    qemu_log_instr_perfetto_session_conf_t conf;
+
+    conf.buffer_size_kb = 1 << 19; // 512MiB
+    conf.shm_size_kb = 1 << 15;    // 32MiB
+    conf.flush_period_ms = 5000;
+    conf.file_write_period_ms = 1000;
+    conf.ncpus = 1;
+    conf.per_cpu_buffers = false;
+    conf.fill_discard = false;
+    return conf;
+}
+
+/* Tracing session configuration */
+qemu_log_instr_perfetto_session_conf_t session_conf = default_session_conf();
+
 /* Global scheduling event track */
 std::unique_ptr<perfetto::Track> sched_track;
 
@@ -93,6 +112,8 @@ struct perfetto_backend_data {
     perfetto::Track ctrl_track;
     // Tracker that resolves the current context scheduled on a CPU
     cheri::guest_context_tracker ctx_tracker;
+    // Global counter samples emitted by this CPU
+    cheri::qemu_counter_batch counters;
     /*
      * Cached copy of the logging activation status.
      * It is easier to keep a cached copy here than exposing the loglevel_active
@@ -170,9 +191,23 @@ bool perfetto_start_tracing(void)
         DynamorioTraceInterceptor::Register(interceptor_desc);
     }
 
-    cfg.add_buffers()->set_size_kb(1 << 19); // 512MiB
-    cfg.set_flush_period_ms(5000);
-    cfg.set_file_write_period_ms(1000);
+    auto *buffer_cfg = cfg.add_buffers();
+    uint64_t buffer_size_kb = session_conf.buffer_size_kb;
+    if (session_conf.per_cpu_buffers) {
+        /*
+         * All track events come from a single data source instance, so they
+         * can not be routed to a buffer per vCPU. Size the buffer for the
+         * number of vCPUs instead.
+         */
+        buffer_size_kb *= session_conf.ncpus;
+    }
+    buffer_cfg->set_size_kb(buffer_size_kb);
+    buffer_cfg->set_fill_policy(
+        session_conf.fill_discard
+            ? perfetto::TraceConfig::BufferConfig::DISCARD
+            : perfetto::TraceConfig::BufferConfig::RING_BUFFER);
+    cfg.set_flush_period_ms(session_conf.flush_period_ms);
+    cfg.set_file_write_period_ms(session_conf.file_write_period_ms);
     fs::remove(logfile);
     cfg.set_write_into_file(true);
     cfg.set_output_path(logfile.string());
@@ -190,7 +225,7 @@ bool perfetto_start_tracing(void)
 
     auto *producer_cfg = cfg.add_producers();
     producer_cfg->set_producer_name("qemu-tcg");
-    producer_cfg->set_shm_size_kb(1 << 15); // 32MiB (the current max allowed)
+    producer_cfg->set_shm_size_kb(session_conf.shm_size_kb);
 
     session = perfetto::Tracing::NewTrace();
 
@@ -214,11 +249,47 @@ bool perfetto_start_tracing(void)
     return true;
 }
 
+/*
+ * Report trace buffer statistics, so that data loss is visible when the
+ * buffer or the producer shared memory are too small.
+ */
+void perfetto_report_trace_stats(void)
+{
+    auto args = session->GetTraceStatsBlocking();
+    perfetto::protos::gen::TraceStats stats;
+
+    if (!args.success || !stats.ParseFromArray(args.trace_stats_data.data(),
+                                               args.trace_stats_data.size())) {
+        std::cerr << "perfetto: failed to fetch trace stats" << std::endl;
+        return;
+    }
+    for (const auto &buf : stats.buffer_stats()) {
+        std::cerr << "perfetto: buffer " << (buf.buffer_size() >> 10)
+                  << "KiB written " << buf.bytes_written()
+                  << " bytes, chunks overwritten " << buf.chunks_overwritten()
+                  << " discarded " << buf.chunks_discarded()
+                  << ", overruns " << buf.write_wrap_count()
+                  << ", patches failed " << buf.patches_failed() << std::endl;
+        if (buf.chunks_overwritten() || buf.chunks_discarded() ||
+            buf.patches_failed()) {
+            std::cerr << "perfetto: trace data was lost, consider a larger "
+                         "buffer-size or smb-size in "
+                         "-cheri-trace-perfetto-config"
+                      << std::endl;
+        }
+    }
+    if (stats.chunks_discarded()) {
+        std::cerr << "perfetto: " << stats.chunks_discarded()
+                  << " chunks discarded by the service" << std::endl;
+    }
+}
+
 void perfetto_tracing_stop(void)
 {
     // NOTE: This is not sufficient for flushing the buffers, we currently
     // also need to call the buffer sync function for each CPU on the exit path.
     session->FlushBlocking();
+    perfetto_report_trace_stats();
     session->StopBlocking();
     if (enable_interceptor) {
         // add footer to tracing file
@@ -309,12 +380,11 @@ void process_marker_event(perfetto_backend_data *data, log_event_t *evt)
  */
 void process_counter_event(perfetto_backend_data *data, log_event_t *evt)
 {
-    qemu_counter_id cnt_id = std::make_tuple(
-        evt->counter.name, log_event_counter_slot(evt->counter.flags));
+    unsigned int slot = log_event_counter_slot(evt->counter.flags);
     if (log_event_counter_incremental(evt->counter.flags)) {
-        global_counter_inc_emit(cnt_id, evt->counter.value);
+        data->counters.inc(evt->counter.name, slot, evt->counter.value);
     } else {
-        global_counter_set_emit(cnt_id, evt->counter.value);
+        data->counters.set(evt->counter.name, slot, evt->counter.value);
     }
 }
 
@@ -348,6 +418,7 @@ void process_events(perfetto_backend_data *data, cpu_log_entry_handle entry)
             assert(false && "Invalid event identifier");
         }
     }
+    data->counters.flush();
 
     if (perfetto_log_entry_flags(entry) & LI_FLAG_MODE_SWITCH) {
         auto mode = cheri::qemu_cpu_mode_to_trace(
@@ -497,6 +568,23 @@ void process_instr(perfetto_backend_data *data, cpu_log_entry_handle entry)
 
 } // namespace
 
+extern "C" void qemu_log_instr_perfetto_conf_session(
+    const qemu_log_instr_perfetto_session_conf_t *conf)
+{
+    if (conf->buffer_size_kb)
+        session_conf.buffer_size_kb = conf->buffer_size_kb;
+    if (conf->shm_size_kb)
+        session_conf.shm_size_kb = conf->shm_size_kb;
+    if (conf->flush_period_ms)
+        session_conf.flush_period_ms = conf->flush_period_ms;
+    if (conf->file_write_period_ms)
+        session_conf.file_write_period_ms = conf->file_write_period_ms;
+    if (conf->ncpus)
+        session_conf.ncpus = conf->ncpus;
+    session_conf.per_cpu_buffers = conf->per_cpu_buffers;
+    session_conf.fill_discard = conf->fill_discard;
+}
+
 extern "C" void qemu_log_instr_perfetto_conf_logfile(const char *name)
 {
     logfile = name;
@@ -28,6 +28,24 @@
 
 AioWait global_aio_wait;
 
+/* Requests in flight in all AioContexts, accessed with atomic ops */
+static unsigned aio_in_flight;
+
+void aio_inc_in_flight(void)
+{
+    qatomic_inc(&aio_in_flight);
+}
+
+void aio_dec_in_flight(void)
+{
+    qatomic_dec(&aio_in_flight);
+}
+
+bool aio_any_in_flight(void)
+{
+    return qatomic_read(&aio_in_flight) != 0;
+}
+
 static void dummy_bh_cb(void *opaque)
 {
     /* The point is to make AIO_WAIT_WHILE()'s aio_poll() return */
@@ -543,6 +543,30 @@ fail:
     return NULL;
 }
 
+void aio_context_after_fork(AioContext *ctx, Error **errp)
+{
+    int ret;
+
+    /* Drop the fd monitoring instance (epoll, io_uring) of the parent */
+    aio_context_destroy(ctx);
+    aio_context_setup(ctx);
+    if (g_source_get_context(&ctx->source)) {
+        aio_context_use_g_source(ctx);
+    }
+
+    aio_set_event_notifier(ctx, &ctx->notifier, false, NULL, NULL);
+    event_notifier_cleanup(&ctx->notifier);
+    ret = event_notifier_init(&ctx->notifier, false);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Failed to initialize event notifier");
+        return;
+    }
+    aio_set_event_notifier(ctx, &ctx->notifier,
+                           false,
+                           aio_context_notifier_cb,
+                           aio_context_notifier_poll);
+}
+
 void aio_co_schedule(AioContext *ctx, Coroutine *co)
 {
     trace_aio_co_schedule(ctx, co);
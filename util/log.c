@@ -29,6 +29,8 @@
 #include "qemu/lockable.h"
 
 static char *logfilename;
+/* The filename as given to qemu_set_log_filename(), before expanding %d */
+static char *logfilename_fmt;
 static QemuMutex qemu_logfile_mutex;
 QemuLogFile *qemu_logfile;
 int qemu_loglevel;
@@ -186,6 +188,8 @@ void qemu_set_log_filename(const char *filename, Error **errp)
 {
     g_free(logfilename);
     logfilename = NULL;
+    g_free(logfilename_fmt);
+    logfilename_fmt = g_strdup(filename);
 
     if (filename) {
             char *pidstr = strstr(filename, "%");
@@ -209,6 +213,26 @@ void qemu_set_log_filename(const char *filename, Error **errp)
     }
 }
 
+/*
+ * Reopen the log file in a child process created by fork(), so that it does
+ * not write to the file of its parent. A %d in the filename is expanded with
+ * the pid of the child, otherwise the pid is appended to the filename.
+ */
+void qemu_log_reopen_after_fork(Error **errp)
+{
+    g_autofree char *filename = NULL;
+
+    if (logfilename_fmt == NULL) {
+        return;
+    }
+    if (strchr(logfilename_fmt, '%')) {
+        filename = g_strdup(logfilename_fmt);
+    } else {
+        filename = g_strdup_printf("%s.%%d", logfilename_fmt);
+    }
+    qemu_set_log_filename(filename, errp);
+}
+
 /* Returns true if addr is in our debug filter or no filter defined
  */
 bool qemu_log_in_addr_range(uint64_t addr)
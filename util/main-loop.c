@@ -173,6 +173,16 @@ int qemu_init_main_loop(Error **errp)
     return 0;
 }
 
+void qemu_main_loop_after_fork(Error **errp)
+{
+    ERRP_GUARD();
+
+    aio_context_after_fork(qemu_aio_context, errp);
+    if (!*errp) {
+        aio_context_after_fork(iohandler_get_aio_context(), errp);
+    }
+}
+
 static int max_priority;
 
 #ifndef _WIN32
@@ -517,6 +527,11 @@ void main_loop_wait(int nonblocking)
                                       timerlistgroup_deadline_ns(
                                           &main_loop_tlg));
 
+    if (!icount_enabled() && cpu_idle_warp_deadline() > 0) {
+        /* Don't sleep through idle virtual time, cpu_idle_warp skips it */
+        timeout_ns = 0;
+    }
+
     ret = os_host_main_loop_wait(timeout_ns);
     mlpoll.state = ret < 0 ? MAIN_LOOP_POLL_ERR : MAIN_LOOP_POLL_OK;
     notifier_list_notify(&main_loop_poll_notifiers, &mlpoll);
@@ -527,6 +542,9 @@ void main_loop_wait(int nonblocking)
          * missing the warp
          */
         icount_start_warp_timer();
+    } else if (ret == 0) {
+        /* No I/O completed; if the vCPUs are still idle, skip ahead */
+        cpu_idle_warp();
     }
     qemu_clock_run_all_timers();
 }
@@ -21,6 +21,7 @@
 #include "trace.h"
 #include "block/thread-pool.h"
 #include "qemu/main-loop.h"
+#include "block/aio-wait.h"
 
 static void do_spawn_thread(ThreadPool *pool);
 
@@ -195,9 +196,11 @@ restart:
             qemu_bh_cancel(pool->completion_bh);
 
             qemu_aio_unref(elem);
+            aio_dec_in_flight();
             goto restart;
         } else {
             qemu_aio_unref(elem);
+            aio_dec_in_flight();
         }
     }
     aio_context_release(pool->ctx);
@@ -253,6 +256,7 @@ BlockAIOCB *thread_pool_submit_aio(ThreadPool *pool,
     req->pool = pool;
 
     QLIST_INSERT_HEAD(&pool->head, req, all);
+    aio_inc_in_flight();
 
     trace_thread_pool_submit(pool, req, arg);
 